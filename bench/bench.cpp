@@ -0,0 +1,337 @@
+//***********************************************************************************************
+//Impromptu Modular: Modules for VCV Rack by Marc Boulé
+//
+//Headless process() benchmark: instantiates every model registered in init() against a stub
+//  context and engine (no window, no audio), drives its inputs with scripted clocks, gates and CVs,
+//  and reports the cost of process() per sample at 44.1, 48, 96 and 192 kHz.
+//See ./LICENSE.md for all licenses
+//***********************************************************************************************
+
+// Usage: bench [-s seconds] [-r sampleRate] [caseName...]
+//   -s: seconds of audio processed per case and sample rate (default 2)
+//   -r: run a single sample rate instead of the four default ones
+//   caseName: only run the cases whose name starts with one of the given names (default: all cases)
+// Columns:
+//   ns/smp: mean time of one process() call (all instances of the case together)
+//   %budget: ns/smp relative to the duration of one sample at that rate
+//   p99/max: 99th percentile and worst single process() call, these show the periodic spikes
+//     (RefreshCounter::processInputs() every 16 samples, processLights() every 256 samples)
+//   allocs: heap allocations per process() call, should be 0 on the audio thread
+
+
+#include "rack.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <functional>
+#include <cstring>
+#include <new>
+
+using namespace rack;
+
+
+// Allocation counter (all threads, only counted while a case is being timed)
+
+static std::atomic<bool> countAllocs{false};
+static std::atomic<long> numAllocs{0};
+
+void* operator new(std::size_t size) {
+	if (countAllocs.load(std::memory_order_relaxed)) {
+		numAllocs.fetch_add(1, std::memory_order_relaxed);
+	}
+	void* ptr = std::malloc(size == 0 ? 1 : size);
+	if (!ptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+void* operator new[](std::size_t size) {
+	return operator new(size);
+}
+void operator delete(void* ptr) noexcept {
+	std::free(ptr);
+}
+void operator delete[](void* ptr) noexcept {
+	std::free(ptr);
+}
+void operator delete(void* ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+void operator delete[](void* ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+
+
+
+// Scripted inputs
+
+struct InputScript {
+	// Inputs are classified by name: clocks (clock, clk, tempo), held low (reset, clear, run), gates (gate, trig),
+	//   and CVs (all others). Gates and CVs are polyphonic, clocks are monophonic.
+	float clockHz = 8.0f;// 1/16 notes at 120 BPM
+	float gateHz = 4.0f;// 1/8 notes at 120 BPM
+	int channels = 4;
+};
+
+enum InputKinds {IN_CLOCK, IN_LOW, IN_GATE, IN_CV};
+
+static int getInputKind(engine::Module* module, int inputId) {
+	std::string name = string::lowercase(module->inputInfos[inputId]->name);
+	if (name.find("reset") != std::string::npos || name.find("clear") != std::string::npos || name.find("run") != std::string::npos) {
+		return IN_LOW;
+	}
+	if (name.find("clock") != std::string::npos || name.find("clk") != std::string::npos || name.find("tempo") != std::string::npos) {
+		return IN_CLOCK;
+	}
+	if (name.find("gate") != std::string::npos || name.find("trig") != std::string::npos) {
+		return IN_GATE;
+	}
+	return IN_CV;
+}
+
+static void setInputs(engine::Module* module, const std::vector<int>& kinds, const InputScript& script, int64_t frame, float sampleRate) {
+	float t = (float)frame / sampleRate;
+	for (size_t i = 0; i < kinds.size(); i++) {
+		Input& input = module->inputs[i];
+		switch (kinds[i]) {
+			case IN_CLOCK: {
+				float ph = t * script.clockHz;
+				input.setVoltage(ph - std::floor(ph) < 0.5f ? 10.0f : 0.0f);
+			} break;
+			case IN_LOW: {
+				input.setVoltage(0.0f);
+			} break;
+			case IN_GATE: {
+				for (int c = 0; c < input.getChannels(); c++) {
+					float ph = t * script.gateHz + (float)c * 0.13f;// channels slightly staggered
+					input.setVoltage(ph - std::floor(ph) < 0.5f ? 10.0f : 0.0f, c);
+				}
+			} break;
+			default: {// CV: a new semitone every gate period, different per channel
+				int64_t n = (int64_t)(t * script.gateHz);
+				for (int c = 0; c < input.getChannels(); c++) {
+					input.setVoltage((float)((n * 7 + c * 5) % 25 - 12) / 12.0f, c);
+				}
+			} break;
+		}
+	}
+}
+
+
+
+// Cases
+
+struct BenchCase {
+	std::string name;
+	plugin::Model* model;
+	int instances;
+	InputScript script;
+	std::function<void(engine::Module*)> setup;// optional, called once after the module is created
+};
+
+static void pressRunButton(engine::Module* module, int64_t frame) {
+	// sequencers and clocks are started by pressing their Run button during the first samples
+	for (size_t p = 0; p < module->paramQuantities.size(); p++) {
+		if (module->paramQuantities[p]->name == "Run") {
+			module->params[p].setValue(frame < 64 ? 1.0f : 0.0f);
+		}
+	}
+}
+
+static plugin::Model* findModel(plugin::Plugin* plugin, const std::string& slug) {
+	for (plugin::Model* model : plugin->models) {
+		if (model->slug == slug) {
+			return model;
+		}
+	}
+	return nullptr;
+}
+
+static std::vector<BenchCase> makeCases(plugin::Plugin* plugin) {
+	std::vector<BenchCase> cases;
+
+	// every registered model, with its default settings
+	for (plugin::Model* model : plugin->models) {
+		cases.push_back(BenchCase{model->slug, model, 1, InputScript(), nullptr});
+	}
+
+	// Clocked: four chained instances, the usual way of getting more divisions, against one instance with 
+	//   its 15 poly clocks (x1 to x16 on the master clock output) 
+	plugin::Model* clocked = findModel(plugin, "Clocked");
+	if (clocked) {
+		cases.push_back(BenchCase{"Clocked-x4", clocked, 4, InputScript(), nullptr});
+		cases.push_back(BenchCase{"Clocked-poly16", clocked, 1, InputScript(), [](engine::Module* module) {
+			json_t* dataJ = module->dataToJson();
+			json_object_set_new(dataJ, "polyClocks", json_integer(1));
+			module->dataFromJson(dataJ);
+			json_decref(dataJ);
+		}});
+	}
+
+	// NoteEcho: 4 taps on 4 poly channels with dense 1/32 gates
+	plugin::Model* noteEcho = findModel(plugin, "NoteEcho");
+	if (noteEcho) {
+		InputScript script;
+		script.gateHz = 16.0f;
+		cases.push_back(BenchCase{"NoteEcho-4taps-4poly-32nd", noteEcho, 1, script, [](engine::Module* module) {
+			for (size_t p = 0; p < module->paramQuantities.size(); p++) {
+				if (module->paramQuantities[p]->name == "Input polyphony") {
+					module->params[p].setValue(4.0f);
+				}
+			}
+		}});
+	}
+
+	return cases;
+}
+
+
+
+// Timing
+
+struct BenchResult {
+	double nsPerSample;
+	double p99;
+	double max;
+	double allocsPerCall;
+};
+
+typedef std::chrono::steady_clock Clock;
+static float timerNs = 0.0f;// cost of the two Clock::now() calls around each process() call, subtracted from the timings
+
+static void calibrateTimer() {
+	std::vector<float> ns;
+	for (int i = 0; i < 10001; i++) {
+		Clock::time_point t0 = Clock::now();
+		ns.push_back(std::chrono::duration<float, std::nano>(Clock::now() - t0).count());
+	}
+	std::sort(ns.begin(), ns.end());
+	timerNs = ns[ns.size() / 2];
+}
+
+static BenchResult runCase(const BenchCase& bc, float sampleRate, float seconds) {
+
+	// create the instances
+	APP->engine->setSampleRate(sampleRate);
+	std::vector<engine::Module*> modules;
+	std::vector<std::vector<int>> kinds;
+	for (int i = 0; i < bc.instances; i++) {
+		engine::Module* module = bc.model->createModule();
+		engine::Module::SampleRateChangeEvent e;
+		e.sampleRate = sampleRate;
+		e.sampleTime = 1.0f / sampleRate;
+		module->onSampleRateChange(e);
+		if (bc.setup) {
+			bc.setup(module);
+		}
+		std::vector<int> moduleKinds;
+		for (size_t in = 0; in < module->inputs.size(); in++) {
+			int kind = getInputKind(module, in);
+			module->inputs[in].setChannels(kind == IN_CLOCK || kind == IN_LOW ? 1 : bc.script.channels);
+			moduleKinds.push_back(kind);
+		}
+		modules.push_back(module);
+		kinds.push_back(moduleKinds);
+	}
+
+	engine::Module::ProcessArgs args;
+	args.sampleRate = sampleRate;
+	args.sampleTime = 1.0f / sampleRate;
+	int64_t numFrames = (int64_t)(sampleRate * seconds);
+	std::vector<float> callNs;
+	callNs.reserve(numFrames);
+
+	// warm-up (not timed): the Run buttons are pressed, and the modules reach their running state
+	int64_t warmupFrames = (int64_t)(sampleRate * 0.1f);
+	for (int64_t f = 0; f < warmupFrames; f++) {
+		args.frame = f;
+		for (size_t i = 0; i < modules.size(); i++) {
+			setInputs(modules[i], kinds[i], bc.script, f, sampleRate);
+			pressRunButton(modules[i], f);
+		}
+		for (engine::Module* module : modules) {
+			module->process(args);
+		}
+	}
+
+	// timed: each call is timed (the inputs are set outside of the timed part), and the allocations are counted
+	numAllocs.store(0);
+	countAllocs.store(true);
+	for (int64_t f = warmupFrames; f < warmupFrames + numFrames; f++) {
+		args.frame = f;
+		for (size_t i = 0; i < modules.size(); i++) {
+			setInputs(modules[i], kinds[i], bc.script, f, sampleRate);
+		}
+		Clock::time_point t0 = Clock::now();
+		for (engine::Module* module : modules) {
+			module->process(args);
+		}
+		callNs.push_back(std::chrono::duration<float, std::nano>(Clock::now() - t0).count() - timerNs);
+	}
+	countAllocs.store(false);
+
+	for (engine::Module* module : modules) {
+		delete module;
+	}
+
+	BenchResult res;
+	double totalNs = 0.0;
+	for (float ns : callNs) {
+		totalNs += ns;
+	}
+	res.nsPerSample = totalNs / (double)numFrames;
+	res.allocsPerCall = (double)numAllocs.load() / (double)numFrames;
+	std::sort(callNs.begin(), callNs.end());
+	res.p99 = callNs[(size_t)((double)(callNs.size() - 1) * 0.99)];
+	res.max = callNs.back();
+	return res;
+}
+
+
+
+int main(int argc, char* argv[]) {
+	float seconds = 2.0f;
+	std::vector<float> sampleRates = {44100.0f, 48000.0f, 96000.0f, 192000.0f};
+	std::vector<std::string> filters;
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			seconds = std::max(0.01f, (float)std::atof(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+			sampleRates = {(float)std::atof(argv[++i])};
+		}
+		else {
+			filters.push_back(argv[i]);
+		}
+	}
+
+	// stub context: an engine that is never started, and no window
+	random::init();
+	asset::userDir = ".";// where init() reads and writes the default theme file
+	Context* context = new Context;
+	contextSet(context);
+	context->engine = new engine::Engine;
+
+	plugin::Plugin* plugin = new plugin::Plugin;
+	plugin->slug = "ImpromptuModular";
+	init(plugin);
+	calibrateTimer();
+
+	std::printf("%-28s %9s %9s %8s %9s %9s %7s\n", "case", "rate", "ns/smp", "%budget", "p99 ns", "max ns", "allocs");
+	for (const BenchCase& bc : makeCases(plugin)) {
+		if (!filters.empty() && std::none_of(filters.begin(), filters.end(), [&](const std::string& f) {return bc.name.compare(0, f.size(), f) == 0;})) {
+			continue;
+		}
+		for (float sampleRate : sampleRates) {
+			BenchResult res = runCase(bc, sampleRate, seconds);
+			std::printf("%-28s %9.0f %9.1f %7.3f%% %9.0f %9.0f %7.3f\n", bc.name.c_str(), sampleRate, res.nsPerSample,
+				res.nsPerSample * sampleRate * 1e-7, res.p99, res.max, res.allocsPerCall);
+		}
+	}
+
+	contextSet(nullptr);
+	delete context;
+	return 0;
+}
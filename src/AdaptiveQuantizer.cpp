@@ -66,8 +66,11 @@ struct AdaptiveQuantizer : Module {
 
 		
 	// Constants
-	static const int DTSIZE = 240;// should be a multiple of 60 (since there are 60 pitch matrix leds and alternate display will be done)
-	static const int EVENTS_PER_LED = DTSIZE / (12 * 5);
+	// data table sizes should be multiples of 60 (since there are 60 pitch matrix leds and alternate display will be done)
+	static const int DTSIZE_DEFAULT = 240;
+	static const int DTSIZE_MAX = 61440;
+	static const int NUM_DTSIZES = 5;
+	static constexpr float DURATION_TICK = 0.001f;// seconds per duration tick in the data table events
 	
 	// Need to save, no reset
 	int panelTheme;
@@ -78,12 +81,10 @@ struct AdaptiveQuantizer : Module {
 	bool freeze;
 	bool sampHold;
 	int resetClearsDataTable;
-	float cvOut;
+	float cvOut[PORT_MAX_CHANNELS];// polyphonic, all channels share the same weights and qdist[]
 	float chordOut[5];
-	int8_t notes[DTSIZE] = {};// contains note numbers from 0 to 11 (chromatic pitches)
-	int8_t octs[DTSIZE] = {};// contains octave number for notes
-	int8_t intervals[DTSIZE] = {};// contains intervals of notes (interval of a given note wrt the previous note)
-	float durations[DTSIZE] = {};// contains duration of gate for notes
+	int dtSize;// number of events in the data table, must call setDataTableSize() to change
+	std::vector<uint32_t> events;// packed events (note, octave, interval and duration), see packAqEvent(); allocated for DTSIZE_MAX
 	int head;// position of next note to be entered
 	bool full;
 	int intervalMode;
@@ -100,10 +101,12 @@ struct AdaptiveQuantizer : Module {
 	std::vector<WeightAndIndex> sortedWeights;// follows weights[]
 	int targets;// aka target pitches, must follow weights and numPitch, must call updateRanges() when changed, bit0 = C, bit11 = B
 	int qdist[12];// number of semitones distance (offset) in order to quantize; must follow targets
+	WindowStats winStats;// must follow data table, persistence and offset
 	long infoDataTable;// 0 when no info (i.e. just weights), positive downward step counter timer when showing data fill status
 	bool pending;
 	float pendingCv;
 	long durationCount;
+	int pendingDtSize;// 0 when no change, else the data table size requested from the menu
 
 	// No need to save, no reset
 	RefreshCounter refresh;
@@ -114,7 +117,7 @@ struct AdaptiveQuantizer : Module {
 	Trigger freezeTrigger;
 	Trigger sampHoldTrigger;
 	// Trigger sampHoldCvTrigger;
-	Trigger liveGateTrigger;
+	Trigger liveGateTriggers[PORT_MAX_CHANNELS];
 	Trigger intervalModeTrigger;
 	TriggerRiseFall refGateTrigger;
 
@@ -125,13 +128,28 @@ struct AdaptiveQuantizer : Module {
 	}
 	
 	int getPersistence() {
-		int persist = std::round(params[PERSIST_PARAM].getValue() + inputs[PERSIST_INPUT].getVoltage() * 0.1f * (float)DTSIZE);
-		return clamp(persist, 4, DTSIZE);
+		int persist = std::round(params[PERSIST_PARAM].getValue() + inputs[PERSIST_INPUT].getVoltage() * 0.1f * (float)dtSize);
+		return clamp(persist, 4, dtSize);
 	}
 	
 	int getOffset() {
-		int ofst = std::round(params[OFFSET_PARAM].getValue() + inputs[OFFSET_INPUT].getVoltage() * 0.1f * (float)DTSIZE);
-		return clamp(ofst, 0, DTSIZE);
+		int ofst = std::round(params[OFFSET_PARAM].getValue() + inputs[OFFSET_INPUT].getVoltage() * 0.1f * (float)dtSize);
+		return clamp(ofst, 0, dtSize);
+	}
+	
+	int getEventsPerLed() {
+		return dtSize / (12 * 5);
+	}
+	
+	static int getDtSizeFromIndex(int index) {// index 0 is the default size, each next size is 4 times larger
+		return DTSIZE_DEFAULT << (2 * index);
+	}
+	static int getNearestDtSize(int size) {// snaps to the nearest size offered in the menu (geometric midpoints)
+		int index = 0;
+		while (index < NUM_DTSIZES - 1 && size > getDtSizeFromIndex(index) * 2) {
+			index++;
+		}
+		return getDtSizeFromIndex(index);
 	}
 	
 	int getChordPoly() {
@@ -150,17 +168,20 @@ struct AdaptiveQuantizer : Module {
 	}
 	
 	
-	AdaptiveQuantizer() : sortedWeights(12) {
+	AdaptiveQuantizer() : events(DTSIZE_MAX, 0), sortedWeights(12) {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
 		
+		winStats.init(DTSIZE_MAX);
+		dtSize = DTSIZE_DEFAULT;
+		
 		// diplay params are: base, mult, offset
 		configParam(PITCHES_PARAM, 1.0f, 12.0f, 12.0f, "Number of pitches", "");
 		paramQuantities[PITCHES_PARAM]->snapEnabled = true;
 		configParam(OCTW_PARAM, -1.0f, 1.0f, 0.0f, "Octave weighting", " %", 0.0f, 100.0f, 0.0f);
 		configParam(DURW_PARAM, -1.0f, 1.0f, 0.0f, "Duration weighting", " %", 0.0f, 100.0f, 0.0f);
-		configParam(OFFSET_PARAM, 0.0f, (float)DTSIZE, 0.0f, "Offset", " events");
+		configParam(OFFSET_PARAM, 0.0f, (float)DTSIZE_DEFAULT, 0.0f, "Offset", " events");
 		paramQuantities[OFFSET_PARAM]->snapEnabled = true;
-		configParam(PERSIST_PARAM, 4.0f, (float)DTSIZE, (float)DTSIZE, "Persistence", " events");
+		configParam(PERSIST_PARAM, 4.0f, (float)DTSIZE_DEFAULT, (float)DTSIZE_DEFAULT, "Persistence", " events");
 		paramQuantities[PERSIST_PARAM]->snapEnabled = true;
 		configParam(RESET_PARAM, 0.0f, 1.0f, 0.0f, "Reset", "");
 		configParam(FREEZE_PARAM, 0.0f, 1.0f, 0.0f, "Freeze", "");
@@ -201,7 +222,9 @@ struct AdaptiveQuantizer : Module {
 		freeze = false;
 		sampHold = false;
 		resetClearsDataTable = 1;// 0 means not cleared, 1 means cleared, 2 means copy last n events to start of data table
-		cvOut = 0.0f;
+		for (int c = 0; c < PORT_MAX_CHANNELS; c++) {
+			cvOut[c] = 0.0f;
+		}
 		for (int i = 0; i < 5; i++) {
 			chordOut[i] = 0.0f;
 		}
@@ -211,24 +234,42 @@ struct AdaptiveQuantizer : Module {
 		resetNonJson();
 	}
 	void clearDataTable() {
-		// notes: no need to clear
-		// octs: no need to clear
-		// intervals: no need to clear
-		// duration: no need to clear
+		// events: no need to clear
 		head = 0;
 		full = false;
 	}
+	void setDataTableSize(int newDtSize) {
+		// keeps the most recent events, oldest first, and rescales the ranges of the persistence and offset knobs
+		int numEvents = full ? dtSize : head;
+		if (full) {
+			std::rotate(events.begin(), events.begin() + head, events.begin() + dtSize);// oldest event now at index 0
+		}
+		if (numEvents > newDtSize) {
+			std::copy(events.begin() + (numEvents - newDtSize), events.begin() + numEvents, events.begin());
+			numEvents = newDtSize;
+		}
+		dtSize = newDtSize;
+		full = (numEvents >= dtSize);
+		head = full ? 0 : numEvents;
+		
+		paramQuantities[OFFSET_PARAM]->maxValue = (float)dtSize;
+		paramQuantities[PERSIST_PARAM]->maxValue = (float)dtSize;
+		paramQuantities[PERSIST_PARAM]->defaultValue = (float)dtSize;
+		params[OFFSET_PARAM].setValue(std::min(params[OFFSET_PARAM].getValue(), (float)dtSize));
+		params[PERSIST_PARAM].setValue(std::min(params[PERSIST_PARAM].getValue(), (float)dtSize));
+	}
 	void resetNonJson() {
 		numPitch = getNumPitch();
 		persistence = getPersistence();
 		offset = getOffset();
 		octw = getOctw();
 		durw = getDurw();
-		updateWeights();// weights[], weightAges[], sortedWeights, targets, qdist[]
+		updateWindow();// winStats, weights[], weightAges[], sortedWeights, targets, qdist[]
 		infoDataTable = 0l;
 		pending = false;
 		pendingCv = 0.0f;
 		durationCount = 0;
+		pendingDtSize = 0;
 	}
 	
 	
@@ -238,10 +279,7 @@ struct AdaptiveQuantizer : Module {
 
 	void clearDataTableWithPriming() {
 		static const int numPrimed = 4;
-		int8_t pNotes[numPrimed];
-		int8_t pOcts[numPrimed];
-		int8_t pIntervals[numPrimed];
-		float pDurations[numPrimed];
+		uint32_t pEvents[numPrimed];
 		int actualPrimed = 0;
 		
 		// preserve numPrimed last events
@@ -249,11 +287,7 @@ struct AdaptiveQuantizer : Module {
 			if (!full && i < 0) {
 				break;
 			}
-			int dti = eucMod(i, DTSIZE);
-			pNotes[actualPrimed] = notes[dti];
-			pOcts[actualPrimed] = octs[dti];
-			pIntervals[actualPrimed] = intervals[dti];
-			pDurations[actualPrimed] = durations[dti];
+			pEvents[actualPrimed] = events[eucMod(i, dtSize)];
 			actualPrimed++;
 		}
 		
@@ -261,12 +295,11 @@ struct AdaptiveQuantizer : Module {
 		
 		// restore preserved events at start of data table
 		for (head = 0; head < actualPrimed; head++) {
-			notes[head] = pNotes[head];
-			octs[head] = pOcts[head];
-			intervals[head] = pIntervals[head];
-			durations[head] = pDurations[head];
+			events[head] = pEvents[head];
+		}
+		if (actualPrimed > 0) {
+			events[0] = packAqEvent(aqEventNote(events[0]), aqEventOct(events[0]), 0, aqEventDuration(events[0]));// interval of first event is 0
 		}
-		intervals[0] = 0;
 	}	
 		
 
@@ -292,7 +325,11 @@ struct AdaptiveQuantizer : Module {
 		json_object_set_new(rootJ, "resetClearsDataTable", json_integer(resetClearsDataTable));
 		
 		// cvOut
-		json_object_set_new(rootJ, "cvOut", json_real(cvOut));
+		json_t *cvOutJ = json_array();
+		for (int c = 0; c < PORT_MAX_CHANNELS; c++) {
+			json_array_insert_new(cvOutJ, c, json_real(cvOut[c]));
+		}
+		json_object_set_new(rootJ, "cvOut", cvOutJ);
 
 		// chordOut
 		json_t *chordOutJ = json_array();
@@ -301,33 +338,22 @@ struct AdaptiveQuantizer : Module {
 		}
 		json_object_set_new(rootJ, "chordOut", chordOutJ);
 
-		// notes
-		json_t *notesJ = json_array();
-		for (int i = 0; i < DTSIZE; i++) {
-			json_array_insert_new(notesJ, i, json_integer(notes[i]));
-		}
-		json_object_set_new(rootJ, "notes", notesJ);
+		// dtSize
+		json_object_set_new(rootJ, "dtSize", json_integer(dtSize));
 		
-		// octs
-		json_t *octsJ = json_array();
-		for (int i = 0; i < DTSIZE; i++) {
-			json_array_insert_new(octsJ, i, json_integer(octs[i]));
-		}
-		json_object_set_new(rootJ, "octs", octsJ);
-		
-		// intervals
-		json_t *intervalsJ = json_array();
-		for (int i = 0; i < DTSIZE; i++) {
-			json_array_insert_new(intervalsJ, i, json_integer(intervals[i]));
-		}
-		json_object_set_new(rootJ, "intervals", intervalsJ);
+		// persistence and offset knobs (their ranges depend on dtSize, so they are restored after dtSize in dataFromJson())
+		json_object_set_new(rootJ, "persistParam", json_real(params[PERSIST_PARAM].getValue()));
+		json_object_set_new(rootJ, "offsetParam", json_real(params[OFFSET_PARAM].getValue()));
 		
-		// durations
-		json_t *durationsJ = json_array();
-		for (int i = 0; i < DTSIZE; i++) {
-			json_array_insert_new(durationsJ, i, json_real(durations[i]));
+		// events (only the used part of the data table, as little-endian 32-bit words in a base64 string)
+		int numEvents = full ? dtSize : head;
+		std::vector<uint8_t> eventBytes(numEvents * 4);
+		for (int i = 0; i < numEvents; i++) {
+			for (int b = 0; b < 4; b++) {
+				eventBytes[i * 4 + b] = (uint8_t)(events[i] >> (8 * b));
+			}
 		}
-		json_object_set_new(rootJ, "durations", durationsJ);
+		json_object_set_new(rootJ, "events", json_string(string::toBase64(eventBytes).c_str()));
 		
 		// head
 		json_object_set_new(rootJ, "head", json_integer(head));
@@ -384,7 +410,18 @@ struct AdaptiveQuantizer : Module {
 		// cvOut
 		json_t *cvOutJ = json_object_get(rootJ, "cvOut");
 		if (cvOutJ) {
-			cvOut = json_number_value(cvOutJ);
+			if (json_is_array(cvOutJ)) {
+				for (int c = 0; c < PORT_MAX_CHANNELS; c++) {
+					json_t *cvOutArrayJ = json_array_get(cvOutJ, c);
+					if (cvOutArrayJ) {
+						cvOut[c] = json_number_value(cvOutArrayJ);
+					}
+				}
+			}
+			else {
+				// legacy monophonic cvOut
+				cvOut[0] = json_number_value(cvOutJ);
+			}
 		}
 
 		// chordOut
@@ -398,46 +435,60 @@ struct AdaptiveQuantizer : Module {
 			}
 		}
 
-		// notes
-		json_t *notesJ = json_object_get(rootJ, "notes");
-		if (notesJ && json_is_array(notesJ)) {
-			for (int i = 0; i < DTSIZE; i++) {
-				json_t *notesArrayJ = json_array_get(notesJ, i);
-				if (notesArrayJ) {
-					notes[i] = json_integer_value(notesArrayJ);
-				}
-			}
+		// dtSize (and data table cleared, since it is loaded below)
+		head = 0;
+		full = false;
+		int newDtSize = DTSIZE_DEFAULT;
+		json_t *dtSizeJ = json_object_get(rootJ, "dtSize");
+		if (dtSizeJ) {
+			newDtSize = getNearestDtSize((int)json_integer_value(dtSizeJ));
 		}
-
-		// octs
-		json_t *octsJ = json_object_get(rootJ, "octs");
-		if (octsJ && json_is_array(octsJ)) {
-			for (int i = 0; i < DTSIZE; i++) {
-				json_t *octsArrayJ = json_array_get(octsJ, i);
-				if (octsArrayJ) {
-					octs[i] = json_integer_value(octsArrayJ);
-				}
-			}
+		setDataTableSize(newDtSize);
+		
+		// persistence and offset knobs
+		json_t *persistParamJ = json_object_get(rootJ, "persistParam");
+		if (persistParamJ) {
+			params[PERSIST_PARAM].setValue(clamp((float)json_number_value(persistParamJ), 4.0f, (float)dtSize));
+		}
+		json_t *offsetParamJ = json_object_get(rootJ, "offsetParam");
+		if (offsetParamJ) {
+			params[OFFSET_PARAM].setValue(clamp((float)json_number_value(offsetParamJ), 0.0f, (float)dtSize));
 		}
 
-		// intervals
-		json_t *intervalsJ = json_object_get(rootJ, "intervals");
-		if (intervalsJ && json_is_array(intervalsJ)) {
-			for (int i = 0; i < DTSIZE; i++) {
-				json_t *intervalsArrayJ = json_array_get(intervalsJ, i);
-				if (intervalsArrayJ) {
-					intervals[i] = json_integer_value(intervalsArrayJ);
+		// events
+		int numEventsLoaded = 0;
+		json_t *eventsJ = json_object_get(rootJ, "events");
+		if (eventsJ && json_is_string(eventsJ)) {
+			std::vector<uint8_t> eventBytes = string::fromBase64(json_string_value(eventsJ));
+			numEventsLoaded = std::min((int)eventBytes.size() / 4, dtSize);
+			for (int i = 0; i < numEventsLoaded; i++) {
+				uint32_t event = 0;
+				for (int b = 0; b < 4; b++) {
+					event |= ((uint32_t)eventBytes[i * 4 + b]) << (8 * b);
 				}
+				events[i] = event;
 			}
 		}
-
-		// durations
-		json_t *durationsJ = json_object_get(rootJ, "durations");
-		if (durationsJ && json_is_array(durationsJ)) {
-			for (int i = 0; i < DTSIZE; i++) {
-				json_t *durationsArrayJ = json_array_get(durationsJ, i);
-				if (durationsArrayJ) {
-					durations[i] = json_number_value(durationsArrayJ);
+		else {
+			// legacy format: notes, octs, intervals and durations arrays, with a 240 event data table
+			json_t *notesJ = json_object_get(rootJ, "notes");
+			json_t *octsJ = json_object_get(rootJ, "octs");
+			json_t *intervalsJ = json_object_get(rootJ, "intervals");
+			json_t *durationsJ = json_object_get(rootJ, "durations");
+			if (notesJ && json_is_array(notesJ) && octsJ && json_is_array(octsJ) && 
+					intervalsJ && json_is_array(intervalsJ) && durationsJ && json_is_array(durationsJ)) {
+				for (int i = 0; i < DTSIZE_DEFAULT; i++) {
+					json_t *notesArrayJ = json_array_get(notesJ, i);
+					json_t *octsArrayJ = json_array_get(octsJ, i);
+					json_t *intervalsArrayJ = json_array_get(intervalsJ, i);
+					json_t *durationsArrayJ = json_array_get(durationsJ, i);
+					if (!notesArrayJ || !octsArrayJ || !intervalsArrayJ || !durationsArrayJ) {
+						break;
+					}
+					int durationTicks = (int)std::round(json_number_value(durationsArrayJ) / DURATION_TICK);
+					events[i] = packAqEvent(eucMod((int)json_integer_value(notesArrayJ), 12), json_integer_value(octsArrayJ), 
+											clamp((int)json_integer_value(intervalsArrayJ), -11, 11), durationTicks);
+					numEventsLoaded++;
 				}
 			}
 		}
@@ -451,8 +502,9 @@ struct AdaptiveQuantizer : Module {
 		// full
 		json_t *fullJ = json_object_get(rootJ, "full");
 		if (fullJ) {
-			full = json_is_true(fullJ);
+			full = json_is_true(fullJ) && numEventsLoaded >= dtSize;
 		}
+		head = clamp(head, 0, full ? dtSize - 1 : numEventsLoaded);
 		
 		// intervalMode
 		json_t *intervalModeJ = json_object_get(rootJ, "intervalMode");
@@ -480,6 +532,17 @@ struct AdaptiveQuantizer : Module {
 		//********** Buttons, knobs, switches and inputs **********
 		
 		if (refresh.processInputs()) {
+			// data table size (requested from menu)
+			if (pendingDtSize != 0) {
+				if (pendingDtSize != dtSize) {
+					setDataTableSize(pendingDtSize);
+					persistence = getPersistence();
+					offset = getOffset();
+					updateWindow();
+				}
+				pendingDtSize = 0;
+			}
+			
 			// freeze
 			if (freezeTrigger.process(params[FREEZE_PARAM].getValue() + inputs[FREEZE_INPUT].getVoltage())) {
 				freeze = !freeze;
@@ -523,14 +586,14 @@ struct AdaptiveQuantizer : Module {
 			int newPersistence = getPersistence();
 			if (persistence != newPersistence) {
 				persistence = newPersistence;
-				updateWeights();
+				updateWindow();
 			}
 			
 			// offset
 			int newOffset = getOffset();
 			if (offset != newOffset) {
 				offset = newOffset;
-				updateWeights();
+				updateWindow();
 			}
 			
 			// octave weighting
@@ -567,7 +630,6 @@ struct AdaptiveQuantizer : Module {
 					// falling edge
 					if (pending) {
 						enterNote(pendingCv, ((float)durationCount) * args.sampleTime);
-						updateWeights();
 						pending = false;
 						durationCount = 0;
 					}
@@ -582,7 +644,9 @@ struct AdaptiveQuantizer : Module {
 		if (resetTrigger.process(params[RESET_PARAM].getValue() + inputs[RESET_INPUT].getVoltage())) {
 			resetLight = 1.0f;
 			freeze = false;
-			cvOut = 0.0f;
+			for (int c = 0; c < PORT_MAX_CHANNELS; c++) {
+				cvOut[c] = 0.0f;
+			}
 			for (int i = 0; i < 5; i++) {
 				chordOut[i] = 0.0f;
 			}
@@ -594,31 +658,48 @@ struct AdaptiveQuantizer : Module {
 					clearDataTable();
 				}
 			}
-			updateWeights();
+			updateWindow();
 		}
 		
 		
 		
 		//********** Outputs and lights **********
 		
-		// Gate and CV outputs
-		bool liveGateRise = liveGateTrigger.process(inputs[GATE_INPUT].getVoltage());
-		if (thru) {
-			// 12TET quantizing
-			cvOut = std::round(inputs[CV_INPUT].getVoltage() * 12.0f) / 12.0f;
-		}	
-		else if (!sampHold || liveGateRise) {
-			// cvOut
-			if (targets != 0) {
+		// Gate and CV outputs (polyphonic, a mono gate applies to all cv channels)
+		int numChan = std::max(1, inputs[CV_INPUT].getChannels());
+		bool liveGateRise[PORT_MAX_CHANNELS] = {};
+		for (int c = 0; c < numChan; c++) {
+			liveGateRise[c] = liveGateTriggers[c].process(inputs[GATE_INPUT].getPolyVoltage(c));
+		}
+		for (int c = 0; c < numChan; c += 4) {
+			simd::float_4 cvIn = inputs[CV_INPUT].getVoltageSimd<simd::float_4>(c);
+			if (thru) {
+				// 12TET quantizing
+				simd::float_4 cvQuant = simd::round(cvIn * 12.0f) / 12.0f;
+				cvQuant.store(&cvOut[c]);
+			}	
+			else if (targets != 0) {
 				// AQ quantizing
-				cvOut = aqQuantize(inputs[CV_INPUT].getVoltage());
+				simd::float_4 cvQuant = aqQuantize(cvIn);
+				for (int i = 0; i < 4; i++) {
+					if (!sampHold || liveGateRise[c + i]) {
+						cvOut[c + i] = cvQuant[i];
+					}
+				}
 			}
 		}
-		outputs[GATE_OUTPUT].setVoltage(targets != 0 ? inputs[GATE_INPUT].getVoltage() : 0.0f);
-		outputs[CV_OUTPUT].setVoltage(cvOut);
+		int numGateChan = std::max(1, inputs[GATE_INPUT].getChannels());
+		for (int c = 0; c < numGateChan; c++) {
+			outputs[GATE_OUTPUT].setVoltage(targets != 0 ? inputs[GATE_INPUT].getVoltage(c) : 0.0f, c);
+		}
+		outputs[GATE_OUTPUT].setChannels(numGateChan);
+		for (int c = 0; c < numChan; c++) {
+			outputs[CV_OUTPUT].setVoltage(cvOut[c], c);
+		}
+		outputs[CV_OUTPUT].setChannels(numChan);
 		
-		// Chord output
-		if (!sampHold || liveGateRise) {
+		// Chord output (follows the gate of the first channel)
+		if (!sampHold || liveGateRise[0]) {
 			// chordOut
 			float lastOut = 0.0f;
 			for (int i = 0; i < 5; i++) {
@@ -684,16 +765,19 @@ struct AdaptiveQuantizer : Module {
 	}// process()
 	
 	
-	float aqQuantize(float inCv) {
-		float noteInFloat = inCv * 12.0f;
-		int noteIn = (int)std::round(noteInFloat);
-		int noteIn12 = eucMod(noteIn, 12);
-		int dist = qdist[noteIn12];
-		if (dist == -6 && noteInFloat > (float)noteIn) {// "greater than" is used so that perfectly equidistant 6 half-step quantizations goes low
-			dist = 6;
+	simd::float_4 aqQuantize(simd::float_4 inCv) {
+		// quantizes four channels at once, all channels use the same qdist[]
+		simd::float_4 noteInFloat = inCv * 12.0f;
+		simd::float_4 noteIn = simd::round(noteInFloat);
+		simd::float_4 noteIn12 = noteIn - 12.0f * simd::floor(noteIn / 12.0f);// eucMod, exact since noteIn is integer-valued
+		simd::float_4 dist;
+		for (int i = 0; i < 4; i++) {
+			dist[i] = (float)qdist[clamp((int)noteIn12[i], 0, 11)];// table gather
 		}
+		// "greater than" is used so that perfectly equidistant 6 half-step quantizations goes low
+		dist = simd::ifelse((dist == -6.0f) & (noteInFloat > noteIn), 6.0f, dist);
 		
-		return (float)(noteIn + dist) / 12.0f;
+		return (noteIn + dist) / 12.0f;
 	}
 	
 	
@@ -702,26 +786,46 @@ struct AdaptiveQuantizer : Module {
 		int newNote = 0;
 		int newOct = 0;
 		eucDivMod((int)std::round(cv * 12.0f), 12, &newOct, &newNote);
+		newOct = clamp(newOct, -32, 31);// range of packed events
 
 		if ((ignoreRepetitions != 0) && (full || head != 0)) {
-			int dti = eucMod(head - 1, DTSIZE);// previous event
-			if (notes[dti] == newNote && octs[dti] == newOct) {
+			uint32_t prevEvent = events[eucMod(head - 1, dtSize)];
+			if (aqEventNote(prevEvent) == newNote && aqEventOct(prevEvent) == newOct) {
 				return;// skip repeats of same note
 			}
 		}
 
-		notes[head] = newNote;
-		octs[head] = newOct;
-		intervals[head] = (!full && head == 0) ? 0 : notes[head] - notes[eucMod(head - 1, DTSIZE)];// intervals in -11 to 11
-		durations[head] = gateDuration;
+		// slide the window by one event when it does not wrap around the data table, else rebuild it after the note is entered
+		bool slideWindow = (offset + persistence <= dtSize);
+		int numEventsBefore = full ? dtSize : head;
+		if (slideWindow && (offset + persistence - 1) < numEventsBefore) {
+			// oldest event leaves the window (must be done before it is possibly overwritten below)
+			uint32_t event = events[eucMod(head - offset - persistence, dtSize)];
+			winStats.removeOldest(aqEventNote(event), aqEventOct(event), aqEventInterval(event), aqEventDuration(event));
+		}
+		
+		int newInterval = (!full && head == 0) ? 0 : newNote - aqEventNote(events[eucMod(head - 1, dtSize)]);// intervals in -11 to 11
+		int newDuration = std::max(1, (int)std::round(gateDuration / DURATION_TICK));// at least one tick, so that very short gates still count in the duration weighting
+		events[head] = packAqEvent(newNote, newOct, newInterval, newDuration);
+		
+		if (slideWindow && offset <= numEventsBefore) {
+			// youngest event enters the window (this is the new note when offset is 0)
+			uint32_t event = events[eucMod(head - offset, dtSize)];
+			winStats.addYoungest(aqEventNote(event), aqEventOct(event), aqEventInterval(event), aqEventDuration(event));
+		}
 		
 		head++;
-		if (head >= DTSIZE) {
+		if (head >= dtSize) {
 			full = true;
 			head = 0;
 		}
 		
-		updateWeights();
+		if (slideWindow) {
+			updateWeights();
+		}
+		else {
+			updateWindow();
+		}
 	}
 	
 	
@@ -746,15 +850,13 @@ struct AdaptiveQuantizer : Module {
 	
 	// optimized version (fast), hardcoded for nValue = 5.0f
 	// this is a curve fit with a degree 3 polynomial to the function above
+	static constexpr float aCoeff = 128.0f / 45.0f;
+	static constexpr float bCoeff = 32.0f / 15.0f;
+	static constexpr float cCoeff = -8.0f / 45.0f;
+	static constexpr float dCoeff = 1.0f / 5.0f;
 	float convertNormalizedToWeightingRatio(float normalized, float control) {
 		// normalized is 0.0f to 1.0f
 		// a normalized value of 0.5f should always return 1.0f, irrespective of control
-		static const float aCoeff = 128.0f / 45.0f;
-		static const float bCoeff = 32.0f / 15.0f;
-		static const float cCoeff = -8.0f / 45.0f;
-		static const float dCoeff = 1.0f / 5.0f;
-		
-		
 		if (control < 0.0) {
 			normalized = 1.0f - normalized;
 			control *= -1.0f;
@@ -764,85 +866,110 @@ struct AdaptiveQuantizer : Module {
 	}
 	
 	
-	void updateWeights() { 
-		// depends on: data table and many knobs (persistence, offset, weightings)
-		// dependants: targets
-		int numEvents = full ? DTSIZE : head;
+	double sumWeightingRatios(const uint64_t* sums, double scale, double bias, float control) {
+		// sum of convertNormalizedToWeightingRatio() over a set of values x, with normalized = x * scale + bias (0.0 to 1.0), 
+		//   given the number of values and the sums of x, x^2 and x^3 (sums[0] to sums[3])
+		// the ratio being a polynomial of degree 3 of x, its sum only depends on these sums
+		if (control < 0.0f) {
+			scale = -scale;
+			bias = 1.0 - bias;
+			control *= -1.0f;
+		}
+		double s0 = (double)sums[0];
+		double s1 = (double)sums[1];
+		double s2 = (double)sums[2];
+		double s3 = (double)sums[3];
+		double n1 = scale * s1 + bias * s0;// sum of normalized
+		double n2 = scale * scale * s2 + 2.0 * scale * bias * s1 + bias * bias * s0;// sum of normalized^2
+		double n3 = scale * scale * scale * s3 + 3.0 * scale * scale * bias * s2 + 3.0 * scale * bias * bias * s1 + bias * bias * bias * s0;// sum of normalized^3
+		double y = dCoeff * s0 + cCoeff * n1 + bCoeff * n2 + aCoeff * n3;
+		return s0 + (y - s0) * control;// crossfade(1.0f, y, control) summed over the values
+	}
+	
+	
+	void updateWindow() {
+		// depends on: data table, persistence, offset
+		// dependants: winStats, weights
+		// full rebuild of the window statistics, only needed when the window can't simply slide by one event
+		winStats.clear();
+		int numEvents = full ? dtSize : head;
 		int numPersistEvents = std::min(persistence, numEvents);
+		int numWindowEvents = 0;
+		for (; numWindowEvents < numPersistEvents; numWindowEvents++) {
+			int dti = eucMod(head - 1 - numWindowEvents - offset, dtSize);
+			if (!full && dti >= head) {
+				break;
+			}
+		}
+		for (int i = numWindowEvents - 1; i >= 0; i--) {// oldest to youngest
+			uint32_t event = events[eucMod(head - 1 - i - offset, dtSize)];
+			winStats.addYoungest(aqEventNote(event), aqEventOct(event), aqEventInterval(event), aqEventDuration(event));
+		}
 		
+		updateWeights();
+	}
+	
+	
+	void updateWeights() { 
+		// depends on: winStats and weighting knobs
+		// dependants: targets
+		// each event in the window adds the product of its octave and duration weighting ratios to the freq of its note
+		// (1.0f when no weighting); the sums are calculated from winStats for each note and octave, in constant time
+		// whatever the size of the window
 		for (int i = 0; i < 12; i++) {
-			weightAges[i] = 0;
+			weightAges[i] = winStats.getAge(i);
 		}
 		
-		if (numPersistEvents <= 0) {
-			for (int i = 0; i < 12; i++) {
-				weights[i] = 0.0f;
-			}
-		}
-		else {
-			float weightedFreq[12] = {};
-			float maxDuration = 0.0f;
-			float sumDuration = 0.0f;
-			
-			// calc duration and age statistics
-			for (int i = 0; i < numPersistEvents; i++) {
-				int dti = eucMod(head - 1 - i - offset, DTSIZE);
-				if (!full && dti >= head) {
-					break;
-				}
-				maxDuration = std::max(maxDuration, durations[dti]);
-				sumDuration += durations[dti];
-				if (weightAges[notes[dti]] == 0) {
-					weightAges[notes[dti]] = i + 1;
-				}
+		float weightedFreq[12] = {};
+		int count = winStats.getCount();
+		if (count > 0) {
+			// octave weighting
+			float octRatios[WindowStats::NUM_OCTS];
+			for (int o = 0; o < WindowStats::NUM_OCTS; o++) {
+				float normalized = ((float)o) / ((float)(WindowStats::NUM_OCTS - 1));// octaves -3 to 3
+				octRatios[o] = convertNormalizedToWeightingRatio(normalized, octw);
 			}
+			// duration weighting, durations are in ticks (the duration weighting is independent of the time unit)
+			// normalized is -1 to +1 around the average duration when symmetrical delta, then mapped to 0 to 1
+			double avgDuration = (double)winStats.getSumDuration() / (double)count;
+			double maxDeltaDuration = std::max(avgDuration, (double)winStats.getMaxDuration() - avgDuration);
+			bool durWeighting = (durw != 0.0f && maxDeltaDuration > 0.0);// all durations are 0 in some older patches
+			double durScale = durWeighting ? 0.5 / maxDeltaDuration : 0.0;
+			double durBias = 0.5 - avgDuration * durScale;
 			
-			// calc freqs
-			for (int i = 0; i < numPersistEvents; i++) {
-				int dti = eucMod(head - 1 - i - offset, DTSIZE);
-				if (!full && dti >= head) {
-					break;
-				}
-				weightedFreq[notes[dti]] += 1.0f;
-				// apply duration weighting
-				if (maxDuration > 0.0f && durw != 0.0f) {
-					// original version:
-					// float durWeightOffset = clamp(durw * (2.0f * durations[dti] / maxDuration - 1.0f), -1.0f, 1.0f);
-					// weightedFreq[notes[dti]] += durWeightOffset;
-					// new version:
-					float avgDuration = sumDuration / (float)numPersistEvents;
-					float maxDeltaDuration = std::max(avgDuration, maxDuration - avgDuration);
-					float normalized = (durations[dti] - avgDuration) / maxDeltaDuration;// range here is -1 to +1 when symmetrical delta;
-					normalized = normalized * 0.5f + 0.5f;
-					float ratio = convertNormalizedToWeightingRatio(normalized, durw);
-					weightedFreq[notes[dti]] *= ratio;
+			for (int i = 0; i < 12; i++) {
+				if (winStats.getNoteCount(i) == 0) {
+					continue;
 				}
-				// apply oct weighting
-				if (octw != 0.0f) {
-					// original version:
-					// float octWeightOffset = clamp(octw * ((float)octs[dti]) / 3.0f, -1.0f, 1.0f);
-					// weightedFreq[notes[dti]] = clamp(weightedFreq[notes[dti]] + octWeightOffset, 0.0f, 2.0f);
-					// new version:
-					float normalized = clamp( ((float)(octs[dti] + 3)) / 6.0f, 0.0f, 1.0f);
-					float ratio = convertNormalizedToWeightingRatio(normalized, octw);
-					weightedFreq[notes[dti]] *= ratio;
+				double freq = 0.0;
+				for (int o = 0; o < WindowStats::NUM_OCTS; o++) {
+					const uint64_t* sums = winStats.getDurationSums(i, o);
+					if (sums[0] != 0) {
+						double durRatioSum = (durWeighting ? sumWeightingRatios(sums, durScale, durBias, durw) : (double)sums[0]);
+						freq += (double)octRatios[o] * durRatioSum;
+					}
 				}
-			}
-
-			// calc sum and max of weighted freqs
-			// float sum = 0.0f;
-			float maxWeightedFreq = 0.0f;
-			for (int i = 0; i < 12; i++) {
-				// sum += weightedFreq[i];
-				maxWeightedFreq = std::max(maxWeightedFreq, weightedFreq[i]);
-			}
-			
-			// convert weightedFreqs to normalized weights
-			for (int i = 0; i < 12; i++) {
-				float w = (maxWeightedFreq <= 0.0f ? 0.0f : weightedFreq[i] / maxWeightedFreq);
-				weights[i] = w;
+				weightedFreq[i] = (float)freq;
 			}
 		}
+		setWeights(weightedFreq);
+	}
+	
+	
+	void setWeights(const float* weightedFreq) {
+		// calc sum and max of weighted freqs
+		// float sum = 0.0f;
+		float maxWeightedFreq = 0.0f;
+		for (int i = 0; i < 12; i++) {
+			// sum += weightedFreq[i];
+			maxWeightedFreq = std::max(maxWeightedFreq, weightedFreq[i]);
+		}
+		
+		// convert weightedFreqs to normalized weights
+		for (int i = 0; i < 12; i++) {
+			float w = (maxWeightedFreq <= 0.0f ? 0.0f : weightedFreq[i] / maxWeightedFreq);
+			weights[i] = w;
+		}
 		
 		updateTargets();
 	}
@@ -890,20 +1017,10 @@ struct AdaptiveQuantizer : Module {
 		int intervalFreq[12] = {};// only used when intervalMode == 2. intervalFreq[0] is not used, since bit number "qdi + 0" in targets will always be zero anytime the code that uses this is reached (qdi appears further below in this method). This is also not used when the datatable is empty because of a guard further below.
 		
 		if (intervalMode == 2) {
-			int numEvents = full ? DTSIZE : head;
-			int numPersistEvents = std::min(persistence, numEvents);
-			for (int i = 0; i < numPersistEvents; i++) {
-				int dti = eucMod(head - 1 - i - offset, DTSIZE);
-				if (!full && dti >= head) {
-					break;
-				}
-				
-				// count freqs of intervals
-				int intervalI = intervals[dti];// -11 to +11
-				if (intervalI == 0) continue;
-				if (intervalI < 0) intervalI += 12;// now +1 to +11
-				intervalFreq[intervalI]++;
-			}	
+			// freqs of intervals in the window
+			for (int i = 1; i < 12; i++) {
+				intervalFreq[i] = winStats.getIntervalCount(i);
+			}
 		}
 		
 		for (int qdi = 0; qdi < 12; qdi++) {
@@ -917,7 +1034,7 @@ struct AdaptiveQuantizer : Module {
 				if (intervalMode != 0 && (full || head != 0)) {
 					int interval = 0;// -11 to +11
 					if (intervalMode == 1) {
-						interval = filterIntervalToTargetPitch(qdi, intervals[eucMod(head - 1, DTSIZE)]);// -11 to +11
+						interval = filterIntervalToTargetPitch(qdi, aqEventInterval(events[eucMod(head - 1, dtSize)]));// -11 to +11
 					}
 					else {// if (intervalMode == 2) {
 						int intervalFreqI[12] = {};// a copy of intervalFreq but zero out the freq corresponding to intervalled pitches that are not in the target pitches.
@@ -1073,6 +1190,16 @@ struct AdaptiveQuantizerWidget : ModuleWidget {
 			[=]() {module->ignoreRepetitions ^= 0x1;}
 		));
 
+		menu->addChild(createSubmenuItem("Data table size", string::f("%i", module->dtSize), [=](Menu* menu) {
+			for (int i = 0; i < AdaptiveQuantizer::NUM_DTSIZES; i++) {
+				int dtSizeI = AdaptiveQuantizer::getDtSizeFromIndex(i);
+				menu->addChild(createCheckMenuItem(string::f(i == 0 ? "%i events (default)" : "%i events", dtSizeI), "",
+					[=]() {return module->dtSize == dtSizeI;},
+					[=]() {module->pendingDtSize = dtSizeI;}
+				));
+			}
+		}));	
+
 		menu->addChild(createSubmenuItem("Reset of data table", "", [=](Menu* menu) {
 			menu->addChild(createCheckMenuItem("None", "",
 				[=]() {return module->resetClearsDataTable == 0;},
@@ -1278,19 +1405,20 @@ struct AdaptiveQuantizerWidget : ModuleWidget {
 						
 			if (module->infoDataTable != 0l) {
 				// prepare data-table picture (for alternate representation i.e. data-table visual)
-				int numEvents = module->full ? AdaptiveQuantizer::DTSIZE : module->head;
+				int numEvents = module->full ? module->dtSize : module->head;
+				int eventsPerLed = module->getEventsPerLed();
 				int numPersistEvents = module->persistence;//std::min(module->persistence, numEvents);
 				int intStart = module->offset;
 				int intEnd = intStart + numPersistEvents;
 				
 				for (int i = 0; i < 12 * 5; i++) {
 					int intLedLevel = 
-						clamp((intEnd -   (i * AdaptiveQuantizer::EVENTS_PER_LED)), 0, AdaptiveQuantizer::EVENTS_PER_LED) - 
-						clamp((intStart - (i * AdaptiveQuantizer::EVENTS_PER_LED)), 0, AdaptiveQuantizer::EVENTS_PER_LED);
-					// float ledLevel = ((float)intLedLevel) / ((float)AdaptiveQuantizer::EVENTS_PER_LED);// orig
-					float ledLevel = 0.5f *((float)intLedLevel) / ((float)AdaptiveQuantizer::EVENTS_PER_LED);// new
+						clamp((intEnd -   (i * eventsPerLed)), 0, eventsPerLed) - 
+						clamp((intStart - (i * eventsPerLed)), 0, eventsPerLed);
+					// float ledLevel = ((float)intLedLevel) / ((float)eventsPerLed);// orig
+					float ledLevel = 0.5f *((float)intLedLevel) / ((float)eventsPerLed);// new
 					// if (ledLevel == 0.0f) {// orig
-						ledLevel += (i * AdaptiveQuantizer::EVENTS_PER_LED < numEvents) ? 0.5f : 0.0f;
+						ledLevel += (i * eventsPerLed < numEvents) ? 0.5f : 0.0f;
 					// }// orig
 					datapic[i] = ledLevel;
 				}
@@ -155,3 +155,145 @@ struct PitchesKnob : IMMediumKnob {
 // Other
 // ****************************************************************************
 
+// Data table events are packed in 32 bits:
+//   bits 0-3: note (0 to 11)
+//   bits 4-9: octave, offset by 32 (-32 to 31)
+//   bits 10-14: interval wrt the previous note, offset by 16 (-11 to 11)
+//   bits 16-31: gate duration in ticks (see AdaptiveQuantizer::DURATION_TICK)
+
+inline uint32_t packAqEvent(int note, int oct, int interval, int durationTicks) {
+	return  ((uint32_t)note & 0xF) | 
+			(((uint32_t)(clamp(oct, -32, 31) + 32)) << 4) | 
+			(((uint32_t)(interval + 16) & 0x1F) << 10) | 
+			(((uint32_t)clamp(durationTicks, 0, 0xFFFF)) << 16);
+}
+inline int aqEventNote(uint32_t event) {
+	return (int)(event & 0xF);
+}
+inline int aqEventOct(uint32_t event) {
+	return (int)((event >> 4) & 0x3F) - 32;
+}
+inline int aqEventInterval(uint32_t event) {
+	return (int)((event >> 10) & 0x1F) - 16;
+}
+inline int aqEventDuration(uint32_t event) {
+	return (int)(event >> 16);
+}
+
+
+struct WindowStats {
+	// Incrementally maintained statistics of the events in the active window of the data table (the window 
+	// is set by persistence and offset). Events are added from oldest to youngest, and removed from oldest to 
+	// youngest, so that sliding the window by one event when a note is entered costs O(1).
+	static const int NUM_OCTS = 7;// octaves -3 to 3 for the octave weighting, other octaves are counted in the nearest one
+	int noteCounts[12];
+	// for each note and octave: number of events, and sums of their durations, squared durations and cubed durations, 
+	// so that the duration weighting (a polynomial of the duration) can be summed over the window without scanning it; 
+	// these are exact (a cubed duration is less than 2^48, and DTSIZE_MAX of them less than 2^64) so that adding and 
+	// removing events does not accumulate rounding errors
+	uint64_t durationSums[12][NUM_OCTS][4];
+	int intervalCounts[12];// index 0 is not used (intervals of 0 are not counted), negative intervals are offset by 12
+	int64_t youngestEntries[12];// entry number of the youngest event of each note (valid only when its count is non zero)
+	int64_t sumDuration;// durations are in ticks, so adding and removing events does not accumulate rounding errors
+	int64_t numEntries;// number of events added since last clear, also the entry number of the next event
+	int count;// number of events in the window
+	// monotonic deque for the maximum duration (ring buffer of entry numbers and durations), 
+	// entry numbers are truncated to 32 bits since only equality tests are made on them
+	std::vector<uint32_t> maxDqEntries;
+	std::vector<uint16_t> maxDqDurations;
+	int maxDqHead;
+	int maxDqSize;
+	
+	void init(int capacity) {
+		// capacity must be the largest possible number of events in the window
+		maxDqEntries.resize(capacity);
+		maxDqDurations.resize(capacity);
+		clear();
+	}
+	
+	void clear() {
+		for (int i = 0; i < 12; i++) {
+			noteCounts[i] = 0;
+			intervalCounts[i] = 0;
+			youngestEntries[i] = 0;
+			for (int o = 0; o < NUM_OCTS; o++) {
+				for (int p = 0; p < 4; p++) {
+					durationSums[i][o][p] = 0;
+				}
+			}
+		}
+		sumDuration = 0;
+		numEntries = 0;
+		count = 0;
+		maxDqHead = 0;
+		maxDqSize = 0;
+	}
+	
+	void addYoungest(int note, int oct, int interval, int duration) {
+		noteCounts[note]++;
+		uint64_t* sums = durationSums[note][clamp(oct + 3, 0, NUM_OCTS - 1)];
+		uint64_t d = (uint64_t)duration;
+		sums[0]++;
+		sums[1] += d;
+		sums[2] += d * d;
+		sums[3] += d * d * d;
+		if (interval != 0) {
+			intervalCounts[interval < 0 ? interval + 12 : interval]++;
+		}
+		youngestEntries[note] = numEntries;
+		sumDuration += duration;
+		// pop smaller or equal durations from the back of the deque, then push
+		int cap = (int)maxDqEntries.size();
+		while (maxDqSize > 0 && maxDqDurations[(maxDqHead + maxDqSize - 1) % cap] <= duration) {
+			maxDqSize--;
+		}
+		int back = (maxDqHead + maxDqSize) % cap;
+		maxDqEntries[back] = (uint32_t)numEntries;
+		maxDqDurations[back] = (uint16_t)duration;
+		maxDqSize++;
+		numEntries++;
+		count++;
+	}
+	
+	void removeOldest(int note, int oct, int interval, int duration) {
+		// given event must be the oldest in the window
+		noteCounts[note]--;
+		uint64_t* sums = durationSums[note][clamp(oct + 3, 0, NUM_OCTS - 1)];
+		uint64_t d = (uint64_t)duration;
+		sums[0]--;
+		sums[1] -= d;
+		sums[2] -= d * d;
+		sums[3] -= d * d * d;
+		if (interval != 0) {
+			intervalCounts[interval < 0 ? interval + 12 : interval]--;
+		}
+		sumDuration -= duration;
+		if (maxDqSize > 0 && maxDqEntries[maxDqHead] == (uint32_t)(numEntries - count)) {
+			maxDqHead = (maxDqHead + 1) % (int)maxDqEntries.size();
+			maxDqSize--;
+		}
+		count--;
+	}
+	
+	int getCount() {
+		return count;
+	}
+	int getNoteCount(int note) {
+		return noteCounts[note];
+	}
+	const uint64_t* getDurationSums(int note, int octIndex) {// octIndex is 0 to NUM_OCTS - 1 for octaves -3 to 3
+		return durationSums[note][octIndex];
+	}
+	int getIntervalCount(int intervalPos) {// intervalPos is 1 to 11
+		return intervalCounts[intervalPos];
+	}
+	int getAge(int note) {// 0 when note is not in window, 1 when youngest event in window is this note, and so on
+		return noteCounts[note] == 0 ? 0 : (int)(numEntries - youngestEntries[note]);
+	}
+	int getMaxDuration() {
+		return maxDqSize == 0 ? 0 : maxDqDurations[maxDqHead];
+	}
+	int64_t getSumDuration() {
+		return sumDuration;
+	}
+};
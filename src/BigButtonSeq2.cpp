@@ -81,6 +81,7 @@ struct BigButtonSeq2 : Module {
 	int retrigGatesOnReset;
 	bool nextStepHits;
 	bool sampleAndHold;
+	ClockBusReader clockBusReader;// clock and reset from the clock bus instead of the cables when subscribed
 	
 	// No need to save, with reset
 	long clockIgnoreOnReset;
@@ -191,6 +192,7 @@ struct BigButtonSeq2 : Module {
 		retrigGatesOnReset = RGOR_NRUN;
 		nextStepHits = false;
 		sampleAndHold = false;
+		clockBusReader.source = -1;
 		resetNonJson();
 	}
 	void resetNonJson() {
@@ -283,6 +285,9 @@ struct BigButtonSeq2 : Module {
 		// sampleAndHold
 		json_object_set_new(rootJ, "sampleAndHold", json_boolean(sampleAndHold));
 
+		// clockBusSource
+		json_object_set_new(rootJ, "clockBusSource", json_integer(clockBusReader.source));
+
 		return rootJ;
 	}
 
@@ -394,6 +399,13 @@ struct BigButtonSeq2 : Module {
 		json_t *sampleAndHoldJ = json_object_get(rootJ, "sampleAndHold");
 		if (sampleAndHoldJ)
 			sampleAndHold = json_is_true(sampleAndHoldJ);
+
+		// clockBusSource
+		json_t *clockBusSourceJ = json_object_get(rootJ, "clockBusSource");
+		if (clockBusSourceJ) {
+			clockBusReader.source = clamp((int)json_integer_value(clockBusSourceJ), -1, ClockBus::NUM_CLOCKS - 1);
+			clockBusReader.sync();
+		}
 		
 		resetNonJson();
 	}
@@ -528,8 +540,9 @@ struct BigButtonSeq2 : Module {
 		//********** Clock and reset **********
 		
 		// Clock
+		bool busClock = clockBusReader.isSubscribed();
 		if (clockIgnoreOnReset == 0l) {			
-			if (clockTrigger.process(inputs[CLK_INPUT].getVoltage() + params[CLOCK_PARAM].getValue())) {
+			if (busClock ? clockBusReader.processClock(&clockTrigger) : clockTrigger.process(inputs[CLK_INPUT].getVoltage() + params[CLOCK_PARAM].getValue())) {
 				if ((++indexStep) >= length) indexStep = 0;
 				
 				// Fill button
@@ -561,10 +574,17 @@ struct BigButtonSeq2 : Module {
 				clockTime = 0.0;
 			}
 		}
+		else if (busClock) {
+			clockBusReader.syncClock();
+		}
 			
 		
 		// Reset
-		if (resetTrigger.process(params[RESET_PARAM].getValue() + inputs[RESET_INPUT].getVoltage())) {
+		bool resetTrigged = resetTrigger.process(params[RESET_PARAM].getValue() + (busClock ? 0.0f : inputs[RESET_INPUT].getVoltage()));
+		if (busClock && clockBusReader.processReset()) {
+			resetTrigged = true;
+		}
+		if (resetTrigged) {
 			clockIgnoreOnReset = (long) (clockIgnoreOnResetDuration * args.sampleRate);
 			indexStep = 0;
 			//outPulse.trigger(0.001f);
@@ -789,6 +809,8 @@ struct BigButtonSeq2Widget : ModuleWidget {
 
 		menu->addChild(createBoolPtrMenuItem("Big and Del on next step", "", &module->nextStepHits));
 
+		createClockBusMenu(menu, &module->clockBusReader);
+
 		menu->addChild(createSubmenuItem("Metronome light", "", [=](Menu* menu) {
 			menu->addChild(createCheckMenuItem("Every clock", "",
 				[=]() {return module->metronomeDiv == 1;},
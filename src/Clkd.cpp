@@ -11,81 +11,28 @@
 #include "ClockedCommon.hpp"
 
 
-class Clock {
-	// The -1.0 step is used as a reset state every period so that 
-	//   lengths can be re-computed; it will stay at -1.0 when a clock is inactive.
-	// a clock frame is defined as "length * iterations + syncWait", and
-	//   for master, syncWait does not apply and iterations = 1
-
+class Clock : public ClockCore {
+	// length is a period
 	
-	double step = 0.0;// -1.0 when stopped, [0 to period[ for clock steps 
-	double remainder = 0.0;
-	double length = 0.0;// period
-	double sampleTime = 0.0;
-	int iterations = 0;// run this many periods before going into sync if sub-clock
-	Clock* syncSrc = nullptr; // only subclocks will have this set to master clock
-	static constexpr double guard = 0.0005;// in seconds, region for sync to occur right before end of length of last iteration; sub clocks must be low during this period
-	bool *resetClockOutputsHigh = nullptr;
 	bool *trigOut = nullptr;
 	
 	public:
 	
-	Clock(Clock* clkGiven, bool *resetClockOutputsHighPtr, bool *trigOutPtr) {
-		syncSrc = clkGiven;
-		resetClockOutputsHigh = resetClockOutputsHighPtr;
+	Clock(Clock* clkGiven, bool *resetClockOutputsHighPtr, bool *trigOutPtr, bool *frameClockPtr) : ClockCore(clkGiven, resetClockOutputsHighPtr, frameClockPtr) {
 		trigOut = trigOutPtr;
-		reset();
-	}
-	
-	void reset(double _remainder = 0.0) {
-		step = -1.0;
-		remainder = _remainder;
-	}
-	bool isReset() {
-		return step == -1.0;
-	}
-	double getStep() {
-		return step;
-	}
-	void start() {
-		step = remainder;
 	}
 	
-	void setup(double lengthGiven, int iterationsGiven, double sampleTimeGiven) {
-		length = lengthGiven;
-		iterations = iterationsGiven;
-		sampleTime = sampleTimeGiven;
-	}
-
-	void stepClock() {// here the clock was output on step "step", this function is called near end of module::process()
-		if (step >= 0.0) {// if active clock
-			step += sampleTime;
-			if ( (syncSrc != nullptr) && (iterations == 1) && (step > (length - guard)) ) {// if in sync region
-				if (syncSrc->isReset()) {
-					reset();
-				}// else nothing needs to be done, just wait and step stays the same
-			}
-			else {
-				if (step >= length) {// reached end iteration
-					iterations--;
-					step -= length;
-					if (iterations <= 0) {
-						double newRemainder = (syncSrc == nullptr ? step : 0.0);// don't calc remainders for subclocks since they sync to master
-						reset(newRemainder);// frame done
-					}
+	int isHigh() {
+		if (*frameClock) {
+			if (!frames.isReset()) {
+				if (!frames.edgesUpToDate(*trigOut ? 1.0f : 0.0f, 0.0f)) {
+					// single pulse per period: a 1ms trigger or a 50% gate
+					frames.setEdges(*trigOut ? 0.001 : (frames.getLength() * 0.5), -1.0, -1.0, *trigOut ? 1.0f : 0.0f, 0.0f);
 				}
+				return frames.getHigh() != 0 ? 1 : 0;
 			}
 		}
-	}
-	
-	void applyNewLength(double lengthStretchFactor) {
-		if (step != -1.0)
-			step *= lengthStretchFactor;
-		length *= lengthStretchFactor;
-	}
-	
-	int isHigh() {
-		if (step >= 0.0) {
+		else if (step >= 0.0) {
 			if (*trigOut)
 				return (step <= 0.001f) ? 1 : 0;
 			return (step < (length * 0.5)) ? 1 : 0;
@@ -156,6 +103,7 @@ struct Clkd : Module {
 	bool resetClockOutputsHigh;
 	bool momentaryRunInput;// true = trigger (original rising edge only version), false = level sensitive (emulated with rising and falling detection)
 	bool forceCvOnBpmOut;
+	bool frameClock;// use the integer-frame (drift-free) clock engine
 	int displayIndex;
 	bool trigOuts[4];// output triggers when true, one for each clock output, master is index 0. 
 	float bpmInputScale;// -1.0f to 1.0f
@@ -246,9 +194,9 @@ struct Clkd : Module {
 		configBypass(BPM_INPUT, BPM_OUTPUT);
 
 		clk.reserve(4);
-		clk.push_back(Clock(nullptr, &resetClockOutputsHigh, &trigOuts[0]));
+		clk.push_back(Clock(nullptr, &resetClockOutputsHigh, &trigOuts[0], &frameClock));
 		for (int i = 1; i < 4; i++) {
-			clk.push_back(Clock(&clk[0], &resetClockOutputsHigh, &trigOuts[i]));		
+			clk.push_back(Clock(&clk[0], &resetClockOutputsHigh, &trigOuts[i], &frameClock));		
 		}
 		onReset();
 		
@@ -264,6 +212,7 @@ struct Clkd : Module {
 		resetClockOutputsHigh = true;
 		momentaryRunInput = true;
 		forceCvOnBpmOut = false;
+		frameClock = false;
 		displayIndex = 0;// show BPM (knob 0) by default
 		for (int i = 0; i < 4; i++) {
 			trigOuts[i] = false;
@@ -282,6 +231,10 @@ struct Clkd : Module {
 		}			
 	}
 	
+	void onRemove(const RemoveEvent& e) override {
+		clockBus.unpublish(id);
+	}
+	
 	void onRandomize() override {
 		resetClkd(false);
 	}
@@ -350,6 +303,9 @@ struct Clkd : Module {
 		
 		// forceCvOnBpmOut
 		json_object_set_new(rootJ, "forceCvOnBpmOut", json_boolean(forceCvOnBpmOut));
+
+		// frameClock
+		json_object_set_new(rootJ, "frameClock", json_boolean(frameClock));
 		
 		// displayIndex
 		json_object_set_new(rootJ, "displayIndex", json_integer(displayIndex));
@@ -442,6 +398,11 @@ struct Clkd : Module {
 		if (forceCvOnBpmOutJ)
 			forceCvOnBpmOut = json_is_true(forceCvOnBpmOutJ);
 
+		// frameClock
+		json_t *frameClockJ = json_object_get(rootJ, "frameClock");
+		if (frameClockJ)
+			frameClock = json_is_true(frameClockJ);
+
 		// displayIndex
 		json_t *displayIndexJ = json_object_get(rootJ, "displayIndex");
 		if (displayIndexJ)
@@ -727,19 +688,7 @@ struct Clkd : Module {
 			// Sub clocks
 			for (int i = 1; i < 4; i++) {
 				if (clk[i].isReset()) {
-					double length;
-					int iterations;
-					int ratioDoubled = ratiosDoubled[i - 1];
-					if (ratioDoubled < 0) { // if div 
-						ratioDoubled *= -1;
-						length = masterLength * ((double)ratioDoubled) / 2.0;
-						iterations = 1l + (ratioDoubled % 2);		
-					}
-					else {// mult 
-						length = (2.0f * masterLength) / ((double)ratioDoubled);
-						iterations = ratioDoubled / (2l - (ratioDoubled % 2l));							
-					}
-					clk[i].setup(length, iterations, sampleTime);
+					clk[i].setupSubClock(ratiosDoubled[i - 1], masterLength, sampleTime);
 					clk[i].start();
 				}
 				clkOutputs[i] = clk[i].isHigh() ? 10.0f : 0.0f;
@@ -754,9 +703,23 @@ struct Clkd : Module {
 		for (int i = 0; i < 4; i++) {
 			outputs[CLK_OUTPUTS + i].setVoltage(clkOutputs[i]);
 		}
-		outputs[RESET_OUTPUT].setVoltage((resetPulse.process((float)sampleTime) ? 10.0f : 0.0f));
+		bool resetOutHigh = resetPulse.process((float)sampleTime);
+		outputs[RESET_OUTPUT].setVoltage(resetOutHigh ? 10.0f : 0.0f);
 		outputs[RUN_OUTPUT].setVoltage((runPulse.process((float)sampleTime) ? 10.0f : 0.0f));
 		outputs[BPM_OUTPUT].setVoltage( (inputs[BPM_INPUT].isConnected() && !forceCvOnBpmOut) ? inputs[BPM_INPUT].getVoltage() : log2f(0.5f / masterLength));
+		
+		// clock bus (published by the clock master only)
+		if (clockMaster.id == id) {
+			bool clockHighs[4];
+			for (int i = 0; i < 4; i++) {
+				clockHighs[i] = clkOutputs[i] > 0.0f;
+			}
+			float phase = (running && !clk[0].isReset()) ? (float)(clk[0].getStep() / masterLength) : 0.0f;
+			clockBus.publish(id, clockHighs, resetOutHigh, running, phase);
+		}
+		else {
+			clockBus.unpublish(id);
+		}
 			
 		
 		// lights
@@ -910,6 +873,12 @@ struct ClkdWidget : ModuleWidget {
 
 		menu->addChild(createBoolPtrMenuItem("BPM output is CV when ext sync", "", &module->forceCvOnBpmOut));
 
+		menu->addChild(createCheckMenuItem("Drift-free clock engine (integer frames)", "",
+			[=]() {return module->frameClock;},
+			[=]() {module->frameClock = !module->frameClock;
+				   module->resetClkd(true);}
+		));
+
 		createBPMCVInputMenu(menu, &module->bpmInputScale, &module->bpmInputOffset);
 
 		menu->addChild(createSubmenuItem("Send triggers (instead of gates)", "", [=](Menu* menu) {
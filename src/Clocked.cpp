@@ -13,100 +13,66 @@
 #include "ClockedCommon.hpp"
 
 
-class Clock {
-	// The -1.0 step is used as a reset state every double-period so that 
-	//   lengths can be re-computed; it will stay at -1.0 when a clock is inactive.
-	// a clock frame is defined as "length * iterations + syncWait", and
-	//   for master, syncWait does not apply and iterations = 1
-
-	
-	double step = 0.0;// -1.0 when stopped, [0 to 2*period[ for clock steps (*2 is because of swing, so we do groups of 2 periods)
-	double remainder = 0.0;
-	double length = 0.0;// double period
-	double sampleTime = 0.0;
-	int iterations = 0;// run this many double periods before going into sync if sub-clock
-	Clock* syncSrc = nullptr; // only subclocks will have this set to master clock
-	static constexpr double guard = 0.0005;// in seconds, region for sync to occur right before end of length of last iteration; sub clocks must be low during this period
-	bool *resetClockOutputsHigh = nullptr;
-	
-	public:
-	
-	Clock(Clock* clkGiven, bool *resetClockOutputsHighPtr) {
-		syncSrc = clkGiven;
-		resetClockOutputsHigh = resetClockOutputsHighPtr;
-		reset();
-	}
+class Clock : public ClockCore {
+	// length is a double period (*2 is because of swing, so we do groups of 2 periods)
 	
-	void reset(double _remainder = 0.0) {
-		step = -1.0;
-		remainder = _remainder;
-	}
-	bool isReset() {
-		return step == -1.0;
-	}
-	double getStep() {
-		return step;
-	}
-	void start() {
-		step = remainder;
-	}
+	// edge schedule of the double period, only recalculated when the length or the pulse shape changes
+	double edgeP2 = 0.0;
+	double edgeP3 = 0.0;
+	double edgeP4 = 0.0;
+	double edgeLength = -1.0;// length that the edges were computed for, -1.0 when never computed
+	float edgeSwing = 0.0f;
+	float edgePulseWidth = 0.0f;
 	
-	void setup(double lengthGiven, int iterationsGiven, double sampleTimeGiven) {
-		length = lengthGiven;
-		iterations = iterationsGiven;
-		sampleTime = sampleTimeGiven;
-	}
-
-	void stepClock() {// here the clock was output on step "step", this function is called near end of module::process()
-		if (step >= 0.0) {// if active clock
-			step += sampleTime;
-			if ( (syncSrc != nullptr) && (iterations == 1) && (step > (length - guard)) ) {// if in sync region
-				if (syncSrc->isReset()) {
-					reset();
-				}// else nothing needs to be done, just wait and step stays the same
-			}
-			else {
-				if (step >= length) {// reached end iteration
-					iterations--;
-					step -= length;
-					if (iterations <= 0) {
-						double newRemainder = (syncSrc == nullptr ? step : 0.0);// don't calc remainders for subclocks since they sync to master
-						reset(newRemainder);// frame done
-					}
-				}
-			}
+	static void calcEdges(double lengthGiven, float swingParam, float pulseWidth, double* p2, double* p3, double* p4) {
+		// last 0.5ms (guard time) must be low so that sync mechanism will work properly (i.e. no missed pulses)
+		//   this will automatically be the case, since code below disallows any pulses or inter-pulse times less than 1ms
+		// all following values are in seconds
+		float onems = 0.001f;
+		float period = (float)lengthGiven / 2.0f;
+		float swing = (period - 2.0f * onems) * swingParam;// swingParam is [-1 : 1]
+		float p2min = onems;
+		float p2max = period - onems - std::fabs(swing);
+		if (p2max < p2min) {
+			p2max = p2min;
 		}
+		
+		//double p1 = 0.0;// implicit, no need 
+		*p2 = (double)((p2max - p2min) * pulseWidth + p2min);// pulseWidth is [0 : 1]
+		*p3 = (double)(period + swing);
+		*p4 = ((double)(period + swing)) + *p2;
 	}
 	
-	void applyNewLength(double lengthStretchFactor) {
-		if (step != -1.0)
-			step *= lengthStretchFactor;
-		length *= lengthStretchFactor;
+	public:
+	
+	Clock(Clock* clkGiven, bool *resetClockOutputsHighPtr, bool *frameClockPtr) : ClockCore(clkGiven, resetClockOutputsHighPtr, frameClockPtr) {
 	}
 	
 	int isHigh(float swingParam, float pulseWidth) {
-		// last 0.5ms (guard time) must be low so that sync mechanism will work properly (i.e. no missed pulses)
-		//   this will automatically be the case, since code below disallows any pulses or inter-pulse times less than 1ms
 		int high = 0;
-		if (step >= 0.0) {
-			// all following values are in seconds
-			float onems = 0.001f;
-			float period = (float)length / 2.0f;
-			float swing = (period - 2.0f * onems) * swingParam;// swingParam is [-1 : 1]
-			float p2min = onems;
-			float p2max = period - onems - std::fabs(swing);
-			if (p2max < p2min) {
-				p2max = p2min;
+		if (*frameClock) {
+			if (!frames.isReset()) {
+				if (!frames.edgesUpToDate(swingParam, pulseWidth)) {
+					double p2, p3, p4;
+					calcEdges(frames.getLength(), swingParam, pulseWidth, &p2, &p3, &p4);
+					frames.setEdges(p2, p3, p4, swingParam, pulseWidth);
+				}
+				high = frames.getHigh();
+			}
+			else if (*resetClockOutputsHigh)
+				high = 1;
+		}
+		else if (step >= 0.0) {
+			if (length != edgeLength || swingParam != edgeSwing || pulseWidth != edgePulseWidth) {
+				calcEdges(length, swingParam, pulseWidth, &edgeP2, &edgeP3, &edgeP4);
+				edgeLength = length;
+				edgeSwing = swingParam;
+				edgePulseWidth = pulseWidth;
 			}
 			
-			//double p1 = 0.0;// implicit, no need 
-			double p2 = (double)((p2max - p2min) * pulseWidth + p2min);// pulseWidth is [0 : 1]
-			double p3 = (double)(period + swing);
-			double p4 = ((double)(period + swing)) + p2;
-			
-			if (step <= p2)
+			if (step <= edgeP2)
 				high = 1;
-			else if ((step >= p3) && (step <= p4))
+			else if ((step >= edgeP3) && (step <= edgeP4))
 				high = 2;
 		}
 		else if (*resetClockOutputsHigh)
@@ -119,75 +85,6 @@ class Clock {
 //*****************************************************************************
 
 
-class ClockDelay {
-	long stepCounter;
-	int lastWriteValue;
-	bool readState;
-	long stepRise1;
-	long stepFall1;
-	long stepRise2;
-	long stepFall2;
-	
-	public:
-	
-	ClockDelay() {
-		reset(true);
-	}
-	
-	void setup() {
-	}
-	
-	void reset(bool resetClockOutputsHigh) {
-		stepCounter = 0l;
-		lastWriteValue = 0;
-		readState = resetClockOutputsHigh;
-		stepRise1 = 0l;
-		stepFall1 = 0l;
-		stepRise2 = 0l;
-		stepFall2 = 0l;
-	}
-	
-	void write(int value) {
-		if (value == 1) {// first pulse is high
-			if (lastWriteValue == 0) // if got rise 1
-				stepRise1 = stepCounter;
-		}
-		else if (value == 2) {// second pulse is high
-			if (lastWriteValue == 0) // if got rise 2
-				stepRise2 = stepCounter;
-		}
-		else {// value = 0 (pulse is low)
-			if (lastWriteValue == 1) // if got fall 1
-				stepFall1 = stepCounter;
-			else if (lastWriteValue == 2) // if got fall 2
-				stepFall2 = stepCounter;
-		}
-		
-		lastWriteValue = value;
-	}
-	
-	bool read(long delaySamples) {
-		long delayedStepCounter = stepCounter - delaySamples;
-		if (delayedStepCounter == stepRise1 || delayedStepCounter == stepRise2)
-			readState = true;
-		else if (delayedStepCounter == stepFall1 || delayedStepCounter == stepFall2)
-			readState = false;
-		stepCounter++;
-		if (stepCounter > 1e8) {// keep within long's bounds (could go higher or could allow negative)
-			stepCounter -= 1e8;// 192000 samp/s * 2s * 64 * (3/4) = 18.4 Msamp
-			stepRise1 -= 1e8;
-			stepFall1 -= 1e8;
-			stepRise2 -= 1e8;
-			stepFall2 -= 1e8;
-		}
-		return readState;
-	}
-};
-
-
-//*****************************************************************************
-
-
 struct Clocked : Module {
 	
 	struct BpmParam : ParamQuantity {
@@ -239,6 +136,75 @@ struct Clocked : Module {
 	static constexpr float masterLengthMax = 120.0f / bpmMin;// a length is a double period
 	static constexpr float masterLengthMin = 120.0f / bpmMax;// a length is a double period
 	static constexpr float delayInfoTime = 3.0f;// seconds
+	static const int maxTempoChanges = 64;
+	static const int numPolyClocks = 15;// channels 2 to 16 of the master clock output in poly clocks mode, channel 1 is the master clock
+	static const int maxClocks = 4 + numPolyClocks;// the poly clocks are after the master and the three sub-clocks
+	enum PolyClocksIds {POLY_OFF, POLY_MULT, POLY_DIV};
+	static const double pllGains[3];// low, medium and high bandwidth
+	
+	
+	struct TempoChange {
+		int bar;// 0 is the first bar
+		float bpm;
+	};
+	
+	enum TempoMapEditIds {TM_ADD, TM_DELETE, TM_CLEAR};
+	struct TempoMapEdit {
+		int type;// TM_ADD, TM_DELETE (the change at bar) or TM_CLEAR
+		int bar;
+		float bpm;
+	};
+	
+	struct TempoMap {
+		TempoChange changes[maxTempoChanges];// sorted by bar, no two changes on the same bar
+		int size;
+		
+		void add(int bar, float bpm) {
+			int i = 0;
+			while (i < size && changes[i].bar < bar) {
+				i++;
+			}
+			if (i >= size || changes[i].bar != bar) {
+				if (size >= maxTempoChanges) {
+					return;
+				}
+				for (int j = size; j > i; j--) {
+					changes[j] = changes[j - 1];
+				}
+				size++;
+			}
+			changes[i].bar = bar;
+			changes[i].bpm = clamp(bpm, (float)bpmMin, (float)bpmMax);
+		}
+		
+		void remove(int bar) {
+			int i = 0;
+			while (i < size && changes[i].bar != bar) {
+				i++;
+			}
+			if (i >= size) {
+				return;
+			}
+			for (int j = i; j < size - 1; j++) {
+				changes[j] = changes[j + 1];
+			}
+			size--;
+		}
+		
+		void apply(const TempoMapEdit& edit) {
+			if (edit.type == TM_ADD) {
+				add(edit.bar, edit.bpm);
+			}
+			else if (edit.type == TM_DELETE) {
+				remove(edit.bar);
+			}
+			else {
+				size = 0;
+			}
+		}
+	};
+	
+	static const int maxTempoMapEdits = 16;
 	
 	
 	// Need to save, no reset
@@ -254,18 +220,28 @@ struct Clocked : Module {
 	bool resetClockOutputsHigh;
 	bool momentaryRunInput;// true = trigger (original rising edge only version), false = level sensitive (emulated with rising and falling detection)
 	bool forceCvOnBpmOut;
+	bool frameClock;// use the integer-frame (drift-free) clock engine
 	float bpmInputScale;// -1.0f to 1.0f
 	float bpmInputOffset;// -10.0f to 10.0f
+	bool tempoMapActive;// when true and no BPM input, the tempo map sets the BPM from the first change onwards
+	int beatsPerBar;
+	bool songPosOnBpmOut;// when true, the BPM output is polyphonic with the bar and the beat in channels 2 and 3
+	TempoMap tempoMap;// only edited by the engine thread (and when it is not processing the module), see requestTempoMapEdit()
+	bool pllMode;// when true, BPM detection follows the external clock with a phase-locked loop
+	int pllBandwidth;// 0 = low, 1 = medium, 2 = high
+	int polyClocks;// POLY_OFF, or POLY_MULT (channel c of the master clock output is x c) or POLY_DIV (channel c is ÷c)
 
 	// No need to save, with reset
 	long editingBpmMode;// 0 when no edit bpmMode, downward step counter timer when edit, negative upward when show can't edit ("--") 
 	double sampleRate;
 	double sampleTime;
-	std::vector<Clock> clk;// size 4
+	std::vector<Clock> clk;// size maxClocks
+	int numClocks;// 4, or maxClocks when the poly clocks are running
+	int polyClocksRunning;// polyClocks that the running poly clocks were set up with, only changes when the master clock restarts
 	ClockDelay delay[3];// only channels 1 to 3 have delay
 	float bufferedRatioKnobs[4];// 0 = mast bpm knob, 1..3 is ratio knobs
 	bool syncRatios[4];// 0 index unused
-	int ratiosDoubled[4];// 0 index unused
+	int ratiosDoubled[maxClocks];// 0 index unused
 	int extPulseNumber;// 0 to ppqn * 2 - 1
 	double extIntervalTime;// also used for auto mode change to P24 (2nd use of this member variable)
 	double timeoutTime;
@@ -274,13 +250,27 @@ struct Clocked : Module {
 	long delaySamples[4];
 	float newMasterLength;
 	float masterLength;
-	float clkOutputs[4];
+	float clkOutputs[maxClocks];
+	int64_t songPeriods;// number of master double periods started since reset
+	int64_t songBeatOffset;// beat of the song position at reset (when seeking)
+	long songBar;
+	long tempoMapBar;// bar for which tempoMapBpm was looked up, -1 to force a new lookup
+	float tempoMapBpm;// 0.0f when the tempo map has no change at or before tempoMapBar
+	double pllLength;// estimated double period of the external clock, 0.0 when not yet measured
+	double pllPulseTime;// time since the last external clock pulse
+	int pllPulses;// number of external clock pulses since reset
+	bool pllLocked;
 	
 	// No need to save, no reset
+	TempoMapEdit tempoMapEdits[maxTempoMapEdits];// ring buffer of the tempo map edits requested from the menu
+	std::atomic<uint32_t> tempoMapEditsRequested{0};// written by the UI thread
+	std::atomic<uint32_t> tempoMapEditsDone{0};// written by the engine thread
+	std::atomic<uint32_t> tempoMapSeq{0};// odd while the engine thread edits the tempo map
 	bool scheduledReset = false;
 	int notifyingSource[4] = {-1, -1, -1, -1};
 	long notifyInfo[4] = {0l, 0l, 0l, 0l};// downward step counter when swing to be displayed, 0 when normal display
 	long cantRunWarning = 0l;// 0 when no warning, positive downward step counter timer when warning
+	long pllUnlockedFlash = 0l;// downward step counter for flashing the BPM light when the PLL is not locked
 	RefreshCounter refresh;
 	float resetLight = 0.0f;
 	Trigger resetTrigger;
@@ -311,6 +301,17 @@ struct Clocked : Module {
 		return ret;
 	}
 	
+	void setupPolyClocks() {
+		// poly clock i is x(i+2) or ÷(i+2), channel 1 of the poly output being the master clock itself
+		polyClocksRunning = polyClocks;
+		numClocks = (polyClocksRunning == POLY_OFF ? 4 : maxClocks);
+		for (int i = 4; i < maxClocks; i++) {
+			clk[i].reset();
+			ratiosDoubled[i] = (i - 2) * (polyClocksRunning == POLY_DIV ? -2 : 2);
+			clkOutputs[i] = resetClockOutputsHigh ? 10.0f : 0.0f;
+		}
+	}
+	
 	void updatePulseSwingDelay() {
 		bool expanderPresent = (rightExpander.module && rightExpander.module->model == modelClockedExpander);
 		const float *messagesFromExpander = static_cast<float*>(rightExpander.consumerMessage);// could be invalid pointer when !expanderPresent, so read it only when expanderPresent
@@ -341,6 +342,129 @@ struct Clocked : Module {
 			delaySamples[i] = (long)(masterLength * delayFraction * sampleRate / (ratioValue * 2.0));
 		}				
 	}
+	
+	double getSongBeats() {
+		// a double period is two beats, and the master clock is reset for one sample at the end of each double period
+		if (songPeriods <= 0) {
+			return (double)songBeatOffset;
+		}
+		double phase = clk[0].isReset() ? 1.0 : (clk[0].getStep() / masterLength);
+		return (double)songBeatOffset + 2.0 * ((double)(songPeriods - 1) + phase);
+	}
+	
+	float lookupTempoMap(long bar) {
+		float bpm = 0.0f;
+		for (int i = 0; i < tempoMap.size && tempoMap.changes[i].bar <= bar; i++) {
+			bpm = tempoMap.changes[i].bpm;
+		}
+		return bpm;
+	}
+	
+	float getInternalBpm() {// BPM when the BPM input is not connected
+		if (tempoMapActive && tempoMapBpm > 0.0f) {
+			return tempoMapBpm;
+		}
+		return bufferedRatioKnobs[0];
+	}
+	
+	float processPllPulse() {
+		// Phase-locked loop follower for BPM detection, called on each external clock pulse when running: the estimated 
+		//   double period only moves by a fraction of each measured pulse interval, and the phase error of the master clock 
+		//   at the pulse is corrected with a small length offset, so that a jittery external clock does not re-plan the 
+		//   clocks on every pulse. Full gain is used during the first ppqn cycle to acquire the tempo.
+		// returns the new master length
+		pllPulses++;
+		double measuredLength = pllPulseTime * (double)(ppqn * 2);
+		pllPulseTime = 0.0;
+		if (pllPulses < 2) {
+			return masterLength;// first pulse starts the clocks, no interval yet
+		}
+		bool acquiring = (pllPulses <= ppqn * 2 + 1);
+		double gain = acquiring ? 1.0 : pllGains[pllBandwidth];
+		if (pllLength == 0.0) {
+			pllLength = measuredLength;
+		}
+		else {
+			pllLength += gain * 0.5 * (measuredLength - pllLength);
+		}
+		
+		double expectedPhase = (double)extPulseNumber / (double)(ppqn * 2);
+		double phase = clk[0].isReset() ? 0.0 : (clk[0].getStep() / masterLength);
+		double phaseError = expectedPhase - phase;// positive when the master clock is late
+		if (phaseError >= 0.5) {
+			phaseError -= 1.0;
+		}
+		else if (phaseError < -0.5) {
+			phaseError += 1.0;
+		}
+		if (acquiring || std::fabs(phaseError) > 0.05) {
+			pllLocked = false;
+		}
+		else if (std::fabs(phaseError) < 0.01) {
+			pllLocked = true;
+		}
+		
+		double speedup = std::min(std::max(1.0 + gain * (double)(ppqn * 2) * phaseError, 0.5), 2.0);
+		float newLength = clamp((float)(pllLength / speedup), masterLengthMin / 1.5f, masterLengthMax * 1.5f);// extended range as in the non PLL method
+		if (pllLocked && std::fabs(newLength - masterLength) < masterLength * 1e-4f) {
+			return masterLength;// no stretch for negligible corrections once locked
+		}
+		return newLength;
+	}
+	
+	void requestTempoMapEdit(int type, int bar = 0, float bpm = 0.0f) {
+		// UI thread: the edit is done by the engine thread in processTempoMapEdits(), since it reads the tempo map on every sample
+		uint32_t requested = tempoMapEditsRequested.load();
+		if (requested - tempoMapEditsDone.load() >= maxTempoMapEdits) {
+			return;// engine not processing the module, and too many edits pending
+		}
+		tempoMapEdits[requested % maxTempoMapEdits] = TempoMapEdit{type, bar, bpm};
+		tempoMapEditsRequested.store(requested + 1);
+	}
+	
+	void processTempoMapEdits() {
+		// engine thread
+		uint32_t requested = tempoMapEditsRequested.load();
+		uint32_t done = tempoMapEditsDone.load();
+		if (requested == done) {
+			return;
+		}
+		uint32_t seq = tempoMapSeq.load();
+		tempoMapSeq.store(seq + 1);
+		for (; done != requested; done++) {
+			tempoMap.apply(tempoMapEdits[done % maxTempoMapEdits]);
+		}
+		tempoMapEditsDone.store(done);
+		tempoMapSeq.store(seq + 2);
+		tempoMapBar = -1l;
+	}
+	
+	void copyTempoMap(TempoMap* copy) {
+		// UI thread: consistent copy of the tempo map, with the requested edits that the engine has not done yet
+		uint32_t seq;
+		uint32_t done;
+		while (true) {
+			seq = tempoMapSeq.load();
+			if ((seq & 0x1) != 0) {
+				std::this_thread::yield();// the engine is in processTempoMapEdits(), this is short
+				continue;
+			}
+			*copy = tempoMap;
+			done = tempoMapEditsDone.load();
+			if (tempoMapSeq.load() == seq) {
+				break;
+			}
+		}
+		uint32_t requested = tempoMapEditsRequested.load();
+		for (; done != requested; done++) {
+			copy->apply(tempoMapEdits[done % maxTempoMapEdits]);
+		}
+	}
+	
+	void clearTempoMapEdits() {
+		// only when the engine thread is not processing the module (onReset(), dataFromJson())
+		tempoMapEditsDone.store(tempoMapEditsRequested.load());
+	}
 
 	
 	Clocked() {
@@ -389,10 +513,10 @@ struct Clocked : Module {
 		configBypass(RUN_INPUT, RUN_OUTPUT);
 		configBypass(BPM_INPUT, BPM_OUTPUT);
 
-		clk.reserve(4);
-		clk.push_back(Clock(nullptr, &resetClockOutputsHigh));
-		for (int i = 1; i < 4; i++) {
-			clk.push_back(Clock(&clk[0], &resetClockOutputsHigh));		
+		clk.reserve(maxClocks);// sub-clocks keep a pointer to clk[0]
+		clk.push_back(Clock(nullptr, &resetClockOutputsHigh, &frameClock));
+		for (int i = 1; i < maxClocks; i++) {
+			clk.push_back(Clock(&clk[0], &resetClockOutputsHigh, &frameClock));		
 		}
 		onReset();
 		
@@ -409,8 +533,17 @@ struct Clocked : Module {
 		resetClockOutputsHigh = true;
 		momentaryRunInput = true;
 		forceCvOnBpmOut = false;
+		frameClock = false;
 		bpmInputScale = 1.0f;
 		bpmInputOffset = 0.0f;
+		tempoMapActive = false;
+		beatsPerBar = 4;
+		songPosOnBpmOut = false;
+		tempoMap.size = 0;
+		clearTempoMapEdits();
+		pllMode = false;
+		pllBandwidth = 1;
+		polyClocks = POLY_OFF;
 		resetNonJson(false);
 	}
 	void resetNonJson(bool delayed) {// delay thread sensitive parts (i.e. schedule them so that process() will do them)
@@ -423,12 +556,17 @@ struct Clocked : Module {
 		}			
 	}
 	
+	void onRemove(const RemoveEvent& e) override {
+		clockBus.unpublish(id);
+	}
+	
 	void onRandomize() override {
 		resetClocked(false);
 	}
 
 	
-	void resetClocked(bool hardReset) {// set hardReset to true to revert learned BPM to 120 in sync mode, or else when false, learned bmp will stay persistent
+	void resetClocked(bool hardReset, int seekBar = 0) {// set hardReset to true to revert learned BPM to 120 in sync mode, or else when false, learned bmp will stay persistent
+		// seekBar is the bar of the song position after the reset
 		sampleRate = (double)(APP->engine->getSampleRate());
 		sampleTime = 1.0 / sampleRate;
 		for (int i = 0; i < 4; i++) {
@@ -441,6 +579,16 @@ struct Clocked : Module {
 			ratiosDoubled[i] = (i == 0 ? 1 : getRatioDoubled(i));
 			clkOutputs[i] = resetClockOutputsHigh ? 10.0f : 0.0f;
 		}
+		setupPolyClocks();
+		songPeriods = 0;
+		songBeatOffset = (int64_t)seekBar * beatsPerBar;
+		songBar = seekBar;
+		tempoMapBar = seekBar;
+		tempoMapBpm = lookupTempoMap(seekBar);
+		pllLength = 0.0;
+		pllPulseTime = 0.0;
+		pllPulses = 0;
+		pllLocked = false;
 		updatePulseSwingDelay();
 		extPulseNumber = -1;
 		extIntervalTime = 0.0;// also used for auto mode change to P24 (2nd use of this member variable)
@@ -457,7 +605,7 @@ struct Clocked : Module {
 			}
 		}
 		else {
-			newMasterLength = 120.0f / bufferedRatioKnobs[0];
+			newMasterLength = 120.0f / getInternalBpm();
 		}
 		newMasterLength = clamp(newMasterLength, masterLengthMin, masterLengthMax);
 		masterLength = newMasterLength;
@@ -496,6 +644,9 @@ struct Clocked : Module {
 		
 		// forceCvOnBpmOut
 		json_object_set_new(rootJ, "forceCvOnBpmOut", json_boolean(forceCvOnBpmOut));
+
+		// frameClock
+		json_object_set_new(rootJ, "frameClock", json_boolean(frameClock));
 		
 		// bpmInputScale
 		json_object_set_new(rootJ, "bpmInputScale", json_real(bpmInputScale));
@@ -503,6 +654,36 @@ struct Clocked : Module {
 		// bpmInputOffset
 		json_object_set_new(rootJ, "bpmInputOffset", json_real(bpmInputOffset));
 
+		// pllMode
+		json_object_set_new(rootJ, "pllMode", json_boolean(pllMode));
+
+		// pllBandwidth
+		json_object_set_new(rootJ, "pllBandwidth", json_integer(pllBandwidth));
+
+		// polyClocks
+		json_object_set_new(rootJ, "polyClocks", json_integer(polyClocks));
+
+		// tempoMapActive
+		json_object_set_new(rootJ, "tempoMapActive", json_boolean(tempoMapActive));
+
+		// beatsPerBar
+		json_object_set_new(rootJ, "beatsPerBar", json_integer(beatsPerBar));
+
+		// songPosOnBpmOut
+		json_object_set_new(rootJ, "songPosOnBpmOut", json_boolean(songPosOnBpmOut));
+
+		// tempoMap
+		TempoMap tempoMapCopy;
+		copyTempoMap(&tempoMapCopy);
+		json_t *tempoMapBarsJ = json_array();
+		json_t *tempoMapBpmsJ = json_array();
+		for (int i = 0; i < tempoMapCopy.size; i++) {
+			json_array_insert_new(tempoMapBarsJ, i, json_integer(tempoMapCopy.changes[i].bar));
+			json_array_insert_new(tempoMapBpmsJ, i, json_real(tempoMapCopy.changes[i].bpm));
+		}
+		json_object_set_new(rootJ, "tempoMapBars", tempoMapBarsJ);
+		json_object_set_new(rootJ, "tempoMapBpms", tempoMapBpmsJ);
+
 		// clockMaster
 		json_object_set_new(rootJ, "clockMaster", json_boolean(clockMaster.id == id));
 		
@@ -594,6 +775,11 @@ struct Clocked : Module {
 		if (forceCvOnBpmOutJ)
 			forceCvOnBpmOut = json_is_true(forceCvOnBpmOutJ);
 
+		// frameClock
+		json_t *frameClockJ = json_object_get(rootJ, "frameClock");
+		if (frameClockJ)
+			frameClock = json_is_true(frameClockJ);
+
 		// bpmInputScale
 		json_t *bpmInputScaleJ = json_object_get(rootJ, "bpmInputScale");
 		if (bpmInputScaleJ)
@@ -604,6 +790,52 @@ struct Clocked : Module {
 		if (bpmInputOffsetJ)
 			bpmInputOffset = json_number_value(bpmInputOffsetJ);
 
+		// pllMode
+		json_t *pllModeJ = json_object_get(rootJ, "pllMode");
+		if (pllModeJ)
+			pllMode = json_is_true(pllModeJ);
+
+		// pllBandwidth
+		json_t *pllBandwidthJ = json_object_get(rootJ, "pllBandwidth");
+		if (pllBandwidthJ)
+			pllBandwidth = clamp((int)json_integer_value(pllBandwidthJ), 0, 2);
+
+		// polyClocks
+		json_t *polyClocksJ = json_object_get(rootJ, "polyClocks");
+		if (polyClocksJ)
+			polyClocks = clamp((int)json_integer_value(polyClocksJ), (int)POLY_OFF, (int)POLY_DIV);
+
+		// tempoMapActive
+		json_t *tempoMapActiveJ = json_object_get(rootJ, "tempoMapActive");
+		if (tempoMapActiveJ)
+			tempoMapActive = json_is_true(tempoMapActiveJ);
+
+		// beatsPerBar
+		json_t *beatsPerBarJ = json_object_get(rootJ, "beatsPerBar");
+		if (beatsPerBarJ)
+			beatsPerBar = clamp((int)json_integer_value(beatsPerBarJ), 1, 16);
+
+		// songPosOnBpmOut
+		json_t *songPosOnBpmOutJ = json_object_get(rootJ, "songPosOnBpmOut");
+		if (songPosOnBpmOutJ)
+			songPosOnBpmOut = json_is_true(songPosOnBpmOutJ);
+
+		// tempoMap
+		tempoMap.size = 0;
+		clearTempoMapEdits();
+		json_t *tempoMapBarsJ = json_object_get(rootJ, "tempoMapBars");
+		json_t *tempoMapBpmsJ = json_object_get(rootJ, "tempoMapBpms");
+		if (tempoMapBarsJ && tempoMapBpmsJ && json_is_array(tempoMapBarsJ) && json_is_array(tempoMapBpmsJ)) {
+			size_t n = std::min(json_array_size(tempoMapBarsJ), json_array_size(tempoMapBpmsJ));
+			for (size_t i = 0; i < n; i++) {
+				json_t *barJ = json_array_get(tempoMapBarsJ, i);
+				json_t *bpmJ = json_array_get(tempoMapBpmsJ, i);
+				if (barJ && bpmJ) {
+					tempoMap.add(std::max((int)json_integer_value(barJ), 0), json_number_value(bpmJ));// keeps the map sorted
+				}
+			}
+		}
+
 		resetNonJson(true);
 		
 		// clockMaster
@@ -649,6 +881,12 @@ struct Clocked : Module {
 	}		
 	
 
+	void processBypass(const ProcessArgs &args) override {
+		processTempoMapEdits();
+		Module::processBypass(args);
+	}
+	
+	
 	void process(const ProcessArgs &args) override {
 		// Scheduled reset
 		if (scheduledReset) {
@@ -656,6 +894,9 @@ struct Clocked : Module {
 			scheduledReset = false;
 		}
 		
+		// Tempo map edits requested from the menu
+		processTempoMapEdits();
+		
 		// Run button
 		if (runButtonTrigger.process(params[RUN_PARAM].getValue())) {
 			toggleRun();
@@ -682,7 +923,11 @@ struct Clocked : Module {
 		if (resetTrigger.process(inputs[RESET_INPUT].getVoltage() + params[RESET_PARAM].getValue())) {
 			resetLight = 1.0f;
 			resetPulse.trigger(0.001f);
-			resetClocked(false);	
+			int seekBar = 0;
+			if (inputs[RESET_INPUT].getChannels() >= 2) {// second channel is the bar to seek to, 0.1V per bar
+				seekBar = std::max((int)std::round(inputs[RESET_INPUT].getVoltage(1) * 10.0f), 0);
+			}
+			resetClocked(false, seekBar);	
 		}	
 
 		if (refresh.processInputs()) {
@@ -732,6 +977,13 @@ struct Clocked : Module {
 			}
 		}// userInputs refresh
 	
+		// Song position and tempo map
+		songBar = (long)std::floor(getSongBeats() / (double)beatsPerBar);
+		if (songBar != tempoMapBar) {
+			tempoMapBpm = lookupTempoMap(songBar);
+			tempoMapBar = songBar;
+		}
+		
 		// BPM input and knob
 		newMasterLength = masterLength;
 		if (inputs[BPM_INPUT].isConnected()) { 
@@ -764,14 +1016,21 @@ struct Clocked : Module {
 						else {
 							// all other ppqn pulses except the first one. now we have an interval upon which to plan a stretch 
 							double timeLeft = extIntervalTime * (double)(ppqn * 2 - extPulseNumber) / ((double)extPulseNumber);
-							newMasterLength = clamp(clk[0].getStep() + timeLeft, masterLengthMin / 1.5f, masterLengthMax * 1.5f);// extended range for better sync ability (20-450 BPM)
+							if (!pllMode)
+								newMasterLength = clamp(clk[0].getStep() + timeLeft, masterLengthMin / 1.5f, masterLengthMax * 1.5f);// extended range for better sync ability (20-450 BPM)
 							timeoutTime = extIntervalTime * ((double)(1 + extPulseNumber) / ((double)extPulseNumber)) + 0.1; // when a second or higher clock edge is received, 
 							//  the timeout is the predicted next edge (which is extIntervalTime + extIntervalTime / extPulseNumber) plus epsilon
 						}
+						if (pllMode) {
+							// the PLL follower replaces the re-planning above on every pulse, including the first pulse of a cycle 
+							//   (where the direct method keeps the current length): each pulse interval is a measurement for the PLL
+							newMasterLength = processPllPulse();
+						}
 					}
 				}
 				if (running) {
 					extIntervalTime += sampleTime;
+					pllPulseTime += sampleTime;
 					if (extIntervalTime > timeoutTime) {
 						running = false;
 						runPulse.trigger(0.001f);
@@ -819,11 +1078,11 @@ struct Clocked : Module {
 			}
 		}
 		else {// BPM_INPUT not active
-			newMasterLength = clamp(120.0f / bufferedRatioKnobs[0], masterLengthMin, masterLengthMax);
+			newMasterLength = clamp(120.0f / getInternalBpm(), masterLengthMin, masterLengthMax);
 		}
 		if (newMasterLength != masterLength) {
 			double lengthStretchFactor = ((double)newMasterLength) / ((double)masterLength);
-			for (int i = 0; i < 4; i++) {
+			for (int i = 0; i < numClocks; i++) {
 				clk[i].applyNewLength(lengthStretchFactor);
 			}
 			masterLength = newMasterLength;
@@ -845,35 +1104,32 @@ struct Clocked : Module {
 						syncRatios[i] = false;
 					}
 				}
+				if (polyClocks != polyClocksRunning) {// poly clocks turned on, off or changed from the menu, start them with the master
+					setupPolyClocks();
+				}
 				clk[0].setup(masterLength, 1, sampleTime);// must call setup before start. length = double_period
 				clk[0].start();
+				songPeriods++;
 			}
 			clkOutputs[0] = clk[0].isHigh(swingAmount[0], pulseWidth[0]) ? 10.0f : 0.0f;		
 			
-			// Sub clocks
-			for (int i = 1; i < 4; i++) {
+			// Sub clocks, and the poly clocks (these have the master's swing and pulse width, and no delay)
+			for (int i = 1; i < numClocks; i++) {
 				if (clk[i].isReset()) {
-					double length;
-					int iterations;
-					int ratioDoubled = ratiosDoubled[i];
-					if (ratioDoubled < 0) { // if div 
-						ratioDoubled *= -1;
-						length = masterLength * ((double)ratioDoubled) / 2.0;
-						iterations = 1l + (ratioDoubled % 2);		
-					}
-					else {// mult 
-						length = (2.0f * masterLength) / ((double)ratioDoubled);
-						iterations = ratioDoubled / (2l - (ratioDoubled % 2l));							
-					}
-					clk[i].setup(length, iterations, sampleTime);
+					clk[i].setupSubClock(ratiosDoubled[i], masterLength, sampleTime);
 					clk[i].start();
 				}
-				delay[i - 1].write(clk[i].isHigh(swingAmount[i], pulseWidth[i]));
-				clkOutputs[i] = delay[i - 1].read(delaySamples[i]) ? 10.0f : 0.0f;
+				if (i < 4) {
+					delay[i - 1].write(clk[i].isHigh(swingAmount[i], pulseWidth[i]));
+					clkOutputs[i] = delay[i - 1].read(delaySamples[i]) ? 10.0f : 0.0f;
+				}
+				else {
+					clkOutputs[i] = clk[i].isHigh(swingAmount[0], pulseWidth[0]) ? 10.0f : 0.0f;
+				}
 			}
 
 			// Step clocks
-			for (int i = 0; i < 4; i++)
+			for (int i = 0; i < numClocks; i++)
 				clk[i].stepClock();
 		}
 		
@@ -881,9 +1137,41 @@ struct Clocked : Module {
 		for (int i = 0; i < 4; i++) {
 			outputs[CLK_OUTPUTS + i].setVoltage(clkOutputs[i]);
 		}
-		outputs[RESET_OUTPUT].setVoltage((resetPulse.process((float)sampleTime) ? 10.0f : 0.0f));
+		if (polyClocksRunning != POLY_OFF) {
+			outputs[CLK_OUTPUTS + 0].setChannels(1 + numPolyClocks);
+			for (int i = 4; i < maxClocks; i++) {
+				outputs[CLK_OUTPUTS + 0].setVoltage(clkOutputs[i], i - 3);
+			}
+		}
+		else {
+			outputs[CLK_OUTPUTS + 0].setChannels(1);
+		}
+		bool resetOutHigh = resetPulse.process((float)sampleTime);
+		outputs[RESET_OUTPUT].setVoltage(resetOutHigh ? 10.0f : 0.0f);
 		outputs[RUN_OUTPUT].setVoltage((runPulse.process((float)sampleTime) ? 10.0f : 0.0f));
 		outputs[BPM_OUTPUT].setVoltage( (inputs[BPM_INPUT].isConnected() && !forceCvOnBpmOut) ? inputs[BPM_INPUT].getVoltage() : log2f(1.0f / masterLength));
+		if (songPosOnBpmOut) {
+			long songBeat = (long)std::floor(getSongBeats()) - songBar * beatsPerBar;
+			outputs[BPM_OUTPUT].setChannels(3);
+			outputs[BPM_OUTPUT].setVoltage((float)songBar * 0.1f, 1);
+			outputs[BPM_OUTPUT].setVoltage((float)songBeat, 2);
+		}
+		else {
+			outputs[BPM_OUTPUT].setChannels(1);
+		}
+		
+		// clock bus (published by the clock master only)
+		if (clockMaster.id == id) {
+			bool clockHighs[4];
+			for (int i = 0; i < 4; i++) {
+				clockHighs[i] = clkOutputs[i] > 0.0f;
+			}
+			float phase = (running && !clk[0].isReset()) ? (float)(clk[0].getStep() / masterLength) : 0.0f;
+			clockBus.publish(id, clockHighs, resetOutHigh, running, phase);
+		}
+		else {
+			clockBus.unpublish(id);
+		}
 			
 		
 		// lights
@@ -899,6 +1187,13 @@ struct Clocked : Module {
 			bool warningFlashState = true;
 			if (cantRunWarning > 0l) 
 				warningFlashState = calcWarningFlash(cantRunWarning, (long) (0.7 * sampleRate / RefreshCounter::displayRefreshStepSkips));
+			if (bpmDetectionMode && pllMode && running && !pllLocked) {
+				long pllFlashInit = (long) (0.5 * sampleRate / RefreshCounter::displayRefreshStepSkips);
+				pllUnlockedFlash--;
+				if (pllUnlockedFlash <= 0l)
+					pllUnlockedFlash = pllFlashInit;
+				warningFlashState = warningFlashState && calcWarningFlash(pllUnlockedFlash, pllFlashInit);
+			}
 			lights[BPMSYNC_LIGHT + 0].setBrightness((bpmDetectionMode && warningFlashState) ? 1.0f : 0.0f);
 			lights[BPMSYNC_LIGHT + 1].setBrightness((bpmDetectionMode && warningFlashState) ? (float)((ppqn - 2)*(ppqn - 2))/440.0f : 0.0f);			
 			
@@ -930,6 +1225,9 @@ struct Clocked : Module {
 };
 
 
+const double Clocked::pllGains[3] = {0.05, 0.15, 0.4};
+
+
 struct ClockedWidget : ModuleWidget {
 	PortWidget* slaveResetRunBpmInputs[3];
 
@@ -1073,8 +1371,73 @@ struct ClockedWidget : ModuleWidget {
 		
 		menu->addChild(createBoolPtrMenuItem("BPM output is CV when ext sync", "", &module->forceCvOnBpmOut));
 
+		menu->addChild(createCheckMenuItem("Drift-free clock engine (integer frames)", "",
+			[=]() {return module->frameClock;},
+			[=]() {module->frameClock = !module->frameClock;
+				   module->resetClocked(true);}
+		));
+
 		createBPMCVInputMenu(menu, &module->bpmInputScale, &module->bpmInputOffset);
 
+		menu->addChild(createSubmenuItem("BPM detection follower", module->pllMode ? "PLL" : "Direct", [=](Menu* menu) {
+			menu->addChild(createCheckMenuItem("Direct (re-plan on each pulse)", "",
+				[=]() {return !module->pllMode;},
+				[=]() {module->pllMode = false;}
+			));
+			const std::string bandwidthNames[3] = {"PLL, low bandwidth (smoothest)", "PLL, medium bandwidth", "PLL, high bandwidth (fastest)"};
+			for (int i = 0; i < 3; i++) {
+				menu->addChild(createCheckMenuItem(bandwidthNames[i], "",
+					[=]() {return module->pllMode && module->pllBandwidth == i;},
+					[=]() {module->pllMode = true;
+						   module->pllBandwidth = i;}
+				));
+			}
+		}));
+
+		menu->addChild(createSubmenuItem("Poly clocks on master output", module->polyClocks == Clocked::POLY_MULT ? "x1 to x16" : (module->polyClocks == Clocked::POLY_DIV ? "÷1 to ÷16" : "Off"), [=](Menu* menu) {
+			const std::string polyClocksNames[3] = {"Off", "x1 to x16", "÷1 to ÷16"};
+			for (int i = 0; i < 3; i++) {
+				menu->addChild(createCheckMenuItem(polyClocksNames[i], "",
+					[=]() {return module->polyClocks == i;},
+					[=]() {module->polyClocks = i;}
+				));
+			}
+		}));
+
+		menu->addChild(createSubmenuItem("Tempo map and song position", "", [=](Menu* menu) {
+			menu->addChild(createBoolPtrMenuItem("Follow tempo map", "", &module->tempoMapActive));
+			menu->addChild(createBoolPtrMenuItem("Song position on BPM output (poly)", "", &module->songPosOnBpmOut));
+			menu->addChild(createSubmenuItem("Beats per bar", string::f("%i", module->beatsPerBar), [=](Menu* menu) {
+				for (int b = 1; b <= 16; b++) {
+					menu->addChild(createCheckMenuItem(string::f("%i", b), "",
+						[=]() {return module->beatsPerBar == b;},
+						[=]() {module->beatsPerBar = b;
+							   module->tempoMapBar = -1l;}
+					));
+				}
+			}));
+			
+			menu->addChild(new MenuSeparator());
+			int bar = (int)module->songBar;
+			float bpm = module->params[Clocked::RATIO_PARAMS + 0].getValue();
+			menu->addChild(createMenuItem(string::f("Add change at bar %i (%i BPM)", bar + 1, (int)(bpm + 0.5f)), "",
+				[=]() {module->requestTempoMapEdit(Clocked::TM_ADD, bar, bpm);}
+			));
+			Clocked::TempoMap tempoMap;
+			module->copyTempoMap(&tempoMap);
+			for (int i = 0; i < tempoMap.size; i++) {
+				int changeBar = tempoMap.changes[i].bar;
+				menu->addChild(createSubmenuItem(string::f("Bar %i: %i BPM", changeBar + 1, (int)(tempoMap.changes[i].bpm + 0.5f)), "", [=](Menu* menu) {
+					menu->addChild(createMenuItem("Delete", "",
+						[=]() {module->requestTempoMapEdit(Clocked::TM_DELETE, changeBar);}
+					));
+				}));
+			}
+			menu->addChild(createMenuItem("Clear tempo map", "",
+				[=]() {module->requestTempoMapEdit(Clocked::TM_CLEAR);}
+			));
+		}));
+
 		menu->addChild(new MenuSeparator());
 		menu->addChild(createMenuLabel("Actions"));
 		
@@ -18,6 +18,296 @@ static const unsigned int ON_STOP_EXT_RST_MSK = 0x4;
 static const unsigned int ON_START_EXT_RST_MSK = 0x8;
 
 
+
+// Integer-frame clock engine, used by the Clock classes of Clocked and Clkd when their drift-free option is on.
+//   Steps and lengths are in sample frames, in fixed point with FRAC_BITS fractional bits, so that the remainder carried 
+//   from one period to the next is exact and a clock never drifts with respect to the sample clock, however long it runs.
+//   Sub-clocks derive their length from the master's with an exact rational ratio (ratioNum / ratioDen).
+//   The pulse edges are only computed when a period starts, or when the length or the pulse shape changes.
+class FrameClock {
+	static const int FRAC_BITS = 32;
+	static const int64_t ONE_FRAME = ((int64_t)1) << FRAC_BITS;
+	
+	int64_t step = -1;// -1 when stopped, [0 to length[ for clock steps
+	int64_t remainder = 0;
+	int64_t length = 0;
+	int64_t guard = 0;// same as in the Clock classes, but in fixed point frames
+	int64_t edges[3] = {};// end of first pulse, start of second pulse, end of second pulse (all inclusive); -1 when unused
+	float edgeParams[2] = {};// pulse shape that the edges were computed for
+	bool edgesValid = false;
+	double sampleTime = 0.0;
+	int iterations = 0;// same as in the Clock classes
+	FrameClock* syncSrc = nullptr;// only subclocks will have this set to master clock
+	
+	int64_t secondsToFrames(double seconds) {
+		return (int64_t)std::llround(seconds / sampleTime * (double)ONE_FRAME);
+	}
+	
+	public:
+	
+	void setSyncSrc(FrameClock* _syncSrc) {
+		syncSrc = _syncSrc;
+	}
+	void reset(int64_t _remainder = 0) {
+		step = -1;
+		remainder = _remainder;
+	}
+	bool isReset() {
+		return step == -1;
+	}
+	double getStep() {// in seconds
+		return step == -1 ? -1.0 : ((double)step / (double)ONE_FRAME * sampleTime);
+	}
+	double getLength() {// in seconds
+		return (double)length / (double)ONE_FRAME * sampleTime;
+	}
+	void start() {
+		step = remainder;
+		edgesValid = false;
+	}
+	
+	void setup(double lengthGiven, int iterationsGiven, double sampleTimeGiven, int ratioNum, int ratioDen) {
+		sampleTime = sampleTimeGiven;
+		if (syncSrc != nullptr)
+			length = syncSrc->length * (int64_t)ratioNum / (int64_t)ratioDen;
+		else
+			length = secondsToFrames(lengthGiven);
+		iterations = iterationsGiven;
+		guard = secondsToFrames(0.0005);
+	}
+
+	void stepClock() {
+		if (step >= 0) {// if active clock
+			step += ONE_FRAME;
+			if ( (syncSrc != nullptr) && (iterations == 1) && (step > (length - guard)) ) {// if in sync region
+				if (syncSrc->isReset()) {
+					reset();
+				}// else nothing needs to be done, just wait and step stays the same
+			}
+			else {
+				if (step >= length) {// reached end iteration
+					iterations--;
+					step -= length;
+					if (iterations <= 0) {
+						reset(syncSrc == nullptr ? step : 0);// frame done, don't calc remainders for subclocks since they sync to master
+					}
+				}
+			}
+		}
+	}
+	
+	void applyNewLength(double lengthStretchFactor) {
+		if (step != -1)
+			step = (int64_t)std::llround((double)step * lengthStretchFactor);
+		length = (int64_t)std::llround((double)length * lengthStretchFactor);
+		edgesValid = false;
+	}
+	
+	bool edgesUpToDate(float param1, float param2) {
+		return edgesValid && edgeParams[0] == param1 && edgeParams[1] == param2;
+	}
+	void setEdges(double p2, double p3, double p4, float param1, float param2) {// in seconds from the start of the period, negative p3 and p4 when no second pulse
+		edges[0] = secondsToFrames(p2);
+		edges[1] = p3 < 0.0 ? -1 : secondsToFrames(p3);
+		edges[2] = p4 < 0.0 ? -1 : secondsToFrames(p4);
+		edgeParams[0] = param1;
+		edgeParams[1] = param2;
+		edgesValid = true;
+	}
+	int getHigh() {// 0 when low, 1 when in first pulse, 2 when in second pulse; clock must be active and edges up to date
+		if (step <= edges[0])
+			return 1;
+		if (step >= edges[1] && step <= edges[2])
+			return 2;
+		return 0;
+	}
+};
+
+
+
+
+// Clock delay of the sub-clocks of Clocked.
+class ClockDelay {
+	// The edges of the clock are kept in a ring buffer of (frame, level) entries and played back delaySamples
+	//   later, so that any delay works as long as it spans less than CAPACITY edges
+	static const uint32_t CAPACITY = 256;// must be a power of 2
+	struct Edge {
+		int64_t frame;
+		bool level;
+	};
+	Edge edges[CAPACITY];
+	uint32_t writeCount;// number of edges written since reset, the ring buffer index is writeCount & (CAPACITY - 1)
+	uint32_t readCount;// number of edges read since reset, the read cursor
+	int64_t frameCounter;
+	bool lastWriteLevel;
+	bool readState;
+	
+	public:
+	
+	ClockDelay() {
+		reset(true);
+	}
+	
+	void setup() {
+	}
+	
+	void reset(bool resetClockOutputsHigh) {
+		writeCount = 0;
+		readCount = 0;
+		frameCounter = 0;
+		lastWriteLevel = false;
+		readState = resetClockOutputsHigh;
+	}
+	
+	void write(int value) {
+		// value is 1 or 2 when the first or second pulse of the double period is high, and there is always a low in between
+		bool level = (value != 0);
+		if (level != lastWriteLevel) {
+			if (writeCount - readCount >= CAPACITY) {
+				readCount++;// buffer full, drop the oldest edge
+			}
+			edges[writeCount & (CAPACITY - 1)].frame = frameCounter;
+			edges[writeCount & (CAPACITY - 1)].level = level;
+			writeCount++;
+			lastWriteLevel = level;
+		}
+	}
+	
+	bool read(long delaySamples) {
+		int64_t delayedFrame = frameCounter - delaySamples;
+		while (readCount != writeCount && edges[readCount & (CAPACITY - 1)].frame <= delayedFrame) {
+			readState = edges[readCount & (CAPACITY - 1)].level;
+			readCount++;
+		}
+		frameCounter++;
+		return readState;
+	}
+};
+
+
+
+
+// Clock engine shared by Clocked and Clkd, one instance per clock. A master clock has no sync source, and any number of 
+//   sub-clocks can be locked to it by giving them the master as their sync source; the modules derive their Clock class 
+//   from this one to add the pulse shape of their outputs. A clock's length is the time after which the clock is re-setup
+//   (a double period in Clocked, because of swing, and a period in Clkd).
+// The -1.0 step is used as a reset state every length so that lengths can be re-computed; it will stay at -1.0 when 
+//   a clock is inactive. A clock frame is defined as "length * iterations + syncWait", and for master, syncWait does 
+//   not apply and iterations = 1
+class ClockCore {
+	protected:
+	
+	double step = 0.0;// -1.0 when stopped, [0 to length[ for clock steps
+	double remainder = 0.0;
+	double length = 0.0;
+	double sampleTime = 0.0;
+	int iterations = 0;// run this many lengths before going into sync if sub-clock
+	ClockCore* syncSrc = nullptr; // only subclocks will have this set to master clock
+	static constexpr double guard = 0.0005;// in seconds, region for sync to occur right before end of length of last iteration; sub clocks must be low during this period
+	bool *resetClockOutputsHigh = nullptr;
+	bool *frameClock = nullptr;// when true, the integer-frame engine below is used instead of the members above
+	FrameClock frames;
+	
+	public:
+	
+	ClockCore(ClockCore* clkGiven, bool *resetClockOutputsHighPtr, bool *frameClockPtr) {
+		syncSrc = clkGiven;
+		resetClockOutputsHigh = resetClockOutputsHighPtr;
+		frameClock = frameClockPtr;
+		frames.setSyncSrc(clkGiven == nullptr ? nullptr : &(clkGiven->frames));
+		reset();
+	}
+	
+	void reset(double _remainder = 0.0) {
+		step = -1.0;
+		remainder = _remainder;
+		frames.reset();
+	}
+	bool isReset() {
+		if (*frameClock)
+			return frames.isReset();
+		return step == -1.0;
+	}
+	double getStep() {
+		if (*frameClock)
+			return frames.getStep();
+		return step;
+	}
+	void start() {
+		if (*frameClock)
+			frames.start();
+		else
+			step = remainder;
+	}
+	
+	void setup(double lengthGiven, int iterationsGiven, double sampleTimeGiven, int ratioNum = 1, int ratioDen = 1) {
+		// ratioNum / ratioDen is the length ratio to the master's length, only used by sub-clocks of the integer-frame engine
+		if (*frameClock) {
+			frames.setup(lengthGiven, iterationsGiven, sampleTimeGiven, ratioNum, ratioDen);
+			return;
+		}
+		length = lengthGiven;
+		iterations = iterationsGiven;
+		sampleTime = sampleTimeGiven;
+	}
+	
+	void setupSubClock(int ratioDoubled, float masterLength, double sampleTimeGiven) {
+		// ratioDoubled is twice the ratio to the master clock, positive for a mult and negative for a div (0 is not allowed)
+		double lengthGiven;
+		int iterationsGiven;
+		int ratioNum;
+		int ratioDen;
+		if (ratioDoubled < 0) { // if div 
+			ratioDoubled *= -1;
+			lengthGiven = masterLength * ((double)ratioDoubled) / 2.0;
+			iterationsGiven = 1l + (ratioDoubled % 2);		
+			ratioNum = ratioDoubled;
+			ratioDen = 2;
+		}
+		else {// mult 
+			lengthGiven = (2.0f * masterLength) / ((double)ratioDoubled);
+			iterationsGiven = ratioDoubled / (2l - (ratioDoubled % 2l));							
+			ratioNum = 2;
+			ratioDen = ratioDoubled;
+		}
+		setup(lengthGiven, iterationsGiven, sampleTimeGiven, ratioNum, ratioDen);
+	}
+
+	void stepClock() {// here the clock was output on step "step", this function is called near end of module::process()
+		if (*frameClock) {
+			frames.stepClock();
+		}
+		else if (step >= 0.0) {// if active clock
+			step += sampleTime;
+			if ( (syncSrc != nullptr) && (iterations == 1) && (step > (length - guard)) ) {// if in sync region
+				if (syncSrc->isReset()) {
+					reset();
+				}// else nothing needs to be done, just wait and step stays the same
+			}
+			else {
+				if (step >= length) {// reached end iteration
+					iterations--;
+					step -= length;
+					if (iterations <= 0) {
+						double newRemainder = (syncSrc == nullptr ? step : 0.0);// don't calc remainders for subclocks since they sync to master
+						reset(newRemainder);// frame done
+					}
+				}
+			}
+		}
+	}
+	
+	void applyNewLength(double lengthStretchFactor) {
+		if (*frameClock) {
+			frames.applyNewLength(lengthStretchFactor);
+			return;
+		}
+		if (step != -1.0)
+			step *= lengthStretchFactor;
+		length *= lengthStretchFactor;
+	}
+};
+
 	
 struct RatioParam : ParamQuantity {
 	float getDisplayValue() override {
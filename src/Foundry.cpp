@@ -14,7 +14,22 @@
 #include "Interop.hpp"
 
 
-struct Foundry : Module {	
+// Foundry (4 tracks of 32 steps) and Foundry16 (16 tracks of 64 steps) share the same panel; when a module has more tracks
+//   than track jacks, the tracks are polyphonic channels in the jacks, and when it has more steps than step buttons,
+//   the step buttons show the page of steps that holds the cursor
+template <class TSequencer>
+struct FoundryModule : Module {	
+	typedef typename TSequencer::Kernel Kernel;
+	
+	// Dimensions
+	static const int NUM_TRACKS = TSequencer::NUM_TRACKS;
+	static const int NUM_PORTS = 4;// track jacks of each type on the panel (CV in, clock in, CV out, CV2 out, gate out)
+	static const int TRACKS_PER_PORT = NUM_TRACKS / NUM_PORTS;// poly channels in each track jack
+	static const int NUM_STEP_BUTTONS = 32;
+	static const int NUM_STEP_PAGES = Kernel::MAX_STEPS / NUM_STEP_BUTTONS;
+	static_assert(TRACKS_PER_PORT >= 1 && TRACKS_PER_PORT * NUM_PORTS == NUM_TRACKS && TRACKS_PER_PORT <= PORT_MAX_CHANNELS, "NUM_TRACKS must be a multiple of NUM_PORTS");
+	static_assert(NUM_STEP_PAGES >= 1 && NUM_STEP_PAGES * NUM_STEP_BUTTONS == Kernel::MAX_STEPS, "MAX_STEPS must be a multiple of NUM_STEP_BUTTONS");
+	
 	enum ParamIds {
 		UNUSED1_PARAM,// no longer used
 		PHRASE_PARAM,
@@ -34,7 +49,7 @@ struct Foundry : Module {
 		GATE_PROB_PARAM,
 		TIE_PARAM,// Legato
 		CPMODE_PARAM,
-		ENUMS(STEP_PHRASE_PARAMS, SequencerKernel::MAX_STEPS),
+		ENUMS(STEP_PHRASE_PARAMS, NUM_STEP_BUTTONS),
 		TRACKDOWN_PARAM,
 		TRACKUP_PARAM,
 		VEL_KNOB_PARAM,
@@ -51,22 +66,22 @@ struct Foundry : Module {
 	};
 	enum InputIds {
 		WRITE_INPUT,
-		ENUMS(CV_INPUTS, Sequencer::NUM_TRACKS),
+		ENUMS(CV_INPUTS, NUM_PORTS),
 		RESET_INPUT,
-		ENUMS(CLOCK_INPUTS, Sequencer::NUM_TRACKS),
+		ENUMS(CLOCK_INPUTS, NUM_PORTS),
 		UNUSED1_INPUT,// no longer used
 		UNUSED2_INPUT,// no longer used
 		RUNCV_INPUT,
 		NUM_INPUTS
 	};
 	enum OutputIds {
-		ENUMS(CV_OUTPUTS, Sequencer::NUM_TRACKS),
-		ENUMS(VEL_OUTPUTS, Sequencer::NUM_TRACKS),
-		ENUMS(GATE_OUTPUTS, Sequencer::NUM_TRACKS),
+		ENUMS(CV_OUTPUTS, NUM_PORTS),
+		ENUMS(VEL_OUTPUTS, NUM_PORTS),
+		ENUMS(GATE_OUTPUTS, NUM_PORTS),
 		NUM_OUTPUTS
 	};
 	enum LightIds {
-		ENUMS(STEP_PHRASE_LIGHTS, SequencerKernel::MAX_STEPS * 3),// room for GreenRedWhite
+		ENUMS(STEP_PHRASE_LIGHTS, NUM_STEP_BUTTONS * 3),// room for GreenRedWhite
 		ENUMS(OCTAVE_LIGHTS, 7),// octaves 1 to 7
 		ENUMS(KEY_LIGHTS, 12 * 2),// room for GreenRed
 		RUN_LIGHT,
@@ -78,13 +93,13 @@ struct Foundry : Module {
 		ATTACH_LIGHT,
 		ENUMS(VEL_PROB_LIGHT, 2),// room for GreenRed
 		VEL_SLIDE_LIGHT,
-		ENUMS(WRITECV_LIGHTS, Sequencer::NUM_TRACKS),
+		ENUMS(WRITECV_LIGHTS, NUM_PORTS),
 		NUM_LIGHTS
 	};
 	
-	// Expander
-	static const int messageSize = 	Sequencer::NUM_TRACKS + // VEL_INPUTS with connected
-									Sequencer::NUM_TRACKS + // SEQCV_INPUTS with connected
+	// Expander (only supported when there is one track per track jack)
+	static const int messageSize = 	NUM_PORTS + // VEL_INPUTS with connected
+									NUM_PORTS + // SEQCV_INPUTS with connected
 									1 + // TRKCV_INPUT with connected
 									7 + // GATECV_INPUT, GATEPCV_INPUT, TIEDCV_INPUT, SLIDECV_INPUT, WRITE_SRC_INPUT, LEFTCV_INPUT, RIGHTCV_INPUT
 									2; // SYNC_SEQCV_PARAM, WRITEMODE_PARAM
@@ -97,6 +112,7 @@ struct Foundry : Module {
 	// Need to save, no reset
 	int panelTheme;
 	float panelContrast;
+	uint32_t seed;// of the random streams in the sequencer kernels
 	
 	// Need to save, with reset
 	int velocityMode;
@@ -109,13 +125,15 @@ struct Foundry : Module {
 	int seqCVmethod;// 0 is 0-10V, 1 is C2-D7#, 2 is TrigIncr
 	bool running;
 	bool resetOnRun;
+	ClockBusReader clockBusReader;// clock (of track A's jack), reset and run from the clock bus instead of the cables when subscribed
 	int retrigGatesOnReset;
 	bool attached;
 	int velEditMode;// 0 is velocity (aka CV2), 1 is gate-prob, 2 is slide-rate
 	int writeMode;// 0 is both, 1 is CV only, 2 is CV2 only
-	int stopAtEndOfSong;// 0 to 3 is YES stop on song end of that track, 4 is NO (off)
-	Sequencer seq;
+	int stopAtEndOfSong;// 0 to NUM_TRACKS - 1 is YES stop on song end of that track, NUM_TRACKS is NO (off)
+	TSequencer seq;
 	int mergeTracks;// 0 = none, 1 = merge A with B, 2 = merge A with B and C, 3 = merge A with All
+	int reseedOnReset;
 
 	// No need to save, with reset
 	bool editingSequence;
@@ -125,13 +143,15 @@ struct Foundry : Module {
 	long attachedWarning;// 0 when no warning, positive downward step counter timer when warning
 	long revertDisplay;
 	bool multiSteps;
-	int clkInSources[Sequencer::NUM_TRACKS];// first index is always 0 and will never change
+	int clkInSources[NUM_PORTS];// first index is always 0 and will never change
 	int cpSeqLength;
 	long clockIgnoreOnReset;
 	
 	// No need to save, no reset
 	int cpSongStart;// no need to initialize
 	RefreshCounter refresh;
+	uint32_t rngsSeed;// seed currently used by the sequencer kernels, to detect a new seed from the menu
+	StateSnapshot<typename TSequencer::Snapshot> snapshot;// song and sequences for dataToJson()
 	float resetLight = 0.0f;
 	int sequenceKnob = 0;
 	int velocityKnob = 0;
@@ -140,7 +160,7 @@ struct Foundry : Module {
 	Trigger leftTrigger;
 	Trigger rightTrigger;
 	Trigger runningTrigger;
-	Trigger clockTriggers[SequencerKernel::MAX_STEPS];
+	Trigger clockTriggers[NUM_PORTS];
 	dsp::BooleanTrigger keyTrigger;
 	Trigger octTriggers[7];
 	Trigger gate1Trigger;
@@ -152,7 +172,7 @@ struct Foundry : Module {
 	Trigger pasteTrigger;
 	Trigger modeTrigger;
 	Trigger transposeTrigger;
-	Trigger stepTriggers[SequencerKernel::MAX_STEPS];
+	Trigger stepTriggers[NUM_STEP_BUTTONS];
 	Trigger clkResTrigger;
 	Trigger trackIncTrigger;
 	Trigger trackDecTrigger;	
@@ -160,7 +180,7 @@ struct Foundry : Module {
 	Trigger endTrigger;
 	Trigger repLenTrigger;
 	Trigger attachedTrigger;
-	Trigger seqCVTriggers[Sequencer::NUM_TRACKS];
+	Trigger seqCVTriggers[NUM_TRACKS];
 	Trigger selTrigger;
 	Trigger allTrigger;
 	Trigger velEditTrigger;
@@ -175,20 +195,38 @@ struct Foundry : Module {
 		if (params[CPMODE_PARAM].getValue() < 0.5f) return 4;
 		return 8;
 	}
+	inline bool isExpanderPresent(void) {
+		return NUM_TRACKS == NUM_PORTS && rightExpander.module && rightExpander.module->model == modelFoundryExpander;
+	}
+	int getStepPageOffset() {// first step shown on the step buttons
+		if (NUM_STEP_PAGES == 1)
+			return 0;
+		int stepn = seq.getStepIndexEdit();
+		if (displayState == DISP_LEN)
+			stepn = seq.getLength() - 1;
+		else if (!editingSequence && running)
+			stepn = seq.getStepIndexRun(seq.getTrackIndexEdit());
+		return stepn - (stepn % NUM_STEP_BUTTONS);
+	}
+	std::string getPortTracksName(int portn) {
+		if (TRACKS_PER_PORT == 1)
+			return string::f("Track %c", portn + 'A');
+		return string::f("Tracks %c-%c", portn * TRACKS_PER_PORT + 'A', (portn + 1) * TRACKS_PER_PORT - 1 + 'A');
+	}
 
 	
-	Foundry() : seq(&holdTiedNotes, &velocityMode, &stopAtEndOfSong) {
+	FoundryModule() : seq(&holdTiedNotes, &velocityMode, &stopAtEndOfSong) {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
 		
 		rightExpander.producerMessage = rightMessages[0];
 		rightExpander.consumerMessage = rightMessages[1];
 		
 		// must init those that have no-connect info to non-connected, or else mother may read 0.0 init value if ever refresh limiters make it such that after a connection of expander the mother reads before the first pass through the expander's writing code, and this may do something undesired (ex: change track in Foundry on expander connected while track CV jack is empty)
-		for (int i = 0; i < (Sequencer::NUM_TRACKS * 2 + 1); i++) {
+		for (int i = 0; i < (NUM_PORTS * 2 + 1); i++) {
 			rightMessages[1][i] = std::numeric_limits<float>::quiet_NaN();
 		}
 
-		const int numX = SequencerKernel::MAX_STEPS / 2;
+		const int numX = NUM_STEP_BUTTONS / 2;
 		for (int x = 0; x < numX; x++) {
 			// First row
 			configParam(STEP_PHRASE_PARAMS + x, 0.0f, 1.0f, 0.0f, string::f("Step %i", x + 1));
@@ -234,20 +272,21 @@ struct Foundry : Module {
 
 		configInput(WRITE_INPUT, "Write");
 		configInput(RESET_INPUT, "Reset");
-		for (int i = 0; i < Sequencer::NUM_TRACKS; i++) {
-			configInput(CV_INPUTS + i, string::f("Track %c CV", i + 'A'));
-			configInput(CLOCK_INPUTS + i, string::f("Track %c clock", i + 'A'));
+		for (int i = 0; i < NUM_PORTS; i++) {
+			configInput(CV_INPUTS + i, getPortTracksName(i) + " CV");
+			configInput(CLOCK_INPUTS + i, getPortTracksName(i) + " clock");
 		}
 		configInput(UNUSED1_INPUT, "Unused 1");
 		configInput(UNUSED2_INPUT, "Unused 2");
 		configInput(RUNCV_INPUT, "Run");
 
-		for (int i = 0; i < Sequencer::NUM_TRACKS; i++) {
-			configOutput(CV_OUTPUTS + i, string::f("Track %c CV", i + 'A'));
-			configOutput(VEL_OUTPUTS + i, string::f("Track %c CV2", i + 'A'));
-			configOutput(GATE_OUTPUTS + i, string::f("Track %c gate", i + 'A'));
+		for (int i = 0; i < NUM_PORTS; i++) {
+			configOutput(CV_OUTPUTS + i, getPortTracksName(i) + " CV");
+			configOutput(VEL_OUTPUTS + i, getPortTracksName(i) + " CV2");
+			configOutput(GATE_OUTPUTS + i, getPortTracksName(i) + " gate");
 		}
 		
+		seed = random::u32();
 		onReset();
 		
 		loadThemeAndContrastFromDefault(&panelTheme, &panelContrast);
@@ -265,14 +304,17 @@ struct Foundry : Module {
 		seqCVmethod = 0;
 		running = true;
 		resetOnRun = false;
+		clockBusReader.source = -1;
 		retrigGatesOnReset = RGOR_NRUN;
 		attached = false;
 		velEditMode = 0;
 		writeMode = 0;
-		stopAtEndOfSong = 4;// this means option is turned off (0-3 is on)
+		stopAtEndOfSong = NUM_TRACKS;// this means option is turned off (0 to NUM_TRACKS - 1 is on)
 		seq.onReset(isEditingSequence());
 		mergeTracks = 0;// no merging
+		reseedOnReset = 0;
 		resetNonJson(false);// no need to propagate initRun calls in seq, since seq.onReset() has initRun() in it
+		publishSnapshot();
 	}
 	void resetNonJson(bool propagateInitRun) {
 		editingSequence = isEditingSequence();
@@ -282,12 +324,17 @@ struct Foundry : Module {
 		attachedWarning = 0l;
 		revertDisplay = 0l;
 		multiSteps = false;
-		for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++) {
-			clkInSources[trkn] = 0;
+		for (int portn = 0; portn < NUM_PORTS; portn++) {
+			clkInSources[portn] = 0;
 		}
 		cpSeqLength = cpMode;
+		seedRandomStreams();
 		initRun(propagateInitRun);
 	}
+	void seedRandomStreams() {
+		seq.seedRandom(seed);
+		rngsSeed = seed;
+	}
 	void initRun(bool propagateInitRun) {
 		clockIgnoreOnReset = (long) (clockIgnoreOnResetDuration * APP->engine->getSampleRate());
 		if (propagateInitRun) {
@@ -299,9 +346,24 @@ struct Foundry : Module {
 	void onRandomize() override {
 		if (editingSequence)
 			seq.onRandomize(editingSequence);
+		publishSnapshot();
 	}
 	
 	
+	void publishSnapshot() {// onReset(), onRandomize() and dataFromJson() only (see StateSnapshot)
+		snapshot.publishNow([this](typename TSequencer::Snapshot* snap, uint32_t tracks) {seq.fillSnapshot(snap, tracks);});
+	}
+	void processSnapshot() {// end of process() and processBypass() only (see StateSnapshot)
+		snapshot.process([this](typename TSequencer::Snapshot* snap, uint32_t tracks) {seq.fillSnapshot(snap, tracks);});
+	}
+	void markEdited(bool multi) {// process() only, before editing the song or sequences of the track(s) (see StateSnapshot)
+		snapshot.markDirty(seq.getEditedTracks(multi));
+	}
+	void markEditedFromUi() {// UI thread only, after editing the song or sequences (see StateSnapshot)
+		snapshot.markDirtyFromUi(seq.getEditedTracks(true));
+	}
+
+
 	json_t *dataToJson() override {
 		json_t *rootJ = json_object();
 
@@ -311,6 +373,12 @@ struct Foundry : Module {
 		// panelContrast
 		json_object_set_new(rootJ, "panelContrast", json_real(panelContrast));
 
+		// seed
+		json_object_set_new(rootJ, "seed", json_integer(seed));
+
+		// reseedOnReset
+		json_object_set_new(rootJ, "reseedOnReset", json_integer(reseedOnReset));
+
 		// velocityMode
 		json_object_set_new(rootJ, "velocityMode", json_integer(velocityMode));
 
@@ -340,6 +408,9 @@ struct Foundry : Module {
 		
 		// resetOnRun
 		json_object_set_new(rootJ, "resetOnRun", json_boolean(resetOnRun));
+
+		// clockBusSource
+		json_object_set_new(rootJ, "clockBusSource", json_integer(clockBusReader.source));
 		
 		// retrigGatesOnReset
 		json_object_set_new(rootJ, "retrigGatesOnReset2", json_integer(retrigGatesOnReset));
@@ -356,8 +427,10 @@ struct Foundry : Module {
 		// stopAtEndOfSong
 		json_object_set_new(rootJ, "stopAtEndOfSong", json_integer(stopAtEndOfSong));
 
-		// seq
-		seq.dataToJson(rootJ);
+		// seq (song and sequences are taken from a consistent copy of the state, see StateSnapshot)
+		const typename TSequencer::Snapshot* snap = snapshot.acquire([this](typename TSequencer::Snapshot* snap, uint32_t tracks) {seq.fillSnapshot(snap, tracks);});
+		seq.dataToJson(rootJ, *snap);
+		snapshot.release();
 		
 		// mergeTracks
 		json_object_set_new(rootJ, "mergeTracks", json_integer(mergeTracks));
@@ -380,6 +453,16 @@ struct Foundry : Module {
 		if (panelContrastJ)
 			panelContrast = json_number_value(panelContrastJ);
 
+		// seed
+		json_t *seedJ = json_object_get(rootJ, "seed");
+		if (seedJ)
+			seed = (uint32_t)json_integer_value(seedJ);
+
+		// reseedOnReset
+		json_t *reseedOnResetJ = json_object_get(rootJ, "reseedOnReset");
+		if (reseedOnResetJ)
+			reseedOnReset = json_integer_value(reseedOnResetJ);
+
 		// velocityMode
 		json_t *velocityModeJ = json_object_get(rootJ, "velocityMode");
 		if (velocityModeJ)
@@ -430,6 +513,13 @@ struct Foundry : Module {
 		if (resetOnRunJ)
 			resetOnRun = json_is_true(resetOnRunJ);
 
+		// clockBusSource
+		json_t *clockBusSourceJ = json_object_get(rootJ, "clockBusSource");
+		if (clockBusSourceJ) {
+			clockBusReader.source = clamp((int)json_integer_value(clockBusSourceJ), -1, ClockBus::NUM_CLOCKS - 1);
+			clockBusReader.sync();
+		}
+
 		// retrigGatesOnReset
 		json_t *retrigGatesOnResetJ = json_object_get(rootJ, "retrigGatesOnReset2");
 		if (retrigGatesOnResetJ)
@@ -464,6 +554,7 @@ struct Foundry : Module {
 			mergeTracks = json_integer_value(mergeTracksJ);
 
 		resetNonJson(false);// no need to propagate initRun calls in seq, since seq.dataFromJson() has initRun() in it
+		publishSnapshot();
 	}
 
 
@@ -516,6 +607,14 @@ struct Foundry : Module {
 				seq.toggleTied(i);
 			}
 		}
+		markEditedFromUi();
+	}
+	
+	
+	void processBypass(const ProcessArgs &args) override {
+		Module::processBypass(args);
+		// keep publishing the edits done on the UI thread while bypassed (see StateSnapshot)
+		processSnapshot();
 	}
 	
 	
@@ -523,14 +622,19 @@ struct Foundry : Module {
 		const float sampleRate = args.sampleRate;
 		static const float revertDisplayTime = 0.7f;// seconds
 		
-		bool expanderPresent = (rightExpander.module && rightExpander.module->model == modelFoundryExpander);
+		bool expanderPresent = isExpanderPresent();
 		float *messagesFromExpander = static_cast<float*>(rightExpander.consumerMessage);// could be invalid pointer when !expanderPresent, so read it only when expanderPresent
 		
 		
 		//********** Buttons, knobs, switches and inputs **********
 		
 		// Run button
-		if (runningTrigger.process(params[RUN_PARAM].getValue() + inputs[RUNCV_INPUT].getVoltage())) {// no input refresh here, don't want to introduce startup skew
+		bool busClock = clockBusReader.isSubscribed();
+		bool runToggled = runningTrigger.process(params[RUN_PARAM].getValue() + (busClock ? 0.0f : inputs[RUNCV_INPUT].getVoltage()));// no input refresh here, don't want to introduce startup skew
+		if (busClock && clockBusReader.processRun()) {
+			runToggled = !runToggled;
+		}
+		if (runToggled) {
 			running = !running;
 			if (running) {
 				if (resetOnRun) {
@@ -543,6 +647,11 @@ struct Foundry : Module {
 		}
 
 		if (refresh.processInputs()) {
+			// new random seed from menu
+			if (seed != rngsSeed) {
+				seedRandomStreams();
+			}
+			
 			// Seq / song switch
 			bool newEditingSequence = isEditingSequence();
 			if (newEditingSequence != editingSequence) {
@@ -554,11 +663,11 @@ struct Foundry : Module {
 		
 			// Track CV input
 			if (expanderPresent) {
-				float trkCVin = messagesFromExpander[Sequencer::NUM_TRACKS * 2 + 0];
+				float trkCVin = messagesFromExpander[NUM_PORTS * 2 + 0];
 				if (!std::isnan(trkCVin)) {
-					int newTrk = (int)( trkCVin * (2.0f * (float)Sequencer::NUM_TRACKS - 1.0f) / 10.0f + 0.5f );
+					int newTrk = (int)( trkCVin * (2.0f * (float)NUM_TRACKS - 1.0f) / 10.0f + 0.5f );
 					seq.setTrackIndexEdit(abs(newTrk));
-					multiTracks = (newTrk > 3);
+					multiTracks = (newTrk > NUM_TRACKS - 1);
 				}
 			}
 			
@@ -615,6 +724,7 @@ struct Foundry : Module {
 			// Paste 
 			if (pasteTrigger.process(params[PASTE_PARAM].getValue())) {
 				if (!attached) {
+					markEdited(multiTracks);
 					if (editingSequence) {
 						seq.pasteSequence(multiTracks);
 						displayState = DISP_PASTE_SEQ;
@@ -638,8 +748,9 @@ struct Foundry : Module {
 			bool writeTrig = writeTrigger.process(inputs[WRITE_INPUT].getVoltage());
 			if (writeTrig) {
 				if (editingSequence) {
+					markEdited(multiTracks);
 					int multiStepsCount = multiSteps ? cpSeqLength : 1;
-					for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++) {
+					for (int trkn = 0; trkn < NUM_TRACKS; trkn++) {
 						if (trkn == seq.getTrackIndexEdit() || multiTracks) {
 							if (expanderPresent && ((writeMode & 0x1) == 0)) {	// must be before seq.writeCV() below, so that editing CV2 can be grabbed
 								float velCVin = messagesFromExpander[0 + trkn];
@@ -650,14 +761,15 @@ struct Foundry : Module {
 									seq.setVelocityVal(trkn, clamp(intVel, 0, 200), multiStepsCount, false);
 								}
 							}
-							if (inputs[CV_INPUTS + trkn].isConnected() && ((writeMode & 0x2) == 0)) {
-								seq.writeCV(trkn, clamp(inputs[CV_INPUTS + trkn].getVoltage(), -10.0f, 10.0f), multiStepsCount, sampleRate, false);
+							int portn = trkn / TRACKS_PER_PORT;
+							if (inputs[CV_INPUTS + portn].isConnected() && ((writeMode & 0x2) == 0)) {
+								seq.writeCV(trkn, clamp(inputs[CV_INPUTS + portn].getVoltage(trkn % TRACKS_PER_PORT), -10.0f, 10.0f), multiStepsCount, sampleRate, false);
 							}
 						}
 					}
 					seq.setEditingGateKeyLight(-1);
 					if (params[AUTOSTEP_PARAM].getValue() > 0.5f) {
-						bool seqConnected = (expanderPresent && !std::isnan(messagesFromExpander[Sequencer::NUM_TRACKS + seq.getTrackIndexEdit()]));
+						bool seqConnected = (expanderPresent && !std::isnan(messagesFromExpander[NUM_PORTS + seq.getTrackIndexEdit()]));
 						seq.autostep(autoseq && !seqConnected, autostepLen, multiTracks);
 					}
 				}
@@ -665,10 +777,10 @@ struct Foundry : Module {
 			// Left and right CV inputs in expander module
 			if (expanderPresent) {
 				int delta = 0;
-				if (leftTrigger.process(messagesFromExpander[Sequencer::NUM_TRACKS * 2 + 1 + 5])) {
+				if (leftTrigger.process(messagesFromExpander[NUM_PORTS * 2 + 1 + 5])) {
 					delta = -1;
 				}
-				if (rightTrigger.process(messagesFromExpander[Sequencer::NUM_TRACKS * 2 + 1 + 6])) {
+				if (rightTrigger.process(messagesFromExpander[NUM_PORTS * 2 + 1 + 6])) {
 					delta = +1;
 				}
 				if (delta != 0) {
@@ -687,13 +799,17 @@ struct Foundry : Module {
 
 			// Step button presses
 			int stepPressed = -1;
-			for (int i = 0; i < SequencerKernel::MAX_STEPS; i++) {
+			for (int i = 0; i < NUM_STEP_BUTTONS; i++) {
 				if (stepTriggers[i].process(params[STEP_PHRASE_PARAMS + i].getValue()))
-					stepPressed = i;
+					stepPressed = getStepPageOffset() + i;
 			}
 			if (stepPressed != -1) {
 				if (displayState == DISP_LEN) {
 					if (editingSequence) {
+						if (NUM_STEP_PAGES > 1 && stepPressed == seq.getLength() - 1) {// pressing the last step again goes to the next page
+							stepPressed = (stepPressed + NUM_STEP_BUTTONS) % Kernel::MAX_STEPS;
+						}
+						markEdited(multiTracks);
 						seq.setLength(stepPressed + 1, multiTracks);
 					}
 					revertDisplay = (long) (revertDisplayTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
@@ -705,6 +821,9 @@ struct Foundry : Module {
 								cpSeqLength = stepPressed - seq.getStepIndexEdit() + 1;
 							}
 							else {
+								if (NUM_STEP_PAGES > 1 && stepPressed == seq.getStepIndexEdit()) {// pressing the edited step again goes to the next page
+									stepPressed = (stepPressed + NUM_STEP_BUTTONS) % Kernel::MAX_STEPS;
+								}
 								seq.setStepIndexEdit(stepPressed, sampleRate);
 								displayState = DISP_NORMAL; // leave this here, the if has it also, but through the revert mechanism
 								if (multiSteps && (cpMode == 2000)) {
@@ -794,18 +913,18 @@ struct Foundry : Module {
 
 			// Track Inc/Dec buttons
 			if (trackIncTrigger.process(params[TRACKUP_PARAM].getValue())) {
-				if (!expanderPresent || std::isnan(messagesFromExpander[Sequencer::NUM_TRACKS * 2 + 0])) {
+				if (!expanderPresent || std::isnan(messagesFromExpander[NUM_PORTS * 2 + 0])) {
 					seq.incTrackIndexEdit();
 				}
 			}
 			if (trackDecTrigger.process(params[TRACKDOWN_PARAM].getValue())) {
-				if (!expanderPresent || std::isnan(messagesFromExpander[Sequencer::NUM_TRACKS * 2 + 0])) {
+				if (!expanderPresent || std::isnan(messagesFromExpander[NUM_PORTS * 2 + 0])) {
 					seq.decTrackIndexEdit();
 				}
 			}
 			// All button
 			if (allTrigger.process(params[ALLTRACKS_PARAM].getValue())) {
-				if (!expanderPresent || std::isnan(messagesFromExpander[Sequencer::NUM_TRACKS * 2 + 0])) {
+				if (!expanderPresent || std::isnan(messagesFromExpander[NUM_PORTS * 2 + 0])) {
 					if (!attached) {
 						multiTracks = !multiTracks;
 					}
@@ -839,7 +958,7 @@ struct Foundry : Module {
 			
 			// Write mode button
 			if (expanderPresent) {
-				if (writeModeTrigger.process(messagesFromExpander[Sequencer::NUM_TRACKS * 2 + 1 + 7 + 1] + messagesFromExpander[Sequencer::NUM_TRACKS * 2 + 1 + 4])) {//WRITE_SRC_INPUT
+				if (writeModeTrigger.process(messagesFromExpander[NUM_PORTS * 2 + 1 + 7 + 1] + messagesFromExpander[NUM_PORTS * 2 + 1 + 4])) {//WRITE_SRC_INPUT
 					if (editingSequence) {
 						if (++writeMode > 2)
 							writeMode =0;
@@ -857,6 +976,7 @@ struct Foundry : Module {
 				if (abs(deltaVelKnob) <= 3) {// avoid discontinuous step (initialize for example)
 					// any changes in here should may also require right click behavior to be updated in the knob's onMouseDown()
 					if (editingSequence) {
+						markEdited(multiTracks);
 						displayState = DISP_NORMAL;
 						int mutliStepsCount = multiSteps ? cpSeqLength : 1;
 						if (velEditMode == 2) {
@@ -883,6 +1003,7 @@ struct Foundry : Module {
 			if (deltaSeqKnob != 0) {
 				if (abs(deltaSeqKnob) <= 3) {// avoid discontinuous step (initialize for example)
 					// any changes in here should may also require right click behavior to be updated in the knob's onMouseDown()
+					markEdited(multiTracks);
 					if (displayState == DISP_LEN) {
 						seq.modLength(deltaSeqKnob, multiTracks);
 					}
@@ -900,13 +1021,13 @@ struct Foundry : Module {
 					else {// DISP_NORMAL
 						if (editingSequence) {
 							int activeTrack = seq.getTrackIndexEdit();
-							if (!expanderPresent || std::isnan(messagesFromExpander[Sequencer::NUM_TRACKS + activeTrack])) {
+							if (!expanderPresent || std::isnan(messagesFromExpander[NUM_PORTS + activeTrack])) {
 								seq.moveSeqIndexEdit(deltaSeqKnob);
 								if (multiTracks) {
 									int newSeq = seq.getSeqIndexEdit();
-									for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++) {
+									for (int trkn = 0; trkn < NUM_TRACKS; trkn++) {
 										if (trkn == activeTrack) continue;
-										if (!expanderPresent || std::isnan(messagesFromExpander[Sequencer::NUM_TRACKS + trkn])) {
+										if (!expanderPresent || std::isnan(messagesFromExpander[NUM_PORTS + trkn])) {
 											seq.setSeqIndexEdit(newSeq, trkn);
 										}
 									}
@@ -935,6 +1056,7 @@ struct Foundry : Module {
 				if (abs(deltaPhrKnob) <= 3) {// avoid discontinuous step (initialize for example)
 					// any changes in here should may also require right click behavior to be updated in the knob's onMouseDown()
 					if (displayState == DISP_MODE_SEQ) {
+						markEdited(multiTracks);
 						seq.modRunModeSeq(deltaPhrKnob, multiTracks);
 					}
 					else if (displayState == DISP_PPQN) {
@@ -970,6 +1092,7 @@ struct Foundry : Module {
 			for (int octn = 0; octn < 7; octn++) {
 				if (octTriggers[octn].process(params[OCTAVE_PARAM + octn].getValue())) {
 					if (editingSequence) {
+						markEdited(multiTracks);
 						displayState = DISP_NORMAL;
 						if (seq.applyNewOctave(3 - octn, multiSteps ? cpSeqLength : 1, sampleRate, multiTracks))
 							tiedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
@@ -980,6 +1103,7 @@ struct Foundry : Module {
 			// Keyboard buttons
 			if (keyTrigger.process(pkInfo.gate)) {
 				if (editingSequence) {
+					markEdited(multiTracks);
 					displayState = DISP_NORMAL;
 					if (isEditingGates()) {
 						if (!seq.setGateType(pkInfo.key, multiSteps ? cpSeqLength : 1, sampleRate, pkInfo.isRightClick, multiTracks))
@@ -993,33 +1117,37 @@ struct Foundry : Module {
 			}
 			
 			// Gate, GateProb, Slide and Tied buttons
-			if (gate1Trigger.process(params[GATE_PARAM].getValue() + (expanderPresent ? messagesFromExpander[Sequencer::NUM_TRACKS * 2 + 1 + 0] : 0.0f))) {
+			if (gate1Trigger.process(params[GATE_PARAM].getValue() + (expanderPresent ? messagesFromExpander[NUM_PORTS * 2 + 1 + 0] : 0.0f))) {
 				if (editingSequence) {
 					displayState = DISP_NORMAL;
+					markEdited(multiTracks);
 					seq.toggleGate(multiSteps ? cpSeqLength : 1, multiTracks);
 				}
 			}		
-			if (gateProbTrigger.process(params[GATE_PROB_PARAM].getValue() + (expanderPresent ? messagesFromExpander[Sequencer::NUM_TRACKS * 2 + 1 + 1] : 0.0f))) {
+			if (gateProbTrigger.process(params[GATE_PROB_PARAM].getValue() + (expanderPresent ? messagesFromExpander[NUM_PORTS * 2 + 1 + 1] : 0.0f))) {
 				if (editingSequence) {
 					displayState = DISP_NORMAL;
+					markEdited(multiTracks);
 					if (seq.toggleGateP(multiSteps ? cpSeqLength : 1, multiTracks)) 
 						tiedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
 					else if (seq.getAttribute(true).getGateP())
 						velEditMode = 1;
 				}
 			}		
-			if (slideTrigger.process(params[SLIDE_BTN_PARAM].getValue() + (expanderPresent ? messagesFromExpander[Sequencer::NUM_TRACKS * 2 + 1 + 3] : 0.0f))) {
+			if (slideTrigger.process(params[SLIDE_BTN_PARAM].getValue() + (expanderPresent ? messagesFromExpander[NUM_PORTS * 2 + 1 + 3] : 0.0f))) {
 				if (editingSequence) {
 					displayState = DISP_NORMAL;
+					markEdited(multiTracks);
 					if (seq.toggleSlide(multiSteps ? cpSeqLength : 1, multiTracks))
 						tiedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
 					else if (seq.getAttribute(true).getSlide())
 						velEditMode = 2;
 				}
 			}		
-			if (tiedTrigger.process(params[TIE_PARAM].getValue() + (expanderPresent ? messagesFromExpander[Sequencer::NUM_TRACKS * 2 + 1 + 2] : 0.0f))) {
+			if (tiedTrigger.process(params[TIE_PARAM].getValue() + (expanderPresent ? messagesFromExpander[NUM_PORTS * 2 + 1 + 2] : 0.0f))) {
 				if (editingSequence) {
 					displayState = DISP_NORMAL;
+					markEdited(multiTracks);
 					seq.toggleTied(multiSteps ? cpSeqLength : 1, multiTracks);// will clear other attribs if new state is on
 				}
 			}		
@@ -1030,23 +1158,23 @@ struct Foundry : Module {
 		
 		// Seq CV input
 		if (expanderPresent) {
-			for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++) {
-				float seqCVin = messagesFromExpander[Sequencer::NUM_TRACKS + trkn];
+			for (int trkn = 0; trkn < NUM_TRACKS; trkn++) {
+				float seqCVin = messagesFromExpander[NUM_PORTS + trkn];
 				if (!std::isnan(seqCVin)) {
 					int newSeq = -1;
 					if (seqCVmethod == 0) {// 0-10 V
-						newSeq = (int)(seqCVin * ((float)SequencerKernel::MAX_SEQS - 1.0f) / 10.0f + 0.5f );
-						newSeq = clamp(newSeq, 0, SequencerKernel::MAX_SEQS - 1);
+						newSeq = (int)(seqCVin * ((float)Kernel::MAX_SEQS - 1.0f) / 10.0f + 0.5f );
+						newSeq = clamp(newSeq, 0, Kernel::MAX_SEQS - 1);
 					}
 					else if (seqCVmethod == 1) {// C2-D7#
 						newSeq = (int)std::round((seqCVin + 2.0f) * 12.0f);
-						newSeq = clamp(newSeq, 0, SequencerKernel::MAX_SEQS - 1);
+						newSeq = clamp(newSeq, 0, Kernel::MAX_SEQS - 1);
 					}
 					else if (seqCVTriggers[trkn].process(seqCVin)) {// TrigIncr
-						newSeq = clamp(seq.getSeqIndexEdit(trkn) + 1, 0, SequencerKernel::MAX_SEQS - 1);
+						newSeq = clamp(seq.getSeqIndexEdit(trkn) + 1, 0, Kernel::MAX_SEQS - 1);
 					}
 					if (newSeq >= 0) {
-						if (messagesFromExpander[Sequencer::NUM_TRACKS * 2 + 1 + 7] > 0.5f && running)
+						if (messagesFromExpander[NUM_PORTS * 2 + 1 + 7] > 0.5f && running)
 							seq.requestDelayedSeqChange(trkn, newSeq);
 						else
 							seq.setSeqIndexEdit(newSeq, trkn);				
@@ -1060,10 +1188,15 @@ struct Foundry : Module {
 		
 		// Clock
 		if (running && clockIgnoreOnReset == 0l) {
-			bool clockTrigged[Sequencer::NUM_TRACKS];
-			for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++) {
-				clockTrigged[trkn] = clockTriggers[trkn].process(inputs[CLOCK_INPUTS + trkn].getVoltage());
-				if (clockTrigged[clkInSources[trkn]]) {
+			bool clockTrigged[NUM_PORTS];
+			for (int portn = 0; portn < NUM_PORTS; portn++) {
+				if (portn == 0 && busClock)
+					clockTrigged[portn] = clockBusReader.processClock(&clockTriggers[portn]);
+				else
+					clockTrigged[portn] = clockTriggers[portn].process(inputs[CLOCK_INPUTS + portn].getVoltage());
+			}
+			for (int trkn = 0; trkn < NUM_TRACKS; trkn++) {
+				if (clockTrigged[clkInSources[trkn / TRACKS_PER_PORT]]) {
 					bool stopRequested = seq.clockStep(trkn, editingSequence);
 					if (stopRequested) {
 						running = false;
@@ -1073,15 +1206,27 @@ struct Foundry : Module {
 			}
 			seq.process();
 		}
+		else if (busClock) {
+			clockBusReader.syncClock();
+		}
 				
 		// Reset
-		if (resetTrigger.process(inputs[RESET_INPUT].getVoltage() + params[RESET_PARAM].getValue())) {
+		bool resetTrigged = resetTrigger.process((busClock ? 0.0f : inputs[RESET_INPUT].getVoltage()) + params[RESET_PARAM].getValue());
+		if (busClock && clockBusReader.processReset()) {
+			resetTrigged = true;
+		}
+		if (resetTrigged) {
+			if (reseedOnReset != 0) {
+				seedRandomStreams();
+			}
 			initRun(true);
 			resetLight = 1.0f;
 			displayState = DISP_NORMAL;
-			for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++) {
-				clockTriggers[trkn].reset();	
-				if (expanderPresent && !std::isnan(messagesFromExpander[Sequencer::NUM_TRACKS + trkn]) && seqCVmethod == 2)
+			for (int portn = 0; portn < NUM_PORTS; portn++) {
+				clockTriggers[portn].reset();	
+			}
+			for (int trkn = 0; trkn < NUM_TRACKS; trkn++) {
+				if (expanderPresent && !std::isnan(messagesFromExpander[NUM_PORTS + trkn]) && seqCVmethod == 2)
 					seq.setSeqIndexEdit(0, trkn);
 			}
 		}
@@ -1093,20 +1238,33 @@ struct Foundry : Module {
 		
 		
 		// CV, gate and velocity outputs
-		float cvOut[Sequencer::NUM_TRACKS];
-		float gateOut[Sequencer::NUM_TRACKS];
-		float velOut[Sequencer::NUM_TRACKS];
-		for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++) {
+		float cvOut[NUM_TRACKS];
+		float gateOut[NUM_TRACKS];
+		float velOut[NUM_TRACKS];
+		bool retriggingOnReset = (clockIgnoreOnReset != 0l && calcRGOR(retrigGatesOnReset, &inputs[RUNCV_INPUT]));
+		for (int trkn = 0; trkn < NUM_TRACKS; trkn++) {
 			cvOut[trkn] = (seq.calcCvOutputAndDecSlideStepsRemain(trkn, running, editingSequence));
-			bool retriggingOnReset = (clockIgnoreOnReset != 0l && calcRGOR(retrigGatesOnReset, &inputs[RUNCV_INPUT]));
-			gateOut[trkn] = (seq.calcGateOutput(trkn, running && !retriggingOnReset, clockTriggers[clkInSources[trkn]], sampleRate));
+			gateOut[trkn] = (seq.calcGateOutput(trkn, running && !retriggingOnReset, clockTriggers[clkInSources[trkn / TRACKS_PER_PORT]], sampleRate));
 			velOut[trkn] = (seq.calcVelOutput(trkn, running && !retriggingOnReset, editingSequence) - (velocityBipol ? 5.0f : 0.0f));			
 		}
-		if (mergeTracks == 0) {
+		if (TRACKS_PER_PORT > 1) {// poly track jacks (no merging)
+			for (int portn = 0; portn < NUM_PORTS; portn++) {
+				outputs[CV_OUTPUTS + portn].setChannels(TRACKS_PER_PORT);
+				outputs[GATE_OUTPUTS + portn].setChannels(TRACKS_PER_PORT);
+				outputs[VEL_OUTPUTS + portn].setChannels(TRACKS_PER_PORT);
+			}
+			for (int trkn = 0; trkn < NUM_TRACKS; trkn++) {
+				int portn = trkn / TRACKS_PER_PORT;
+				outputs[CV_OUTPUTS + portn].setVoltage(cvOut[trkn], trkn % TRACKS_PER_PORT);
+				outputs[GATE_OUTPUTS + portn].setVoltage(gateOut[trkn], trkn % TRACKS_PER_PORT);
+				outputs[VEL_OUTPUTS + portn].setVoltage(velOut[trkn], trkn % TRACKS_PER_PORT);
+			}
+		}
+		else if (mergeTracks == 0) {
 			outputs[CV_OUTPUTS + 0].setChannels(1);
 			outputs[GATE_OUTPUTS + 0].setChannels(1);
 			outputs[VEL_OUTPUTS + 0].setChannels(1);
-			for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++) {
+			for (int trkn = 0; trkn < NUM_PORTS; trkn++) {
 				outputs[CV_OUTPUTS + trkn].setVoltage(cvOut[trkn]);
 				outputs[GATE_OUTPUTS + trkn].setVoltage(gateOut[trkn]);
 				outputs[VEL_OUTPUTS + trkn].setVoltage(velOut[trkn]);			
@@ -1124,7 +1282,7 @@ struct Foundry : Module {
 				outputs[GATE_OUTPUTS + 0].setVoltage(gateOut[trkn], trkn);
 				outputs[VEL_OUTPUTS + 0].setVoltage(velOut[trkn], trkn);			
 			}
-			for (int trkn = 2; trkn < Sequencer::NUM_TRACKS; trkn++) {
+			for (int trkn = 2; trkn < NUM_PORTS; trkn++) {
 				outputs[CV_OUTPUTS + trkn].setVoltage(cvOut[trkn]);
 				outputs[GATE_OUTPUTS + trkn].setVoltage(gateOut[trkn]);
 				outputs[VEL_OUTPUTS + trkn].setVoltage(velOut[trkn]);			
@@ -1152,12 +1310,12 @@ struct Foundry : Module {
 			outputs[CV_OUTPUTS + 0].setChannels(4);
 			outputs[GATE_OUTPUTS + 0].setChannels(4);
 			outputs[VEL_OUTPUTS + 0].setChannels(4);
-			for (int trkn = 1; trkn < Sequencer::NUM_TRACKS; trkn++) {
+			for (int trkn = 1; trkn < NUM_PORTS; trkn++) {
 				outputs[CV_OUTPUTS + trkn].setVoltage(0.0f);
 				outputs[GATE_OUTPUTS + trkn].setVoltage(0.0f);
 				outputs[VEL_OUTPUTS + trkn].setVoltage(0.0f);			
 			}
-			for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++) {
+			for (int trkn = 0; trkn < NUM_PORTS; trkn++) {
 				outputs[CV_OUTPUTS + 0].setVoltage(cvOut[trkn], trkn);
 				outputs[GATE_OUTPUTS + 0].setVoltage(gateOut[trkn], trkn);
 				outputs[VEL_OUTPUTS + 0].setVoltage(velOut[trkn], trkn);			
@@ -1178,7 +1336,9 @@ struct Foundry : Module {
 			bool editingGates = isEditingGates();
 			
 			// Step lights
-			for (int stepn = 0; stepn < SequencerKernel::MAX_STEPS; stepn++) {
+			int stepPageOffset = getStepPageOffset();
+			for (int stepButn = 0; stepButn < NUM_STEP_BUTTONS; stepButn++) {
+				int stepn = stepPageOffset + stepButn;
 				float red = 0.0f;
 				float green = 0.0f;	
 				float white = 0.0f;
@@ -1210,8 +1370,9 @@ struct Foundry : Module {
 
 					// Run cursor (green)
 					if (running) {
-						for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++) {
-							bool trknIsUsed = outputs[CV_OUTPUTS + trkn].isConnected() || outputs[GATE_OUTPUTS + trkn].isConnected() || outputs[VEL_OUTPUTS + trkn].isConnected() || (mergeTracks > 0 && trkn <= mergeTracks);
+						for (int trkn = 0; trkn < NUM_TRACKS; trkn++) {
+							int portn = trkn / TRACKS_PER_PORT;
+							bool trknIsUsed = outputs[CV_OUTPUTS + portn].isConnected() || outputs[GATE_OUTPUTS + portn].isConnected() || outputs[VEL_OUTPUTS + portn].isConnected() || (TRACKS_PER_PORT == 1 && mergeTracks > 0 && trkn <= mergeTracks);
 							if (stepn == seq.getStepIndexRun(trkn) && trknIsUsed) 
 								green = 0.42f;	
 						}
@@ -1239,8 +1400,8 @@ struct Foundry : Module {
 					}
 				}
 
-				setGreenRed(STEP_PHRASE_LIGHTS + stepn * 3, green, red);
-				lights[STEP_PHRASE_LIGHTS + stepn * 3 + 2].setBrightness(white);
+				setGreenRed(STEP_PHRASE_LIGHTS + stepButn * 3, green, red);
+				lights[STEP_PHRASE_LIGHTS + stepButn * 3 + 2].setBrightness(white);
 			}
 			
 			
@@ -1279,7 +1440,7 @@ struct Foundry : Module {
 						unsigned long editingType = seq.getEditingType();
 						if (editingType > 0ul) {
 							if (i == seq.getEditingGateKeyLight()) {
-								float dimMult = ((float) editingType / (float)(Sequencer::gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips));
+								float dimMult = ((float) editingType / (float)(TSequencer::gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips));
 								green *= dimMult;
 								red *= dimMult;
 							}
@@ -1352,8 +1513,8 @@ struct Foundry : Module {
 			}
 			
 			// CV writing lights (CV only, CV2 done below for exp panel)
-			for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++) {
-				lights[WRITECV_LIGHTS + trkn].setBrightness((editingSequence && ((writeMode & 0x2) == 0) && (multiTracks || seq.getTrackIndexEdit() == trkn)) ? 1.0f : 0.0f);
+			for (int portn = 0; portn < NUM_PORTS; portn++) {
+				lights[WRITECV_LIGHTS + portn].setBrightness((editingSequence && ((writeMode & 0x2) == 0) && (multiTracks || seq.getTrackIndexEdit() / TRACKS_PER_PORT == portn)) ? 1.0f : 0.0f);
 			}	
 			
 			
@@ -1370,13 +1531,13 @@ struct Foundry : Module {
 			}
 			
 			// To Expander
-			if (rightExpander.module && rightExpander.module->model == modelFoundryExpander) {
+			if (isExpanderPresent()) {
 				float *messagesToExpander = static_cast<float*>(rightExpander.module->leftExpander.producerMessage);
 				messagesToExpander[0] = (float)panelTheme;
 				messagesToExpander[1] = panelContrast;
 				messagesToExpander[2] = (((writeMode & 0x2) == 0) && editingSequence) ? 1.0f : 0.0f;// lights[WRITE_SEL_LIGHTS + 0].setBrightness()
 				messagesToExpander[3] = (((writeMode & 0x1) == 0) && editingSequence) ? 1.0f : 0.0f;// lights[WRITE_SEL_LIGHTS + 1].setBrightness()
-				for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++) {
+				for (int trkn = 0; trkn < NUM_PORTS; trkn++) {
 					messagesToExpander[4 + trkn] = (editingSequence && ((writeMode & 0x1) == 0) && (multiTracks || seq.getTrackIndexEdit() == trkn)) ? 1.0f : 0.0f;
 				}	
 				rightExpander.module->leftExpander.messageFlipRequested = true;
@@ -1386,6 +1547,8 @@ struct Foundry : Module {
 		if (clockIgnoreOnReset > 0l)
 			clockIgnoreOnReset--;
 		
+		// publish the edits of the song and sequences for dataToJson(), when there are any (see StateSnapshot)
+		processSnapshot();
 	}// process()
 	
 
@@ -1396,21 +1559,27 @@ struct Foundry : Module {
 	
 	inline void calcClkInSources() {
 		// index 0 is always 0 so nothing to do for it
-		for (int trkn = 1; trkn < Sequencer::NUM_TRACKS; trkn++) {
-			if (inputs[CLOCK_INPUTS + trkn].isConnected())
-				clkInSources[trkn] = trkn;
+		for (int portn = 1; portn < NUM_PORTS; portn++) {
+			if (inputs[CLOCK_INPUTS + portn].isConnected())
+				clkInSources[portn] = portn;
 			else 
-				clkInSources[trkn] = clkInSources[trkn - 1];
+				clkInSources[portn] = clkInSources[portn - 1];
 		}
 	}
 };
 
+typedef FoundryModule<FoundrySequencer> Foundry;
+typedef FoundryModule<Foundry16Sequencer> Foundry16;
+
 
 
-struct FoundryWidget : ModuleWidget {
+template <class TModule>
+struct FoundryModuleWidget : ModuleWidget {
+	typedef typename TModule::Kernel Kernel;
+
 	template <int NUMCHAR>
 	struct DisplayWidget : TransparentWidget {// a centered display, must derive from this
-		Foundry *module = nullptr;
+		TModule *module = nullptr;
 		std::shared_ptr<Font> font;
 		std::string fontPath;
 		char displayStr[16] = {};
@@ -1418,11 +1587,11 @@ struct FoundryWidget : ModuleWidget {
 		static constexpr float textOffsetY = 19.9f; // 18.2f for 14 pt, 19.7f for 15pt
 		
 		void runModeToStr(int num) {
-			if (num >= 0 && num < SequencerKernel::NUM_MODES)
-				snprintf(displayStr, 4, "%s", SequencerKernel::modeLabels[num].c_str());
+			if (num >= 0 && num < Kernel::NUM_MODES)
+				snprintf(displayStr, 4, "%s", Kernel::modeLabels[num].c_str());
 		}
 
-		DisplayWidget(Vec _pos, Vec _size, Foundry *_module) {
+		DisplayWidget(Vec _pos, Vec _size, TModule *_module) {
 			box.size = _size;
 			box.pos = _pos.minus(_size.div(2));
 			module = _module;
@@ -1458,7 +1627,14 @@ struct FoundryWidget : ModuleWidget {
 	};
 	
 	struct VelocityDisplayWidget : DisplayWidget<4> {
-		VelocityDisplayWidget(Vec _pos, Vec _size, Foundry *_module) : DisplayWidget(_pos, _size, _module) {};
+		using DisplayWidget<4>::module;
+		using DisplayWidget<4>::font;
+		using DisplayWidget<4>::fontPath;
+		using DisplayWidget<4>::displayStr;
+		using DisplayWidget<4>::textFontSize;
+		using DisplayWidget<4>::textOffsetY;
+		using DisplayWidget<4>::runModeToStr;
+		VelocityDisplayWidget(Vec _pos, Vec _size, TModule *_module) : DisplayWidget<4>(_pos, _size, _module) {};
 
 		void drawLayer(const DrawArgs &args, int layer) override {
 			if (layer == 1) {
@@ -1558,7 +1734,14 @@ struct FoundryWidget : ModuleWidget {
 	
 	// Sequence edit display
 	struct SeqEditDisplayWidget : DisplayWidget<3> {
-		SeqEditDisplayWidget(Vec _pos, Vec _size, Foundry *_module) : DisplayWidget(_pos, _size, _module) {};
+		using DisplayWidget<3>::module;
+		using DisplayWidget<3>::font;
+		using DisplayWidget<3>::fontPath;
+		using DisplayWidget<3>::displayStr;
+		using DisplayWidget<3>::textFontSize;
+		using DisplayWidget<3>::textOffsetY;
+		using DisplayWidget<3>::runModeToStr;
+		SeqEditDisplayWidget(Vec _pos, Vec _size, TModule *_module) : DisplayWidget<3>(_pos, _size, _module) {};
 		int lastNum = -1;// -1 means timedout; >= 0 means we have a first number potential, if ever second key comes fast enough
 		clock_t lastTime = 0;
 
@@ -1580,21 +1763,21 @@ struct FoundryWidget : ModuleWidget {
 					num = e.key - GLFW_KEY_KP_0;
 				}
 				else if (e.key == GLFW_KEY_SPACE) {
-					if (module->displayState == Foundry::DISP_MODE_SEQ) {
+					if (module->displayState == TModule::DISP_MODE_SEQ) {
 					}
-					else if (module->displayState == Foundry::DISP_PPQN) {
+					else if (module->displayState == TModule::DISP_PPQN) {
 					}
-					else if (module->displayState == Foundry::DISP_DELAY) {
+					else if (module->displayState == TModule::DISP_DELAY) {
 					}
-					else if (module->displayState == Foundry::DISP_MODE_SONG) {
+					else if (module->displayState == TModule::DISP_MODE_SONG) {
 					}
 					else {
 						if (!module->attached || !module->running) {
 							if (!module->editingSequence) {
-								if (module->displayState != Foundry::DISP_PPQN && module->displayState != Foundry::DISP_DELAY) {
+								if (module->displayState != TModule::DISP_PPQN && module->displayState != TModule::DISP_DELAY) {
 									module->seq.movePhraseIndexEdit(1);// argument is a delta
-									if (module->displayState != Foundry::DISP_REPS && module->displayState != Foundry::DISP_COPY_SONG_CUST)
-										module->displayState = Foundry::DISP_NORMAL;
+									if (module->displayState != TModule::DISP_REPS && module->displayState != TModule::DISP_COPY_SONG_CUST)
+										module->displayState = TModule::DISP_NORMAL;
 									if (!module->running)
 										module->seq.bringPhraseIndexRunToEdit();							
 								}	
@@ -1610,30 +1793,30 @@ struct FoundryWidget : ModuleWidget {
 
 
 					bool editingSequence = module->editingSequence;
-					if (module->displayState == Foundry::DISP_LEN) {
-						module->seq.setLength(clamp(totalNum, 1, SequencerKernel::MAX_STEPS), module->multiTracks);
+					if (module->displayState == TModule::DISP_LEN) {
+						module->seq.setLength(clamp(totalNum, 1, Kernel::MAX_STEPS), module->multiTracks);
 					}
-					else if (module->displayState == Foundry::DISP_TRANSPOSE) {
+					else if (module->displayState == TModule::DISP_TRANSPOSE) {
 					}
-					else if (module->displayState == Foundry::DISP_ROTATE) {
+					else if (module->displayState == TModule::DISP_ROTATE) {
 					}							
-					else if (module->displayState == Foundry::DISP_REPS) {
+					else if (module->displayState == TModule::DISP_REPS) {
 						module->seq.setPhraseReps(clamp(totalNum, 0, 99), module->multiTracks);
 					}
-					else if (module->displayState == Foundry::DISP_PPQN || module->displayState == Foundry::DISP_DELAY) {
+					else if (module->displayState == TModule::DISP_PPQN || module->displayState == TModule::DISP_DELAY) {
 					}
 					else {// DISP_NORMAL
-						totalNum = clamp(totalNum, 1, SequencerKernel::MAX_SEQS);
+						totalNum = clamp(totalNum, 1, Kernel::MAX_SEQS);
 						if (editingSequence) {
 							int activeTrack = module->seq.getTrackIndexEdit();
-							bool expanderPresent = (module->rightExpander.module && module->rightExpander.module->model == modelFoundryExpander);
+							bool expanderPresent = module->isExpanderPresent();
 							const float *messagesFromExpander = static_cast<float*>(module->rightExpander.consumerMessage);// could be invalid pointer when !expanderPresent, so read it only when expanderPresent
-							if (!expanderPresent || std::isnan(messagesFromExpander[Sequencer::NUM_TRACKS + activeTrack])) {
+							if (!expanderPresent || std::isnan(messagesFromExpander[TModule::NUM_PORTS + activeTrack])) {
 								module->seq.setSeqIndexEdit(totalNum - 1, activeTrack);
 								if (module->multiTracks) {
-									for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++) {
+									for (int trkn = 0; trkn < TModule::NUM_TRACKS; trkn++) {
 										if (trkn == activeTrack) continue;
-										if (!expanderPresent || std::isnan(messagesFromExpander[Sequencer::NUM_TRACKS + trkn])) {
+										if (!expanderPresent || std::isnan(messagesFromExpander[TModule::NUM_PORTS + trkn])) {
 											module->seq.setSeqIndexEdit(totalNum - 1, trkn);
 										}
 									}
@@ -1645,6 +1828,7 @@ struct FoundryWidget : ModuleWidget {
 								module->seq.setPhraseSeqNum(totalNum - 1, module->multiTracks);
 						}
 					}	
+					module->markEditedFromUi();
 				}
 				
 				lastTime = currentTime;
@@ -1660,23 +1844,23 @@ struct FoundryWidget : ModuleWidget {
 			else {
 				switch (module->displayState) {
 				
-					case Foundry::DISP_PPQN :
-					case Foundry::DISP_DELAY :
+					case TModule::DISP_PPQN :
+					case TModule::DISP_DELAY :
 						snprintf(displayStr, 4, " - ");
 					break;
-					case Foundry::DISP_REPS :
+					case TModule::DISP_REPS :
 						snprintf(displayStr, 16, "R%2u", (unsigned) module->seq.getPhraseReps());
 					break;
-					case Foundry::DISP_COPY_SEQ :
+					case TModule::DISP_COPY_SEQ :
 						snprintf(displayStr, 4, "CPY");
 					break;
-					case Foundry::DISP_PASTE_SEQ :
+					case TModule::DISP_PASTE_SEQ :
 						snprintf(displayStr, 4, "PST");
 					break;
-					case Foundry::DISP_LEN :
+					case TModule::DISP_LEN :
 						snprintf(displayStr, 16, "L%2u", (unsigned) module->seq.getLength());
 					break;
-					case Foundry::DISP_TRANSPOSE :
+					case TModule::DISP_TRANSPOSE :
 					{
 						int tranOffset = module->seq.getTransposeOffset();
 						snprintf(displayStr, 16, "+%2u", (unsigned) abs(tranOffset));
@@ -1684,7 +1868,7 @@ struct FoundryWidget : ModuleWidget {
 							displayStr[0] = '-';
 					}
 					break;
-					case Foundry::DISP_ROTATE :
+					case TModule::DISP_ROTATE :
 					{
 						int rotOffset = module->seq.getRotateOffset();
 						snprintf(displayStr, 16, ")%2u", (unsigned) abs(rotOffset));
@@ -1709,7 +1893,14 @@ struct FoundryWidget : ModuleWidget {
 	
 	// Phrase edit display
 	struct PhrEditDisplayWidget : DisplayWidget<3> {
-		PhrEditDisplayWidget(Vec _pos, Vec _size, Foundry *_module) : DisplayWidget(_pos, _size, _module) {};
+		using DisplayWidget<3>::module;
+		using DisplayWidget<3>::font;
+		using DisplayWidget<3>::fontPath;
+		using DisplayWidget<3>::displayStr;
+		using DisplayWidget<3>::textFontSize;
+		using DisplayWidget<3>::textOffsetY;
+		using DisplayWidget<3>::runModeToStr;
+		PhrEditDisplayWidget(Vec _pos, Vec _size, TModule *_module) : DisplayWidget<3>(_pos, _size, _module) {};
 
 		char printText() override {
 			char overlayChar = 0;// extra char to print an end symbol overlaped (begin symbol done in here)
@@ -1717,22 +1908,22 @@ struct FoundryWidget : ModuleWidget {
 				snprintf(displayStr, 4, " - ");
 			}
 			else {
-				if (module->displayState == Foundry::DISP_COPY_SONG) {
+				if (module->displayState == TModule::DISP_COPY_SONG) {
 					snprintf(displayStr, 4, "CPY");
 				}
-				else if (module->displayState == Foundry::DISP_PASTE_SONG) {
+				else if (module->displayState == TModule::DISP_PASTE_SONG) {
 					snprintf(displayStr, 4, "PST");
 				}
-				else if (module->displayState == Foundry::DISP_MODE_SONG) {
+				else if (module->displayState == TModule::DISP_MODE_SONG) {
 					runModeToStr(module->seq.getRunModeSong());
 				}
-				else if (module->displayState == Foundry::DISP_PPQN) {
+				else if (module->displayState == TModule::DISP_PPQN) {
 					snprintf(displayStr, 4, "x%2u", (unsigned) module->seq.getPulsesPerStep());
 				}
-				else if (module->displayState == Foundry::DISP_DELAY) {
+				else if (module->displayState == TModule::DISP_DELAY) {
 					snprintf(displayStr, 4, "D%2u", (unsigned) module->seq.getDelay());
 				}
-				else if (module->displayState == Foundry::DISP_MODE_SEQ) {
+				else if (module->displayState == TModule::DISP_MODE_SEQ) {
 					runModeToStr(module->seq.getRunModeSeq());
 				}
 				else { 
@@ -1757,7 +1948,7 @@ struct FoundryWidget : ModuleWidget {
 						}
 						else if (phrn < phrEnd && phrn > phrBeg)
 							displayStr[0] = '_';
-						if (module->displayState == Foundry::DISP_COPY_SONG_CUST) {
+						if (module->displayState == TModule::DISP_COPY_SONG_CUST) {
 							overlayChar = 0;
 							displayStr[0] = (time(0) & 0x1) ? 'C' : ' ';
 						}
@@ -1770,7 +1961,14 @@ struct FoundryWidget : ModuleWidget {
 	
 	
 	struct TrackDisplayWidget : DisplayWidget<2> {
-		TrackDisplayWidget(Vec _pos, Vec _size, Foundry *_module) : DisplayWidget(_pos, _size, _module) {};
+		using DisplayWidget<2>::module;
+		using DisplayWidget<2>::font;
+		using DisplayWidget<2>::fontPath;
+		using DisplayWidget<2>::displayStr;
+		using DisplayWidget<2>::textFontSize;
+		using DisplayWidget<2>::textOffsetY;
+		using DisplayWidget<2>::runModeToStr;
+		TrackDisplayWidget(Vec _pos, Vec _size, TModule *_module) : DisplayWidget<2>(_pos, _size, _module) {};
 		char printText() override {
 			if (module == NULL) {
 				snprintf(displayStr, 3, " A");
@@ -1790,7 +1988,7 @@ struct FoundryWidget : ModuleWidget {
 
 	struct InteropSeqItem : MenuItem {
 		struct InteropCopySeqItem : MenuItem {
-			Foundry *module;
+			TModule *module;
 			void onAction(const event::Action &e) override {
 				int seqLen;
 				IoStep* ioSteps = module->fillIoSteps(&seqLen);
@@ -1799,17 +1997,17 @@ struct FoundryWidget : ModuleWidget {
 			}
 		};
 		struct InteropPasteSeqItem : MenuItem {
-			Foundry *module;
+			TModule *module;
 			void onAction(const event::Action &e) override {
 				int seqLen;
-				IoStep* ioSteps = interopPasteSequence(SequencerKernel::MAX_STEPS, &seqLen);
+				IoStep* ioSteps = interopPasteSequence(Kernel::MAX_STEPS, &seqLen);
 				if (ioSteps != nullptr) {
 					module->emptyIoSteps(ioSteps, seqLen);
 					delete[] ioSteps;
 				}
 			}
 		};
-		Foundry *module;
+		TModule *module;
 		Menu *createChildMenu() override {
 			Menu *menu = new Menu;
 
@@ -1828,7 +2026,7 @@ struct FoundryWidget : ModuleWidget {
 	};		
 
 	void appendContextMenu(Menu *menu) override {
-		Foundry *module = static_cast<Foundry*>(this->module);
+		TModule *module = static_cast<TModule*>(this->module);
 		assert(module);
 
 		menu->addChild(new MenuSeparator());
@@ -1843,8 +2041,12 @@ struct FoundryWidget : ModuleWidget {
 		menu->addChild(new MenuSeparator());
 		menu->addChild(createMenuLabel("Settings"));
 		
+		createRandomSeedMenu(menu, &(module->seed), &(module->reseedOnReset));
+		
 		menu->addChild(createBoolPtrMenuItem("Reset on run", "", &module->resetOnRun));
 
+		createClockBusMenu(menu, &module->clockBusReader);
+
 		menu->addChild(createSubmenuItem("Retrigger gates on reset", "", [=](Menu* menu) {
 			menu->addChild(createCheckMenuItem("No", "",
 				[=]() {return module->retrigGatesOnReset == RGOR_NONE;},
@@ -1864,25 +2066,15 @@ struct FoundryWidget : ModuleWidget {
 
 		menu->addChild(createSubmenuItem("Single shot song", "", [=](Menu* menu) {
 			menu->addChild(createCheckMenuItem("Off", "",
-				[=]() {return module->stopAtEndOfSong == 4;},
-				[=]() {module->stopAtEndOfSong = 4;}
-			));
-			menu->addChild(createCheckMenuItem("Track A", "",
-				[=]() {return module->stopAtEndOfSong == 0;},
-				[=]() {module->stopAtEndOfSong = 0;}
-			));
-			menu->addChild(createCheckMenuItem("Track B", "",
-				[=]() {return module->stopAtEndOfSong == 1;},
-				[=]() {module->stopAtEndOfSong = 1;}
-			));
-			menu->addChild(createCheckMenuItem("Track C", "",
-				[=]() {return module->stopAtEndOfSong == 2;},
-				[=]() {module->stopAtEndOfSong = 2;}
-			));
-			menu->addChild(createCheckMenuItem("Track D", "",
-				[=]() {return module->stopAtEndOfSong == 3;},
-				[=]() {module->stopAtEndOfSong = 3;}
+				[=]() {return module->stopAtEndOfSong == TModule::NUM_TRACKS;},
+				[=]() {module->stopAtEndOfSong = TModule::NUM_TRACKS;}
 			));
+			for (int trkn = 0; trkn < TModule::NUM_TRACKS; trkn++) {
+				menu->addChild(createCheckMenuItem(string::f("Track %c", trkn + 'A'), "",
+					[=]() {return module->stopAtEndOfSong == trkn;},
+					[=]() {module->stopAtEndOfSong = trkn;}
+				));
+			}
 		}));	
 		
 		menu->addChild(createBoolPtrMenuItem("CV2 bipolar", "", &module->velocityBipol));
@@ -1921,33 +2113,37 @@ struct FoundryWidget : ModuleWidget {
 		
 		menu->addChild(createBoolPtrMenuItem("AutoSeq when writing via CV inputs", "", &module->autoseq));
 	
-		menu->addChild(createSubmenuItem("Poly merge into track A outputs", "", [=](Menu* menu) {
-			menu->addChild(createCheckMenuItem("None", "",
-				[=]() {return module->mergeTracks == 0;},
-				[=]() {module->mergeTracks = 0;}
-			));
-			menu->addChild(createCheckMenuItem("Track B", "",
-				[=]() {return module->mergeTracks == 1;},
-				[=]() {module->mergeTracks = 1;}
-			));
-			menu->addChild(createCheckMenuItem("Tracks B and C", "",
-				[=]() {return module->mergeTracks == 2;},
-				[=]() {module->mergeTracks = 2;}
-			));
-			menu->addChild(createCheckMenuItem("Tracks B, C and D", "",
-				[=]() {return module->mergeTracks == 3;},
-				[=]() {module->mergeTracks = 3;}
-			));
-		}));			
+		if (TModule::TRACKS_PER_PORT == 1) {// track jacks are already poly otherwise
+			menu->addChild(createSubmenuItem("Poly merge into track A outputs", "", [=](Menu* menu) {
+				menu->addChild(createCheckMenuItem("None", "",
+					[=]() {return module->mergeTracks == 0;},
+					[=]() {module->mergeTracks = 0;}
+				));
+				menu->addChild(createCheckMenuItem("Track B", "",
+					[=]() {return module->mergeTracks == 1;},
+					[=]() {module->mergeTracks = 1;}
+				));
+				menu->addChild(createCheckMenuItem("Tracks B and C", "",
+					[=]() {return module->mergeTracks == 2;},
+					[=]() {module->mergeTracks = 2;}
+				));
+				menu->addChild(createCheckMenuItem("Tracks B, C and D", "",
+					[=]() {return module->mergeTracks == 3;},
+					[=]() {module->mergeTracks = 3;}
+				));
+			}));
+		}			
 		
 		menu->addChild(new MenuSeparator());
 		menu->addChild(createMenuLabel("Actions"));
 		
-		InstantiateExpanderItem *expItem = createMenuItem<InstantiateExpanderItem>("Add expander (10HP right side)", "");
-		expItem->module = module;
-		expItem->model = modelFoundryExpander;
-		expItem->posit = box.pos.plus(math::Vec(box.size.x,0));
-		menu->addChild(expItem);	
+		if (TModule::NUM_TRACKS == TModule::NUM_PORTS) {
+			InstantiateExpanderItem *expItem = createMenuItem<InstantiateExpanderItem>("Add expander (10HP right side)", "");
+			expItem->module = module;
+			expItem->model = modelFoundryExpander;
+			expItem->posit = box.pos.plus(math::Vec(box.size.x,0));
+			menu->addChild(expItem);
+		}	
 	}	
 		
 	// Velocity edit knob
@@ -1956,10 +2152,10 @@ struct FoundryWidget : ModuleWidget {
 		void onDoubleClick(const event::DoubleClick &e) override {
 			ParamQuantity* paramQuantity = getParamQuantity();
 			if (paramQuantity) {
-				Foundry* module = static_cast<Foundry*>(paramQuantity->module);
+				TModule* module = static_cast<TModule*>(paramQuantity->module);
 				// same code structure below as in velocity knob in main step()
 				if (module->editingSequence) {
-					module->displayState = Foundry::DISP_NORMAL;
+					module->displayState = TModule::DISP_NORMAL;
 					int multiStepsCount = module->multiSteps ? module->cpMode : 1;
 					if (module->velEditMode == 2) {
 						module->seq.initSlideVal(multiStepsCount, module->multiTracks);
@@ -1971,6 +2167,7 @@ struct FoundryWidget : ModuleWidget {
 						module->seq.initVelocityVal(multiStepsCount, module->multiTracks);
 					}
 				}
+				module->markEditedFromUi();
 			}
 			ParamWidget::onDoubleClick(e);
 		}
@@ -1981,28 +2178,28 @@ struct FoundryWidget : ModuleWidget {
 		void onDoubleClick(const event::DoubleClick &e) override {
 			ParamQuantity* paramQuantity = getParamQuantity();
 			if (paramQuantity) {
-				Foundry* module = static_cast<Foundry*>(paramQuantity->module);
+				TModule* module = static_cast<TModule*>(paramQuantity->module);
 				// same code structure below as in sequence knob in main step()
-				if (module->displayState == Foundry::DISP_LEN) {
+				if (module->displayState == TModule::DISP_LEN) {
 					module->seq.initLength(module->multiTracks);
 				}
-				else if (module->displayState == Foundry::DISP_TRANSPOSE) {
+				else if (module->displayState == TModule::DISP_TRANSPOSE) {
 					module->seq.unTransposeSeq(module->multiTracks);
 				}
-				else if (module->displayState == Foundry::DISP_ROTATE) {
+				else if (module->displayState == TModule::DISP_ROTATE) {
 					module->seq.unRotateSeq(module->multiTracks);
 				}							
-				else if (module->displayState == Foundry::DISP_REPS) {
+				else if (module->displayState == TModule::DISP_REPS) {
 					module->seq.initPhraseReps(module->multiTracks);
 				}
-				else if (module->displayState == Foundry::DISP_PPQN || module->displayState == Foundry::DISP_DELAY) {
+				else if (module->displayState == TModule::DISP_PPQN || module->displayState == TModule::DISP_DELAY) {
 				}
 				else {// DISP_NORMAL
 					if (module->editingSequence) {
-						for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++) {
-							bool expanderPresent = (module->rightExpander.module && module->rightExpander.module->model == modelFoundryExpander);
+						for (int trkn = 0; trkn < TModule::NUM_TRACKS; trkn++) {
+							bool expanderPresent = module->isExpanderPresent();
 							const float *messagesFromExpander = static_cast<float*>(module->rightExpander.consumerMessage);// could be invalid pointer when !expanderPresent, so read it only when expanderPresent
-							if (!expanderPresent || std::isnan(messagesFromExpander[Sequencer::NUM_TRACKS + trkn])) {
+							if (!expanderPresent || std::isnan(messagesFromExpander[TModule::NUM_PORTS + trkn])) {
 								if (module->multiTracks || (trkn == module->seq.getTrackIndexEdit())) {
 									module->seq.setSeqIndexEdit(0, trkn);
 								}
@@ -2014,6 +2211,7 @@ struct FoundryWidget : ModuleWidget {
 							module->seq.initPhraseSeqNum(module->multiTracks);
 					}
 				}	
+				module->markEditedFromUi();
 			}
 			ParamWidget::onDoubleClick(e);
 		}
@@ -2024,39 +2222,40 @@ struct FoundryWidget : ModuleWidget {
 		void onDoubleClick(const event::DoubleClick &e) override {
 			ParamQuantity* paramQuantity = getParamQuantity();
 			if (paramQuantity) {
-				Foundry* module = static_cast<Foundry*>(paramQuantity->module);
+				TModule* module = static_cast<TModule*>(paramQuantity->module);
 				// same code structure below as in phrase knob in main step()
-				if (module->displayState == Foundry::DISP_MODE_SEQ) {
+				if (module->displayState == TModule::DISP_MODE_SEQ) {
 					module->seq.initRunModeSeq(module->multiTracks);
 				}
-				else if (module->displayState == Foundry::DISP_PPQN) {
+				else if (module->displayState == TModule::DISP_PPQN) {
 					module->seq.initPulsesPerStep(module->multiTracks);
 				}
-				else if (module->displayState == Foundry::DISP_DELAY) {
+				else if (module->displayState == TModule::DISP_DELAY) {
 					module->seq.initDelay(module->multiTracks);
 				}
-				else if (module->displayState == Foundry::DISP_MODE_SONG) {
+				else if (module->displayState == TModule::DISP_MODE_SONG) {
 					module->seq.initRunModeSong(module->multiTracks);
 				}
 				else {
 					if (!module->attached || !module->running) {
 						if (!module->editingSequence) {
-							// if (module->displayState != Foundry::DISP_PPQN && module->displayState != Foundry::DISP_DELAY) { // redundant
+							// if (module->displayState != TModule::DISP_PPQN && module->displayState != TModule::DISP_DELAY) { // redundant
 								module->seq.setPhraseIndexEdit(0);
-								if (module->displayState != Foundry::DISP_REPS && module->displayState != Foundry::DISP_COPY_SONG_CUST)
-									module->displayState = Foundry::DISP_NORMAL;
+								if (module->displayState != TModule::DISP_REPS && module->displayState != TModule::DISP_COPY_SONG_CUST)
+									module->displayState = TModule::DISP_NORMAL;
 								if (!module->running)
 									module->seq.bringPhraseIndexRunToEdit();							
 							// }	
 						}
 					}
 				}
+				module->markEditedFromUi();
 			}
 			ParamWidget::onDoubleClick(e);
 		}
 	};
 		
-	FoundryWidget(Foundry *module) {
+	FoundryModuleWidget(TModule *module) {
 		setModule(module);
 		int* mode = module ? &module->panelTheme : NULL;
 		float* cont = module ? &module->panelContrast : NULL;
@@ -2090,30 +2289,30 @@ struct FoundryWidget : ModuleWidget {
 		int posX = columnRulerT0;
 		static int spacingSteps = 20;
 		static int spacingSteps4 = 4;
-		const int numX = SequencerKernel::MAX_STEPS / 2;
+		const int numX = TModule::NUM_STEP_BUTTONS / 2;
 		for (int x = 0; x < numX; x++) {
 			// First row
-			addParam(createParamCentered<LEDButton>(VecPx(posX, rowRulerT0 - stepsOffsetY), module, Foundry::STEP_PHRASE_PARAMS + x));
-			addChild(createLightCentered<MediumLight<GreenRedWhiteLightIM>>(VecPx(posX, rowRulerT0 - stepsOffsetY), module, Foundry::STEP_PHRASE_LIGHTS + (x * 3)));
+			addParam(createParamCentered<LEDButton>(VecPx(posX, rowRulerT0 - stepsOffsetY), module, TModule::STEP_PHRASE_PARAMS + x));
+			addChild(createLightCentered<MediumLight<GreenRedWhiteLightIM>>(VecPx(posX, rowRulerT0 - stepsOffsetY), module, TModule::STEP_PHRASE_LIGHTS + (x * 3)));
 			// Second row
-			addParam(createParamCentered<LEDButton>(VecPx(posX, rowRulerT0 + stepsOffsetY), module, Foundry::STEP_PHRASE_PARAMS + x + numX));
-			addChild(createLightCentered<MediumLight<GreenRedWhiteLightIM>>(VecPx(posX, rowRulerT0 + stepsOffsetY), module, Foundry::STEP_PHRASE_LIGHTS + ((x + numX) * 3)));
+			addParam(createParamCentered<LEDButton>(VecPx(posX, rowRulerT0 + stepsOffsetY), module, TModule::STEP_PHRASE_PARAMS + x + numX));
+			addChild(createLightCentered<MediumLight<GreenRedWhiteLightIM>>(VecPx(posX, rowRulerT0 + stepsOffsetY), module, TModule::STEP_PHRASE_LIGHTS + ((x + numX) * 3)));
 			// step position to next location and handle groups of four
 			posX += spacingSteps;
 			if ((x + 1) % 4 == 0)
 				posX += spacingSteps4;
 		}
 		// Sel button
-		addParam(createDynamicParamCentered<IMPushButton>(VecPx(columnRulerT1, rowRulerT0), module, Foundry::SEL_PARAM, mode));
+		addParam(createDynamicParamCentered<IMPushButton>(VecPx(columnRulerT1, rowRulerT0), module, TModule::SEL_PARAM, mode));
 		
 		// Copy-paste and select mode switch (3 position)
-		addParam(createDynamicSwitchCentered<IMSwitch3VInv>(VecPx(columnRulerT2, rowRulerT0), module, Foundry::CPMODE_PARAM, mode, svgPanel));	// 0.0f is top position
+		addParam(createDynamicSwitchCentered<IMSwitch3VInv>(VecPx(columnRulerT2, rowRulerT0), module, TModule::CPMODE_PARAM, mode, svgPanel));	// 0.0f is top position
 		
 		// Copy/paste buttons
 		// see under Track display
 		
 		// Main switch
-		addParam(createDynamicSwitchCentered<IMSwitch2V>(VecPx(columnRulerT5, rowRulerT0 + 3), module, Foundry::EDIT_PARAM, mode, svgPanel));// 1.0f is top position
+		addParam(createDynamicSwitchCentered<IMSwitch2V>(VecPx(columnRulerT5, rowRulerT0 + 3), module, TModule::EDIT_PARAM, mode, svgPanel));// 1.0f is top position
 
 		
 		
@@ -2123,8 +2322,8 @@ struct FoundryWidget : ModuleWidget {
 		static const int octLightsIntY = 20;
 		static const int rowRulerOct = 111;
 		for (int i = 0; i < 7; i++) {
-			addParam(createParamCentered<LEDButton>(VecPx(columnRulerT0, rowRulerOct + i * octLightsIntY), module, Foundry::OCTAVE_PARAM + i));
-			addChild(createLightCentered<MediumLight<RedLightIM>>(VecPx(columnRulerT0, rowRulerOct + i * octLightsIntY), module, Foundry::OCTAVE_LIGHTS + i));
+			addParam(createParamCentered<LEDButton>(VecPx(columnRulerT0, rowRulerOct + i * octLightsIntY), module, TModule::OCTAVE_PARAM + i));
+			addChild(createLightCentered<MediumLight<RedLightIM>>(VecPx(columnRulerT0, rowRulerOct + i * octLightsIntY), module, TModule::OCTAVE_LIGHTS + i));
 		}
 		
 		// Keys and Key lights
@@ -2135,7 +2334,7 @@ struct FoundryWidget : ModuleWidget {
 		for (int k = 0; k < 12; k++) {
 			Vec keyPos = keyboardPos + mm2px(smaKeysPos[k]);
 			addChild(createPianoKey<PianoKeySmall>(keyPos, k, module ? &module->pkInfo : NULL));
-			addChild(createLightCentered<MediumLight<GreenRedLightIM>>(keyPos + offsetLeds, module, Foundry::KEY_LIGHTS + k * 2));
+			addChild(createLightCentered<MediumLight<GreenRedLightIM>>(keyPos + offsetLeds, module, TModule::KEY_LIGHTS + k * 2));
 		}
 
 
@@ -2157,11 +2356,11 @@ struct FoundryWidget : ModuleWidget {
 		addChild(velocityDisplayWidget);// 3 characters
 		svgPanel->fb->addChild(new DisplayBackground(velocityDisplayWidget->box.pos, velocityDisplayWidget->box.size, mode));
 		// Velocity knob
-		addParam(createDynamicParamCentered<VelocityKnob>(VecPx(colRulerVel, rowRulerKnobs), module, Foundry::VEL_KNOB_PARAM, mode));	
+		addParam(createDynamicParamCentered<VelocityKnob>(VecPx(colRulerVel, rowRulerKnobs), module, TModule::VEL_KNOB_PARAM, mode));	
 		// Veocity mode button and lights
-		addParam(createDynamicParamCentered<IMPushButton>(VecPx(colRulerVel - trkButtonsOffsetX - 2, rowRulerSmallButtons), module, Foundry::VEL_EDIT_PARAM, mode));
-		addChild(createLightCentered<MediumLight<GreenRedLightIM>>(VecPx(colRulerVel + 4, rowRulerSmallButtons), module, Foundry::VEL_PROB_LIGHT));
-		addChild(createLightCentered<MediumLight<RedLightIM>>(VecPx(colRulerVel + 20, rowRulerSmallButtons), module, Foundry::VEL_SLIDE_LIGHT));
+		addParam(createDynamicParamCentered<IMPushButton>(VecPx(colRulerVel - trkButtonsOffsetX - 2, rowRulerSmallButtons), module, TModule::VEL_EDIT_PARAM, mode));
+		addChild(createLightCentered<MediumLight<GreenRedLightIM>>(VecPx(colRulerVel + 4, rowRulerSmallButtons), module, TModule::VEL_PROB_LIGHT));
+		addChild(createLightCentered<MediumLight<RedLightIM>>(VecPx(colRulerVel + 20, rowRulerSmallButtons), module, TModule::VEL_SLIDE_LIGHT));
 		
 
 		// Seq edit display 
@@ -2170,9 +2369,9 @@ struct FoundryWidget : ModuleWidget {
 		addChild(seqEditDisplayWidget);
 		svgPanel->fb->addChild(new DisplayBackground(seqEditDisplayWidget->box.pos, seqEditDisplayWidget->box.size, mode));
 		// Sequence-edit knob
-		addParam(createDynamicParamCentered<SequenceKnob>(VecPx(colRulerEditSeq, rowRulerKnobs), module, Foundry::SEQUENCE_PARAM, mode));		
+		addParam(createDynamicParamCentered<SequenceKnob>(VecPx(colRulerEditSeq, rowRulerKnobs), module, TModule::SEQUENCE_PARAM, mode));		
 		// Transpose/rotate button
-		addParam(createDynamicParamCentered<IMPushButton>(VecPx(colRulerEditSeq, rowRulerSmallButtons), module, Foundry::TRAN_ROT_PARAM, mode));
+		addParam(createDynamicParamCentered<IMPushButton>(VecPx(colRulerEditSeq, rowRulerSmallButtons), module, TModule::TRAN_ROT_PARAM, mode));
 	
 			
 		// Phrase edit display 
@@ -2181,10 +2380,10 @@ struct FoundryWidget : ModuleWidget {
 		addChild(phrEditDisplayWidget);
 		svgPanel->fb->addChild(new DisplayBackground(phrEditDisplayWidget->box.pos, phrEditDisplayWidget->box.size, mode));
 		// Phrase knob
-		addParam(createDynamicParamCentered<PhraseKnob>(VecPx(colRulerEditPhr, rowRulerKnobs), module, Foundry::PHRASE_PARAM, mode));		
+		addParam(createDynamicParamCentered<PhraseKnob>(VecPx(colRulerEditPhr, rowRulerKnobs), module, TModule::PHRASE_PARAM, mode));		
 		// Begin/end buttons
-		addParam(createDynamicParamCentered<IMPushButton>(VecPx(colRulerEditPhr - trkButtonsOffsetX, rowRulerSmallButtons), module, Foundry::BEGIN_PARAM, mode));
-		addParam(createDynamicParamCentered<IMPushButton>(VecPx(colRulerEditPhr + trkButtonsOffsetX, rowRulerSmallButtons), module, Foundry::END_PARAM, mode));
+		addParam(createDynamicParamCentered<IMPushButton>(VecPx(colRulerEditPhr - trkButtonsOffsetX, rowRulerSmallButtons), module, TModule::BEGIN_PARAM, mode));
+		addParam(createDynamicParamCentered<IMPushButton>(VecPx(colRulerEditPhr + trkButtonsOffsetX, rowRulerSmallButtons), module, TModule::END_PARAM, mode));
 
 				
 		// Track display
@@ -2193,18 +2392,18 @@ struct FoundryWidget : ModuleWidget {
 		addChild(trackDisplayWidget);
 		svgPanel->fb->addChild(new DisplayBackground(trackDisplayWidget->box.pos, trackDisplayWidget->box.size, mode));
 		// Track buttons
-		addParam(createDynamicParamCentered<IMPushButton>(VecPx(colRulerTrk + trkButtonsOffsetX, rowRulerKnobs), module, Foundry::TRACKUP_PARAM, mode));
-		addParam(createDynamicParamCentered<IMPushButton>(VecPx(colRulerTrk - trkButtonsOffsetX, rowRulerKnobs), module, Foundry::TRACKDOWN_PARAM, mode));
+		addParam(createDynamicParamCentered<IMPushButton>(VecPx(colRulerTrk + trkButtonsOffsetX, rowRulerKnobs), module, TModule::TRACKUP_PARAM, mode));
+		addParam(createDynamicParamCentered<IMPushButton>(VecPx(colRulerTrk - trkButtonsOffsetX, rowRulerKnobs), module, TModule::TRACKDOWN_PARAM, mode));
 		// AllTracks button
-		addParam(createDynamicParamCentered<IMPushButton>(VecPx(colRulerTrk, rowRulerSmallButtons - 12), module, Foundry::ALLTRACKS_PARAM, mode));
+		addParam(createDynamicParamCentered<IMPushButton>(VecPx(colRulerTrk, rowRulerSmallButtons - 12), module, TModule::ALLTRACKS_PARAM, mode));
 		// Copy/paste buttons
-		addParam(createDynamicParamCentered<IMPushButton>(VecPx(colRulerTrk - trkButtonsOffsetX, rowRulerT0), module, Foundry::COPY_PARAM, mode));
-		addParam(createDynamicParamCentered<IMPushButton>(VecPx(colRulerTrk + trkButtonsOffsetX, rowRulerT0), module, Foundry::PASTE_PARAM, mode));
+		addParam(createDynamicParamCentered<IMPushButton>(VecPx(colRulerTrk - trkButtonsOffsetX, rowRulerT0), module, TModule::COPY_PARAM, mode));
+		addParam(createDynamicParamCentered<IMPushButton>(VecPx(colRulerTrk + trkButtonsOffsetX, rowRulerT0), module, TModule::PASTE_PARAM, mode));
 	
 	
 		// Attach button and light
-		addParam(createDynamicParamCentered<IMPushButton>(VecPx(columnRulerT5 - 10, rowRulerDisp + 14), module, Foundry::ATTACH_PARAM, mode));
-		addChild(createLightCentered<MediumLight<RedLightIM>>(VecPx(columnRulerT5 + 10, rowRulerDisp + 14), module, Foundry::ATTACH_LIGHT));
+		addParam(createDynamicParamCentered<IMPushButton>(VecPx(columnRulerT5 - 10, rowRulerDisp + 14), module, TModule::ATTACH_PARAM, mode));
+		addChild(createLightCentered<MediumLight<RedLightIM>>(VecPx(columnRulerT5 + 10, rowRulerDisp + 14), module, TModule::ATTACH_LIGHT));
 	
 	
 		// ****** Gate and slide section ******
@@ -2216,36 +2415,36 @@ struct FoundryWidget : ModuleWidget {
 		
 		// Key mode LED buttons	
 		static const int colRulerKM = 61;
-		addParam(createDynamicSwitchCentered<IMSwitch2V>(VecPx(colRulerKM, rowRulerMB0), module, Foundry::KEY_GATE_PARAM, mode, svgPanel));
+		addParam(createDynamicSwitchCentered<IMSwitch2V>(VecPx(colRulerKM, rowRulerMB0), module, TModule::KEY_GATE_PARAM, mode, svgPanel));
 		
 		// Gate 1 light and button
-		addChild(createLightCentered<MediumLight<GreenRedLightIM>>(VecPx(columnRulerMB1 + posLEDvsButton, rowRulerMB0), module, Foundry::GATE_LIGHT));		
-		addParam(createDynamicParamCentered<IMBigPushButton>(VecPx(columnRulerMB1, rowRulerMB0), module, Foundry::GATE_PARAM, mode));
+		addChild(createLightCentered<MediumLight<GreenRedLightIM>>(VecPx(columnRulerMB1 + posLEDvsButton, rowRulerMB0), module, TModule::GATE_LIGHT));		
+		addParam(createDynamicParamCentered<IMBigPushButton>(VecPx(columnRulerMB1, rowRulerMB0), module, TModule::GATE_PARAM, mode));
 		// Tie light and button
-		addChild(createLightCentered<MediumLight<RedLightIM>>(VecPx(columnRulerMB2 + posLEDvsButton, rowRulerMB0), module, Foundry::TIE_LIGHT));		
-		addParam(createDynamicParamCentered<IMBigPushButton>(VecPx(columnRulerMB2, rowRulerMB0), module, Foundry::TIE_PARAM, mode));
+		addChild(createLightCentered<MediumLight<RedLightIM>>(VecPx(columnRulerMB2 + posLEDvsButton, rowRulerMB0), module, TModule::TIE_LIGHT));		
+		addParam(createDynamicParamCentered<IMBigPushButton>(VecPx(columnRulerMB2, rowRulerMB0), module, TModule::TIE_PARAM, mode));
 		// Gate 1 probability light and button
-		addChild(createLightCentered<MediumLight<GreenRedLightIM>>(VecPx(columnRulerMB3 + posLEDvsButton, rowRulerMB0), module, Foundry::GATE_PROB_LIGHT));		
-		addParam(createDynamicParamCentered<IMBigPushButton>(VecPx(columnRulerMB3, rowRulerMB0), module, Foundry::GATE_PROB_PARAM, mode));
+		addChild(createLightCentered<MediumLight<GreenRedLightIM>>(VecPx(columnRulerMB3 + posLEDvsButton, rowRulerMB0), module, TModule::GATE_PROB_LIGHT));		
+		addParam(createDynamicParamCentered<IMBigPushButton>(VecPx(columnRulerMB3, rowRulerMB0), module, TModule::GATE_PROB_PARAM, mode));
 		
 		// Slide light and button
-		addChild(createLightCentered<MediumLight<RedLightIM>>(VecPx(colRulerVel + posLEDvsButton, rowRulerMB0), module, Foundry::SLIDE_LIGHT));		
-		addParam(createDynamicParamCentered<IMBigPushButton>(VecPx(colRulerVel, rowRulerMB0), module, Foundry::SLIDE_BTN_PARAM, mode));
+		addChild(createLightCentered<MediumLight<RedLightIM>>(VecPx(colRulerVel + posLEDvsButton, rowRulerMB0), module, TModule::SLIDE_LIGHT));		
+		addParam(createDynamicParamCentered<IMBigPushButton>(VecPx(colRulerVel, rowRulerMB0), module, TModule::SLIDE_BTN_PARAM, mode));
 		// Mode button
-		addParam(createDynamicParamCentered<IMBigPushButton>(VecPx(colRulerEditPhr, rowRulerMB0), module, Foundry::MODE_PARAM, mode));
+		addParam(createDynamicParamCentered<IMBigPushButton>(VecPx(colRulerEditPhr, rowRulerMB0), module, TModule::MODE_PARAM, mode));
 		// Rep/Len button
-		addParam(createDynamicParamCentered<IMBigPushButton>(VecPx(colRulerEditSeq, rowRulerMB0), module, Foundry::REP_LEN_PARAM, mode));
+		addParam(createDynamicParamCentered<IMBigPushButton>(VecPx(colRulerEditSeq, rowRulerMB0), module, TModule::REP_LEN_PARAM, mode));
 		// Clk res
-		addParam(createDynamicParamCentered<IMBigPushButton>(VecPx(colRulerTrk, rowRulerMB0), module, Foundry::CLKRES_PARAM, mode));
+		addParam(createDynamicParamCentered<IMBigPushButton>(VecPx(colRulerTrk, rowRulerMB0), module, TModule::CLKRES_PARAM, mode));
 		
 		// Reset and run LED buttons
 		static const int colRulerResetRun = columnRulerT5;
 		// Run LED bezel and light
-		addParam(createParamCentered<LEDBezel>(VecPx(colRulerResetRun, rowRulerSmallButtons - 6), module, Foundry::RUN_PARAM));
-		addChild(createLightCentered<LEDBezelLight<GreenLightIM>>(VecPx(colRulerResetRun, rowRulerSmallButtons - 6), module, Foundry::RUN_LIGHT));
+		addParam(createParamCentered<LEDBezel>(VecPx(colRulerResetRun, rowRulerSmallButtons - 6), module, TModule::RUN_PARAM));
+		addChild(createLightCentered<LEDBezelLight<GreenLightIM>>(VecPx(colRulerResetRun, rowRulerSmallButtons - 6), module, TModule::RUN_LIGHT));
 		// Reset LED bezel and light
-		addParam(createParamCentered<LEDBezel>(VecPx(colRulerResetRun, rowRulerMB0), module, Foundry::RESET_PARAM));
-		addChild(createLightCentered<LEDBezelLight<GreenLightIM>>(VecPx(colRulerResetRun, rowRulerMB0), module, Foundry::RESET_LIGHT));
+		addParam(createParamCentered<LEDBezel>(VecPx(colRulerResetRun, rowRulerMB0), module, TModule::RESET_PARAM));
+		addChild(createLightCentered<LEDBezelLight<GreenLightIM>>(VecPx(colRulerResetRun, rowRulerMB0), module, TModule::RESET_LIGHT));
 		
 
 
@@ -2272,51 +2471,52 @@ struct FoundryWidget : ModuleWidget {
 		
 
 		// Autostep and write
-		addParam(createDynamicSwitchCentered<IMSwitch2V>(VecPx(columnRulerB0, rowRulerBHigh), module, Foundry::AUTOSTEP_PARAM, mode, svgPanel));		
-		addInput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB0, rowRulerBLow), true, module, Foundry::WRITE_INPUT, mode));
+		addParam(createDynamicSwitchCentered<IMSwitch2V>(VecPx(columnRulerB0, rowRulerBHigh), module, TModule::AUTOSTEP_PARAM, mode, svgPanel));		
+		addInput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB0, rowRulerBLow), true, module, TModule::WRITE_INPUT, mode));
 	
 		// CV IN inputs
 		static const int writeLEDoffsetX = 16;
 		static const int writeLEDoffsetY = 18;
-		addInput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB1, rowRulerBHigh), true, module, Foundry::CV_INPUTS + 0, mode));
-		addChild(createLightCentered<SmallLight<RedLightIM>>(VecPx(columnRulerB1 + writeLEDoffsetX, rowRulerBHigh + writeLEDoffsetY), module, Foundry::WRITECV_LIGHTS + 0));
+		addInput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB1, rowRulerBHigh), true, module, TModule::CV_INPUTS + 0, mode));
+		addChild(createLightCentered<SmallLight<RedLightIM>>(VecPx(columnRulerB1 + writeLEDoffsetX, rowRulerBHigh + writeLEDoffsetY), module, TModule::WRITECV_LIGHTS + 0));
 		
-		addInput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB2, rowRulerBHigh), true, module, Foundry::CV_INPUTS + 2, mode));
-		addChild(createLightCentered<SmallLight<RedLightIM>>(VecPx(columnRulerB2 - writeLEDoffsetX, rowRulerBHigh + writeLEDoffsetY), module, Foundry::WRITECV_LIGHTS + 2));
+		addInput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB2, rowRulerBHigh), true, module, TModule::CV_INPUTS + 2, mode));
+		addChild(createLightCentered<SmallLight<RedLightIM>>(VecPx(columnRulerB2 - writeLEDoffsetX, rowRulerBHigh + writeLEDoffsetY), module, TModule::WRITECV_LIGHTS + 2));
 
-		addInput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB1, rowRulerBLow), true, module, Foundry::CV_INPUTS + 1, mode));
-		addChild(createLightCentered<SmallLight<RedLightIM>>(VecPx(columnRulerB1 + writeLEDoffsetX, rowRulerBLow - writeLEDoffsetY), module, Foundry::WRITECV_LIGHTS + 1));
+		addInput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB1, rowRulerBLow), true, module, TModule::CV_INPUTS + 1, mode));
+		addChild(createLightCentered<SmallLight<RedLightIM>>(VecPx(columnRulerB1 + writeLEDoffsetX, rowRulerBLow - writeLEDoffsetY), module, TModule::WRITECV_LIGHTS + 1));
 
-		addInput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB2, rowRulerBLow), true, module, Foundry::CV_INPUTS + 3, mode));
-		addChild(createLightCentered<SmallLight<RedLightIM>>(VecPx(columnRulerB2 - writeLEDoffsetX, rowRulerBLow - writeLEDoffsetY), module, Foundry::WRITECV_LIGHTS + 3));
+		addInput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB2, rowRulerBLow), true, module, TModule::CV_INPUTS + 3, mode));
+		addChild(createLightCentered<SmallLight<RedLightIM>>(VecPx(columnRulerB2 - writeLEDoffsetX, rowRulerBLow - writeLEDoffsetY), module, TModule::WRITECV_LIGHTS + 3));
 		
 		// Clock+CV+Gate+Vel outputs
 		// Track A
-		addInput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB3, rowRulerBHigh), true, module, Foundry::CLOCK_INPUTS + 0, mode));
-		addOutput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB4, rowRulerBHigh), false, module, Foundry::CV_OUTPUTS + 0, mode));
-		addOutput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB5, rowRulerBHigh), false, module, Foundry::GATE_OUTPUTS + 0, mode));
-		addOutput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB6, rowRulerBHigh), false, module, Foundry::VEL_OUTPUTS + 0, mode));
+		addInput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB3, rowRulerBHigh), true, module, TModule::CLOCK_INPUTS + 0, mode));
+		addOutput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB4, rowRulerBHigh), false, module, TModule::CV_OUTPUTS + 0, mode));
+		addOutput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB5, rowRulerBHigh), false, module, TModule::GATE_OUTPUTS + 0, mode));
+		addOutput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB6, rowRulerBHigh), false, module, TModule::VEL_OUTPUTS + 0, mode));
 		// Track C
-		addInput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB7, rowRulerBHigh), true, module, Foundry::CLOCK_INPUTS + 2, mode));
-		addOutput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB8, rowRulerBHigh), false, module, Foundry::CV_OUTPUTS + 2, mode));
-		addOutput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB9, rowRulerBHigh), false, module, Foundry::GATE_OUTPUTS + 2, mode));
-		addOutput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB10, rowRulerBHigh), false, module, Foundry::VEL_OUTPUTS + 2, mode));
+		addInput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB7, rowRulerBHigh), true, module, TModule::CLOCK_INPUTS + 2, mode));
+		addOutput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB8, rowRulerBHigh), false, module, TModule::CV_OUTPUTS + 2, mode));
+		addOutput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB9, rowRulerBHigh), false, module, TModule::GATE_OUTPUTS + 2, mode));
+		addOutput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB10, rowRulerBHigh), false, module, TModule::VEL_OUTPUTS + 2, mode));
 		//
 		// Track B
-		addInput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB3, rowRulerBLow), true, module, Foundry::CLOCK_INPUTS + 1, mode));
-		addOutput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB4, rowRulerBLow), false, module, Foundry::CV_OUTPUTS + 1, mode));
-		addOutput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB5, rowRulerBLow), false, module, Foundry::GATE_OUTPUTS + 1, mode));
-		addOutput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB6, rowRulerBLow), false, module, Foundry::VEL_OUTPUTS + 1, mode));
+		addInput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB3, rowRulerBLow), true, module, TModule::CLOCK_INPUTS + 1, mode));
+		addOutput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB4, rowRulerBLow), false, module, TModule::CV_OUTPUTS + 1, mode));
+		addOutput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB5, rowRulerBLow), false, module, TModule::GATE_OUTPUTS + 1, mode));
+		addOutput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB6, rowRulerBLow), false, module, TModule::VEL_OUTPUTS + 1, mode));
 		// Track D
-		addInput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB7, rowRulerBLow), true, module, Foundry::CLOCK_INPUTS + 3, mode));
-		addOutput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB8, rowRulerBLow), false, module, Foundry::CV_OUTPUTS + 3, mode));
-		addOutput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB9, rowRulerBLow), false, module, Foundry::GATE_OUTPUTS + 3, mode));
-		addOutput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB10, rowRulerBLow), false, module, Foundry::VEL_OUTPUTS + 3, mode));
+		addInput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB7, rowRulerBLow), true, module, TModule::CLOCK_INPUTS + 3, mode));
+		addOutput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB8, rowRulerBLow), false, module, TModule::CV_OUTPUTS + 3, mode));
+		addOutput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB9, rowRulerBLow), false, module, TModule::GATE_OUTPUTS + 3, mode));
+		addOutput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB10, rowRulerBLow), false, module, TModule::VEL_OUTPUTS + 3, mode));
 
 		// Run and reset inputs
-		addInput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB11, rowRulerBHigh), true, module, Foundry::RUNCV_INPUT, mode));
-		addInput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB11, rowRulerBLow), true, module, Foundry::RESET_INPUT, mode));	
+		addInput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB11, rowRulerBHigh), true, module, TModule::RUNCV_INPUT, mode));
+		addInput(createDynamicPortCentered<IMPort>(VecPx(columnRulerB11, rowRulerBLow), true, module, TModule::RESET_INPUT, mode));	
 	}
 };
 
-Model *modelFoundry = createModel<Foundry, FoundryWidget>("Foundry");
+Model *modelFoundry = createModel<Foundry, FoundryModuleWidget<Foundry>>("Foundry");
+Model *modelFoundry16 = createModel<Foundry16, FoundryModuleWidget<Foundry16>>("Foundry16");
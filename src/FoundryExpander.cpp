@@ -18,8 +18,8 @@ struct FoundryExpander : Module {
 		NUM_PARAMS
 	};
 	enum InputIds {
-		ENUMS(VEL_INPUTS, Sequencer::NUM_TRACKS),// needs connected
-		ENUMS(SEQCV_INPUTS, Sequencer::NUM_TRACKS),// needs connected
+		ENUMS(VEL_INPUTS, FoundrySequencer::NUM_TRACKS),// needs connected
+		ENUMS(SEQCV_INPUTS, FoundrySequencer::NUM_TRACKS),// needs connected
 		TRKCV_INPUT,// needs connected
 		GATECV_INPUT,
 		GATEPCV_INPUT,
@@ -33,12 +33,12 @@ struct FoundryExpander : Module {
 	
 	enum LightIds {
 		ENUMS(WRITE_SEL_LIGHTS, 2),
-		ENUMS(WRITECV2_LIGHTS, Sequencer::NUM_TRACKS),
+		ENUMS(WRITECV2_LIGHTS, FoundrySequencer::NUM_TRACKS),
 		NUM_LIGHTS
 	};
 	
 	// Expander
-	float leftMessages[2][2 + 2 + Sequencer::NUM_TRACKS] = {};// messages from mother
+	float leftMessages[2][2 + 2 + FoundrySequencer::NUM_TRACKS] = {};// messages from mother
 
 
 	// No need to save
@@ -58,7 +58,7 @@ struct FoundryExpander : Module {
 	
 		getParamQuantity(SYNC_SEQCV_PARAM)->randomizeEnabled = false;		
 
-		for (int i = 0; i < Sequencer::NUM_TRACKS; i++) {
+		for (int i = 0; i < FoundrySequencer::NUM_TRACKS; i++) {
 			configInput(VEL_INPUTS + i, string::f("Track %c CV2", i + 'A'));
 			configInput(SEQCV_INPUTS + i, string::f("Track %c seq#", i + 'A'));
 		}
@@ -105,7 +105,7 @@ struct FoundryExpander : Module {
 			// From Mother (done outside since turn off leds with no mother; has its own motherPresent guards)
 			lights[WRITE_SEL_LIGHTS + 0].setBrightness(motherPresent ? messagesFromMother[2] : 0.0f);
 			lights[WRITE_SEL_LIGHTS + 1].setBrightness(motherPresent ? messagesFromMother[3] : 0.0f);			
-			for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++) {
+			for (int trkn = 0; trkn < FoundrySequencer::NUM_TRACKS; trkn++) {
 				lights[WRITECV2_LIGHTS + trkn].setBrightness(motherPresent ? messagesFromMother[4 + trkn] : 0.0f);
 			}	
 		}// expanderRefreshCounter
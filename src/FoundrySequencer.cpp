@@ -6,18 +6,20 @@
 #include "FoundrySequencer.hpp"
 
 
-Sequencer::Sequencer(bool* _holdTiedNotesPtr, int* _velocityModePtr, int* _stopAtEndOfSongPtr) {
+template <int TRACKS, class TKernel>
+Sequencer<TRACKS, TKernel>::Sequencer(bool* _holdTiedNotesPtr, int* _velocityModePtr, int* _stopAtEndOfSongPtr) {
 	velocityModePtr = _velocityModePtr;
-	sek.reserve(4);
-	sek.push_back(SequencerKernel(0, nullptr, _holdTiedNotesPtr, _stopAtEndOfSongPtr));
+	sek.reserve(NUM_TRACKS);// must not reallocate, since kernels hold a pointer to sek[0]
+	sek.push_back(Kernel(0, nullptr, _holdTiedNotesPtr, _stopAtEndOfSongPtr));
 	for (int trkn = 1; trkn < NUM_TRACKS; trkn++) {
-		sek.push_back(SequencerKernel(trkn, &sek[0], _holdTiedNotesPtr, _stopAtEndOfSongPtr));
+		sek.push_back(Kernel(trkn, &sek[0], _holdTiedNotesPtr, _stopAtEndOfSongPtr));
 	}
 	onReset(false);
 }
 
 
-void Sequencer::onReset(bool editingSequence) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::onReset(bool editingSequence) {
 	stepIndexEdit = 0;
 	phraseIndexEdit = 0;
 	trackIndexEdit = 0;
@@ -26,7 +28,8 @@ void Sequencer::onReset(bool editingSequence) {
 	}
 	resetNonJson(editingSequence, false);// no need to propagate initRun calls in kernels, since sek[trkn].onReset() have initRun() in them
 }
-void Sequencer::resetNonJson(bool editingSequence, bool propagateInitRun) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::resetNonJson(bool editingSequence, bool propagateInitRun) {
 	editingType = 0ul;
 	for (int trkn = 0; trkn < NUM_TRACKS; trkn++) {
 		editingGate[trkn] = 0ul;
@@ -35,21 +38,24 @@ void Sequencer::resetNonJson(bool editingSequence, bool propagateInitRun) {
 	songCPbuf.reset();
 	initRun(editingSequence, propagateInitRun);
 }
-void Sequencer::initRun(bool editingSequence, bool propagateInitRun) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::initRun(bool editingSequence, bool propagateInitRun) {
 	initDelayedSeqNumberRequest();
 	if (propagateInitRun) {
 		for (int trkn = 0; trkn < NUM_TRACKS; trkn++)
 			sek[trkn].initRun(editingSequence);
 	}
 }
-void Sequencer::initDelayedSeqNumberRequest() {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::initDelayedSeqNumberRequest() {
 	for (int trkn = 0; trkn < NUM_TRACKS; trkn++) {
 		delayedSeqNumberRequest[trkn] = -1;
 	}
 }
 
 
-void Sequencer::dataToJson(json_t *rootJ) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::dataToJson(json_t *rootJ, const Snapshot& snap) {
 	// stepIndexEdit
 	json_object_set_new(rootJ, "stepIndexEdit", json_integer(stepIndexEdit));
 
@@ -60,11 +66,12 @@ void Sequencer::dataToJson(json_t *rootJ) {
 	json_object_set_new(rootJ, "trackIndexEdit", json_integer(trackIndexEdit));
 
 	for (int trkn = 0; trkn < NUM_TRACKS; trkn++)
-		sek[trkn].dataToJson(rootJ);
+		sek[trkn].dataToJson(rootJ, snap.sek[trkn]);
 }
 
 
-void Sequencer::dataFromJson(json_t *rootJ, bool editingSequence) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::dataFromJson(json_t *rootJ, bool editingSequence) {
 	// stepIndexEdit
 	json_t *stepIndexEditJ = json_object_get(rootJ, "stepIndexEdit");
 	if (stepIndexEditJ)
@@ -87,7 +94,8 @@ void Sequencer::dataFromJson(json_t *rootJ, bool editingSequence) {
 }
 
 
-void Sequencer::setVelocityVal(int trkn, int intVel, int multiStepsCount, bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::setVelocityVal(int trkn, int intVel, int multiStepsCount, bool multiTracks) {
 	sek[trkn].setVelocityVal(stepIndexEdit, intVel, multiStepsCount);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -96,7 +104,8 @@ void Sequencer::setVelocityVal(int trkn, int intVel, int multiStepsCount, bool m
 		}
 	}
 }
-void Sequencer::setLength(int length, bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::setLength(int length, bool multiTracks) {
 	sek[trackIndexEdit].setLength(length);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -105,7 +114,8 @@ void Sequencer::setLength(int length, bool multiTracks) {
 		}
 	}
 }
-void Sequencer::setPhraseReps(int reps, bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::setPhraseReps(int reps, bool multiTracks) {
 	sek[trackIndexEdit].setPhraseReps(phraseIndexEdit, reps);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -114,7 +124,8 @@ void Sequencer::setPhraseReps(int reps, bool multiTracks) {
 		}
 	}		
 }
-void Sequencer::setPhraseSeqNum(int seqn, bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::setPhraseSeqNum(int seqn, bool multiTracks) {
 	sek[trackIndexEdit].setPhraseSeqNum(phraseIndexEdit, seqn);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -123,7 +134,8 @@ void Sequencer::setPhraseSeqNum(int seqn, bool multiTracks) {
 		}
 	}	
 }
-void Sequencer::setBegin(bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::setBegin(bool multiTracks) {
 	sek[trackIndexEdit].setBegin(phraseIndexEdit);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -132,7 +144,8 @@ void Sequencer::setBegin(bool multiTracks) {
 		}
 	}
 }
-void Sequencer::setEnd(bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::setEnd(bool multiTracks) {
 	sek[trackIndexEdit].setEnd(phraseIndexEdit);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -141,7 +154,8 @@ void Sequencer::setEnd(bool multiTracks) {
 		}
 	}
 }
-bool Sequencer::setGateType(int keyn, int multiSteps, float sampleRate, bool autostepClick, bool multiTracks) {// Third param is for right-click autostep. Returns success
+template <int TRACKS, class TKernel>
+bool Sequencer<TRACKS, TKernel>::setGateType(int keyn, int multiSteps, float sampleRate, bool autostepClick, bool multiTracks) {// Third param is for right-click autostep. Returns success
 	int newMode = keyIndexToGateTypeEx(keyn);
 	if (newMode == -1) 
 		return false;
@@ -163,7 +177,8 @@ bool Sequencer::setGateType(int keyn, int multiSteps, float sampleRate, bool aut
 }
 
 
-void Sequencer::initSlideVal(int multiStepsCount, bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::initSlideVal(int multiStepsCount, bool multiTracks) {
 	sek[trackIndexEdit].setSlideVal(stepIndexEdit, StepAttributes::INIT_SLIDE, multiStepsCount);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -172,7 +187,8 @@ void Sequencer::initSlideVal(int multiStepsCount, bool multiTracks) {
 		}
 	}		
 }
-void Sequencer::initGatePVal(int multiStepsCount, bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::initGatePVal(int multiStepsCount, bool multiTracks) {
 	sek[trackIndexEdit].setGatePVal(stepIndexEdit, StepAttributes::INIT_PROB, multiStepsCount);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -181,7 +197,8 @@ void Sequencer::initGatePVal(int multiStepsCount, bool multiTracks) {
 		}
 	}		
 }
-void Sequencer::initVelocityVal(int multiStepsCount, bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::initVelocityVal(int multiStepsCount, bool multiTracks) {
 	sek[trackIndexEdit].setVelocityVal(stepIndexEdit, StepAttributes::INIT_VELOCITY, multiStepsCount);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -190,7 +207,8 @@ void Sequencer::initVelocityVal(int multiStepsCount, bool multiTracks) {
 		}
 	}		
 }
-void Sequencer::initPulsesPerStep(bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::initPulsesPerStep(bool multiTracks) {
 	sek[trackIndexEdit].initPulsesPerStep();
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -199,7 +217,8 @@ void Sequencer::initPulsesPerStep(bool multiTracks) {
 		}
 	}		
 }
-void Sequencer::initDelay(bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::initDelay(bool multiTracks) {
 	sek[trackIndexEdit].initDelay();
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -208,34 +227,38 @@ void Sequencer::initDelay(bool multiTracks) {
 		}
 	}		
 }
-void Sequencer::initRunModeSong(bool multiTracks) {
-	sek[trackIndexEdit].setRunModeSong(SequencerKernel::MODE_FWD);
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::initRunModeSong(bool multiTracks) {
+	sek[trackIndexEdit].setRunModeSong(Kernel::MODE_FWD);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
 			if (i == trackIndexEdit) continue;
-			sek[i].setRunModeSong(SequencerKernel::MODE_FWD);
+			sek[i].setRunModeSong(Kernel::MODE_FWD);
 		}
 	}		
 }
-void Sequencer::initRunModeSeq(bool multiTracks) {
-	sek[trackIndexEdit].setRunModeSeq(SequencerKernel::MODE_FWD);
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::initRunModeSeq(bool multiTracks) {
+	sek[trackIndexEdit].setRunModeSeq(Kernel::MODE_FWD);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
 			if (i == trackIndexEdit) continue;
-			sek[i].setRunModeSeq(SequencerKernel::MODE_FWD);
+			sek[i].setRunModeSeq(Kernel::MODE_FWD);
 		}
 	}		
 }
-void Sequencer::initLength(bool multiTracks) {
-	sek[trackIndexEdit].setLength(SequencerKernel::MAX_STEPS);
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::initLength(bool multiTracks) {
+	sek[trackIndexEdit].setLength(Kernel::MAX_STEPS);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
 			if (i == trackIndexEdit) continue;
-			sek[i].setLength(SequencerKernel::MAX_STEPS);
+			sek[i].setLength(Kernel::MAX_STEPS);
 		}
 	}		
 }
-void Sequencer::initPhraseReps(bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::initPhraseReps(bool multiTracks) {
 	sek[trackIndexEdit].setPhraseReps(phraseIndexEdit, 1);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -244,7 +267,8 @@ void Sequencer::initPhraseReps(bool multiTracks) {
 		}
 	}		
 }
-void Sequencer::initPhraseSeqNum(bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::initPhraseSeqNum(bool multiTracks) {
 	sek[trackIndexEdit].setPhraseSeqNum(phraseIndexEdit, 0);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -254,11 +278,13 @@ void Sequencer::initPhraseSeqNum(bool multiTracks) {
 	}		
 }
 
-void Sequencer::copySequence(int countCP) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::copySequence(int countCP) {
 	int startCP = stepIndexEdit;
 	sek[trackIndexEdit].copySequence(&seqCPbuf, startCP, countCP);
 }
-void Sequencer::pasteSequence(bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::pasteSequence(bool multiTracks) {
 	int startCP = stepIndexEdit;
 	sek[trackIndexEdit].pasteSequence(&seqCPbuf, startCP);
 	if (multiTracks) {
@@ -268,10 +294,12 @@ void Sequencer::pasteSequence(bool multiTracks) {
 		}
 	}
 }
-void Sequencer::copySong(int startCP, int countCP) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::copySong(int startCP, int countCP) {
 	sek[trackIndexEdit].copySong(&songCPbuf, startCP, countCP);
 }
-void Sequencer::pasteSong(bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::pasteSong(bool multiTracks) {
 	sek[trackIndexEdit].pasteSong(&songCPbuf, phraseIndexEdit);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -281,7 +309,8 @@ void Sequencer::pasteSong(bool multiTracks) {
 	}
 }
 
-void Sequencer::writeCV(int trkn, float cvVal, int multiStepsCount, float sampleRate, bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::writeCV(int trkn, float cvVal, int multiStepsCount, float sampleRate, bool multiTracks) {
 	sek[trkn].writeCV(stepIndexEdit, cvVal, multiStepsCount);
 	editingGateCV[trkn] = cvVal;
 	editingGateCV2[trkn] = sek[trkn].getAttribute(stepIndexEdit).getVelocityVal();
@@ -293,7 +322,8 @@ void Sequencer::writeCV(int trkn, float cvVal, int multiStepsCount, float sample
 		}
 	}
 }
-void Sequencer::autostep(bool autoseq, bool autostepLen, bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::autostep(bool autoseq, bool autostepLen, bool multiTracks) {
 	moveStepIndexEdit(1, autostepLen);
 	if (stepIndexEdit == 0 && autoseq) {
 		sek[trackIndexEdit].modSeqIndexEdit(1);
@@ -306,7 +336,8 @@ void Sequencer::autostep(bool autoseq, bool autostepLen, bool multiTracks) {
 	}		
 }	
 
-bool Sequencer::applyNewOctave(int octn, int multiSteps, float sampleRate, bool multiTracks) { // returns true if tied
+template <int TRACKS, class TKernel>
+bool Sequencer<TRACKS, TKernel>::applyNewOctave(int octn, int multiSteps, float sampleRate, bool multiTracks) { // returns true if tied
 	StepAttributes stepAttrib = sek[trackIndexEdit].getAttribute(stepIndexEdit);
 	if (stepAttrib.getTied())
 		return true;
@@ -322,7 +353,8 @@ bool Sequencer::applyNewOctave(int octn, int multiSteps, float sampleRate, bool
 	}
 	return false;
 }
-bool Sequencer::applyNewKey(int keyn, int multiSteps, float sampleRate, bool autostepClick, bool multiTracks) { // returns true if tied
+template <int TRACKS, class TKernel>
+bool Sequencer<TRACKS, TKernel>::applyNewKey(int keyn, int multiSteps, float sampleRate, bool autostepClick, bool multiTracks) { // returns true if tied
 	bool ret = false;
 	StepAttributes stepAttrib = sek[trackIndexEdit].getAttribute(stepIndexEdit);
 	if (stepAttrib.getTied()) {
@@ -352,7 +384,8 @@ bool Sequencer::applyNewKey(int keyn, int multiSteps, float sampleRate, bool aut
 	return ret;
 }
 
-void Sequencer::moveStepIndexEditWithEditingGate(int delta, bool writeTrig, float sampleRate) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::moveStepIndexEditWithEditingGate(int delta, bool writeTrig, float sampleRate) {
 	moveStepIndexEdit(delta, false);
 	for (int trkn = 0; trkn < NUM_TRACKS; trkn++) {
 		StepAttributes stepAttrib = sek[trkn].getAttribute(stepIndexEdit);
@@ -369,7 +402,8 @@ void Sequencer::moveStepIndexEditWithEditingGate(int delta, bool writeTrig, floa
 
 
 
-void Sequencer::modSlideVal(int deltaVelKnob, int mutliStepsCount, bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::modSlideVal(int deltaVelKnob, int mutliStepsCount, bool multiTracks) {
 	int sVal = sek[trackIndexEdit].modSlideVal(stepIndexEdit, deltaVelKnob, mutliStepsCount);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -378,7 +412,8 @@ void Sequencer::modSlideVal(int deltaVelKnob, int mutliStepsCount, bool multiTra
 		}
 	}		
 }
-void Sequencer::modGatePVal(int deltaVelKnob, int mutliStepsCount, bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::modGatePVal(int deltaVelKnob, int mutliStepsCount, bool multiTracks) {
 	int gpVal = sek[trackIndexEdit].modGatePVal(stepIndexEdit, deltaVelKnob, mutliStepsCount);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -387,7 +422,8 @@ void Sequencer::modGatePVal(int deltaVelKnob, int mutliStepsCount, bool multiTra
 		}
 	}		
 }
-void Sequencer::modVelocityVal(int deltaVelKnob, int mutliStepsCount, bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::modVelocityVal(int deltaVelKnob, int mutliStepsCount, bool multiTracks) {
 	int upperLimit = ((*velocityModePtr) == 0 ? 200 : 127);
 	int vVal = sek[trackIndexEdit].modVelocityVal(stepIndexEdit, deltaVelKnob, upperLimit, mutliStepsCount);
 	if (multiTracks) {
@@ -397,7 +433,8 @@ void Sequencer::modVelocityVal(int deltaVelKnob, int mutliStepsCount, bool multi
 		}
 	}		
 }
-void Sequencer::modRunModeSong(int deltaPhrKnob, bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::modRunModeSong(int deltaPhrKnob, bool multiTracks) {
 	int newRunMode = sek[trackIndexEdit].modRunModeSong(deltaPhrKnob);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -406,7 +443,8 @@ void Sequencer::modRunModeSong(int deltaPhrKnob, bool multiTracks) {
 		}
 	}		
 }
-void Sequencer::modPulsesPerStep(int deltaSeqKnob, bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::modPulsesPerStep(int deltaSeqKnob, bool multiTracks) {
 	int newPPS = sek[trackIndexEdit].modPulsesPerStep(deltaSeqKnob);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -415,7 +453,8 @@ void Sequencer::modPulsesPerStep(int deltaSeqKnob, bool multiTracks) {
 		}
 	}		
 }
-void Sequencer::modDelay(int deltaSeqKnob, bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::modDelay(int deltaSeqKnob, bool multiTracks) {
 	int newDelay = sek[trackIndexEdit].modDelay(deltaSeqKnob);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -424,7 +463,8 @@ void Sequencer::modDelay(int deltaSeqKnob, bool multiTracks) {
 		}
 	}		
 }
-void Sequencer::modRunModeSeq(int deltaSeqKnob, bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::modRunModeSeq(int deltaSeqKnob, bool multiTracks) {
 	int newRunMode = sek[trackIndexEdit].modRunModeSeq(deltaSeqKnob);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -433,7 +473,8 @@ void Sequencer::modRunModeSeq(int deltaSeqKnob, bool multiTracks) {
 		}
 	}		
 }
-void Sequencer::modLength(int deltaSeqKnob, bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::modLength(int deltaSeqKnob, bool multiTracks) {
 	int newLength = sek[trackIndexEdit].modLength(deltaSeqKnob);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -442,7 +483,8 @@ void Sequencer::modLength(int deltaSeqKnob, bool multiTracks) {
 		}
 	}		
 }
-void Sequencer::modPhraseReps(int deltaSeqKnob, bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::modPhraseReps(int deltaSeqKnob, bool multiTracks) {
 	int newReps = sek[trackIndexEdit].modPhraseReps(phraseIndexEdit, deltaSeqKnob);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -451,7 +493,8 @@ void Sequencer::modPhraseReps(int deltaSeqKnob, bool multiTracks) {
 		}
 	}		
 }
-void Sequencer::modPhraseSeqNum(int deltaSeqKnob, bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::modPhraseSeqNum(int deltaSeqKnob, bool multiTracks) {
 	int newSeqn = sek[trackIndexEdit].modPhraseSeqNum(phraseIndexEdit, deltaSeqKnob);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -460,7 +503,8 @@ void Sequencer::modPhraseSeqNum(int deltaSeqKnob, bool multiTracks) {
 		}
 	}		
 }
-void Sequencer::transposeSeq(int deltaSeqKnob, bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::transposeSeq(int deltaSeqKnob, bool multiTracks) {
 	sek[trackIndexEdit].transposeSeq(deltaSeqKnob);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -469,7 +513,8 @@ void Sequencer::transposeSeq(int deltaSeqKnob, bool multiTracks) {
 		}
 	}		
 }
-void Sequencer::unTransposeSeq(bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::unTransposeSeq(bool multiTracks) {
 	sek[trackIndexEdit].unTransposeSeq();
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -478,7 +523,8 @@ void Sequencer::unTransposeSeq(bool multiTracks) {
 		}
 	}		
 }
-void Sequencer::rotateSeq(int deltaSeqKnob, bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::rotateSeq(int deltaSeqKnob, bool multiTracks) {
 	sek[trackIndexEdit].rotateSeq(deltaSeqKnob);
 	if (stepIndexEdit < getLength())
 		moveStepIndexEdit(deltaSeqKnob, true);
@@ -489,7 +535,8 @@ void Sequencer::rotateSeq(int deltaSeqKnob, bool multiTracks) {
 		}
 	}		
 }
-void Sequencer::unRotateSeq(bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::unRotateSeq(bool multiTracks) {
 	sek[trackIndexEdit].unRotateSeq();
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -498,7 +545,8 @@ void Sequencer::unRotateSeq(bool multiTracks) {
 		}
 	}		
 }
-void Sequencer::toggleGate(int multiSteps, bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::toggleGate(int multiSteps, bool multiTracks) {
 	bool newGate = sek[trackIndexEdit].toggleGate(stepIndexEdit, multiSteps);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -507,7 +555,8 @@ void Sequencer::toggleGate(int multiSteps, bool multiTracks) {
 		}
 	}		
 }
-bool Sequencer::toggleGateP(int multiSteps, bool multiTracks) { // returns true if tied
+template <int TRACKS, class TKernel>
+bool Sequencer<TRACKS, TKernel>::toggleGateP(int multiSteps, bool multiTracks) { // returns true if tied
 	if (sek[trackIndexEdit].getAttribute(stepIndexEdit).getTied())
 		return true;
 	bool newGateP = sek[trackIndexEdit].toggleGateP(stepIndexEdit, multiSteps);
@@ -519,7 +568,8 @@ bool Sequencer::toggleGateP(int multiSteps, bool multiTracks) { // returns true
 	}				
 	return false;
 }
-bool Sequencer::toggleSlide(int multiSteps, bool multiTracks) { // returns true if tied
+template <int TRACKS, class TKernel>
+bool Sequencer<TRACKS, TKernel>::toggleSlide(int multiSteps, bool multiTracks) { // returns true if tied
 	if (sek[trackIndexEdit].getAttribute(stepIndexEdit).getTied())
 		return true;
 	bool newSlide = sek[trackIndexEdit].toggleSlide(stepIndexEdit, multiSteps);
@@ -531,7 +581,8 @@ bool Sequencer::toggleSlide(int multiSteps, bool multiTracks) { // returns true
 	}				
 	return false;
 }
-void Sequencer::toggleTied(int multiSteps, bool multiTracks) {
+template <int TRACKS, class TKernel>
+void Sequencer<TRACKS, TKernel>::toggleTied(int multiSteps, bool multiTracks) {
 	bool newTied = sek[trackIndexEdit].toggleTied(stepIndexEdit, multiSteps);// will clear other attribs if new state is on
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -542,7 +593,8 @@ void Sequencer::toggleTied(int multiSteps, bool multiTracks) {
 }
 
 
-bool Sequencer::clockStep(int trkn, bool editingSequence) {// returns true to signal that run should be turned off
+template <int TRACKS, class TKernel>
+bool Sequencer<TRACKS, TKernel>::clockStep(int trkn, bool editingSequence) {// returns true to signal that run should be turned off
 	int phraseChangeOrStop = sek[trkn].clockStep(editingSequence, delayedSeqNumberRequest[trkn]);
 	
 	if (phraseChangeOrStop == 2)// kernel request that run should be turned off 
@@ -556,7 +608,7 @@ bool Sequencer::clockStep(int trkn, bool editingSequence) {// returns true to si
 	else {
 		if (trkn == 0 && phraseChangeOrStop == 1) {
 			for (int tkbcd = 1; tkbcd < NUM_TRACKS; tkbcd++) {// check for song run mode slaving
-				if (sek[tkbcd].getRunModeSong() == SequencerKernel::MODE_TKA) {
+				if (sek[tkbcd].getRunModeSong() == Kernel::MODE_TKA) {
 					sek[tkbcd].setPhraseIndexRun(sek[0].getPhraseIndexRun());
 					// The code below is to make it such that stepIndexRun should re-init upon phraseChange
 					//   example for phrase jump does not reset stepIndexRun in B
@@ -572,3 +624,7 @@ bool Sequencer::clockStep(int trkn, bool editingSequence) {// returns true to si
 	}
 	return false;
 }
+
+
+template class Sequencer<4, SequencerKernel<32, 64, 99>>;// FoundrySequencer
+template class Sequencer<16, SequencerKernel<64, 64, 99>>;// Foundry16Sequencer
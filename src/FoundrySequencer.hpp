@@ -7,12 +7,21 @@
 #include "FoundrySequencerKernel.hpp"
 
 
+// The number of tracks and the kernel type are template parameters; the combinations that are used must be
+//   explicitly instantiated at the end of FoundrySequencer.cpp
+template <int TRACKS, class TKernel>
 class Sequencer {
 	public: 
 	
 	// Sequencer dimensions
-	static const int NUM_TRACKS = 4;
+	typedef TKernel Kernel;
+	static const int NUM_TRACKS = TRACKS;
 	static constexpr float gateTime = 0.4f;// seconds
+	
+	// Copy of the song and sequences of all tracks, serialized by dataToJson() (see StateSnapshot)
+	struct Snapshot {
+		typename Kernel::Snapshot sek[NUM_TRACKS];
+	};
 
 
 	private:
@@ -21,14 +30,14 @@ class Sequencer {
 	int stepIndexEdit;
 	int phraseIndexEdit;
 	int trackIndexEdit;
-	std::vector<SequencerKernel> sek;// size 4
+	std::vector<Kernel> sek;// size NUM_TRACKS
 	
 	// No need to save, with reset
 	unsigned long editingType;// similar to editingGate, but just for showing remnant gate type (nothing played); uses editingGateKeyLight
 	unsigned long editingGate[NUM_TRACKS];// 0 when no edit gate, downward step counter timer when edit gate
 	int delayedSeqNumberRequest[NUM_TRACKS];
-	SeqCPbuffer seqCPbuf;
-	SongCPbuffer songCPbuf;
+	typename Kernel::SeqCPbuffer seqCPbuf;
+	typename Kernel::SongCPbuffer songCPbuf;
 	
 	// No need to save, no reset
 	int* velocityModePtr = nullptr;
@@ -45,7 +54,22 @@ class Sequencer {
 	void onRandomize(bool editingSequence) {sek[trackIndexEdit].onRandomize(editingSequence);}
 	void initRun(bool editingSequence, bool propagateInitRun);
 	void initDelayedSeqNumberRequest();
-	void dataToJson(json_t *rootJ);
+	void seedRandom(uint32_t seed) {
+		for (int trkn = 0; trkn < NUM_TRACKS; trkn++) {
+			sek[trkn].seedRandom(seed);
+		}
+	}
+	void fillSnapshot(Snapshot* snap, uint32_t tracks) {// one bit per track in tracks
+		for (int trkn = 0; trkn < NUM_TRACKS; trkn++) {
+			if ((tracks & (0x1u << trkn)) != 0) {
+				sek[trkn].fillSnapshot(&snap->sek[trkn]);
+			}
+		}
+	}
+	uint32_t getEditedTracks(bool multiTracks) {// tracks changed by an edit, one bit per track
+		return multiTracks ? ((0x1u << NUM_TRACKS) - 1) : (0x1u << trackIndexEdit);
+	}
+	void dataToJson(json_t *rootJ, const Snapshot& snap);
 	void dataFromJson(json_t *rootJ, bool editingSequence);
 
 
@@ -149,7 +173,7 @@ class Sequencer {
 	bool applyNewKey(int keyn, int multiSteps, float sampleRate, bool autostepClick, bool multiTracks); // returns true if tied
 
 	void moveStepIndexEdit(int delta, bool loopOnLength) {
-		stepIndexEdit = moveIndex(stepIndexEdit, stepIndexEdit + delta, loopOnLength ? getLength() : SequencerKernel::MAX_STEPS);
+		stepIndexEdit = moveIndex(stepIndexEdit, stepIndexEdit + delta, loopOnLength ? getLength() : Kernel::MAX_STEPS);
 	}
 	
 	void moveStepIndexEditWithEditingGate(int delta, bool writeTrig, float sampleRate);
@@ -159,7 +183,7 @@ class Sequencer {
 	}
 	
 	void movePhraseIndexEdit(int deltaPhrKnob) {
-		phraseIndexEdit = moveIndex(phraseIndexEdit, phraseIndexEdit + deltaPhrKnob, SequencerKernel::MAX_PHRASES);
+		phraseIndexEdit = moveIndex(phraseIndexEdit, phraseIndexEdit + deltaPhrKnob, Kernel::MAX_PHRASES);
 	}
 
 	
@@ -255,3 +279,8 @@ class Sequencer {
 	}
 	
 };// class Sequencer 
+
+
+// Foundry is 4 tracks of 32 steps, Foundry16 is 16 tracks of 64 steps
+typedef Sequencer<4, SequencerKernel<32, 64, 99>> FoundrySequencer;
+typedef Sequencer<16, SequencerKernel<64, 64, 99>> Foundry16Sequencer;
@@ -6,22 +6,52 @@
 #include "FoundrySequencerKernel.hpp"
 
 
-const std::string SequencerKernel::modeLabels[NUM_MODES] = {"FWD", "REV", "PPG", "PEN", "BRN", "RND", "TKA", "RNS"};
+template <int STEPS, int SEQS, int PHRASES>
+const std::string SequencerKernel<STEPS, SEQS, PHRASES>::modeLabels[NUM_MODES] = {"FWD", "REV", "PPG", "PEN", "BRN", "RND", "TKA", "RNS"};
 
 
-const uint64_t SequencerKernel::advGateHitMaskLow[NUM_GATES] = 
+template <int STEPS, int SEQS, int PHRASES>
+const uint64_t SequencerKernel<STEPS, SEQS, PHRASES>::advGateHitMaskLow[NUM_GATES] = 
 {0x0000000000FFFFFF, 0x0000FFFF0000FFFF, 0x0000FFFFFFFFFFFF, 0x0000FFFF00000000, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF, 
 //				25%					TRI		  			50%					T23		  			75%					FUL		
  0x000000000000FFFF, 0xFFFF000000FFFFFF, 0x0000FFFF00000000, 0xFFFF000000000000, 0x0000000000000000, 0};
 //  			TR1 				DUO		  			TR2 	     		D2		  			TR3  TRIG		
-const uint64_t SequencerKernel::advGateHitMaskHigh[NUM_GATES] = 
+template <int STEPS, int SEQS, int PHRASES>
+const uint64_t SequencerKernel<STEPS, SEQS, PHRASES>::advGateHitMaskHigh[NUM_GATES] = 
 {0x0000000000000000, 0x000000000000FFFF, 0x0000000000000000, 0x000000000000FFFF, 0x00000000000000FF, 0x00000000FFFFFFFF, 
 //				25%					TRI		  			50%					T23		  			75%					FUL		
  0x0000000000000000, 0x00000000000000FF, 0x0000000000000000, 0x00000000000000FF, 0x000000000000FFFF, 0};
 //  			TR1 				DUO		  			TR2 	     		D2		  			TR3  TRIG		
 
 
-SequencerKernel::SequencerKernel(int _id, SequencerKernel *_masterKernel, bool* _holdTiedNotesPtr, int* _stopAtEndOfSongPtr) {
+// Binary encoding of the song and sequences (saved as a base64 string in the json)
+//   header: version, MAX_STEPS, MAX_SEQS, MAX_PHRASES (16 bits each)
+//   phrases: MAX_PHRASES x 32 bits
+//   sequences: MAX_SEQS x 32 bits
+//   dirty: MAX_SEQS x 8 bits
+//   for each dirty sequence: MAX_STEPS x cv (float bits), then MAX_STEPS x attributes (32 bits each)
+// all values are little-endian
+static const int BIN_DATA_VERSION = 1;
+
+static void pushBinData(std::vector<uint8_t>& bytes, uint32_t value, int numBytes) {
+	for (int b = 0; b < numBytes; b++) {
+		bytes.push_back((uint8_t)(value >> (8 * b)));
+	}
+}
+
+static uint32_t readBinData(const std::vector<uint8_t>& bytes, size_t* pos, int numBytes) {
+	// caller must check size before reading
+	uint32_t value = 0;
+	for (int b = 0; b < numBytes; b++) {
+		value |= ((uint32_t)bytes[*pos + b]) << (8 * b);
+	}
+	*pos += numBytes;
+	return value;
+}
+
+
+template <int STEPS, int SEQS, int PHRASES>
+SequencerKernel<STEPS, SEQS, PHRASES>::SequencerKernel(int _id, SequencerKernel *_masterKernel, bool* _holdTiedNotesPtr, int* _stopAtEndOfSongPtr) {
 	id = _id;
 	ids = "id" + std::to_string(id) + "_";
 	masterKernel = _masterKernel;
@@ -30,7 +60,8 @@ SequencerKernel::SequencerKernel(int _id, SequencerKernel *_masterKernel, bool*
 	onReset(false);
 }
 
-void SequencerKernel::onReset(bool editingSequence) {
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::onReset(bool editingSequence) {
 	initPulsesPerStep();
 	initDelay();
 	// reset song content
@@ -52,11 +83,13 @@ void SequencerKernel::onReset(bool editingSequence) {
 	seqIndexEdit = 0;
 	resetNonJson(editingSequence);
 }
-void SequencerKernel::resetNonJson(bool editingSequence) {
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::resetNonJson(bool editingSequence) {
 	clockPeriod = 0ul;
 	initRun(editingSequence);
 }
-void SequencerKernel::initRun(bool editingSequence) {
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::initRun(bool editingSequence) {
 	movePhraseIndexRun(true);// true means init 
 	moveStepIndexRunIgnore = false;
 	moveStepIndexRun(true, editingSequence);// true means init 
@@ -69,7 +102,8 @@ void SequencerKernel::initRun(bool editingSequence) {
 }
 
 
-void SequencerKernel::onRandomize(bool editingSequence) {
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::onRandomize(bool editingSequence) {
 	// randomize sequence only
 	sequences[seqIndexEdit].randomize(MAX_STEPS, NUM_MODES);// code below uses lengths so this must be randomized first
 	for (int stepn = 0; stepn < MAX_STEPS; stepn++) {
@@ -81,7 +115,18 @@ void SequencerKernel::onRandomize(bool editingSequence) {
 }
 	
 
-void SequencerKernel::dataToJson(json_t *rootJ) {
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::fillSnapshot(Snapshot* snap) {
+	std::memcpy(snap->phrases, phrases, sizeof(phrases));
+	std::memcpy(snap->sequences, sequences, sizeof(sequences));
+	std::memcpy(snap->cv, cv, sizeof(cv));
+	std::memcpy(snap->attributes, attributes, sizeof(attributes));
+	std::memcpy(snap->dirty, dirty, sizeof(dirty));
+}
+
+
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::dataToJson(json_t *rootJ, const Snapshot& snap) {
 	// pulsesPerStep
 	json_object_set_new(rootJ, (ids + "pulsesPerStep").c_str(), json_integer(pulsesPerStep));
 
@@ -97,45 +142,44 @@ void SequencerKernel::dataToJson(json_t *rootJ) {
 	// songEndIndex
 	json_object_set_new(rootJ, (ids + "songEndIndex").c_str(), json_integer(songEndIndex));
 
-	// phrases 
-	json_t *phrasesJ = json_array();
-	for (int i = 0; i < MAX_PHRASES; i++)
-		json_array_insert_new(phrasesJ, i, json_integer(phrases[i].getPhraseJson()));
-	json_object_set_new(rootJ, (ids + "phrases").c_str(), phrasesJ);
-
-	// sequences (attributes of a seqs)
-	json_t *sequencesJ = json_array();
-	for (int i = 0; i < MAX_SEQS; i++)
-		json_array_insert_new(sequencesJ, i, json_integer(sequences[i].getSeqAttrib()));
-	json_object_set_new(rootJ, (ids + "sequences").c_str(), sequencesJ);
-
-	// CV and attributes (and dirty)
-	json_t *seqSavedJ = json_array();		
-	json_t *cvJ = json_array();
-	json_t *attributesJ = json_array();
-	for (int seqnRead = 0, seqnWrite = 0; seqnRead < MAX_SEQS; seqnRead++) {
-		if (dirty[seqnRead] == 0) {
-			json_array_insert_new(seqSavedJ, seqnRead, json_integer(0));
-		}
-		else {
-			json_array_insert_new(seqSavedJ, seqnRead, json_integer(1));
+	// phrases, sequences (attributes of a seqs), CV and attributes (and dirty), as binary data taken from snap
+	// (this replaces the "phrases", "sequences", "seqSaved", "cv" and "attributes" json arrays, which are still read in dataFromJson() for older patches)
+	std::vector<uint8_t> bytes;
+	bytes.reserve(8 + MAX_PHRASES * 4 + MAX_SEQS * 5 + MAX_SEQS * MAX_STEPS * 8);
+	pushBinData(bytes, BIN_DATA_VERSION, 2);
+	pushBinData(bytes, MAX_STEPS, 2);
+	pushBinData(bytes, MAX_SEQS, 2);
+	pushBinData(bytes, MAX_PHRASES, 2);
+	for (int i = 0; i < MAX_PHRASES; i++) {
+		pushBinData(bytes, (uint32_t)snap.phrases[i].getPhraseJson(), 4);
+	}
+	for (int i = 0; i < MAX_SEQS; i++) {
+		pushBinData(bytes, (uint32_t)snap.sequences[i].getSeqAttrib(), 4);
+	}
+	for (int i = 0; i < MAX_SEQS; i++) {
+		pushBinData(bytes, snap.dirty[i] != 0 ? 1 : 0, 1);
+	}
+	for (int seqn = 0; seqn < MAX_SEQS; seqn++) {
+		if (snap.dirty[seqn] != 0) {
 			for (int stepn = 0; stepn < MAX_STEPS; stepn++) {
-				json_array_insert_new(cvJ, stepn + (seqnWrite * MAX_STEPS), json_real(cv[seqnRead][stepn]));
-				json_array_insert_new(attributesJ, stepn + (seqnWrite * MAX_STEPS), json_integer(attributes[seqnRead][stepn].getAttribute()));
+				uint32_t cvBits;
+				std::memcpy(&cvBits, &snap.cv[seqn][stepn], 4);
+				pushBinData(bytes, cvBits, 4);
+			}
+			for (int stepn = 0; stepn < MAX_STEPS; stepn++) {
+				pushBinData(bytes, (uint32_t)snap.attributes[seqn][stepn].getAttribute(), 4);
 			}
-			seqnWrite++;
 		}
 	}
-	json_object_set_new(rootJ, (ids + "seqSaved").c_str(), seqSavedJ);
-	json_object_set_new(rootJ, (ids + "cv").c_str(), cvJ);
-	json_object_set_new(rootJ, (ids + "attributes").c_str(), attributesJ);
+	json_object_set_new(rootJ, (ids + "binData").c_str(), json_string(string::toBase64(bytes).c_str()));
 
 	// seqIndexEdit
 	json_object_set_new(rootJ, (ids + "seqIndexEdit").c_str(), json_integer(seqIndexEdit));
 }
 
 
-void SequencerKernel::dataFromJson(json_t *rootJ, bool editingSequence) {
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::dataFromJson(json_t *rootJ, bool editingSequence) {
 	// pulsesPerStep
 	json_t *pulsesPerStepJ = json_object_get(rootJ, (ids + "pulsesPerStep").c_str());
 	if (pulsesPerStepJ)
@@ -161,6 +205,101 @@ void SequencerKernel::dataFromJson(json_t *rootJ, bool editingSequence) {
 	if (songEndIndexJ)
 		songEndIndex = json_integer_value(songEndIndexJ);
 
+	// phrases, sequences (attributes of a seqs), CV and attributes (and dirty), as binary data
+	json_t *binDataJ = json_object_get(rootJ, (ids + "binData").c_str());
+	if (binDataJ && json_is_string(binDataJ) && binDataFromJson(json_string_value(binDataJ))) {
+		// nothing more to do, legacy arrays below are not present
+	}
+	else {
+		legacyDataFromJson(rootJ);
+	}
+	
+	// seqIndexEdit
+	json_t *seqIndexEditJ = json_object_get(rootJ, (ids + "seqIndexEdit").c_str());
+	if (seqIndexEditJ)
+		seqIndexEdit = json_integer_value(seqIndexEditJ);
+	
+	resetNonJson(editingSequence);
+}
+
+
+template <int STEPS, int SEQS, int PHRASES>
+bool SequencerKernel<STEPS, SEQS, PHRASES>::binDataFromJson(const char* binData) {
+	// returns false when the data is not valid, in which case nothing was written
+	std::vector<uint8_t> bytes = string::fromBase64(binData);
+	size_t pos = 0;
+	if (bytes.size() < 8) {
+		return false;
+	}
+	int version = readBinData(bytes, &pos, 2);
+	int numSteps = readBinData(bytes, &pos, 2);
+	int numSeqs = readBinData(bytes, &pos, 2);
+	int numPhrases = readBinData(bytes, &pos, 2);
+	if (version != BIN_DATA_VERSION || bytes.size() < (size_t)(8 + numPhrases * 4 + numSeqs * 5)) {
+		return false;
+	}
+	int numDirty = 0;
+	for (int i = 0; i < numSeqs; i++) {
+		numDirty += (bytes[8 + numPhrases * 4 + numSeqs * 4 + i] != 0 ? 1 : 0);
+	}
+	if (bytes.size() != (size_t)(8 + numPhrases * 4 + numSeqs * 5 + numDirty * numSteps * 8)) {
+		return false;
+	}
+	
+	// phrases
+	for (int i = 0; i < numPhrases; i++) {
+		uint32_t phraseJson = readBinData(bytes, &pos, 4);
+		if (i < MAX_PHRASES) {
+			phrases[i].setPhraseJson(phraseJson);
+		}
+	}
+	
+	// sequences
+	for (int i = 0; i < numSeqs; i++) {
+		uint32_t seqAttrib = readBinData(bytes, &pos, 4);
+		if (i < MAX_SEQS) {
+			sequences[i].setSeqAttrib(seqAttrib);
+		}
+	}
+
+	// dirty, CV and attributes (attributes of a seq follow all of its CVs)
+	size_t posSteps = pos + numSeqs;
+	for (int seqn = 0; seqn < std::max(numSeqs, (int)MAX_SEQS); seqn++) {
+		bool saved = seqn < numSeqs && bytes[pos + seqn] != 0;
+		for (int stepn = 0; stepn < std::max(numSteps, (int)MAX_STEPS); stepn++) {
+			bool inKernel = seqn < MAX_SEQS && stepn < MAX_STEPS;
+			if (saved && stepn < numSteps) {
+				uint32_t cvBits = readBinData(bytes, &posSteps, 4);
+				if (inKernel) {
+					std::memcpy(&cv[seqn][stepn], &cvBits, 4);
+				}
+			}
+			else if (inKernel) {
+				cv[seqn][stepn] = INIT_CV;
+			}
+		}
+		for (int stepn = 0; stepn < std::max(numSteps, (int)MAX_STEPS); stepn++) {
+			bool inKernel = seqn < MAX_SEQS && stepn < MAX_STEPS;
+			if (saved && stepn < numSteps) {
+				uint32_t attribute = readBinData(bytes, &posSteps, 4);
+				if (inKernel) {
+					attributes[seqn][stepn].setAttribute(attribute);
+				}
+			}
+			else if (inKernel) {
+				attributes[seqn][stepn].init();
+			}
+		}
+		if (seqn < MAX_SEQS) {
+			dirty[seqn] = saved ? 1 : 0;
+		}
+	}
+	return true;
+}
+
+
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::legacyDataFromJson(json_t *rootJ) {
 	// phrases
 	json_t *phrasesJ = json_object_get(rootJ, (ids + "phrases").c_str());
 	if (phrasesJ)
@@ -223,35 +362,32 @@ void SequencerKernel::dataFromJson(json_t *rootJ, bool editingSequence) {
 			}
 		}
 	}		
-	
-	// seqIndexEdit
-	json_t *seqIndexEditJ = json_object_get(rootJ, (ids + "seqIndexEdit").c_str());
-	if (seqIndexEditJ)
-		seqIndexEdit = json_integer_value(seqIndexEditJ);
-	
-	resetNonJson(editingSequence);
 }
 
 
-void SequencerKernel::setGate(int stepn, bool newGate, int count) {
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::setGate(int stepn, bool newGate, int count) {
 	int endi = std::min((int)MAX_STEPS, stepn + count);
 	for (int i = stepn; i < endi; i++)
 		attributes[seqIndexEdit][i].setGate(newGate);
 	dirty[seqIndexEdit] = 1;
 }
-void SequencerKernel::setGateP(int stepn, bool newGateP, int count) {
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::setGateP(int stepn, bool newGateP, int count) {
 	int endi = std::min((int)MAX_STEPS, stepn + count);
 	for (int i = stepn; i < endi; i++)
 		attributes[seqIndexEdit][i].setGateP(newGateP);
 	dirty[seqIndexEdit] = 1;
 }
-void SequencerKernel::setSlide(int stepn, bool newSlide, int count) {
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::setSlide(int stepn, bool newSlide, int count) {
 	int endi = std::min((int)MAX_STEPS, stepn + count);
 	for (int i = stepn; i < endi; i++)
 		attributes[seqIndexEdit][i].setSlide(newSlide);
 	dirty[seqIndexEdit] = 1;
 }
-void SequencerKernel::setTied(int stepn, bool newTied, int count) {
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::setTied(int stepn, bool newTied, int count) {
 	int endi = std::min((int)MAX_STEPS, stepn + count);
 	if (!newTied) {
 		for (int i = stepn; i < endi; i++)
@@ -264,25 +400,29 @@ void SequencerKernel::setTied(int stepn, bool newTied, int count) {
 	dirty[seqIndexEdit] = 1;
 }
 
-void SequencerKernel::setGatePVal(int stepn, int gatePval, int count) {
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::setGatePVal(int stepn, int gatePval, int count) {
 	int endi = std::min((int)MAX_STEPS, stepn + count);
 	for (int i = stepn; i < endi; i++)
 		attributes[seqIndexEdit][i].setGatePVal(gatePval);
 	dirty[seqIndexEdit] = 1;
 }
-void SequencerKernel::setSlideVal(int stepn, int slideVal, int count) {
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::setSlideVal(int stepn, int slideVal, int count) {
 	int endi = std::min((int)MAX_STEPS, stepn + count);
 	for (int i = stepn; i < endi; i++)
 		attributes[seqIndexEdit][i].setSlideVal(slideVal);
 	dirty[seqIndexEdit] = 1;
 }
-void SequencerKernel::setVelocityVal(int stepn, int velocity, int count) {
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::setVelocityVal(int stepn, int velocity, int count) {
 	int endi = std::min((int)MAX_STEPS, stepn + count);
 	for (int i = stepn; i < endi; i++)
 		attributes[seqIndexEdit][i].setVelocityVal(velocity);
 	dirty[seqIndexEdit] = 1;
 }
-void SequencerKernel::setGateType(int stepn, int gateType, int count) {
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::setGateType(int stepn, int gateType, int count) {
 	int endi = std::min((int)MAX_STEPS, stepn + count);
 	for (int i = stepn; i < endi; i++)
 		attributes[seqIndexEdit][i].setGateType(gateType);
@@ -290,7 +430,8 @@ void SequencerKernel::setGateType(int stepn, int gateType, int count) {
 }
 
 
-float SequencerKernel::applyNewOctave(int stepn, int newOct0, int count) {// does not overwrite tied steps
+template <int STEPS, int SEQS, int PHRASES>
+float SequencerKernel<STEPS, SEQS, PHRASES>::applyNewOctave(int stepn, int newOct0, int count) {// does not overwrite tied steps
 	// newOct0 is an octave number, 0 representing octave 4 (as in C4 for example)
 	float cvVal = cv[seqIndexEdit][stepn];
 	float fdel = cvVal - std::floor(cvVal);
@@ -301,13 +442,15 @@ float SequencerKernel::applyNewOctave(int stepn, int newOct0, int count) {// doe
 	writeCV(stepn, newCV, count);// also sets dirty[] to 1
 	return newCV;
 }
-float SequencerKernel::applyNewKey(int stepn, int newKeyIndex, int count) {// does not overwrite tied steps
+template <int STEPS, int SEQS, int PHRASES>
+float SequencerKernel<STEPS, SEQS, PHRASES>::applyNewKey(int stepn, int newKeyIndex, int count) {// does not overwrite tied steps
 	float newCV = std::floor(cv[seqIndexEdit][stepn]) + ((float) newKeyIndex) / 12.0f;
 	
 	writeCV(stepn, newCV, count);// also sets dirty[] to 1
 	return newCV;
 }
-void SequencerKernel::writeCV(int stepn, float newCV, int count) {// does not overwrite tied steps
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::writeCV(int stepn, float newCV, int count) {// does not overwrite tied steps
 	int endi = std::min((int)MAX_STEPS, stepn + count);
 	for (int i = stepn; i < endi; i++) {
 		if (!attributes[seqIndexEdit][i].getTied()) {
@@ -319,7 +462,8 @@ void SequencerKernel::writeCV(int stepn, float newCV, int count) {// does not ov
 }
 
 
-void SequencerKernel::copySequence(SeqCPbuffer* seqCPbuf, int startCP, int countCP) {
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::copySequence(SeqCPbuffer* seqCPbuf, int startCP, int countCP) {
 	countCP = std::min(countCP, (int)MAX_STEPS - startCP);
 	for (int i = 0, stepn = startCP; i < countCP; i++, stepn++) {
 		seqCPbuf->cvCPbuffer[i] = cv[seqIndexEdit][stepn];
@@ -328,7 +472,8 @@ void SequencerKernel::copySequence(SeqCPbuffer* seqCPbuf, int startCP, int count
 	seqCPbuf->seqAttribCPbuffer = sequences[seqIndexEdit];
 	seqCPbuf->storedLength = countCP;
 }
-void SequencerKernel::pasteSequence(SeqCPbuffer* seqCPbuf, int startCP) {
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::pasteSequence(SeqCPbuffer* seqCPbuf, int startCP) {
 	int countCP = std::min(seqCPbuf->storedLength, (int)MAX_STEPS - startCP);
 	for (int i = 0, stepn = startCP; i < countCP; i++, stepn++) {
 		cv[seqIndexEdit][stepn] = seqCPbuf->cvCPbuffer[i];
@@ -338,7 +483,8 @@ void SequencerKernel::pasteSequence(SeqCPbuffer* seqCPbuf, int startCP) {
 		sequences[seqIndexEdit] = seqCPbuf->seqAttribCPbuffer;
 	dirty[seqIndexEdit] = 1;
 }
-void SequencerKernel::copySong(SongCPbuffer* songCPbuf, int startCP, int countCP) {	
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::copySong(SongCPbuffer* songCPbuf, int startCP, int countCP) {	
 	countCP = std::min(countCP, (int)MAX_PHRASES - startCP);
 	for (int i = 0, phrn = startCP; i < countCP; i++, phrn++) {
 		songCPbuf->phraseCPbuffer[i] = phrases[phrn];
@@ -348,7 +494,8 @@ void SequencerKernel::copySong(SongCPbuffer* songCPbuf, int startCP, int countCP
 	songCPbuf->runModeSong = runModeSong;
 	songCPbuf->storedLength = countCP;
 }
-void SequencerKernel::pasteSong(SongCPbuffer* songCPbuf, int startCP) {	
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::pasteSong(SongCPbuffer* songCPbuf, int startCP) {	
 	int countCP = std::min(songCPbuf->storedLength, (int)MAX_PHRASES - startCP);
 	for (int i = 0, phrn = startCP; i < countCP; i++, phrn++) {
 		phrases[phrn] = songCPbuf->phraseCPbuffer[i];
@@ -361,7 +508,8 @@ void SequencerKernel::pasteSong(SongCPbuffer* songCPbuf, int startCP) {
 }
 
 
-int SequencerKernel::clockStep(bool editingSequence, int delayedSeqNumberRequest) {// delayedSeqNumberRequest is only valid in seq mode (-1 means no request)
+template <int STEPS, int SEQS, int PHRASES>
+int SequencerKernel<STEPS, SEQS, PHRASES>::clockStep(bool editingSequence, int delayedSeqNumberRequest) {// delayedSeqNumberRequest is only valid in seq mode (-1 means no request)
 	int phraseChangeOrStop = 0;//0 = nothing, 1 = phrase change, 2 = turn off run
 	
 	if (ppqnLeftToSkip > 0) {
@@ -423,7 +571,8 @@ int SequencerKernel::clockStep(bool editingSequence, int delayedSeqNumberRequest
 }
 
 
-int SequencerKernel::keyIndexToGateTypeEx(int keyIndex) {// return -1 when invalid gate type given current pps setting
+template <int STEPS, int SEQS, int PHRASES>
+int SequencerKernel<STEPS, SEQS, PHRASES>::keyIndexToGateTypeEx(int keyIndex) {// return -1 when invalid gate type given current pps setting
 	int ppsFiltered = getPulsesPerStep();// must use method
 	int ret = keyIndex;
 	
@@ -449,7 +598,8 @@ int SequencerKernel::keyIndexToGateTypeEx(int keyIndex) {// return -1 when inval
 }
 
 
-void SequencerKernel::transposeSeq(int delta) {
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::transposeSeq(int delta) {
 	int tVal = sequences[seqIndexEdit].getTranspose();
 	int oldTransposeOffset = tVal;
 	tVal = clamp(tVal + delta, -99, 99);
@@ -465,7 +615,8 @@ void SequencerKernel::transposeSeq(int delta) {
 }
 
 
-void SequencerKernel::rotateSeq(int delta) {
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::rotateSeq(int delta) {
 	int rVal = sequences[seqIndexEdit].getRotate();
 	int oldRotateOffset = rVal;
 	rVal = clamp(rVal + delta, -99, 99);
@@ -489,7 +640,8 @@ void SequencerKernel::rotateSeq(int delta) {
 }	
 
 
-void SequencerKernel::rotateSeqByOne(int seqn, bool directionRight) {// caller sets dirty[] to 1
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::rotateSeqByOne(int seqn, bool directionRight) {// caller sets dirty[] to 1
 	float rotCV;
 	StepAttributes rotAttributes;
 	int iStart = 0;
@@ -513,7 +665,8 @@ void SequencerKernel::rotateSeqByOne(int seqn, bool directionRight) {// caller s
 }
 
 
-void SequencerKernel::activateTiedStep(int seqn, int stepn) {// caller sets dirty[] to 1
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::activateTiedStep(int seqn, int stepn) {// caller sets dirty[] to 1
 	attributes[seqn][stepn].setTied(true);
 	if (stepn > 0) {
 		propagateCVtoTied(seqn, stepn - 1);
@@ -536,7 +689,8 @@ void SequencerKernel::activateTiedStep(int seqn, int stepn) {// caller sets dirt
 }
 
 
-void SequencerKernel::deactivateTiedStep(int seqn, int stepn) {// caller sets dirty[] to 1
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::deactivateTiedStep(int seqn, int stepn) {// caller sets dirty[] to 1
 	attributes[seqn][stepn].setTied(false);
 	if (*holdTiedNotesPtr && stepn != 0) {// new method
 		int lastGateType = attributes[seqn][stepn].getGateType();
@@ -548,7 +702,8 @@ void SequencerKernel::deactivateTiedStep(int seqn, int stepn) {// caller sets di
 }
 
 
-void SequencerKernel::calcGateCode(bool editingSequence) {
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::calcGateCode(bool editingSequence) {
 	// uses stepIndexRun as the step and {phraseIndexRun or seqIndexEdit} to determine the seq
 	
 	// computes gateCode and lastProbGateEnable
@@ -570,7 +725,7 @@ void SequencerKernel::calcGateCode(bool editingSequence) {
 	
 	// calc: ** lastProbGateEnable ** decision only when first ppqn of a non-tied step
 	if (ppqnCount == 0 && !attribute.getTied()) {
-		lastProbGateEnable = !attribute.getGateP() || (random::uniform() < ((float)attribute.getGatePVal() / 100.0f));// random::uniform is [0.0, 1.0), see include/util/common.hpp
+		lastProbGateEnable = !attribute.getGateP() || (rng.uniform() < ((float)attribute.getGatePVal() / 100.0f));// uniform() is [0.0, 1.0)
 	}
 	
 	// calc: ** gateType ** 
@@ -585,24 +740,45 @@ void SequencerKernel::calcGateCode(bool editingSequence) {
 			gateCode = (ppqnCount == 0 ? 3 : 0);// trig on first ppqnCount
 		}
 		else {
-			uint64_t shiftAmt = ((uint64_t)ppqnCount) * (((uint64_t)96) / ((uint64_t)ppsFiltered));
+			if (pulseMasksPps != pulsesPerStep)
+				updatePulseMasks();
+			gateCode = (int)((pulseMasks[gateType][ppqnCount >> 6] >> (ppqnCount & 0x3F)) & (uint64_t)0x1);
+		}
+	}
+}
+
+
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::updatePulseMasks() {
+	// renders the advanced gate hit masks (in 96ths of a step) into one bit per pulse of a step, for the current pulses per step
+	// (at most 96 pulses, so two 64-bit words per gate type); trigger gates (type 11) are handled directly in calcGateCode()
+	int ppsFiltered = getPulsesPerStep();// must use method
+	for (int gateType = 0; gateType < NUM_GATES; gateType++) {
+		pulseMasks[gateType][0] = 0;
+		pulseMasks[gateType][1] = 0;
+		for (int pulsen = 0; pulsen < ppsFiltered; pulsen++) {
+			uint64_t shiftAmt = ((uint64_t)pulsen) * (((uint64_t)96) / ((uint64_t)ppsFiltered));
+			uint64_t hit;
 			if (shiftAmt >= 64)
-				gateCode = (int)((advGateHitMaskHigh[gateType] >> (shiftAmt - (uint64_t)64)) & (uint64_t)0x1);
+				hit = (advGateHitMaskHigh[gateType] >> (shiftAmt - (uint64_t)64)) & (uint64_t)0x1;
 			else
-				gateCode = (int)((advGateHitMaskLow[gateType] >> shiftAmt) & (uint64_t)0x1);
+				hit = (advGateHitMaskLow[gateType] >> shiftAmt) & (uint64_t)0x1;
+			pulseMasks[gateType][pulsen >> 6] |= (hit << (pulsen & 0x3F));
 		}
 	}
+	pulseMasksPps = pulsesPerStep;
 }
 	
 
-bool SequencerKernel::moveStepIndexRun(bool init, bool editingSequence) {	
+template <int STEPS, int SEQS, int PHRASES>
+bool SequencerKernel<STEPS, SEQS, PHRASES>::moveStepIndexRun(bool init, bool editingSequence) {	
 	if (moveStepIndexRunIgnore) {
 		moveStepIndexRunIgnore = false;
 		return true;
 	}
 	
 	int reps = (editingSequence ? 1 : phrases[phraseIndexRun].getReps());// 0-rep seqs should be filtered elsewhere and should never happen here. If they do, they will be played (this can be the case when all of the song has 0-rep seqs, or the song is started (reset) into a first phrase that has 0 reps)
-	// assert((reps * MAX_STEPS) <= 0xFFF); // for BRN and RND run modes, history is not a span count but a step count
+	// assert((reps * MAX_STEPS) <= 0xFFFF); // for BRN and RND run modes, history is not a span count but a step count
 	int seqn = (editingSequence ? seqIndexEdit : phrases[phraseIndexRun].getSeqNum());
 	int runMode = sequences[seqn].getRunMode();
 	int endStep = sequences[seqn].getLength() - 1;
@@ -618,9 +794,9 @@ bool SequencerKernel::moveStepIndexRun(bool init, bool editingSequence) {
 	
 		// history 0x0000 is reserved for reset
 		
-		case MODE_REV :// reverse; history base is 0x2000
-			if (stepIndexRunHistory < 0x2001 || stepIndexRunHistory > 0x2FFF)
-				stepIndexRunHistory = 0x2000 + reps;
+		case MODE_REV :// reverse; history base is 0x20000
+			if (stepIndexRunHistory < 0x20001 || stepIndexRunHistory > 0x2FFFF)
+				stepIndexRunHistory = 0x20000 + reps;
 			if (init)
 				stepIndexRun = endStep;
 			else {
@@ -628,15 +804,15 @@ bool SequencerKernel::moveStepIndexRun(bool init, bool editingSequence) {
 				if (stepIndexRun < 0) {
 					stepIndexRun = endStep;
 					stepIndexRunHistory--;
-					if (stepIndexRunHistory <= 0x2000)
+					if (stepIndexRunHistory <= 0x20000)
 						crossBoundary = true;
 				}
 			}
 		break;
 		
-		case MODE_PPG :// forward-reverse; history base is 0x3000
-			if (stepIndexRunHistory < 0x3001 || stepIndexRunHistory > 0x3FFF) // even means going forward, odd means going reverse
-				stepIndexRunHistory = 0x3000 + reps * 2;
+		case MODE_PPG :// forward-reverse; history base is 0x30000
+			if (stepIndexRunHistory < 0x30001 || stepIndexRunHistory > 0x3FFFF) // even means going forward, odd means going reverse
+				stepIndexRunHistory = 0x30000 + reps * 2;
 			if (init)
 				stepIndexRun = 0;
 			else {
@@ -652,16 +828,16 @@ bool SequencerKernel::moveStepIndexRun(bool init, bool editingSequence) {
 					if (stepIndexRun < 0) {
 						stepIndexRun = 0;
 						stepIndexRunHistory--;
-						if (stepIndexRunHistory <= 0x3000)
+						if (stepIndexRunHistory <= 0x30000)
 							crossBoundary = true;
 					}
 				}
 			}
 		break;
 
-		case MODE_PEN :// forward-reverse; history base is 0x4000
-			if (stepIndexRunHistory < 0x4001 || stepIndexRunHistory > 0x4FFF) // even means going forward, odd means going reverse
-				stepIndexRunHistory = 0x4000 + reps * 2;
+		case MODE_PEN :// forward-reverse; history base is 0x40000
+			if (stepIndexRunHistory < 0x40001 || stepIndexRunHistory > 0x4FFFF) // even means going forward, odd means going reverse
+				stepIndexRunHistory = 0x40000 + reps * 2;
 			if (init)
 				stepIndexRun = 0;
 			else {			
@@ -673,7 +849,7 @@ bool SequencerKernel::moveStepIndexRun(bool init, bool editingSequence) {
 						if (stepIndexRun <= 0) {// if back at start after turnaround, then no reverse phase needed
 							stepIndexRun = 0;
 							stepIndexRunHistory--;
-							if (stepIndexRunHistory <= 0x4000)
+							if (stepIndexRunHistory <= 0x40000)
 								crossBoundary = true;
 						}
 					}
@@ -685,67 +861,67 @@ bool SequencerKernel::moveStepIndexRun(bool init, bool editingSequence) {
 					if (stepIndexRun <= 0) {
 						stepIndexRun = 0;
 						stepIndexRunHistory--;
-						if (stepIndexRunHistory <= 0x4000)
+						if (stepIndexRunHistory <= 0x40000)
 							crossBoundary = true;
 					}
 				}
 			}
 		break;
 		
-		case MODE_BRN :// brownian random; history base is 0x5000
-			if (stepIndexRunHistory < 0x5001 || stepIndexRunHistory > 0x5FFF) 
-				stepIndexRunHistory = 0x5000 + (endStep + 1) * reps;			
+		case MODE_BRN :// brownian random; history base is 0x50000
+			if (stepIndexRunHistory < 0x50001 || stepIndexRunHistory > 0x5FFFF) 
+				stepIndexRunHistory = 0x50000 + (endStep + 1) * reps;			
 			if (init)
 				stepIndexRun = 0;
 			else {
-				stepIndexRun += (random::u32() % 3) - 1;
+				stepIndexRun += (rng.u32() % 3) - 1;
 				if (stepIndexRun > endStep)
 					stepIndexRun = 0;
 				if (stepIndexRun < 0)
 					stepIndexRun = endStep;
 				stepIndexRunHistory--;
-				if (stepIndexRunHistory <= 0x5000)
+				if (stepIndexRunHistory <= 0x50000)
 					crossBoundary = true;
 			}
 		break;
 		
-		case MODE_RND :// random; history base is 0x6000
-			if (stepIndexRunHistory < 0x6001 || stepIndexRunHistory > 0x6FFF)
-				stepIndexRunHistory = 0x6000 + (endStep + 1) * reps;
+		case MODE_RND :// random; history base is 0x60000
+			if (stepIndexRunHistory < 0x60001 || stepIndexRunHistory > 0x6FFFF)
+				stepIndexRunHistory = 0x60000 + (endStep + 1) * reps;
 			if (init)
 				stepIndexRun = 0;
 			else {
-				stepIndexRun = (random::u32() % (endStep + 1));
+				stepIndexRun = (rng.u32() % (endStep + 1));
 				stepIndexRunHistory--;
-				if (stepIndexRunHistory <= 0x6000)
+				if (stepIndexRunHistory <= 0x60000)
 					crossBoundary = true;
 			}
 		break;
 
-		case MODE_RNS :// random single step; history base is 0x8000
+		case MODE_RNS :// random single step; history base is 0x80000
 			// (play each step only once per seq, and play all before restart anew)
-			if (stepIndexRunHistory < 0x8001 || stepIndexRunHistory > 0x8FFF)
-				stepIndexRunHistory = 0x8000 + (endStep + 1) * reps;
+			if (stepIndexRunHistory < 0x80001 || stepIndexRunHistory > 0x8FFFF)
+				stepIndexRunHistory = 0x80000 + (endStep + 1) * reps;
 			if (init)
 				stepIndexRun = 0;
 			else {
-				stepIndexRun = singleStepRandom.getNext(endStep + 1);//(random::u32() % (endStep + 1));
+				stepIndexRun = singleStepRandom.getNext(endStep + 1, &rng);
 				stepIndexRunHistory--;
-				if (stepIndexRunHistory <= 0x8000)
+				if (stepIndexRunHistory <= 0x80000)
 					crossBoundary = true;
 			}
 		break;
 		
-		case MODE_TKA :// use track A's stepIndexRun; base is 0x7000
+		case MODE_TKA :// use track A's stepIndexRun; base is 0x70000
 			if (masterKernel != nullptr) {
-				stepIndexRunHistory = 0x7000;
+				stepIndexRunHistory = 0x70000;
 				stepIndexRun = masterKernel->getStepIndexRun();
 				break;
 			}
 			[[fallthrough]];// TKA defaults to FWD for track A
-		default :// MODE_FWD  forward; history base is 0x1000
-			if (stepIndexRunHistory < 0x1001 || stepIndexRunHistory > 0x1FFF)
-				stepIndexRunHistory = 0x1000 + reps;
+		default :// MODE_FWD  forward; history base is 0x10000
+			if (stepIndexRunHistory < 0x10001 || stepIndexRunHistory > 0x1FFFF)
+				stepIndexRunHistory = 0x10000 + reps;
 			if (init)
 				stepIndexRun = 0;
 			else {			
@@ -753,7 +929,7 @@ bool SequencerKernel::moveStepIndexRun(bool init, bool editingSequence) {
 				if (stepIndexRun > endStep) {
 					stepIndexRun = 0;
 					stepIndexRunHistory--;
-					if (stepIndexRunHistory <= 0x1000)
+					if (stepIndexRunHistory <= 0x10000)
 						crossBoundary = true;
 				}
 			}
@@ -763,7 +939,8 @@ bool SequencerKernel::moveStepIndexRun(bool init, bool editingSequence) {
 }
 
 
-bool SequencerKernel::movePhraseIndexBackward(bool init, bool rollover) {
+template <int STEPS, int SEQS, int PHRASES>
+bool SequencerKernel<STEPS, SEQS, PHRASES>::movePhraseIndexBackward(bool init, bool rollover) {
 	int phrn = 0;
 	bool crossBoundary = false;
 
@@ -788,7 +965,8 @@ bool SequencerKernel::movePhraseIndexBackward(bool init, bool rollover) {
 }
 
 
-bool SequencerKernel::movePhraseIndexForeward(bool init, bool rollover) {
+template <int STEPS, int SEQS, int PHRASES>
+bool SequencerKernel<STEPS, SEQS, PHRASES>::movePhraseIndexForeward(bool init, bool rollover) {
 	int phrn = 0;
 	bool crossBoundary = false;
 	
@@ -813,7 +991,8 @@ bool SequencerKernel::movePhraseIndexForeward(bool init, bool rollover) {
 }
 
 
-void SequencerKernel::movePhraseIndexRandom(bool init, uint32_t randomValue) {
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::movePhraseIndexRandom(bool init, uint32_t randomValue) {
 	int tpi = 0;
 	
 	for (int phrn = songBeginIndex; phrn <= songEndIndex; phrn++) {
@@ -833,7 +1012,8 @@ void SequencerKernel::movePhraseIndexRandom(bool init, uint32_t randomValue) {
 }
 
 
-void SequencerKernel::movePhraseIndexRandomSingle(bool init) {
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::movePhraseIndexRandomSingle(bool init) {
 	int tpi = 0;
 	
 	for (int phrn = songBeginIndex; phrn <= songEndIndex; phrn++) {
@@ -848,12 +1028,13 @@ void SequencerKernel::movePhraseIndexRandomSingle(bool init) {
 		phraseIndexRun = (tpi == 0 ? songBeginIndex : tempPhraseIndexes[0]);
 	}
 	else {	
-		phraseIndexRun = tempPhraseIndexes[singlePhraseRandom.getNext(tpi)];// tempPhraseIndexes[randomValue % tpi];
+		phraseIndexRun = tempPhraseIndexes[singlePhraseRandom.getNext(tpi, &rng)];// tempPhraseIndexes[randomValue % tpi];
 	}
 }
 
 
-void SequencerKernel::movePhraseIndexBrownian(bool init, uint32_t randomValue) {	
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::movePhraseIndexBrownian(bool init, uint32_t randomValue) {	
 	randomValue = randomValue % 3;// 0 = left, 1 = stay, 2 = right
 	
 	if (init) {
@@ -872,7 +1053,8 @@ void SequencerKernel::movePhraseIndexBrownian(bool init, uint32_t randomValue) {
 }
 
 
-bool SequencerKernel::movePhraseIndexRun(bool init) {
+template <int STEPS, int SEQS, int PHRASES>
+bool SequencerKernel<STEPS, SEQS, PHRASES>::movePhraseIndexRun(bool init) {
 	bool crossBoundary = false;
 	
 	if (init) {
@@ -917,12 +1099,12 @@ bool SequencerKernel::movePhraseIndexRun(bool init) {
 		
 		case MODE_BRN :// brownian random; history base is 0x5000
 			phraseIndexRunHistory = 0x5000;
-			movePhraseIndexBrownian(init, random::u32());// no crossBoundary
+			movePhraseIndexBrownian(init, rng.u32());// no crossBoundary
 		break;
 		
 		case MODE_RND :// random; history base is 0x6000
 			phraseIndexRunHistory = 0x6000;
-			movePhraseIndexRandom(init, random::u32());// no crossBoundary
+			movePhraseIndexRandom(init, rng.u32());// no crossBoundary
 		break;
 		
 		case MODE_RNS :// random single phrase; history base is 0x8000
@@ -947,20 +1129,27 @@ bool SequencerKernel::movePhraseIndexRun(bool init) {
 
 
  
-void SeqCPbuffer::reset() {		
-	for (int stepn = 0; stepn < SequencerKernel::MAX_STEPS; stepn++) {
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::SeqCPbuffer::reset() {		
+	for (int stepn = 0; stepn < MAX_STEPS; stepn++) {
 		cvCPbuffer[stepn] = 0.0f;
 		attribCPbuffer[stepn].init();
 	}
-	seqAttribCPbuffer.init(SequencerKernel::MAX_STEPS, SequencerKernel::MODE_FWD);
-	storedLength = SequencerKernel::MAX_STEPS;// number of steps that contain actual cp data
+	seqAttribCPbuffer.init(MAX_STEPS, MODE_FWD);
+	storedLength = MAX_STEPS;// number of steps that contain actual cp data
 }
 
-void SongCPbuffer::reset() {
-	for (int phrn = 0; phrn < SequencerKernel::MAX_PHRASES; phrn++)
+template <int STEPS, int SEQS, int PHRASES>
+void SequencerKernel<STEPS, SEQS, PHRASES>::SongCPbuffer::reset() {
+	for (int phrn = 0; phrn < MAX_PHRASES; phrn++)
 		phraseCPbuffer[phrn].init();
 	beginIndex = 0;
 	endIndex = 0;
-	runModeSong = SequencerKernel::MODE_FWD;
-	storedLength = SequencerKernel::MAX_PHRASES;
+	runModeSong = MODE_FWD;
+	storedLength = MAX_PHRASES;
 }
+
+
+// Kernel dimensions used by Foundry (4 tracks of 32 steps) and Foundry16 (16 tracks of 64 steps)
+template class SequencerKernel<32, 64, 99>;
+template class SequencerKernel<64, 64, 99>;
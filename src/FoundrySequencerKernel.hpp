@@ -40,7 +40,7 @@ class StepAttributes {
 	bool getSlide() {return (attributes & ATT_MSK_SLIDE) != 0;}
 	int getSlideVal() {return (int)((attributes & ATT_MSK_SLIDE_VAL) >> slideValShift);}
 	int getVelocityVal() {return (int)((attributes & ATT_MSK_VELOCITY) >> velocityShift);}
-	unsigned long getAttribute() {return attributes;}
+	unsigned long getAttribute() const {return attributes;}
 
 	void setGate(bool gate1State) {attributes &= ~ATT_MSK_GATE; if (gate1State) attributes |= ATT_MSK_GATE;}
 	void setGateType(int gateType) {attributes &= ~ATT_MSK_GATETYPE; attributes |= (((unsigned long)gateType) << gateTypeShift);}
@@ -77,7 +77,7 @@ class Phrase {
 	
 	int getSeqNum() {return (int)(phrase & PHR_MSK_SEQNUM);}
 	int getReps() {return (int)((phrase & PHR_MSK_REPS) >> repShift);}
-	unsigned long getPhraseJson() {return phrase - (1 << repShift);}// compression trick (store 0 instead of 1)
+	unsigned long getPhraseJson() const {return phrase - (1 << repShift);}// compression trick (store 0 instead of 1)
 	
 	void setSeqNum(int seqn) {phrase &= ~PHR_MSK_SEQNUM; phrase |= ((unsigned long)seqn);}
 	void setReps(int _reps) {phrase &= ~PHR_MSK_REPS; phrase |= (((unsigned long)_reps) << repShift);}
@@ -117,7 +117,7 @@ class SeqAttributes {
 			ret *= -1;
 		return ret;
 	}
-	unsigned long getSeqAttrib() {return attributes;}
+	unsigned long getSeqAttrib() const {return attributes;}
 	
 	void setLength(int length) {attributes &= ~SEQ_MSK_LENGTH; attributes |= ((unsigned long)length);}
 	void setRunMode(int runMode) {attributes &= ~SEQ_MSK_RUNMODE; attributes |= (((unsigned long)runMode) << runModeShift);}
@@ -141,31 +141,31 @@ class SeqAttributes {
 
 
 class SingleStepRandom {
-	uint32_t played = 0;// bit field that says if a given item was already played, max 32 steps
+	uint64_t played = 0;// bit field that says if a given item was already played, max 64 steps
 	std::vector<uint8_t> candidates;
 	
 	public:
 	
 	void init() {played = 0x1;}// we always start on (reset to) first step, so mark it as played
 	
-	int getNext(int length) {
+	int getNext(int length, RandomStream* rng) {
 		// get a random unplayed step within length, if none, reset all and choose one randomly
 		int retStep = 0;
 		
 		candidates.clear();
 		for (int i = 0; i < length; i++) {
-			if ( (played & (0x1 << i)) == 0) {
+			if ( (played & (((uint64_t)0x1) << i)) == 0) {
 				candidates.push_back(i);
 			}
 		}
 		if (candidates.empty()) {
 			played = 0;
-			retStep = random::u32() % length;
+			retStep = rng->u32() % length;
 		}
 		else {
-			retStep = candidates[random::u32() % candidates.size()];
+			retStep = candidates[rng->u32() % candidates.size()];
 		}
-		played |= (0x1 << retStep);
+		played |= (((uint64_t)0x1) << retStep);
 		
 		return retStep;
 	}
@@ -180,7 +180,7 @@ class SinglePhraseRandom {
 	
 	void init() {played0 = 0x1, played1 = 0;}// we always start on (reset to) first phrase, so mark it as played
 	
-	int getNext(int length) {
+	int getNext(int length, RandomStream* rng) {
 		// get a random unplayed index in tempPhraseIndexes[] within length, if none, reset all and choose one randomly
 		int tpiIndex = 0;
 		
@@ -199,10 +199,10 @@ class SinglePhraseRandom {
 		}
 		if (candidates.empty()) {
 			played0 = 0, played1 = 0;
-			tpiIndex = random::u32() % length;
+			tpiIndex = rng->u32() % length;
 		}
 		else {
-			tpiIndex = candidates[random::u32() % candidates.size()];
+			tpiIndex = candidates[rng->u32() % candidates.size()];
 		}
 		if (tpiIndex < 64) {
 			played0 |= (((uint64_t)0x1) << tpiIndex);
@@ -221,21 +221,55 @@ class SinglePhraseRandom {
 //*****************************************************************************
 
 
-struct SeqCPbuffer;
-struct SongCPbuffer;
-
+// The kernel dimensions are template parameters; the dimensions that are used must be explicitly
+//   instantiated at the end of FoundrySequencerKernel.cpp
+template <int STEPS, int SEQS, int PHRASES>
 class SequencerKernel {
 	public: 
 
 	// Sequencer kernel dimensions
-	static const int MAX_STEPS = 32;// must be a power of two (some multi select loops have bitwise "& (MAX_STEPS - 1)")
-	static const int MAX_SEQS = 64;
-	static const int MAX_PHRASES = 99;// maximum value is 99 (index value is 0 to 98; disp will be 1 to 99)
+	static const int MAX_STEPS = STEPS;// must be a power of two (some multi select loops have bitwise "& (MAX_STEPS - 1)")
+	static const int MAX_SEQS = SEQS;
+	static const int MAX_PHRASES = PHRASES;// maximum value is 99 (index value is 0 to 98; disp will be 1 to 99)
+	static_assert(MAX_STEPS >= 2 && MAX_STEPS <= 64 && (MAX_STEPS & (MAX_STEPS - 1)) == 0, "MAX_STEPS must be a power of two, max 64 (SingleStepRandom)");
+	static_assert(MAX_SEQS >= 1 && MAX_SEQS <= 99, "MAX_SEQS must be 1 to 99 (two digit display)");
+	static_assert(MAX_PHRASES >= 1 && MAX_PHRASES <= 99, "MAX_PHRASES must be 1 to 99 (two digit display)");
 
 	// Run modes
 	enum RunModeIds {MODE_FWD, MODE_REV, MODE_PPG, MODE_PEN, MODE_BRN, MODE_RND, MODE_TKA, MODE_RNS, NUM_MODES};
 	static const std::string modeLabels[NUM_MODES];
 	
+	// Copy of the song and sequences, serialized by dataToJson() (see StateSnapshot)
+	struct Snapshot {
+		Phrase phrases[MAX_PHRASES];
+		SeqAttributes sequences[MAX_SEQS];
+		float cv[MAX_SEQS][MAX_STEPS];
+		StepAttributes attributes[MAX_SEQS][MAX_STEPS];
+		char dirty[MAX_SEQS];
+	};
+	
+	// Copy-paste buffers (owned by the Sequencer)
+	struct SeqCPbuffer {
+		float cvCPbuffer[MAX_STEPS];// copy paste buffer for CVs
+		StepAttributes attribCPbuffer[MAX_STEPS];
+		SeqAttributes seqAttribCPbuffer;
+		int storedLength;// number of steps that contain actual cp data
+		
+		SeqCPbuffer() {reset();}
+		void reset();
+	};// struct SeqCPbuffer
+
+	struct SongCPbuffer {
+		Phrase phraseCPbuffer[MAX_PHRASES];
+		int beginIndex;
+		int endIndex;
+		int runModeSong;
+		int storedLength;// number of steps that contain actual cp data
+		
+		SongCPbuffer() {reset();}
+		void reset();
+	};// struct SongCPbuffer
+	
 	
 	private:
 	
@@ -283,6 +317,9 @@ class SequencerKernel {
 	SequencerKernel *masterKernel = nullptr;// nullptr for track 0, used for grouped run modes (tracks B,C,D follow A when random, for example)
 	bool* holdTiedNotesPtr = nullptr;
 	int* stopAtEndOfSongPtr = nullptr;
+	RandomStream rng;// for the random run modes and gate probabilities, seeded by the module
+	uint64_t pulseMasks[NUM_GATES][2];// bit n is the gate state of pulse n of a step, for each gate type, see updatePulseMasks()
+	int pulseMasksPps = 0;// pulsesPerStep that pulseMasks was rendered for (0 means not rendered yet)
 	
 	
 	
@@ -293,9 +330,11 @@ class SequencerKernel {
 	void resetNonJson(bool editingSequence);
 	void onRandomize(bool editingSequence);
 	void initRun(bool editingSequence);
+	void seedRandom(uint32_t seed) {rng.seed(seed, id);}
 	void initPulsesPerStep() {pulsesPerStep = 1;}
 	void initDelay() {delay = 0;}
-	void dataToJson(json_t *rootJ);
+	void fillSnapshot(Snapshot* snap);
+	void dataToJson(json_t *rootJ, const Snapshot& snap);
 	void dataFromJson(json_t *rootJ, bool editingSequence);
 
 
@@ -477,6 +516,7 @@ class SequencerKernel {
 	void activateTiedStep(int seqn, int stepn);
 	void deactivateTiedStep(int seqn, int stepn);
 	void calcGateCode(bool editingSequence);
+	void updatePulseMasks();
 	bool moveStepIndexRun(bool init, bool editingSequence);
 	bool movePhraseIndexBackward(bool init, bool rollover);
 	bool movePhraseIndexForeward(bool init, bool rollover);
@@ -485,27 +525,6 @@ class SequencerKernel {
 	void movePhraseIndexRandomSingle(bool init);	
 	void movePhraseIndexBrownian(bool init, uint32_t randomValue);	
 	bool movePhraseIndexRun(bool init);
+	bool binDataFromJson(const char* binData);
+	void legacyDataFromJson(json_t *rootJ);
 };// class SequencerKernel 
-
-
-struct SeqCPbuffer {
-	float cvCPbuffer[SequencerKernel::MAX_STEPS];// copy paste buffer for CVs
-	StepAttributes attribCPbuffer[SequencerKernel::MAX_STEPS];
-	SeqAttributes seqAttribCPbuffer;
-	int storedLength;// number of steps that contain actual cp data
-	
-	SeqCPbuffer() {reset();}
-	void reset();
-};// struct SeqCPbuffer
-
-
-struct SongCPbuffer {
-	Phrase phraseCPbuffer[SequencerKernel::MAX_PHRASES];
-	int beginIndex;
-	int endIndex;
-	int runModeSong;
-	int storedLength;// number of steps that contain actual cp data
-	
-	SongCPbuffer() {reset();}
-	void reset();
-};// song SeqCPbuffer
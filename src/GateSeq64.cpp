@@ -62,6 +62,13 @@ struct GateSeq64 : Module {
 	static const int blinkNumInit = 15;// init number of blink cycles for cursor
 	static constexpr float editingPhraseSongRunningTime = 4.0f;// seconds
 
+	// Copy of the song and sequences, serialized by dataToJson() (see StateSnapshot)
+	struct SeqSnapshot {
+		StepAttributesGS attributes[MAX_SEQS][64];
+		SeqAttributesGS sequences[MAX_SEQS];
+		int phrase[64];
+	};
+
 	// Need to save, no reset
 	int panelTheme;
 	float panelContrast;
@@ -80,6 +87,7 @@ struct GateSeq64 : Module {
 	SeqAttributesGS sequences[MAX_SEQS];
 	int phrase[64];// This is the song (series of phases; a phrase is a patten number)
 	bool resetOnRun;
+	ClockBusReader clockBusReader;// clock, reset and run from the clock bus instead of the cables when subscribed
 	int retrigGatesOnReset;
 	bool stopAtEndOfSong;
 	bool lock;
@@ -111,6 +119,7 @@ struct GateSeq64 : Module {
 	// No need to save, no reset
 	int stepConfigSync = 0;// 0 means no sync requested, 1 means synchronous read of lengths requested
 	RefreshCounter refresh;
+	StateSnapshot<SeqSnapshot> snapshot;// song and sequences for dataToJson()
 	float resetLight = 0.0f;
 	int sequenceKnob = 0;
 	Trigger modesTrigger;
@@ -229,10 +238,12 @@ struct GateSeq64 : Module {
 			phrase[i] = 0;
 		}
 		resetOnRun = false;
+		clockBusReader.source = -1;
 		retrigGatesOnReset = RGOR_NRUN;
 		stopAtEndOfSong = false;
 		lock = false;
 		resetNonJson(false);
+		publishSnapshot();
 	}
 	void resetNonJson(bool delayed) {// delay thread sensitive parts (i.e. schedule them so that process() will do them)
 		displayState = DISP_GATE;
@@ -282,11 +293,30 @@ struct GateSeq64 : Module {
 			}
 			sequences[sequence].randomize(16 * stepConfig, NUM_MODES);// ok to use stepConfig since CONFIG_PARAM is not randomizable		
 		}
+		publishSnapshot();
 	}
 	
 	
+	void fillSnapshot(SeqSnapshot* snap) {// the song and sequences are a single chunk
+		std::memcpy(snap->attributes, attributes, sizeof(attributes));
+		std::memcpy(snap->sequences, sequences, sizeof(sequences));
+		std::memcpy(snap->phrase, phrase, sizeof(phrase));
+	}
+
+
+	void publishSnapshot() {// onReset(), onRandomize() and dataFromJson() only (see StateSnapshot)
+		snapshot.publishNow([this](SeqSnapshot* snap, uint32_t chunks) {fillSnapshot(snap);});
+	}
+	void processSnapshot() {// end of process() and processBypass() only (see StateSnapshot)
+		snapshot.process([this](SeqSnapshot* snap, uint32_t chunks) {fillSnapshot(snap);});
+	}
+
+
 	json_t *dataToJson() override {
 		json_t *rootJ = json_object();
+		
+		// song and sequences are taken from a consistent copy of the state (see StateSnapshot)
+		const SeqSnapshot* snap = snapshot.acquire([this](SeqSnapshot* snap, uint32_t chunks) {fillSnapshot(snap);});
 
 		// panelTheme
 		json_object_set_new(rootJ, "panelTheme", json_integer(panelTheme));
@@ -325,24 +355,27 @@ struct GateSeq64 : Module {
 		json_t *attributesJ = json_array();
 		for (int i = 0; i < MAX_SEQS; i++)
 			for (int s = 0; s < 64; s++) {
-				json_array_insert_new(attributesJ, s + (i * 64), json_integer(attributes[i][s].getAttribute()));
+				json_array_insert_new(attributesJ, s + (i * 64), json_integer(snap->attributes[i][s].getAttribute()));
 			}
 		json_object_set_new(rootJ, "attributes2", attributesJ);// "2" appended so no break patches
 		
 		// sequences
 		json_t *sequencesJ = json_array();
 		for (int i = 0; i < MAX_SEQS; i++)
-			json_array_insert_new(sequencesJ, i, json_integer(sequences[i].getSeqAttrib()));
+			json_array_insert_new(sequencesJ, i, json_integer(snap->sequences[i].getSeqAttrib()));
 		json_object_set_new(rootJ, "sequences", sequencesJ);
 
 		// phrase 
 		json_t *phraseJ = json_array();
 		for (int i = 0; i < 64; i++)
-			json_array_insert_new(phraseJ, i, json_integer(phrase[i]));
+			json_array_insert_new(phraseJ, i, json_integer(snap->phrase[i]));
 		json_object_set_new(rootJ, "phrase2", phraseJ);// "2" appended so no break patches
 
 		// resetOnRun
 		json_object_set_new(rootJ, "resetOnRun", json_boolean(resetOnRun));
+
+		// clockBusSource
+		json_object_set_new(rootJ, "clockBusSource", json_integer(clockBusReader.source));
 		
 		// retrigGatesOnReset
 		json_object_set_new(rootJ, "retrigGatesOnReset2", json_integer(retrigGatesOnReset));
@@ -353,6 +386,8 @@ struct GateSeq64 : Module {
 		// lock
 		json_object_set_new(rootJ, "lock", json_boolean(lock));
 
+		snapshot.release();
+
 		return rootJ;
 	}
 
@@ -534,6 +569,13 @@ struct GateSeq64 : Module {
 		if (resetOnRunJ)
 			resetOnRun = json_is_true(resetOnRunJ);
 
+		// clockBusSource
+		json_t *clockBusSourceJ = json_object_get(rootJ, "clockBusSource");
+		if (clockBusSourceJ) {
+			clockBusReader.source = clamp((int)json_integer_value(clockBusSourceJ), -1, ClockBus::NUM_CLOCKS - 1);
+			clockBusReader.sync();
+		}
+
 		// retrigGatesOnReset
 		json_t *retrigGatesOnResetJ = json_object_get(rootJ, "retrigGatesOnReset2");
 		if (retrigGatesOnResetJ)
@@ -550,9 +592,17 @@ struct GateSeq64 : Module {
 			lock = json_is_true(lockJ);
 		
 		resetNonJson(true);
+		publishSnapshot();
 	}
 
 	
+	void processBypass(const ProcessArgs &args) override {
+		Module::processBypass(args);
+		// keep publishing the edits done on the UI thread while bypassed (see StateSnapshot)
+		processSnapshot();
+	}
+	
+	
 	void process(const ProcessArgs &args) override {
 		static const float displayProbInfoTime = 3.0f;// seconds
 		static const float revertDisplayTime = 0.7f;// seconds
@@ -568,7 +618,12 @@ struct GateSeq64 : Module {
 		bool editingSequence = isEditingSequence();// true = editing sequence, false = editing song
 		
 		// Run state button
-		if (runningTrigger.process(params[RUN_PARAM].getValue() + inputs[RUNCV_INPUT].getVoltage())) {// no input refresh here, don't want to introduce startup skew
+		bool busClock = clockBusReader.isSubscribed();
+		bool runToggled = runningTrigger.process(params[RUN_PARAM].getValue() + (busClock ? 0.0f : inputs[RUNCV_INPUT].getVoltage()));// no input refresh here, don't want to introduce startup skew
+		if (busClock && clockBusReader.processRun()) {
+			runToggled = !runToggled;
+		}
+		if (runToggled) {
 			running = !running;
 			if (running) {
 				if (resetOnRun) {
@@ -592,12 +647,14 @@ struct GateSeq64 : Module {
 			int oldStepConfig = stepConfig;
 			stepConfig = getStepConfig();
 			if (stepConfigSync != 0) {// sync from dataFromJson, so read lengths from seqAttribBuffer
+				snapshot.markDirty();
 				for (int i = 0; i < MAX_SEQS; i++)
 					sequences[i].setSeqAttrib(seqAttribBuffer[i].getSeqAttrib());
 				initRun();	
 				stepConfigSync = 0;
 			}
 			else if (stepConfig != oldStepConfig) {// switch moved, so init lengths
+				snapshot.markDirty();
 				for (int i = 0; i < MAX_SEQS; i++)
 					sequences[i].setLength(16 * stepConfig);
 				initRun();
@@ -630,6 +687,7 @@ struct GateSeq64 : Module {
 			}
 			// Paste button
 			if (pasteTrigger.process(params[PASTE_PARAM].getValue())) {
+				snapshot.markDirty();
 				infoCopyPaste = (long) (-1 * revertDisplayTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
 				startCP = 0;
 				if (countCP <= 8) {
@@ -705,6 +763,7 @@ struct GateSeq64 : Module {
 				bool write1Trig = write1Trigger.process(messagesFromExpander[3]);
 				if (writeTrig || write0Trig || write1Trig) {
 					if (editingSequence) {
+						snapshot.markDirty();
 						blinkNum = blinkNumInit;
 						if (writeTrig) {// higher priority than write0 and write1
 							if (!std::isnan(messagesFromExpander[1])) {
@@ -743,6 +802,7 @@ struct GateSeq64 : Module {
 					stepPressed = i;
 			}		
 			if (stepPressed != -1 && !lock) {
+				snapshot.markDirty();
 				if (editingSequence) {
 					if (displayState == DISP_LENGTH) {
 						sequences[sequence].setLength(stepPressed % (16 * stepConfig) + 1);
@@ -825,6 +885,7 @@ struct GateSeq64 : Module {
 			if (probTrigger.process(params[PROB_PARAM].getValue())) {
 				blinkNum = blinkNumInit;
 				if (editingSequence && !lock) {
+					snapshot.markDirty();
 					if (attributes[sequence][stepIndexEdit].getGate()) {// gate is on and pressed gatep
 						if (attributes[sequence][stepIndexEdit].getGateP()) {
 							displayProbInfo = 0l;
@@ -850,6 +911,7 @@ struct GateSeq64 : Module {
 					blinkNum = blinkNumInit;
 					if (editingSequence && !lock && attributes[sequence][stepIndexEdit].getGate()) {
 						if (ppsRequirementMet(i, pulsesPerStep)) {
+							snapshot.markDirty();
 							editingPpqn = 0l;
 							attributes[sequence][stepIndexEdit].setGateMode(i);
 						}
@@ -869,6 +931,7 @@ struct GateSeq64 : Module {
 			int deltaKnob = newSequenceKnob - sequenceKnob;
 			if (deltaKnob != 0) {
 				if (abs(deltaKnob) <= 3) {// avoid discontinuous step (initialize for example)
+					snapshot.markDirty();
 					if (displayProbInfo != 0l && editingSequence) {
 						blinkNum = blinkNumInit;
 						int pval = attributes[sequence][stepIndexEdit].getGatePVal();
@@ -946,7 +1009,7 @@ struct GateSeq64 : Module {
 		
 		// Clock
 		if (running && clockIgnoreOnReset == 0l) {
-			if (clockTrigger.process(inputs[CLOCK_INPUT].getVoltage())) {
+			if (busClock ? clockBusReader.processClock(&clockTrigger) : clockTrigger.process(inputs[CLOCK_INPUT].getVoltage())) {
 				ppqnCount++;
 				if (ppqnCount >= pulsesPerStep)
 					ppqnCount = 0;
@@ -987,9 +1050,16 @@ struct GateSeq64 : Module {
 				}
 			}
 		}	
+		else if (busClock) {
+			clockBusReader.syncClock();
+		}
 		
 		// Reset
-		if (resetTrigger.process(inputs[RESET_INPUT].getVoltage() + params[RESET_PARAM].getValue())) {
+		bool resetTrigged = resetTrigger.process((busClock ? 0.0f : inputs[RESET_INPUT].getVoltage()) + params[RESET_PARAM].getValue());
+		if (busClock && clockBusReader.processReset()) {
+			resetTrigged = true;
+		}
+		if (resetTrigged) {
 			initRun();// must be before SEQCV_INPUT below
 			resetLight = 1.0f;
 			displayState = DISP_GATE;
@@ -1166,6 +1236,9 @@ struct GateSeq64 : Module {
 
 		if (clockIgnoreOnReset > 0l)
 			clockIgnoreOnReset--;
+		
+		// publish the edits of the song and sequences for dataToJson(), when there are any (see StateSnapshot)
+		processSnapshot();
 	}// process()
 	
 	inline void setGreenRed(int id, float green, float red) {
@@ -1258,6 +1331,7 @@ struct GateSeq64Widget : ModuleWidget {
 								module->phrase[module->phraseIndexEdit] = totalNum - 1;
 						}
 					}
+					module->snapshot.markDirtyFromUi();
 				}
 				
 				lastTime = currentTime;
@@ -1373,6 +1447,8 @@ struct GateSeq64Widget : ModuleWidget {
 		
 		menu->addChild(createBoolPtrMenuItem("Reset on run", "", &module->resetOnRun));
 
+		createClockBusMenu(menu, &module->clockBusReader);
+
 		menu->addChild(createSubmenuItem("Retrigger gates on reset", "", [=](Menu* menu) {
 			menu->addChild(createCheckMenuItem("No", "",
 				[=]() {return module->retrigGatesOnReset == RGOR_NONE;},
@@ -1462,6 +1538,7 @@ struct GateSeq64Widget : ModuleWidget {
 						}
 					}	
 				}			
+				module->snapshot.markDirtyFromUi();
 			}
 			ParamWidget::onDoubleClick(e);
 		}
@@ -1503,6 +1580,7 @@ struct GateSeq64Widget : ModuleWidget {
 						int step = paramQuantity->paramId - GateSeq64::STEP_PARAMS;
 						if ((step != *lastStep) && (step >= 0) && (step < 64)) {
 							module->attributes[module->sequence][step].setGate(*lastValue);
+							module->snapshot.markDirtyFromUi();
 						}
 					}
 				}
@@ -27,7 +27,7 @@ class StepAttributesGS {
 	inline bool getGateP() {return (attributes & ATT_MSK_GATEP) != 0;}
 	inline int getGatePVal() {return attributes & ATT_MSK_PROB;}
 	inline int getGateMode() {return (attributes & ATT_MSK_GATEMODE) >> gateModeShift;}
-	inline unsigned short getAttribute() {return attributes;}
+	inline unsigned short getAttribute() const {return attributes;}
 
 	inline void setGate(bool gateState) {attributes &= ~ATT_MSK_GATE; if (gateState) attributes |= ATT_MSK_GATE;}
 	inline void setGateP(bool gatePState) {attributes &= ~ATT_MSK_GATEP; if (gatePState) attributes |= ATT_MSK_GATEP;}
@@ -56,7 +56,7 @@ class SeqAttributesGS {
 	
 	inline int getLength() {return (int)(attributes & SEQ_MSK_LENGTH);}
 	inline int getRunMode() {return (int)((attributes & SEQ_MSK_RUNMODE) >> runModeShift);}
-	inline unsigned short getSeqAttrib() {return attributes;}
+	inline unsigned short getSeqAttrib() const {return attributes;}
 	
 	inline void setLength(int length) {attributes &= ~SEQ_MSK_LENGTH; attributes |= ((unsigned short)length);}
 	inline void setRunMode(int runMode) {attributes &= ~SEQ_MSK_RUNMODE; attributes |= (((unsigned short)runMode) << runModeShift);}
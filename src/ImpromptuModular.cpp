@@ -29,6 +29,7 @@ void init(Plugin *p) {
 	p->addModel(modelClkd);
 	p->addModel(modelCvPad);
 	p->addModel(modelFoundry);
+	p->addModel(modelFoundry16);
 	p->addModel(modelFoundryExpander);
 	p->addModel(modelFourView);
 	p->addModel(modelGateSeq64);
@@ -58,6 +59,7 @@ void init(Plugin *p) {
 // General objects
 
 ClockMaster clockMaster;  
+ClockBus clockBus;
 
 
 
@@ -177,6 +179,36 @@ void InstantiateExpanderItem::onAction(const event::Action &e) {
 }
 
 
+void createRandomSeedMenu(Menu* menu, uint32_t* seed, int* reseedOnReset) {
+	menu->addChild(createSubmenuItem("Random seed", string::f("%08X", *seed), [=](Menu* menu) {
+		menu->addChild(createMenuItem("New random seed", "", [=]() {*seed = random::u32();}));
+		if (reseedOnReset != nullptr) {
+			menu->addChild(createCheckMenuItem("Reseed on reset", "",
+				[=]() {return *reseedOnReset != 0;},
+				[=]() {*reseedOnReset ^= 0x1;}
+			));
+		}
+	}));	
+}
+
+
+void createClockBusMenu(Menu* menu, ClockBusReader* clockBusReader) {
+	static const char* sourceNames[ClockBus::NUM_CLOCKS + 1] = {"Off (use cables)", "Master clock", "Clock 1", "Clock 2", "Clock 3"};
+	menu->addChild(createSubmenuItem("Clock bus from clock master", sourceNames[clockBusReader->source + 1], [=](Menu* menu) {
+		for (int i = -1; i < ClockBus::NUM_CLOCKS; i++) {
+			menu->addChild(createCheckMenuItem(sourceNames[i + 1], "",
+				[=]() {return clockBusReader->source == i;},
+				[=]() {clockBusReader->source = i;
+					   clockBusReader->sync();}
+			));
+		}
+		if (!clockBus.isActive()) {
+			menu->addChild(createMenuLabel("(No clock master is publishing, cables are used)"));
+		}
+	}));	
+}
+
+
 void NormalizedFloat12Copy(float* float12) {
 	json_t* normFloats12J = json_object();
 	json_t *normFloats12ArrayJ = json_array();
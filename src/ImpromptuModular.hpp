@@ -14,6 +14,8 @@
 
 #include "rack.hpp"
 #include "comp/Components.hpp"
+#include <atomic>
+#include <thread>
 
 using namespace rack;
 
@@ -32,6 +34,7 @@ extern Model *modelClockedExpander;
 extern Model *modelClkd;
 extern Model *modelCvPad;
 extern Model *modelFoundry;
+extern Model *modelFoundry16;
 extern Model *modelFoundryExpander;
 extern Model *modelFourView;
 extern Model *modelGateSeq64;
@@ -109,6 +112,79 @@ struct ClockMaster {// should not need to have mutex since only menu driven
 extern ClockMaster clockMaster;
 
 
+struct ClockBus {
+	// In-process clock bus: the clock master (a Clocked) publishes its clocks, reset and run state here in each of its 
+	//   process() calls, and sequencers can subscribe to it instead of using their clock, reset and run cables (see ClockBusReader).
+	// Lock-free single writer: the tick counters only increase and everything is a relaxed atomic; readers detect edges by 
+	//   comparing counters with the ones they last saw, so an edge can never be missed whatever the module processing order.
+	static const int NUM_CLOCKS = 4;// master clock and clocks 1 to 3 of Clocked
+	
+	std::atomic<int64_t> writerId;// id of the publishing module, -1 when none
+	std::atomic<uint32_t> ticks[NUM_CLOCKS];// number of rising edges of each clock output
+	std::atomic<uint32_t> highs;// bit i is set when clock output i is high
+	std::atomic<uint32_t> resets;// number of reset pulses
+	std::atomic<bool> running;
+	std::atomic<float> phase;// position of the master clock in its double period, [0 : 1[
+	
+	// writer side, only for the publishing module
+	uint32_t lastHighs = 0;
+	bool lastReset = false;
+	
+	ClockBus() {
+		writerId = -1;
+		for (int i = 0; i < NUM_CLOCKS; i++) {
+			ticks[i] = 0;
+		}
+		highs = 0;
+		resets = 0;
+		running = false;
+		phase = 0.0f;
+	}
+	
+	bool isActive() {
+		return writerId.load(std::memory_order_relaxed) != -1;
+	}
+	void publish(int64_t id, const bool* clockHighs, bool resetHigh, bool _running, float _phase) {
+		uint32_t newHighs = 0;
+		for (int i = 0; i < NUM_CLOCKS; i++) {
+			if (clockHighs[i]) {
+				newHighs |= (0x1 << i);
+			}
+		}
+		if (writerId.load(std::memory_order_relaxed) != id) {
+			// new master: its edges are relative to what the readers last saw, and a reset that is already high is not a new pulse
+			writerId.store(id, std::memory_order_relaxed);
+			lastHighs = highs.load(std::memory_order_relaxed);
+			lastReset = resetHigh;
+		}
+		uint32_t rises = newHighs & ~lastHighs;
+		if (resetHigh && !lastReset) {
+			resets.fetch_add(1, std::memory_order_relaxed);
+		}
+		for (int i = 0; i < NUM_CLOCKS; i++) {
+			if ((rises & (0x1 << i)) != 0) {
+				ticks[i].fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		highs.store(newHighs, std::memory_order_relaxed);
+		running.store(_running, std::memory_order_relaxed);
+		phase.store(_phase, std::memory_order_relaxed);
+		lastHighs = newHighs;
+		lastReset = resetHigh;
+	}
+	void unpublish(int64_t id) {// called every sample by the clocks that are not the master, so only read unless needed
+		int64_t expected = id;
+		if (writerId.load(std::memory_order_relaxed) == id) {
+			if (writerId.compare_exchange_strong(expected, -1)) {
+				highs.store(0, std::memory_order_relaxed);
+			}
+		}
+	}
+};
+extern ClockBus clockBus;
+
+
+
 struct VecPx : Vec {
 	// temporary method to avoid having to convert all px coordinates to mm; no use when making a new module (since mm is the standard)
 	static constexpr float scl = 5.08f / 15.0f;
@@ -199,6 +275,56 @@ struct TriggerRiseFall {
 };	
 
 
+struct ClockBusReader {
+	// Subscription of a sequencer to the clock bus, replaces the Schmitt triggers on the clock, reset and run inputs
+	int source = -1;// clock of the bus that is followed (0 = master clock, 1 to 3 = clocks 1 to 3), -1 when not subscribed (must save)
+	uint32_t lastTicks = 0;
+	uint32_t lastResets = 0;
+	bool lastRunning = false;
+	bool wasSubscribed = false;
+	
+	bool isSubscribed() {// must be called in each process(), since it syncs to the bus when a master (re)appears or when subscribing
+		bool subscribed = source >= 0 && clockBus.isActive();
+		if (subscribed && !wasSubscribed) {
+			sync();// the counters moved on while not following the bus, these are not edges
+		}
+		wasSubscribed = subscribed;
+		return subscribed;
+	}
+	void sync() {// forget any edges that were published before now
+		syncClock();
+		lastResets = clockBus.resets.load(std::memory_order_relaxed);
+		lastRunning = clockBus.running.load(std::memory_order_relaxed);
+	}
+	void syncClock() {// call in each sample where the module ignores its clock, so that these edges are not seen later
+		if (source >= 0) {
+			lastTicks = clockBus.ticks[source].load(std::memory_order_relaxed);
+		}
+	}
+	bool processClock(Trigger* clockTrigger = nullptr) {// returns true on a rising edge of the followed clock, and updates the trigger's level when given
+		uint32_t newTicks = clockBus.ticks[source].load(std::memory_order_relaxed);
+		bool edge = (newTicks != lastTicks);
+		lastTicks = newTicks;
+		if (clockTrigger != nullptr) {
+			clockTrigger->state = edge || ((clockBus.highs.load(std::memory_order_relaxed) >> source) & 0x1) != 0;
+		}
+		return edge;
+	}
+	bool processReset() {// returns true on a reset pulse
+		uint32_t newResets = clockBus.resets.load(std::memory_order_relaxed);
+		bool edge = (newResets != lastResets);
+		lastResets = newResets;
+		return edge;
+	}
+	bool processRun() {// returns true when the master's run state changed (same as a pulse from its run output)
+		bool newRunning = clockBus.running.load(std::memory_order_relaxed);
+		bool changed = (newRunning != lastRunning);
+		lastRunning = newRunning;
+		return changed;
+	}
+};
+
+
 struct HoldDetect {
 	long modeHoldDetect;// 0 when not detecting, downward counter when detecting
 	
@@ -227,6 +353,254 @@ struct HoldDetect {
 };
 
 
+struct RandomStream {
+	// xoshiro128** generator, so that generative modules have their own seedable (reproducible) random streams
+	// instead of the global random::u32() and random::uniform()
+	uint32_t s[4] = {0x1u, 0x2u, 0x3u, 0x4u};
+	
+	void seed(uint32_t seedValue, uint32_t streamIndex) {
+		// splitmix64 to fill the state, each stream index of a given seed value gives an unrelated stream
+		uint64_t x = (((uint64_t)streamIndex) << 32) | seedValue;
+		for (int i = 0; i < 4; i += 2) {
+			uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			z ^= (z >> 31);
+			s[i] = (uint32_t)z;
+			s[i + 1] = (uint32_t)(z >> 32);
+		}
+	}
+	
+	uint32_t u32() {
+		uint32_t result = rotl(s[1] * 5, 7) * 9;
+		uint32_t t = s[1] << 9;
+		s[2] ^= s[0];
+		s[3] ^= s[1];
+		s[1] ^= s[2];
+		s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = rotl(s[3], 11);
+		return result;
+	}
+	
+	float uniform() {
+		// [0.0f : 1.0f[, same as random::uniform()
+		return (float)(u32() >> 8) * (1.0f / 16777216.0f);
+	}
+	
+	float normal() {
+		// mean 0 and std dev 1 (Box-Muller), same as random::normal()
+		float u1 = uniform();
+		float u2 = uniform();
+		return std::sqrt(-2.0f * std::log(1.0f - u1)) * std::cos(2.0f * float(M_PI) * u2);
+	}
+	
+	private:
+	
+	static uint32_t rotl(uint32_t x, int k) {
+		return (x << k) | (x >> (32 - k));
+	}
+};
+
+
+struct RandomStream4 {
+	// four xoshiro128** generators stepped together (one per lane, with the state laid out so that the steps vectorize), 
+	// for modules that draw random values for four poly channels at a time; lane l gives the same values as a RandomStream 
+	// seeded with stream index firstStreamIndex + l, and only the lanes set in laneMask are stepped, so that the stream 
+	// of a channel does not depend on the draws of the other channels
+	uint32_t s[4][4] = {};// s[i][lane]
+	
+	void seed(uint32_t seedValue, uint32_t firstStreamIndex) {
+		// lane l is seeded like RandomStream::seed(seedValue, firstStreamIndex + l)
+		for (int l = 0; l < 4; l++) {
+			RandomStream rs;
+			rs.seed(seedValue, firstStreamIndex + l);
+			for (int i = 0; i < 4; i++) {
+				s[i][l] = rs.s[i];
+			}
+		}
+	}
+	
+	simd::float_4 uniform(int laneMask = 0xF) {
+		// [0.0f : 1.0f[ in each stepped lane, 0.0f in the others
+		float f[4];
+		for (int l = 0; l < 4; l++) {
+			uint32_t keep = ((uint32_t)(laneMask >> l) & 0x1u) - 1u;// all ones when the lane is not stepped
+			uint32_t result = rotl(s[1][l] * 5, 7) * 9;
+			uint32_t t = s[1][l] << 9;
+			uint32_t s2 = s[2][l] ^ s[0][l];
+			uint32_t s3 = s[3][l] ^ s[1][l];
+			uint32_t s1 = s[1][l] ^ s2;
+			uint32_t s0 = s[0][l] ^ s3;
+			s2 ^= t;
+			s3 = rotl(s3, 11);
+			s[0][l] = (s[0][l] & keep) | (s0 & ~keep);
+			s[1][l] = (s[1][l] & keep) | (s1 & ~keep);
+			s[2][l] = (s[2][l] & keep) | (s2 & ~keep);
+			s[3][l] = (s[3][l] & keep) | (s3 & ~keep);
+			f[l] = (float)((result & ~keep) >> 8) * (1.0f / 16777216.0f);
+		}
+		return simd::float_4::load(f);
+	}
+	
+	simd::float_4 normal(int laneMask = 0xF) {
+		// mean 0 and std dev 1 (Box-Muller)
+		simd::float_4 u1 = uniform(laneMask);
+		simd::float_4 u2 = uniform(laneMask);
+		return simd::sqrt(-2.0f * simd::log(1.0f - u1)) * simd::cos(2.0f * float(M_PI) * u2);
+	}
+	
+	simd::float_4 triangular(int laneMask = 0xF) {
+		// ]-1.0f : 1.0f[, peak at 0
+		return uniform(laneMask) + uniform(laneMask) - 1.0f;
+	}
+	
+	private:
+	
+	static uint32_t rotl(uint32_t x, int k) {
+		return (x << k) | (x >> (32 - k));
+	}
+};
+
+
+
+
+template<typename T>
+struct StateSnapshot {
+	// Triple-buffered copy of the sequencer state of a module (T must be trivially copyable), so that dataToJson() can 
+	// serialize a consistent copy on the UI/autosave thread while the engine thread keeps editing the live state.
+	// The state is split in up to 32 chunks (the tracks of Foundry for example, a single chunk elsewhere), and a copy 
+	// is published only when something was edited, and then only the edited chunks are copied:
+	// - edits done by the engine thread (process()) must call markDirty() BEFORE changing the state, and are published 
+	//   at the end of that same process() call;
+	// - edits done on the UI thread (widgets and menus) must call markDirtyFromUi() AFTER changing the state, and are 
+	//   published by the engine on its next sample, or copied directly by dataToJson() if that comes first;
+	// - onReset(), onRandomize() and dataFromJson() must call publishNow(), since the engine is then not processing 
+	//   the module (and may be paused).
+	// process() must be called at the end of both process() and processBypass(), so that a bypassed module keeps 
+	// publishing. acquire() never returns a copy that misses an edit made before it was called, and never sleeps.
+	// Single writer (engine thread, or publishNow()) and single reader (UI/autosave thread, acquire() and release()).
+	static const uint32_t ALL_CHUNKS = 0xFFFFFFFF;
+	
+	T buffers[3] = {};
+	std::atomic<int> published{0};// index of the last published copy
+	std::atomic<int> reading{-1};// index of the copy being read by dataToJson(), -1 when none
+	std::atomic<uint32_t> engineSeq{0};// odd while the engine has edits that are not yet published
+	std::atomic<uint32_t> uiChunks{0};// chunks edited on the UI thread and not yet taken by the engine
+	std::atomic<uint32_t> uiEdits{0};// count of UI thread edits
+	std::atomic<uint32_t> uiEditsPublished{0};// count of UI thread edits contained in the published copy
+	uint32_t staleChunks[3] = {ALL_CHUNKS, ALL_CHUNKS, ALL_CHUNKS};// engine thread only, chunks a buffer lacks
+	uint32_t uiEditsTaken = 0;// engine thread only
+	std::unique_ptr<T> liveCopy;// reader only, used when UI edits are not yet published
+	
+	
+	// engine thread, in process() before editing the given chunks of the state
+	void markDirty(uint32_t chunks = 0x1) {
+		for (int b = 0; b < 3; b++) {
+			staleChunks[b] |= chunks;
+		}
+		uint32_t seq = engineSeq.load();
+		if ((seq & 0x1) == 0) {
+			engineSeq.store(seq + 1);
+		}
+	}
+	
+	// UI thread, after editing the given chunks of the state
+	void markDirtyFromUi(uint32_t chunks = 0x1) {
+		uiChunks.fetch_or(chunks);
+		uiEdits.fetch_add(1);
+	}
+	
+	
+	// engine thread, to be called at the end of process() and processBypass(); only copies when something was edited
+	template<typename FillFunc>
+	void process(FillFunc fillCopy) {
+		uint32_t edits = uiEdits.load();
+		if (edits != uiEditsTaken) {
+			uint32_t chunks = uiChunks.exchange(0);
+			for (int b = 0; b < 3; b++) {
+				staleChunks[b] |= chunks;
+			}
+			uiEditsTaken = edits;
+		}
+		uint32_t seq = engineSeq.load();
+		if ((seq & 0x1) == 0 && uiEditsTaken == uiEditsPublished.load()) {
+			return;
+		}
+		// the third buffer is always free: neither the published one nor the one being read
+		int p = published.load();
+		int r = reading.load();
+		int w = 0;
+		while (w == p || w == r) {
+			w++;
+		}
+		fillCopy(&buffers[w], staleChunks[w]);
+		staleChunks[w] = 0;
+		published.store(w);
+		uiEditsPublished.store(uiEditsTaken);
+		if ((seq & 0x1) != 0) {
+			engineSeq.store(seq + 1);
+		}
+	}
+	
+	
+	// onReset(), onRandomize() and dataFromJson() only, since the engine thread is then not processing the module
+	template<typename FillFunc>
+	void publishNow(FillFunc fillCopy) {
+		int p = published.load();
+		int w = (p + 1) % 3;
+		fillCopy(&buffers[w], ALL_CHUNKS);
+		for (int b = 0; b < 3; b++) {
+			staleChunks[b] = ALL_CHUNKS;
+		}
+		staleChunks[w] = 0;
+		uiChunks.store(0);
+		uiEditsTaken = uiEdits.load();
+		published.store(w);
+		uiEditsPublished.store(uiEditsTaken);
+		uint32_t seq = engineSeq.load();
+		if ((seq & 0x1) != 0) {
+			engineSeq.store(seq + 1);
+		}
+	}
+	
+	
+	// UI/autosave thread: returns an up-to-date copy, release() must be called when done with it
+	template<typename FillFunc>
+	const T* acquire(FillFunc fillCopy) {
+		while (true) {
+			uint32_t seq = engineSeq.load();
+			if ((seq & 0x1) != 0) {
+				// engine edits are published at the end of the current process() call, so this is short
+				std::this_thread::yield();
+				continue;
+			}
+			if (uiEdits.load() != uiEditsPublished.load()) {
+				// UI edits not yet published by the engine: copy the live state, valid if the engine did not edit meanwhile
+				if (!liveCopy) {
+					liveCopy.reset(new T);
+				}
+				fillCopy(liveCopy.get(), ALL_CHUNKS);
+				if (engineSeq.load() == seq) {
+					return liveCopy.get();
+				}
+				continue;
+			}
+			int p = published.load();
+			reading.store(p);
+			if (published.load() == p) {
+				// the engine never writes to the buffer being read
+				return &buffers[p];
+			}
+			reading.store(-1);
+		}
+	}
+	
+	void release() {
+		reading.store(-1);
+	}
+};
+
 
 
 // General functions
@@ -259,3 +633,6 @@ struct InstantiateExpanderItem : MenuItem {
 
 void NormalizedFloat12Copy(float* float12);
 void NormalizedFloat12Paste(float* float12);
+
+void createRandomSeedMenu(Menu* menu, uint32_t* seed, int* reseedOnReset);// reseedOnReset is nullptr when the module has no reset input
+void createClockBusMenu(Menu* menu, ClockBusReader* clockBusReader);
@@ -13,9 +13,11 @@
 struct NoteEcho : Module {	
 
 	static const int NUM_TAPS = 4;
-	static const int MAX_POLY = 4;
-	static const int MAX_DEL = 32;
-	static const int BUF_SIZE = MAX_DEL * 2;  
+	static const int MAX_POLY = 16;
+	static const int POLY_KNOB_MAX = 4;// the poly knob is multiplied by polyStep
+	static const int MAX_DEL = 32;// on the tap knobs
+	static const int MAX_DEL_CLOCKS = MAX_DEL * 8;// with the slowest tempo multiplier
+	static const int BUF_SIZE = MAX_DEL_CLOCKS * 2;  
 
 	enum ParamIds {
 		ENUMS(TAP_PARAMS, NUM_TAPS),
@@ -51,32 +53,63 @@ struct NoteEcho : Module {
 	};
 	enum LightIds {
 		WET_LIGHT,
-		ENUMS(GATE_LIGHTS, (NUM_TAPS + 1) * MAX_POLY),
+		ENUMS(GATE_LIGHTS, (NUM_TAPS + 1) * POLY_KNOB_MAX),
 		NUM_LIGHTS
 	};
 	
 	
 	struct NoteEvent {
-		// DEL Mode: an event is considered pending when gateOffFrame==0 (waiting for falling edge of the clk or a gate  input), and ready when >0; when pending, rest of struct is populated
-		int64_t gateOnFrame = 0;
-		int64_t gateOffFrame = 0;// 0 when pending (DEL Mode only), is set on rising clk when SR Mode
+		// compact record, the gate times are relative to the baseFrame of the EventBuffer that holds the event
+		// DEL Mode: an event is considered pending when gateLength==0 (waiting for falling edge of the clk or a gate  input), and ready when >0; when pending, rest of struct is populated
+		int32_t gateOn = 0;
+		uint32_t gateLength = 0;
 		float cv = 0.0f;
 		float cv2 = 0.0f;
-		int8_t muted[NUM_TAPS] = {};// gate prob result for each proper tap (freeze and dry excluded), -1=unseen, 0=pass-prob (not muted), 1=fail-prob (muted); processed by taps during output read, will only be set to non -1 value for a given tap when that tap first encounters the event (must check other taps for closeness also)
 		int8_t semip[NUM_TAPS] = {};// random semitone offset, 127=unseen
+		uint8_t probBits = 0;// bit t is set when tap t has seen the event, bit t + NUM_TAPS is set when the event is muted in tap t
+		
+		int8_t getMuted(int t) {
+			// gate prob result for each proper tap (freeze and dry excluded), -1=unseen, 0=pass-prob (not muted), 1=fail-prob (muted); processed by taps during output read, will only be set to non -1 value for a given tap when that tap first encounters the event (must check other taps for closeness also)
+			if ((probBits & (1 << t)) == 0) {
+				return -1;
+			}
+			return (probBits >> (t + NUM_TAPS)) & 0x1;
+		}
+		void setMuted(int t, int8_t muted) {// muted is 0 or 1
+			probBits |= (1 << t);
+			if (muted != 0) {
+				probBits |= (1 << (t + NUM_TAPS));
+			}
+			else {
+				probBits &= ~(1 << (t + NUM_TAPS));
+			}
+		}
 	};
 
 
 	class EventBuffer {
+		static const int64_t REBASE_FRAMES = ((int64_t)1) << 30;
+		
 		NoteEvent events[BUF_SIZE];
 		uint16_t head = 0;// points to next empty entry that can be written to
 		uint16_t size = 0;
+		int64_t numEntered = 0;// events entered since clear, event number n is at index n % BUF_SIZE while it is in the buffer
+		int64_t cursors[NUM_TAPS + 1];// event number last found by each reader (0 is dry, 1 to NUM_TAPS are the taps), less than the oldest event when none
+		int64_t baseFrame = 0;// frame of the events' relative gate times
 		
 		public:
 		
+		EventBuffer() {
+			clear();
+		}
+		
 		void clear() {
 			head = 0;
 			size = 0;
+			numEntered = 0;
+			for (int r = 0; r < NUM_TAPS + 1; r++) {
+				cursors[r] = -1;
+			}
 		}
 		void step() {
 			if (size < BUF_SIZE) {
@@ -92,31 +125,83 @@ struct NoteEcho : Module {
 			}
 			return (BUF_SIZE + head - 1 - num) % BUF_SIZE;
 		}
-		void enterEvent(const NoteEvent& e) {
-			events[head] = e;
+		int64_t getGateOnFrame(const NoteEvent* event) {
+			return baseFrame + event->gateOn;
+		}
+		void rebase(int64_t newBaseFrame) {
+			// move the relative gate times to a new base frame, dropping the oldest events when they are too old to be 
+			//   represented (more than 2^31 frames, which no tap can reach)
+			int64_t oldest = numEntered - size;
+			for (int64_t n = oldest; n < numEntered; n++) {
+				int64_t gateOn = events[n % BUF_SIZE].gateOn + baseFrame - newBaseFrame;
+				if (gateOn < (int64_t)INT32_MIN) {
+					size--;
+				}
+				else {
+					events[n % BUF_SIZE].gateOn = (int32_t)gateOn;
+				}
+			}
+			baseFrame = newBaseFrame;
+		}
+		void enterEvent(int64_t gateOnFrame, float cv, float cv2) {
+			if (size == 0) {
+				baseFrame = gateOnFrame;
+			}
+			else if (gateOnFrame - baseFrame >= REBASE_FRAMES) {
+				rebase(gateOnFrame);
+			}
+			NoteEvent& e = events[head];
+			e.gateOn = (int32_t)(gateOnFrame - baseFrame);
+			e.gateLength = 0;// will be completed when gate falls
+			e.cv = cv;
+			e.cv2 = cv2;
+			for (int i = 0; i < NUM_TAPS; i++) {
+				e.semip[i] = 127;
+			}
+			e.probBits = 0;
 			step();
+			numEntered++;
 		}
 		void finishDelEvent(int64_t gateOffFrame) {
 			uint16_t index = prev(0);
-			if (index < BUF_SIZE && events[index].gateOffFrame == 0) {
-				events[index].gateOffFrame = gateOffFrame;
+			if (index < BUF_SIZE && events[index].gateLength == 0) {
+				int64_t gateLength = gateOffFrame - getGateOnFrame(&events[index]);
+				events[index].gateLength = (uint32_t)std::min(std::max(gateLength, (int64_t)1), (int64_t)UINT32_MAX);
 			}
 		}
-		NoteEvent* findEvent(int64_t frameOrClk) {
-			for (uint16_t cnt = 0; ; cnt++) {
-				uint16_t test = prev(cnt);
-				if (test >= BUF_SIZE) {
-					return nullptr;
+		NoteEvent* findEvent(int64_t frameOrClk, int reader) {
+			// returns the last event with gate on at or before frameOrClk (events are entered in time order)
+			// each reader keeps a cursor on the event it last found, which normally only moves forward since time does, so that
+			//   a lookup is amortized O(1); when the cursor is no longer in the buffer, or when the reader moved back in time
+			//   (tap, tempo or clear), the cursor is found again with a binary search
+			int64_t relFrame = frameOrClk - baseFrame;
+			int64_t oldest = numEntered - size;
+			int64_t cursor = cursors[reader];
+			if (cursor < oldest - 1 || cursor >= numEntered || (cursor >= oldest && events[cursor % BUF_SIZE].gateOn > relFrame)) {
+				int64_t lo = oldest - 1;// oldest - 1 means no event
+				int64_t hi = numEntered - 1;
+				while (lo < hi) {
+					int64_t mid = (lo + hi + 1) / 2;
+					if (events[mid % BUF_SIZE].gateOn <= relFrame) {
+						lo = mid;
+					}
+					else {
+						hi = mid - 1;
+					}
 				}
-				if (frameOrClk >= events[test].gateOnFrame) {
-					return &events[test];
+				cursor = lo;
+			}
+			else {
+				while (cursor + 1 < numEntered && events[(cursor + 1) % BUF_SIZE].gateOn <= relFrame) {
+					cursor++;
 				}
 			}
-			return nullptr;
+			cursors[reader] = cursor;
+			return cursor >= oldest ? &events[cursor % BUF_SIZE] : nullptr;
 		}
-		NoteEvent* findEventGateOn(int64_t frameOrClk) {
-			NoteEvent* event = findEvent(frameOrClk);
-			if (event != nullptr && event->gateOffFrame != 0 && frameOrClk >= event->gateOffFrame) {
+		NoteEvent* findEventGateOn(int64_t frameOrClk, int reader) {
+			NoteEvent* event = findEvent(frameOrClk, reader);
+			if (event != nullptr && event->gateLength != 0 && frameOrClk - getGateOnFrame(event) >= (int64_t)event->gateLength) {
 				return nullptr;
 			}
 			return event;
@@ -130,7 +215,8 @@ struct NoteEcho : Module {
 	// Constants
 	static constexpr float delayInfoTime = 3.0f;// seconds
 	static constexpr float groupedProbsEpsilon = 0.02f;// time in seconds within which gates are considered grouped across polys, for when random mode is set to chord, for DEL Mode
-	static const int numMults = 7;    // 1/2  2/3 3/4  1   4/3  3/2  2
+	static const int numMults = 9;    // 1/2  2/3 3/4  1   4/3  3/2  2   1/4  1/8 (the last two were added later, for long delays)
+	static const int numMultsLong = 7;// index of the first long delay multiplier
 	static const int numMultsUnityIndex = 3;    
 	static const int64_t multNum[numMults];
 	static const int64_t multDen[numMults];
@@ -142,14 +228,18 @@ struct NoteEcho : Module {
 	// Need to save, no reset
 	int panelTheme;
 	float panelContrast;
+	uint32_t seed;// of the random streams in rngs[]
 	
 	// Need to save, with reset
+	int reseedOnReset;
 	// bool noteFilter;
 	bool wetOnly;// excludes tap0 from outputs
 	// float cv2NormalledVoltage;
 	int64_t clockPeriod;
 	int ecoMode;
 	int delMult;
+	int polyStep;// 1 or 4, the poly knob is multiplied by this
+	ClockBusReader clockBusReader;// clock from the clock bus instead of the clock cable when subscribed (not in tempo CV mode)
 
 	// No need to save, with reset
 	EventBuffer channel[MAX_POLY];
@@ -157,6 +247,8 @@ struct NoteEcho : Module {
 	int lastPoly;
 	
 	// No need to save, no reset
+	RandomStream rngs[MAX_POLY];// one per poly chan
+	uint32_t rngsSeed;// seed currently used by rngs[], to detect a new seed from the menu
 	int notifySource[NUM_TAPS] = {};// 0 (normal), 1 (semi) 2 (CV2), 3 (prob), 4 (freeze length)
 	long notifyInfo[NUM_TAPS] = {};// downward step counter when semi, cv2, prob to be displayed, 0 when normal tap display
 	long notifyPoly = 0l;// downward step counter when notify poly size in leds, 0 when normal leds
@@ -168,7 +260,7 @@ struct NoteEcho : Module {
 
 
 	int getPolyKnob() {
-		return (int)(params[POLY_PARAM].getValue() + 0.5f);
+		return (int)(params[POLY_PARAM].getValue() + 0.5f) * polyStep;
 	}
 	int getTapValue(int tapNum) {
 		return (int)(params[TAP_PARAMS + tapNum].getValue() + 0.5f);
@@ -185,8 +277,15 @@ struct NoteEcho : Module {
 		}
 		return count;
 	}
-	bool isLastTapAllowed() {
-		return getPolyKnob() < MAX_POLY || countActiveTaps() < NUM_TAPS || wetOnly;
+	bool isTapAllowed(int tapNum) {
+		// a tap is allowed when its channels fit in the 16 channels of the outputs, after those of tap0 and of the active taps before it
+		int group = (wetOnly ? 0 : 1);
+		for (int i = 0; i < tapNum; i++) {
+			if (isTapActive(i)) {
+				group++;
+			}
+		}
+		return (group + 1) * getPolyKnob() <= 16;
 	}
 	int getSemiValue(int tapNum) {
 		return (int)(std::round(params[ST_PARAMS + tapNum].getValue()));
@@ -194,7 +293,7 @@ struct NoteEcho : Module {
 	int getRndSemiValue(int tapNum) {
 		return (int)(std::round(params[RNDSEMI_PARAMS + tapNum].getValue()));
 	}
-	int8_t getSemiProbedOffset(int tapNum) {
+	int8_t getSemiProbedOffset(int tapNum, int p) {
 		int rndSemiKnob = getRndSemiValue(tapNum);
 		int semiKnob = getSemiValue(tapNum);
 		if (rndSemiKnob == 0) {
@@ -202,11 +301,11 @@ struct NoteEcho : Module {
 		}
 		if (rndSemiKnob > 0) {
 			// bipol
-			return semiKnob + random::u32() % (rndSemiKnob * 2 + 1) - rndSemiKnob;
+			return semiKnob + rngs[p].u32() % (rndSemiKnob * 2 + 1) - rndSemiKnob;
 		}
 		// unipolar (up only)
 		rndSemiKnob = std::abs(rndSemiKnob);
-		return semiKnob + random::u32() % (rndSemiKnob + 1);
+		return semiKnob + rngs[p].u32() % (rndSemiKnob + 1);
 	}
 	float getSemiVolts(int tapNum) {
 		return params[ST_PARAMS + tapNum].getValue() / 12.0f;
@@ -220,8 +319,8 @@ struct NoteEcho : Module {
 	bool isSingleProbs() {
 		return params[PMODE_PARAM].getValue() > 0.5f;
 	}
-	bool getGateProbEnableForTap(int tapNum) {
-		return (random::uniform() < params[GATEP_PARAMS + tapNum].getValue()); // random::uniform is [0.0, 1.0), see include/util/common.hpp
+	bool getGateProbEnableForTap(int tapNum, int p) {
+		return (rngs[p].uniform() < params[GATEP_PARAMS + tapNum].getValue()); // uniform() is [0.0, 1.0)
 	}
 	
 	
@@ -249,7 +348,7 @@ struct NoteEcho : Module {
 	NoteEcho() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
 
-		configParam(POLY_PARAM, 1, MAX_POLY, 1, "Input polyphony");
+		configParam(POLY_PARAM, 1, POLY_KNOB_MAX, 1, "Input polyphony");
 		paramQuantities[POLY_PARAM]->snapEnabled = true;
 		configSwitch(CV2MODE_PARAM, 0.0f, 1.0f, 1.0f, "CV2 mode", {"Scale", "Offset"});
 		configSwitch(PMODE_PARAM, 0.0f, 1.0f, 1.0f, "Random mode", {"Separate", "Chord"});
@@ -288,6 +387,7 @@ struct NoteEcho : Module {
 		configBypass(GATE_INPUT, GATE_OUTPUT);
 		configBypass(CV2_INPUT, CV2_OUTPUT);
 
+		seed = random::u32();
 		onReset();
 		
 		loadThemeAndContrastFromDefault(&panelTheme, &panelContrast);
@@ -302,16 +402,28 @@ struct NoteEcho : Module {
 		}
 	}
 
+	void seedRandomStreams() {
+		for (int c = 0; c < MAX_POLY; c++) {
+			rngs[c].seed(seed, c);
+		}
+		rngsSeed = seed;
+	}
+	
+	
 	void onReset() override final {
+		reseedOnReset = 0;
+		clockBusReader.source = -1;
 		// noteFilter = false;
 		wetOnly = false;
 		// cv2NormalledVoltage = 0.0f;
 		clockPeriod = (int64_t)(APP->engine->getSampleRate());// 60 BPM until detected
 		ecoMode = 1;
 		delMult = numMultsUnityIndex;
+		polyStep = 1;
 		resetNonJson();
 	}
 	void resetNonJson() {
+		seedRandomStreams();
 		clear();
 		lastRisingClkFrame = -1;// none
 		lastPoly = getPolyKnob();
@@ -326,6 +438,15 @@ struct NoteEcho : Module {
 
 		// panelContrast
 		json_object_set_new(rootJ, "panelContrast", json_real(panelContrast));
+
+		// seed
+		json_object_set_new(rootJ, "seed", json_integer(seed));
+
+		// reseedOnReset
+		json_object_set_new(rootJ, "reseedOnReset", json_integer(reseedOnReset));
+
+		// clockBusSource
+		json_object_set_new(rootJ, "clockBusSource", json_integer(clockBusReader.source));
 		
 		// noteFilter
 		// json_object_set_new(rootJ, "noteFilter", json_boolean(noteFilter));
@@ -344,6 +465,9 @@ struct NoteEcho : Module {
 		
 		// delMult
 		json_object_set_new(rootJ, "delMult", json_integer(delMult));
+
+		// polyStep
+		json_object_set_new(rootJ, "polyStep", json_integer(polyStep));
 		
 		return rootJ;
 	}
@@ -360,6 +484,23 @@ struct NoteEcho : Module {
 		if (panelContrastJ)
 			panelContrast = json_number_value(panelContrastJ);
 
+		// seed
+		json_t *seedJ = json_object_get(rootJ, "seed");
+		if (seedJ)
+			seed = (uint32_t)json_integer_value(seedJ);
+
+		// reseedOnReset
+		json_t *reseedOnResetJ = json_object_get(rootJ, "reseedOnReset");
+		if (reseedOnResetJ)
+			reseedOnReset = json_integer_value(reseedOnResetJ);
+
+		// clockBusSource
+		json_t *clockBusSourceJ = json_object_get(rootJ, "clockBusSource");
+		if (clockBusSourceJ) {
+			clockBusReader.source = clamp((int)json_integer_value(clockBusSourceJ), -1, ClockBus::NUM_CLOCKS - 1);
+			clockBusReader.sync();
+		}
+
 		// noteFilter
 		// json_t *noteFilterJ = json_object_get(rootJ, "noteFilter");
 		// if (noteFilterJ)
@@ -397,6 +538,11 @@ struct NoteEcho : Module {
 		if (delMultJ)
 			delMult = json_integer_value(delMultJ);
 
+		// polyStep
+		json_t *polyStepJ = json_object_get(rootJ, "polyStep");
+		if (polyStepJ)
+			polyStep = (json_integer_value(polyStepJ) == 4 ? 4 : 1);
+
 		resetNonJson();
 	}
 
@@ -409,6 +555,11 @@ struct NoteEcho : Module {
 	void process(const ProcessArgs &args) override {
 		// user inputs
 		if (refresh.processInputs()) {
+			// new random seed from menu
+			if (seed != rngsSeed) {
+				seedRandomStreams();
+			}
+			
 			if (wetTrigger.process(params[WET_PARAM].getValue())) {
 				wetOnly = !wetOnly;
 			}
@@ -419,9 +570,15 @@ struct NoteEcho : Module {
 			clear();
 			lastPoly = poly;
 		}
-		int numActiveTaps = countActiveTaps();
-		bool lastTapAllowed = isLastTapAllowed();
-		int chans = std::min( poly * ( (wetOnly ? 0 : 1) + numActiveTaps ) , 16 );
+		bool tapOn[NUM_TAPS];// active and allowed
+		int numTapsOn = 0;
+		for (int t = 0; t < NUM_TAPS; t++) {
+			tapOn[t] = isTapActive(t) && isTapAllowed(t);
+			if (tapOn[t]) {
+				numTapsOn++;
+			}
+		}
+		int chans = std::min( poly * ( (wetOnly ? 0 : 1) + numTapsOn ) , 16 );
 		if (outputs[CV_OUTPUT].getChannels() != chans) {
 			outputs[CV_OUTPUT].setChannels(chans);
 		}
@@ -436,8 +593,17 @@ struct NoteEcho : Module {
 		// clear and clock
 		if (clearTrigger.process(inputs[CLEAR_INPUT].getVoltage())) {
 			clear();
+			if (reseedOnReset != 0) {
+				seedRandomStreams();
+			}
+		}
+		int clkEdge;
+		if (clockBusReader.isSubscribed() && !isTempoCV()) {
+			clkEdge = clockBusReader.processClock() ? 1 : 0;
+		}
+		else {
+			clkEdge = clkTrigger.process(inputs[CLK_INPUT].getVoltage());
 		}
-		int clkEdge = clkTrigger.process(inputs[CLK_INPUT].getVoltage());
 		if (isTempoCV()) {
 			if ((args.frame & 0x3F) == 0) {// fs/64
 				clockPeriod = (int64_t)(args.sampleRate * 0.5f / std::pow(2.0f, inputs[CLK_INPUT].getVoltage()));
@@ -470,16 +636,9 @@ struct NoteEcho : Module {
 			// Sample the inputs on rising poly gate edges (finish job on falling)
 			if (eventEdge == 1) {
 				// here we have a rising gate on poly p, or a rising clk with a gate active on poly p
-				NoteEvent e;
-				e.gateOnFrame = currFrameOrClk;
-				e.gateOffFrame = 0;// will be completed when gate falls
-				e.cv  = inputs[CV_INPUT ].getChannels() > p ? inputs[CV_INPUT ].getVoltage(p) : 0.0f;
-				e.cv2 = inputs[CV2_INPUT].getChannels() > p ? inputs[CV2_INPUT].getVoltage(p) : params[CV2NORM_PARAM].getValue();
-				for (int i = 0; i < NUM_TAPS; i++) {
-					e.muted[i] = -1;
-					e.semip[i] = 127;
-				}
-				channel[p].enterEvent(e);
+				float cv  = inputs[CV_INPUT ].getChannels() > p ? inputs[CV_INPUT ].getVoltage(p) : 0.0f;
+				float cv2 = inputs[CV2_INPUT].getChannels() > p ? inputs[CV2_INPUT].getVoltage(p) : params[CV2NORM_PARAM].getValue();
+				channel[p].enterEvent(currFrameOrClk, cv, cv2);
 			}
 			else if (eventEdge == -1) {
 				// here we have a falling gate on poly p, no falling clk though
@@ -496,7 +655,7 @@ struct NoteEcho : Module {
 			if (!wetOnly) {
 				for (; c < poly; c++) {
 					float gate = 0.0f;
-					NoteEvent* event = channel[c].findEventGateOn(currFrameOrClk);
+					NoteEvent* event = channel[c].findEventGateOn(currFrameOrClk, 0);
 					if (event != nullptr) {
 						gate = 10.0f;
 						outputs[CV_OUTPUT].setVoltage(event->cv, c);
@@ -508,7 +667,7 @@ struct NoteEcho : Module {
 			// now do main tap outputs
 			bool cv2IsOffset = isCv2Offset();
 			for (int t = 0; t < NUM_TAPS; t++) {
-				if ( !isTapActive(t) || (t == (NUM_TAPS - 1) && !lastTapAllowed) ) {
+				if (!tapOn[t]) {
 					continue;
 				}
 				int64_t tapFrameOrClk = currFrameOrClk - clockPeriod * (int64_t)getTapValue(t);
@@ -517,10 +676,10 @@ struct NoteEcho : Module {
 
 				for (int p = 0; p < poly; p++, c++) {
 					bool gate = false;
-					NoteEvent* event = channel[p].findEventGateOn(tapFrameOrClk);
+					NoteEvent* event = channel[p].findEventGateOn(tapFrameOrClk, t + 1);
 					if (event != nullptr) {
 						// check for probs here before giving high gate
-						if (event->muted[t] == -1) {
+						if (event->getMuted(t) == -1) {
 							// event never seen by this tap
 							if (isSingleProbs()) {
 								// test for closeness in other polys, to steal that muted[]
@@ -528,18 +687,18 @@ struct NoteEcho : Module {
 								int64_t closenessFrames = (int64_t)(groupedProbsEpsilon * args.sampleRate);
 								for (int p2 = 0; p2 < poly; p2++) {
 									if (p2 == p) continue;
-									NoteEvent* event2 = channel[p2].findEventGateOn(tapFrameOrClk);
+									NoteEvent* event2 = channel[p2].findEventGateOn(tapFrameOrClk, t + 1);
 									if (event2 == nullptr) continue;
-									int64_t delta = event->gateOnFrame - event2->gateOnFrame;
-									if (llabs(delta) < closenessFrames) {
-										event->muted[t] = event2->muted[t];
+									int64_t delta = channel[p].getGateOnFrame(event) - channel[p2].getGateOnFrame(event2);
+									if (llabs(delta) < closenessFrames && event2->getMuted(t) != -1) {
+										event->setMuted(t, event2->getMuted(t));
 										break;
 									}
 								}
 							}
 							// here either "!singleProbs" or "singleProbs but no closeness", so generate a prob
-							if (event->muted[t] == -1) {
-								event->muted[t] = getGateProbEnableForTap(t) ? 0 : 1;
+							if (event->getMuted(t) == -1) {
+								event->setMuted(t, getGateProbEnableForTap(t, p) ? 0 : 1);
 							}
 						}
 						// here event->muted[t] is not -1 
@@ -555,9 +714,9 @@ struct NoteEcho : Module {
 								// }
 							// }
 						// }
-						gate = event->muted[t] == 0;
+						gate = event->getMuted(t) == 0;
 						if (event->semip[t] == 127) {
-							event->semip[t] = getSemiProbedOffset(t);
+							event->semip[t] = getSemiProbedOffset(t, p);
 						}
 						if (gate) {
 							float cv = event->cv + ((float)event->semip[t]) / 12.0f;
@@ -577,41 +736,37 @@ struct NoteEcho : Module {
 			// lights
 			// simple ones done in NoteEchoWidget::step(), gate lights must be here (see detailed comment in step():
 			
-			// gate lights
+			// gate lights, one light per poly knob step (a light shows polyStep channels)
 			if (notifyPoly > 0) {
 				// notify poly in gate lights
+				int polyKnob = poly / polyStep;
 				// do tap0 outputs first
-				for (int p = 0; p < MAX_POLY; p++) {
-					lights[GATE_LIGHTS + p].setBrightness(p < poly && !wetOnly ? 1.0f : 0.0f);
+				for (int p = 0; p < POLY_KNOB_MAX; p++) {
+					lights[GATE_LIGHTS + p].setBrightness(p < polyKnob && !wetOnly ? 1.0f : 0.0f);
 				}
 				// now do main tap outputs
 				for (int t = 0; t < NUM_TAPS; t++) {
-					for (int p = 0; p < MAX_POLY; p++) {
-						bool lstate = p < poly && isTapActive(t);
-						if (t == (NUM_TAPS - 1) && !isLastTapAllowed()) {
-							lstate = false;
-						}
-						lights[GATE_LIGHTS + 4 + t * MAX_POLY + p].setBrightness(lstate ? 1.0f : 0.0f);
+					for (int p = 0; p < POLY_KNOB_MAX; p++) {
+						bool lstate = p < polyKnob && tapOn[t];
+						lights[GATE_LIGHTS + POLY_KNOB_MAX + t * POLY_KNOB_MAX + p].setBrightness(lstate ? 1.0f : 0.0f);
 					}
 				}
 			}
 			else {// normal gate lights
 				c = 0;
-				// do tap0 outputs first
-				for (int p = 0; p < MAX_POLY; p++) {
-					bool lstate = p < poly && !wetOnly;
-					lights[GATE_LIGHTS + p].setBrightness(lstate && outputs[GATE_OUTPUT].getVoltage(c) ? 1.0f : 0.0f);
-					if (lstate) c++;
-				}
-				// now do main tap outputs
-				for (int t = 0; t < NUM_TAPS; t++) {
-					for (int p = 0; p < MAX_POLY; p++) {
-						bool lstate = p < poly && isTapActive(t);
-						if (t == (NUM_TAPS - 1) && !isLastTapAllowed()) {
-							lstate = false;
+				for (int t = -1; t < NUM_TAPS; t++) {// -1 is tap0
+					bool rowOn = (t == -1 ? !wetOnly : tapOn[t]);
+					for (int p = 0; p < POLY_KNOB_MAX; p++) {
+						bool lstate = false;
+						if (rowOn) {
+							for (int i = p * polyStep; i < std::min((p + 1) * polyStep, poly); i++) {
+								lstate |= outputs[GATE_OUTPUT].getVoltage(c + i) >= 1.0f;
+							}
 						}
-						lights[GATE_LIGHTS + 4 + t * MAX_POLY + p].setBrightness(lstate && outputs[GATE_OUTPUT].getVoltage(c) ? 1.0f : 0.0f);
-						if (lstate) c++;
+						lights[GATE_LIGHTS + POLY_KNOB_MAX + t * POLY_KNOB_MAX + p].setBrightness(lstate ? 1.0f : 0.0f);
+					}
+					if (rowOn) {
+						c += poly;
 					}
 				}
 			}
@@ -633,8 +788,8 @@ struct NoteEcho : Module {
 };
 
 
-const int64_t NoteEcho::multNum[numMults] = {1, 2, 3, 1, 4, 3, 2};
-const int64_t NoteEcho::multDen[numMults] = {2, 3, 4, 1, 3, 2, 1};
+const int64_t NoteEcho::multNum[numMults] = {1, 2, 3, 1, 4, 3, 2, 1, 1};
+const int64_t NoteEcho::multDen[numMults] = {2, 3, 4, 1, 3, 2, 1, 4, 8};
 
 
 
@@ -801,11 +956,17 @@ struct NoteEchoWidget : ModuleWidget {
 					else if (module->getTapValue(tapNum) < 1) {
 						dispStr = "  - ";
 					}
-					else if (tapNum == 3 && !module->isLastTapAllowed()) {
+					else if (!module->isTapAllowed(tapNum)) {
 						dispStr = "O VF";
 					}
 					else {
-						dispStr = string::f("D %2u", (unsigned)(module->getTapValue(tapNum)));	
+						int64_t tapValue = module->getTapValue(tapNum) * NoteEcho::multDen[module->delMult] / NoteEcho::multNum[module->delMult];
+						if (module->delMult >= NoteEcho::numMultsLong) {// long delays, shown in clocks
+							dispStr = string::f("D%3u", (unsigned)tapValue);
+						}
+						else {
+							dispStr = string::f("D %2u", (unsigned)(module->getTapValue(tapNum)));	
+						}
 					}
 				}// if (module)
 				else {
@@ -887,10 +1048,17 @@ struct NoteEchoWidget : ModuleWidget {
 		menu->addChild(new MenuSeparator());
 		menu->addChild(createMenuLabel("Settings"));
 		
+		createRandomSeedMenu(menu, &(module->seed), &(module->reseedOnReset));
+		
+		createClockBusMenu(menu, &module->clockBusReader);
+		
 		// menu->addChild(createBoolPtrMenuItem("Filter out identical notes (experimental)", "", &module->noteFilter));
 		
 		menu->addChild(createSubmenuItem("Tempo multiplier", "", [=](Menu* menu) {
 			for (int i = 0; i < NoteEcho::numMults; i++) {
+				if (i == NoteEcho::numMultsLong) {
+					menu->addChild(createMenuLabel("Long delays (up to 256 clocks)"));
+				}
 				std::string label = string::f("x %i", (int)NoteEcho::multNum[i]);
 				if (NoteEcho::multDen[i] != 1) {
 					label += string::f("/%i", (int)NoteEcho::multDen[i]);
@@ -902,6 +1070,17 @@ struct NoteEchoWidget : ModuleWidget {
 			}
 		}));
 
+		menu->addChild(createSubmenuItem("Input polyphony range", "", [=](Menu* menu) {
+			menu->addChild(createCheckMenuItem("1 to 4", "",
+				[=]() {return module->polyStep == 1;},
+				[=]() {module->polyStep = 1;}
+			));
+			menu->addChild(createCheckMenuItem("4 to 16 (by 4)", "",
+				[=]() {return module->polyStep == 4;},
+				[=]() {module->polyStep = 4;}
+			));
+		}));
+
 		menu->addChild(createCheckMenuItem("Low CPU mode", "",
 			[=]() {return module->ecoMode != 1;},
 			[=]() {module->ecoMode = (module->ecoMode == 1) ? 8 : 1;}
@@ -1031,8 +1210,8 @@ struct NoteEchoWidget : ModuleWidget {
 		
 		for (int j = 0; j < 5; j++) {
 			float posx = col42 - gldx * 1.5f;
-			for (int i = 0; i < NoteEcho::MAX_POLY; i++) {
-				addChild(createLightCentered<SmallLight<GreenLight>>(mm2px(Vec(posx, posy[j])), module, NoteEcho::GATE_LIGHTS + j * NoteEcho::MAX_POLY + i));
+			for (int i = 0; i < NoteEcho::POLY_KNOB_MAX; i++) {
+				addChild(createLightCentered<SmallLight<GreenLight>>(mm2px(Vec(posx, posy[j])), module, NoteEcho::GATE_LIGHTS + j * NoteEcho::POLY_KNOB_MAX + i));
 				posx += gldx;
 			}
 		}
@@ -34,11 +34,71 @@ struct NoteFilter : Module {
 	};
 
 	
+	struct PitchIndex {
+		// sorted pitches of the notes whose gates are high, with the number of channels on each pitch
+		float pitches[16];
+		int counts[16];
+		int size = 0;
+		
+		void clear() {
+			size = 0;
+		}
+		int lowerBound(float pitch) {
+			int lo = 0;
+			int hi = size;
+			while (lo < hi) {
+				int mid = (lo + hi) / 2;
+				if (pitches[mid] < pitch) {
+					lo = mid + 1;
+				}
+				else {
+					hi = mid;
+				}
+			}
+			return lo;
+		}
+		int count(float pitch) {
+			int i = lowerBound(pitch);
+			return (i < size && pitches[i] == pitch) ? counts[i] : 0;
+		}
+		void add(float pitch) {
+			if (pitch != pitch) {
+				return;// NaN never matches
+			}
+			int i = lowerBound(pitch);
+			if (i < size && pitches[i] == pitch) {
+				counts[i]++;
+				return;
+			}
+			for (int j = size; j > i; j--) {
+				pitches[j] = pitches[j - 1];
+				counts[j] = counts[j - 1];
+			}
+			pitches[i] = pitch;
+			counts[i] = 1;
+			size++;
+		}
+		void remove(float pitch) {
+			int i = lowerBound(pitch);
+			if (i < size && pitches[i] == pitch && --counts[i] == 0) {
+				size--;
+				for (int j = i; j < size; j++) {
+					pitches[j] = pitches[j + 1];
+					counts[j] = counts[j + 1];
+				}
+			}
+		}
+	};
+	
+	
 	// Expander
 	// none
 
 	// Constants
-	static const int MAXSD = 5;
+	static const int MAXSD = 5;// default range of the gate sample delay knob
+	static const int MAXSD_DEPTH = 64;// size of the gate delay lines, must be a power of 2
+	static const int NUM_SD_RANGES = 4;
+	static const int sdRanges[NUM_SD_RANGES];
 	
 	// Need to save, no reset
 	int panelTheme;
@@ -47,11 +107,16 @@ struct NoteFilter : Module {
 	// Need to save, with reset
 	float currCv[16];
 	float currCv2[16];
+	int sdRange;// maximum of the gate sample delay knob, must call setSdRange() to change
 	
 	// No need to save, with reset
-	float gateDelReg[16][MAXSD];
+	float gateDelLine[16][MAXSD_DEPTH];
+	int gateDelHead;// index of the last gate input written in the delay lines
+	int lastDelay;// delay lines are not written when the delay is 0, and are refilled when the delay is turned on
 	float currGate[16];
 	TriggerRiseFall gateTriggers[16];
+	PitchIndex pitchIndex;// pitches of the channels with high gates, indexPoly channels are indexed, -1 to rebuild
+	int indexPoly;
 
 	// No need to save, no reset
 	RefreshCounter refresh;
@@ -94,16 +159,43 @@ struct NoteFilter : Module {
 			currCv[p] = 0.0f;
 			currCv2[p] = 0.0f;
 		}
+		setSdRange(MAXSD);
 		resetNonJson();
 	}
 	void resetNonJson() {
 		for (int p = 0; p < 16; p++) {
-			for (int d = 0; d < MAXSD; d++) {
-				gateDelReg[p][d] = 0.0f;
+			for (int d = 0; d < MAXSD_DEPTH; d++) {
+				gateDelLine[p][d] = 0.0f;
 			}
 			currGate[p] = 0.0f;
 			gateTriggers[p].reset();
 		}
+		gateDelHead = 0;
+		lastDelay = 0;
+		indexPoly = -1;
+	}
+	void setSdRange(int newSdRange) {
+		sdRange = newSdRange;
+		paramQuantities[GATESD_PARAM]->maxValue = (float)sdRange;
+		params[GATESD_PARAM].setValue(std::min(params[GATESD_PARAM].getValue(), (float)sdRange));
+	}
+	static int getNearestSdRange(int range) {// snaps to the nearest range offered in the menu
+		int nearest = sdRanges[0];
+		for (int i = 1; i < NUM_SD_RANGES; i++) {
+			if (std::abs(range - sdRanges[i]) < std::abs(range - nearest)) {
+				nearest = sdRanges[i];
+			}
+		}
+		return nearest;
+	}
+	void rebuildPitchIndex(int poly) {
+		pitchIndex.clear();
+		for (int p = 0; p < poly; p++) {
+			if (currGate[p] > 0.5f) {
+				pitchIndex.add(currCv[p]);
+			}
+		}
+		indexPoly = poly;
 	}
 
 	
@@ -128,6 +220,12 @@ struct NoteFilter : Module {
 			json_array_insert_new(currCv2J, i, json_real(currCv2[i]));
 		json_object_set_new(rootJ, "currCv2", currCv2J);
 
+		// sdRange
+		json_object_set_new(rootJ, "sdRange", json_integer(sdRange));
+
+		// gate sample delay knob (its range depends on sdRange, so it is restored after sdRange in dataFromJson())
+		json_object_set_new(rootJ, "gateSdParam", json_real(params[GATESD_PARAM].getValue()));
+
 		return rootJ;
 	}
 
@@ -165,6 +263,18 @@ struct NoteFilter : Module {
 			}
 		}
 
+		// sdRange
+		int newSdRange = MAXSD;
+		json_t *sdRangeJ = json_object_get(rootJ, "sdRange");
+		if (sdRangeJ)
+			newSdRange = getNearestSdRange((int)json_integer_value(sdRangeJ));
+		setSdRange(newSdRange);
+
+		// gate sample delay knob
+		json_t *gateSdParamJ = json_object_get(rootJ, "gateSdParam");
+		if (gateSdParamJ)
+			params[GATESD_PARAM].setValue(clamp((float)json_number_value(gateSdParamJ), 0.0f, (float)sdRange));
+
 		resetNonJson();
 	}
 
@@ -178,7 +288,7 @@ struct NoteFilter : Module {
 		if (refresh.processInputs()) {
 		}// userInputs refresh
 	
-		int delay = getSdKnob();
+		int delay = std::min(getSdKnob(), MAXSD_DEPTH);
 		int poly = inputs[GATE_INPUT].getChannels();
 		if (outputs[CV_OUTPUT].getChannels() != poly) {
 			outputs[CV_OUTPUT].setChannels(poly);
@@ -186,8 +296,8 @@ struct NoteFilter : Module {
 		if (outputs[GATE_OUTPUT].getChannels() != poly) {
 			if (poly > 0) {
 				for (int p = poly - 1; p < outputs[GATE_OUTPUT].getChannels(); p++) {
-					for (int d = 0; d < MAXSD; d++) {
-						gateDelReg[p][d] = 0.0f;
+					for (int d = 0; d < MAXSD_DEPTH; d++) {
+						gateDelLine[p][d] = 0.0f;
 					}
 					gateTriggers[p].reset();
 				}
@@ -199,34 +309,50 @@ struct NoteFilter : Module {
 			outputs[CV2_OUTPUT].setChannels(poly);
 		}
 
-		// sd the gate
+		// sd the gate (the delay lines hold the gates of the last delay samples, and are left as is when there is no delay)
+		if (delay != 0 && lastDelay == 0) {
+			for (int p = 0; p < poly; p++) {
+				for (int d = 0; d < MAXSD_DEPTH; d++) {
+					gateDelLine[p][d] = inputs[GATE_INPUT].getVoltage(p);
+				}
+			}
+		}
+		lastDelay = delay;
+		if (poly != indexPoly) {
+			rebuildPitchIndex(poly);
+		}
 		for (int p = 0; p < poly; p++) {
-			float gateIn = delay == 0 ? inputs[GATE_INPUT].getVoltage(p) : gateDelReg[p][delay - 1];
+			float gateIn = delay == 0 ? inputs[GATE_INPUT].getVoltage(p) : gateDelLine[p][(gateDelHead - (delay - 1)) & (MAXSD_DEPTH - 1)];
 			int gateEdge = gateTriggers[p].process(gateIn);
 			if (gateEdge == 1) {
 				// rising gate
 				float newCv = inputs[CV_INPUT].getVoltage(p);
 				
-				// filter check
-				bool foundSame = false;
-				for (int p2 = 0; p2 < poly; p2++) {
-					if (p2 == p) continue;
-					if ((newCv == currCv[p2]) && (currGate[p2] > 0.5f)) {
-						foundSame = true;
-						filterLight = 1.0f;
-						break;
-					}
+				// filter check (other channels with a high gate on the same pitch)
+				int sameCount = pitchIndex.count(newCv);
+				if (currGate[p] > 0.5f && currCv[p] == newCv) {
+					sameCount--;
+				}
+				if (sameCount > 0) {
+					filterLight = 1.0f;
 				}
 				
 				// keep if not redundant
-				if (!foundSame) {
+				else {
+					if (currGate[p] > 0.5f) {
+						pitchIndex.remove(currCv[p]);
+					}
 					currCv[p] = newCv;
 					currGate[p] = gateIn;
 					currCv2[p] = inputs[CV2_INPUT].getVoltage(p);
+					pitchIndex.add(currCv[p]);
 				}
 			}
 			else if (gateEdge == -1) {
 				// falling gate
+				if (currGate[p] > 0.5f) {
+					pitchIndex.remove(currCv[p]);
+				}
 				currGate[p] = gateIn;
 			}
 			
@@ -244,17 +370,19 @@ struct NoteFilter : Module {
 		}// lightRefreshCounter
 
 		// sd the gate
-		for (int p = 0; p < poly; p++) {
-			gateDelReg[p][4] = gateDelReg[p][3];
-			gateDelReg[p][3] = gateDelReg[p][2];
-			gateDelReg[p][2] = gateDelReg[p][1];
-			gateDelReg[p][1] = gateDelReg[p][0];
-			gateDelReg[p][0] = inputs[GATE_INPUT].getVoltage(p);
+		if (delay != 0) {
+			gateDelHead = (gateDelHead + 1) & (MAXSD_DEPTH - 1);
+			for (int p = 0; p < poly; p++) {
+				gateDelLine[p][gateDelHead] = inputs[GATE_INPUT].getVoltage(p);
+			}
 		}
 	}// process()
 };
 
 
+const int NoteFilter::sdRanges[NUM_SD_RANGES] = {MAXSD, 16, 32, MAXSD_DEPTH};
+
+
 
 struct NoteFilterWidget : ModuleWidget {
 	typedef IMMediumKnob LoopKnob;
@@ -266,6 +394,19 @@ struct NoteFilterWidget : ModuleWidget {
 		menu->addChild(new MenuSeparator());
 		
 		createPanelThemeMenu(menu, &(module->panelTheme), &(module->panelContrast), static_cast<SvgPanel*>(getPanel()));
+
+		menu->addChild(new MenuSeparator());
+		menu->addChild(createMenuLabel("Settings"));
+
+		menu->addChild(createSubmenuItem("Gate delay range", string::f("%i", module->sdRange), [=](Menu* menu) {
+			for (int i = 0; i < NoteFilter::NUM_SD_RANGES; i++) {
+				int sdRangeI = NoteFilter::sdRanges[i];
+				menu->addChild(createCheckMenuItem(string::f(i == 0 ? "%i samples (default)" : "%i samples", sdRangeI), "",
+					[=]() {return module->sdRange == sdRangeI;},
+					[=]() {module->setSdRange(sdRangeI);}
+				));
+			}
+		}));
 	}	
 
 	
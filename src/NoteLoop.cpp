@@ -13,8 +13,11 @@
 struct NoteLoop : Module {	
 
 	static const int MAX_POLY = 16;
-	static const int MAX_DEL = 32;
+	static const int MAX_DEL = 128;
 	static const int BUF_SIZE = MAX_DEL * 2;  
+	static const int NUM_READERS = 1;// 0 is the outputs
+	static const int MAX_LAYERS = 8;// loop layers, including the one captured when the loop turns on
+	static const int POOL_SIZE = 8192;// events shared by all the loop layers
 
 	enum ParamIds {
 		LOOP_PARAM,
@@ -60,12 +63,26 @@ struct NoteLoop : Module {
 		NoteEvent events[BUF_SIZE];
 		uint16_t head = 0;// points to next empty entry that can be written to
 		uint16_t size = 0;
+		NoteEvent* readEvents[NUM_READERS];// event last found by each reader (gate on), nullptr when none
+		int64_t readNextFrames[NUM_READERS];// first frame at which each reader's event can change, INT64_MIN forces a new lookup
 		
 		public:
 		
+		EventBuffer() {
+			clear();
+		}
+		
 		void clear() {
 			head = 0;
 			size = 0;
+			invalidateReaders();
+		}
+		void invalidateReaders() {
+			// must be called when the events change, or when a reader moves back in time
+			for (int r = 0; r < NUM_READERS; r++) {
+				readEvents[r] = nullptr;
+				readNextFrames[r] = INT64_MIN;
+			}
 		}
 		void step() {
 			if (size < BUF_SIZE) {
@@ -81,14 +98,21 @@ struct NoteLoop : Module {
 			}
 			return (BUF_SIZE + head - 1 - num) % BUF_SIZE;
 		}
+		NoteEvent* getPrev(uint16_t num) {
+			// same as prev(), but returns the event, or nullptr when num is too large
+			uint16_t index = prev(num);
+			return index < BUF_SIZE ? &events[index] : nullptr;
+		}
 		void enterEvent(const NoteEvent& e) {
 			events[head] = e;
 			step();
+			invalidateReaders();
 		}
 		void finishDelEvent(int64_t gateOffFrame) {
 			uint16_t index = prev(0);
 			if (index < BUF_SIZE && events[index].gateOffFrame == 0) {
 				events[index].gateOffFrame = gateOffFrame;
+				invalidateReaders();
 			}
 		}
 		NoteEvent* findEvent(int64_t frameOrClk) {
@@ -110,6 +134,378 @@ struct NoteLoop : Module {
 			}
 			return event;
 		}
+		bool updateReader(int64_t frameOrClk, int reader) {
+			// same result as findEventGateOn(), kept in getReaderEvent(reader), but the scan is only done when frameOrClk 
+			//   reaches the next frame where a gate turns on or off, or when the events changed; returns true when a scan was done
+			if (frameOrClk < readNextFrames[reader]) {
+				return false;
+			}
+			NoteEvent* event = nullptr;
+			int64_t nextFrame = INT64_MAX;// when the last event is pending, finishDelEvent() will force the next scan
+			for (uint16_t cnt = 0; ; cnt++) {
+				uint16_t test = prev(cnt);
+				if (test >= BUF_SIZE) {
+					break;
+				}
+				if (frameOrClk >= events[test].gateOnFrame) {
+					if (events[test].gateOffFrame == 0) {
+						event = &events[test];
+					}
+					else if (frameOrClk < events[test].gateOffFrame) {
+						event = &events[test];
+						nextFrame = std::min(nextFrame, events[test].gateOffFrame);
+					}
+					break;
+				}
+				nextFrame = events[test].gateOnFrame;// a newer event is still ahead
+			}
+			readEvents[reader] = event;
+			readNextFrames[reader] = nextFrame;
+			return true;
+		}
+		NoteEvent* getReaderEvent(int reader) {
+			return readEvents[reader];
+		}
+	};
+	
+	
+	struct LayerEvent {
+		// times are in frames from the start of the loop, a length of 0 means that the gate is still held (overdub being recorded)
+		int32_t start;
+		int32_t length;
+		float cv;
+		float cv2;
+		uint8_t channel;// input channel, which is also the preferred voice when the event plays (see LoopLayers::startVoice())
+	};
+	
+	
+	class LoopLayers {
+		// The loop plays from layers of note events held in a preallocated pool, each layer sorted by start time. Layer 0 is 
+		//   captured from the tape when the loop turns on, the others are overdubs recorded from the inputs while looping.
+		// All layers play on the same voices (as many as the widest layer), an event takes the voice of its input channel when 
+		//   free, else the first free voice, else the voice of the note that started first is stolen.
+		// The open layer (the one being recorded) is layer numLayers, and ends at top. When all layers are used, the two oldest
+		//   overdub layers are merged so that there is always an open layer.
+		LayerEvent pool[POOL_SIZE];
+		int begins[MAX_LAYERS + 1];// layer l starts at pool[begins[l]] and ends right before begins[l + 1]
+		int polys[MAX_LAYERS + 1];// number of channels of each layer
+		int numLayers = 0;// closed layers
+		int top = 0;// next free event in the pool
+		int pending[MAX_POLY];// event being recorded for each input channel, -1 when none
+		int cursors[MAX_LAYERS + 1];// next event to start in each layer
+		LayerEvent* active[MAX_POLY];// event playing on each voice, nullptr when none
+		uint32_t retrigs = 0;// bit c is set when an event took over voice c while the voice was still playing another one, in the last play()
+		int32_t nextPos = 0;// next loop position where an event starts or ends, from the merge of the layers' cursors
+		
+		int getEnd(int l) {
+			return l < numLayers ? begins[l + 1] : top;
+		}
+		int getNumPlayedLayers() {
+			// closed layers and the open one
+			return numLayers + 1;
+		}
+		void startVoice(LayerEvent* le) {
+			int numVoices = getNumChannels();
+			if (numVoices == 0) {
+				return;
+			}
+			int v = -1;
+			if (le->channel < numVoices && active[le->channel] == nullptr) {
+				v = le->channel;
+			}
+			for (int c = 0; c < numVoices && v < 0; c++) {
+				if (active[c] == nullptr) {
+					v = c;
+				}
+			}
+			if (v < 0) {
+				// no free voice, steal the one of the note that started first
+				v = 0;
+				for (int c = 1; c < numVoices; c++) {
+					if (active[c]->start < active[v]->start) {
+						v = c;
+					}
+				}
+			}
+			if (active[v] != nullptr) {
+				retrigs |= (0x1 << v);
+			}
+			active[v] = le;
+		}
+		void mergeOldestOverdubs() {
+			// layers 1 and 2 become layer 1, the following layers move down by one
+			std::sort(pool + begins[1], pool + begins[3], [](const LayerEvent& a, const LayerEvent& b) {return a.start < b.start;});
+			polys[1] = std::max(polys[1], polys[2]);
+			for (int l = 2; l < numLayers; l++) {
+				begins[l] = begins[l + 1];
+				polys[l] = polys[l + 1];
+			}
+			numLayers--;
+		}
+		
+		public:
+		
+		LoopLayers() {
+			clear();
+		}
+		
+		void clear() {
+			numLayers = 0;
+			top = 0;
+			for (int l = 0; l < MAX_LAYERS + 1; l++) {
+				begins[l] = 0;
+				polys[l] = 0;
+			}
+			for (int c = 0; c < MAX_POLY; c++) {
+				pending[c] = -1;
+			}
+			seek(0);
+		}
+		int getNumLayers() {
+			return numLayers;
+		}
+		bool isPoolFull() {
+			return top >= POOL_SIZE;
+		}
+		int getNumChannels() {
+			// number of voices
+			int numVoices = 0;
+			for (int l = 0; l < getNumPlayedLayers(); l++) {
+				numVoices = std::max(numVoices, polys[l]);
+			}
+			return numVoices;
+		}
+		LayerEvent* getActive(int c) {
+			return active[c];
+		}
+		bool isRetriggered(int c) {
+			return (retrigs & (0x1 << c)) != 0;
+		}
+		
+		void capture(EventBuffer* channels, int poly, int64_t startFrame, int64_t loopLength) {
+			// layer 0 gets the notes of the tape that are in the last loopLength frames, the ones still held are cut at the end of the loop
+			clear();
+			int64_t endFrame = startFrame + loopLength;
+			for (int p = 0; p < poly; p++) {
+				for (uint16_t cnt = 0; top < POOL_SIZE; cnt++) {
+					NoteEvent* e = channels[p].getPrev(cnt);
+					if (e == nullptr) {
+						break;
+					}
+					int64_t gateOff = (e->gateOffFrame == 0 ? endFrame : std::min(e->gateOffFrame, endFrame));
+					if (gateOff <= startFrame) {
+						break;// this event and the older ones are before the loop
+					}
+					int64_t gateOn = std::max(e->gateOnFrame, startFrame);
+					LayerEvent& le = pool[top++];
+					le.start = (int32_t)(gateOn - startFrame);
+					le.length = (int32_t)std::max(gateOff - gateOn, (int64_t)1);
+					le.cv = e->cv;
+					le.cv2 = e->cv2;
+					le.channel = (uint8_t)p;
+				}
+			}
+			std::sort(pool, pool + top, [](const LayerEvent& a, const LayerEvent& b) {return a.start < b.start;});
+			polys[0] = poly;
+			begins[1] = top;
+			numLayers = 1;
+			seek(0);
+		}
+		
+		void startNote(int c, int32_t pos, float cv, float cv2) {
+			// overdub a note in the open layer, when there is room for it in the pool
+			if (top >= POOL_SIZE) {
+				return;
+			}
+			LayerEvent& le = pool[top];
+			le.start = pos;
+			le.length = 0;// will be completed when gate falls
+			le.cv = cv;
+			le.cv2 = cv2;
+			le.channel = (uint8_t)c;
+			pending[c] = top;
+			top++;
+			polys[numLayers] = std::max(polys[numLayers], c + 1);
+			nextPos = std::min(nextPos, pos);
+		}
+		void endNote(int c, int32_t pos) {
+			if (pending[c] >= 0) {
+				LayerEvent& le = pool[pending[c]];
+				le.length = std::max(pos - le.start, (int32_t)1);
+				pending[c] = -1;
+				nextPos = std::min(nextPos, le.start + le.length);
+			}
+		}
+		void wrap(int32_t loopLength) {
+			// end of the loop: cut the notes still held and close the open layer if it has notes, then play from the start
+			// (when this uses the last layer, the two oldest overdubs are merged to make room for the next open layer)
+			for (int c = 0; c < MAX_POLY; c++) {
+				if (pending[c] >= 0) {
+					pool[pending[c]].length = std::max(loopLength - pool[pending[c]].start, (int32_t)1);
+					pending[c] = -1;
+				}
+			}
+			if (top > begins[numLayers]) {
+				numLayers++;
+				begins[numLayers] = top;
+				polys[numLayers] = 0;
+				if (numLayers >= MAX_LAYERS) {
+					mergeOldestOverdubs();
+				}
+			}
+			seek(0);
+		}
+		void undo(int32_t pos) {
+			// removes the notes recorded in the open layer, or the last closed layer when the open one is empty
+			for (int c = 0; c < MAX_POLY; c++) {
+				pending[c] = -1;
+			}
+			if (top > begins[numLayers]) {
+				top = begins[numLayers];
+			}
+			else if (numLayers > 0) {
+				numLayers--;
+				top = begins[numLayers];
+			}
+			polys[numLayers] = 0;
+			seek(pos);
+		}
+		void rescale(double ratio) {
+			// for sample rate changes
+			for (int i = 0; i < top; i++) {
+				pool[i].start = (int32_t)(pool[i].start * ratio);
+				if (pool[i].length != 0) {
+					pool[i].length = std::max((int32_t)(pool[i].length * ratio), (int32_t)1);
+				}
+			}
+		}
+		
+		void seek(int32_t pos) {
+			// finds the active events and the cursors for the given loop position
+			for (int c = 0; c < MAX_POLY; c++) {
+				active[c] = nullptr;
+			}
+			int numPlayed = getNumPlayedLayers();
+			for (int l = 0; l < numPlayed; l++) {
+				cursors[l] = begins[l];
+				for (int end = getEnd(l); cursors[l] < end && pool[cursors[l]].start <= pos; cursors[l]++) {
+					LayerEvent* le = &pool[cursors[l]];
+					if (le->length == 0 || pos < le->start + le->length) {
+						startVoice(le);
+					}
+				}
+			}
+			retrigs = 0;
+			nextPos = INT32_MIN;// play() will find it
+		}
+		bool play(int32_t pos) {
+			// updates the active events at the given loop position, which must move forward by one at each call (or seek() must be 
+			//   called); the layers are only scanned when pos reaches the next start or end of an event; returns true when they were
+			retrigs = 0;
+			if (pos < nextPos) {
+				return false;
+			}
+			// gate offs
+			for (int c = 0; c < MAX_POLY; c++) {
+				if (active[c] != nullptr && active[c]->length != 0 && pos >= active[c]->start + active[c]->length) {
+					active[c] = nullptr;
+				}
+			}
+			// gate ons, merged from the cursors of the layers
+			int numPlayed = getNumPlayedLayers();
+			nextPos = INT32_MAX;
+			for (int l = 0; l < numPlayed; l++) {
+				int end = getEnd(l);
+				for (; cursors[l] < end && pool[cursors[l]].start <= pos; cursors[l]++) {
+					startVoice(&pool[cursors[l]]);
+				}
+				if (cursors[l] < end) {
+					nextPos = std::min(nextPos, pool[cursors[l]].start);
+				}
+			}
+			for (int c = 0; c < MAX_POLY; c++) {
+				if (active[c] != nullptr && active[c]->length != 0) {
+					nextPos = std::min(nextPos, active[c]->start + active[c]->length);
+				}
+			}
+			return true;
+		}
+		
+		void copyClosedLayers(const LoopLayers& src) {
+			// for the snapshot that is serialized (see NoteLoop::fillSnapshot()), only what toBytes() needs is copied
+			numLayers = src.numLayers;
+			for (int l = 0; l <= numLayers; l++) {
+				begins[l] = src.begins[l];
+				polys[l] = src.polys[l];
+			}
+			top = begins[numLayers];
+			std::copy(src.pool, src.pool + top, pool);
+		}
+		
+		void toBytes(std::vector<uint8_t>& bytes) const {
+			// closed layers only, as: number of layers, then for each layer its number of channels, its number of events (32 bits)
+			//   and its events (start and length in 32 bits, cv and cv2 as 32 bit floats, channel), all little-endian
+			bytes.clear();
+			bytes.push_back((uint8_t)numLayers);
+			for (int l = 0; l < numLayers; l++) {
+				bytes.push_back((uint8_t)polys[l]);
+				pushWord(bytes, (uint32_t)(begins[l + 1] - begins[l]));
+				for (int i = begins[l]; i < begins[l + 1]; i++) {
+					uint32_t cvBits;
+					uint32_t cv2Bits;
+					std::memcpy(&cvBits, &pool[i].cv, 4);
+					std::memcpy(&cv2Bits, &pool[i].cv2, 4);
+					pushWord(bytes, (uint32_t)pool[i].start);
+					pushWord(bytes, (uint32_t)pool[i].length);
+					pushWord(bytes, cvBits);
+					pushWord(bytes, cv2Bits);
+					bytes.push_back(pool[i].channel);
+				}
+			}
+		}
+		void fromBytes(const std::vector<uint8_t>& bytes) {
+			clear();
+			size_t n = 0;
+			if (bytes.size() < 1) {
+				return;
+			}
+			int numLayersRead = (int)bytes[n++];
+			for (int l = 0; l < numLayersRead; l++) {
+				if (n + 5 > bytes.size()) {
+					break;
+				}
+				polys[numLayers] = std::min((int)bytes[n++], MAX_POLY);
+				uint32_t count = popWord(bytes, n);
+				for (uint32_t i = 0; i < count && n + 17 <= bytes.size() && top < POOL_SIZE; i++) {
+					LayerEvent& le = pool[top++];
+					le.start = (int32_t)popWord(bytes, n);
+					le.length = std::max((int32_t)popWord(bytes, n), (int32_t)1);
+					uint32_t cvBits = popWord(bytes, n);
+					uint32_t cv2Bits = popWord(bytes, n);
+					std::memcpy(&le.cv, &cvBits, 4);
+					std::memcpy(&le.cv2, &cv2Bits, 4);
+					le.channel = std::min(bytes[n++], (uint8_t)(MAX_POLY - 1));
+				}
+				numLayers++;
+				begins[numLayers] = top;
+				if (numLayers >= MAX_LAYERS) {
+					mergeOldestOverdubs();
+				}
+			}
+			seek(0);
+		}
+		static void pushWord(std::vector<uint8_t>& bytes, uint32_t word) {
+			for (int b = 0; b < 4; b++) {
+				bytes.push_back((uint8_t)(word >> (8 * b)));
+			}
+		}
+		static uint32_t popWord(const std::vector<uint8_t>& bytes, size_t& n) {
+			uint32_t word = 0;
+			for (int b = 0; b < 4; b++) {
+				word |= ((uint32_t)bytes[n++]) << (8 * b);
+			}
+			return word;
+		}
 	};
 	
 	
@@ -134,20 +530,37 @@ struct NoteLoop : Module {
 	int64_t clockPeriod;
 	int monoMode;
 	int delMult;
+	bool overdub;
+	bool loop;// saved along with the loop layers
+	int64_t clockPeriodForLoop;// this is set when loop turns on
+	int64_t lengthForLoop;// this is set when loop turns on
+	float loopSampleRate;// sample rate of the loop layers' frames
+	LoopLayers layers;
+	
+	// copy of the loop for dataToJson(), published by the engine after the loop or its closed layers change (see StateSnapshot)
+	struct LoopSnapshot {
+		bool loop;
+		int64_t clockPeriodForLoop;
+		int64_t lengthForLoop;
+		float loopSampleRate;
+		LoopLayers layers;// closed layers only
+	};
+	StateSnapshot<LoopSnapshot> snapshot;
 
 	// No need to save, with reset
-	bool loop;
 	EventBuffer channel[MAX_POLY];
 	EventBuffer loopStart;
 	int64_t lastRisingClkFrame;// -1 when none
-	int64_t clockPeriodForLoop;// no need to save since loop is off when reload patch, and this is set when loop turns on
-	int64_t lengthForLoop;// no need to save since loop is off when reload patch, and this is set when loop turns on
+	int64_t loopPos;// frames since the start of the loop
+	bool pendingUndo;// set by the menu, done in process()
 	
 	// No need to save, no reset
 	float clearLight = 0.0f;
 	RefreshCounter refresh;
+	bool refreshOutputs = true;// force the outputs to be rewritten even when no gate changed
 	TriggerRiseFall clkTrigger;
 	TriggerRiseFall gateTriggers[MAX_POLY];
+	TriggerRiseFall overdubTriggers[MAX_POLY];
 	Trigger loopButtonTrigger;
 	Trigger loopStartTrigger;
 	Trigger clearTrigger;
@@ -160,6 +573,9 @@ struct NoteLoop : Module {
 	bool isTempoCV() {
 		return params[TEMPOCV_PARAM].getValue() > 0.5f;
 	}
+	int64_t getLoopLength() {
+		return clockPeriodForLoop * lengthForLoop;
+	}
 
 	
 	
@@ -196,13 +612,18 @@ struct NoteLoop : Module {
 
 
 	
-	void clear() {
+	void clearTape() {
 		for (int p = 0; p < MAX_POLY; p++) {
 			channel[p].clear();
 			gateTriggers[p].reset();
 		}
 		loopStart.clear();
 		loopStartTrigger.reset();
+		refreshOutputs = true;
+	}
+	void clear() {
+		clearTape();
+		layers.clear();
 	}
 
 	void onReset() override final {
@@ -210,14 +631,37 @@ struct NoteLoop : Module {
 		clockPeriod = (int64_t)(APP->engine->getSampleRate());// 60 BPM until detected
 		monoMode = 0;
 		delMult = numMultsUnityIndex;
+		overdub = false;
+		loop = false;
+		clockPeriodForLoop = 0;
+		lengthForLoop = 0;
+		loopSampleRate = APP->engine->getSampleRate();
+		layers.clear();
 		resetNonJson();
+		publishSnapshot();
 	}
 	void resetNonJson() {
-		loop = false;
-		clear();
+		clearTape();
 		lastRisingClkFrame = -1;// none
-		clockPeriodForLoop = 0;
-		lengthForLoop = 0;
+		loopPos = 0;
+		pendingUndo = false;
+	}
+
+	
+	void fillSnapshot(LoopSnapshot* snap) {
+		snap->loop = loop;
+		snap->clockPeriodForLoop = clockPeriodForLoop;
+		snap->lengthForLoop = lengthForLoop;
+		snap->loopSampleRate = loopSampleRate;
+		snap->layers.copyClosedLayers(layers);
+	}
+
+
+	void publishSnapshot() {// onReset(), dataFromJson() and onSampleRateChange() only (see StateSnapshot)
+		snapshot.publishNow([this](LoopSnapshot* snap, uint32_t chunks) {fillSnapshot(snap);});
+	}
+	void processSnapshot() {// end of process() and processBypass() only (see StateSnapshot)
+		snapshot.process([this](LoopSnapshot* snap, uint32_t chunks) {fillSnapshot(snap);});
 	}
 
 	
@@ -242,6 +686,23 @@ struct NoteLoop : Module {
 		// delMult
 		json_object_set_new(rootJ, "delMult", json_integer(delMult));
 		
+		// overdub
+		json_object_set_new(rootJ, "overdub", json_boolean(overdub));
+		
+		// loop, with its length and layers (only when looping, the tape is not saved), 
+		//   taken from a consistent copy since the engine closes and merges layers while looping (see StateSnapshot)
+		const LoopSnapshot* snap = snapshot.acquire([this](LoopSnapshot* snap, uint32_t chunks) {fillSnapshot(snap);});
+		json_object_set_new(rootJ, "loop", json_boolean(snap->loop));
+		if (snap->loop) {
+			json_object_set_new(rootJ, "clockPeriodForLoop", json_integer((long)snap->clockPeriodForLoop));
+			json_object_set_new(rootJ, "lengthForLoop", json_integer((long)snap->lengthForLoop));
+			json_object_set_new(rootJ, "loopSampleRate", json_real(snap->loopSampleRate));
+			std::vector<uint8_t> layerBytes;
+			snap->layers.toBytes(layerBytes);
+			json_object_set_new(rootJ, "loopLayers", json_string(string::toBase64(layerBytes).c_str()));
+		}
+		snapshot.release();
+		
 		return rootJ;
 	}
 
@@ -277,32 +738,74 @@ struct NoteLoop : Module {
 		if (delMultJ)
 			delMult = json_integer_value(delMultJ);
 
+		// overdub
+		json_t *overdubJ = json_object_get(rootJ, "overdub");
+		if (overdubJ)
+			overdub = json_is_true(overdubJ);
+
+		// loop, with its length and layers
+		loop = false;
+		layers.clear();
+		json_t *loopJ = json_object_get(rootJ, "loop");
+		json_t *clockPeriodForLoopJ = json_object_get(rootJ, "clockPeriodForLoop");
+		json_t *lengthForLoopJ = json_object_get(rootJ, "lengthForLoop");
+		json_t *loopSampleRateJ = json_object_get(rootJ, "loopSampleRate");
+		json_t *loopLayersJ = json_object_get(rootJ, "loopLayers");
+		if (loopJ && json_is_true(loopJ) && clockPeriodForLoopJ && lengthForLoopJ && loopSampleRateJ && loopLayersJ && json_is_string(loopLayersJ)) {
+			clockPeriodForLoop = (int64_t)json_integer_value(clockPeriodForLoopJ);
+			lengthForLoop = (int64_t)json_integer_value(lengthForLoopJ);
+			loopSampleRate = json_number_value(loopSampleRateJ);
+			layers.fromBytes(string::fromBase64(json_string_value(loopLayersJ)));
+			if (getLoopLength() > 0) {
+				loop = true;
+				rescaleLoop(APP->engine->getSampleRate());
+			}
+		}
+
 		resetNonJson();
+		publishSnapshot();
+	}
+
+
+	void rescaleLoop(float sampleRate) {
+		// keeps the loop layers at the same tempo when the sample rate changes
+		if (sampleRate != loopSampleRate && loopSampleRate > 0.0f) {
+			double ratio = (double)sampleRate / (double)loopSampleRate;
+			layers.rescale(ratio);
+			clockPeriodForLoop = std::max((int64_t)(clockPeriodForLoop * ratio), (int64_t)1);
+			loopPos = 0;
+			layers.seek(0);
+		}
+		loopSampleRate = sampleRate;
 	}
 
 
 	void onSampleRateChange() override {
-		clear();
+		clearTape();
+		rescaleLoop(APP->engine->getSampleRate());
+		publishSnapshot();
 	}		
 
 
+	void processBypass(const ProcessArgs &args) override {
+		Module::processBypass(args);
+		processSnapshot();
+	}
+
+
 	void process(const ProcessArgs &args) override {
 		// user inputs
 		if (refresh.processInputs()) {
+			refreshOutputs = true;// held outputs are cleared by Rack when cables are removed
 		}// userInputs refresh
 		
+		int poly = inputs[GATE_INPUT].getChannels();
+
 		// Loop
 		if (loopButtonTrigger.process(inputs[LOOP_INPUT].getVoltage() + params[LOOP_PARAM].getValue())) {
+			snapshot.markDirty();
 			loop = !loop;
 			if (loop) {
-				// enter event in loopStart special channel
-				NoteEvent e;
-				e.gateOnFrame = args.frame;
-				e.gateOffFrame = args.frame + (int64_t)(0.0011f * args.sampleRate);
-				e.cv = 0.0f;// unused
-				e.cv2 = 0.0f;// unused
-				loopStart.enterEvent(e);
-				
 				// sample clockPeriod and loop length so that it never changes during looping
 				if (isTempoCV()) {
 					float clockPeriodF = (args.sampleRate * 0.5f / std::pow(2.0f, inputs[CLK_INPUT].getVoltage()));
@@ -314,27 +817,56 @@ struct NoteLoop : Module {
 				//else clockPeriod already set since non BPM-CV always processing tempo edges further below
 				clockPeriodForLoop = clockPeriod;
 				lengthForLoop = (int64_t)getLoopLengthKnob();
+				
+				// the tape of the last loop length becomes the first layer of the loop
+				layers.capture(channel, poly, args.frame - getLoopLength(), getLoopLength());
+				loopSampleRate = args.sampleRate;
+				loopPos = 0;
+				// notes held when the loop turns on are not overdubbed
+				for (int c = 0; c < MAX_POLY; c++) {
+					overdubTriggers[c].reset();
+					if (c < poly) {
+						overdubTriggers[c].process(inputs[GATE_INPUT].getVoltage(c));
+					}
+				}
 			}
 			else {
+				layers.clear();
 				loopStart.clear();
+				// end the notes of the channels of the overdubs, which are no longer played
+				for (int p = poly; p < MAX_POLY; p++) {
+					channel[p].finishDelEvent(args.frame);
+					gateTriggers[p].reset();
+				}
+			}
+		}
+		if (pendingUndo) {
+			pendingUndo = false;
+			if (loop) {
+				snapshot.markDirty();
+				layers.undo((int32_t)loopPos);
 			}
 		}
 	
-		int poly = inputs[GATE_INPUT].getChannels();
-		int actualPolyOut = monoMode == 1 ? 1 : poly;
+		int numChannels = loop ? layers.getNumChannels() : poly;
+		int actualPolyOut = monoMode == 1 ? 1 : numChannels;
 		if (outputs[CV_OUTPUT].getChannels() != actualPolyOut) {
 			outputs[CV_OUTPUT].setChannels(actualPolyOut);
+			refreshOutputs = true;
 		}
 		if (outputs[GATE_OUTPUT].getChannels() != actualPolyOut) {
 			outputs[GATE_OUTPUT].setChannels(actualPolyOut);
+			refreshOutputs = true;
 		}
 		if (outputs[CV2_OUTPUT].getChannels() != actualPolyOut) {
 			outputs[CV2_OUTPUT].setChannels(actualPolyOut);
+			refreshOutputs = true;
 		}
 
 	
 		// clear and clock
 		if (clearTrigger.process(inputs[CLEAR_INPUT].getVoltage() + params[CLEAR_PARAM].getValue())) {
+			snapshot.markDirty();
 			clear();
 			clearLight = 1.0f;
 			//clearPulse.trigger(0.001f);
@@ -358,18 +890,35 @@ struct NoteLoop : Module {
 		}
 		
 		// sample the inputs on poly gates
-		NoteEvent* loopEvents[MAX_POLY] = {};
-		const NoteEvent* loopStartEvent = nullptr;
+		LayerEvent* loopEvents[MAX_POLY] = {};
 		float gateIn[MAX_POLY];
 		float loopStartIn;
 		if (loop) {
-			int64_t loopFrameOrClk = args.frame - clockPeriodForLoop * lengthForLoop;
-			for (int p = 0; p < poly; p++) {
-				loopEvents[p] = channel[p].findEventGateOn(loopFrameOrClk);
+			if (loopPos >= getLoopLength()) {
+				loopPos = 0;
+				snapshot.markDirty();// the open layer is closed
+				layers.wrap((int32_t)getLoopLength());
+			}
+			// overdubs
+			for (int c = 0; c < poly; c++) {
+				int overdubEdge = overdubTriggers[c].process(inputs[GATE_INPUT].getVoltage(c));
+				if (overdubEdge == 1 && overdub) {
+					float cv  = inputs[CV_INPUT ].getChannels() > c ? inputs[CV_INPUT ].getVoltage(c) : 0.0f;
+					float cv2 = inputs[CV2_INPUT].getChannels() > c ? inputs[CV2_INPUT].getVoltage(c) : cv2NormalledVoltage;
+					layers.startNote(c, (int32_t)loopPos, cv, cv2);
+				}
+				else if (overdubEdge == -1) {
+					layers.endNote(c, (int32_t)loopPos);
+				}
+			}
+			// playback
+			layers.play((int32_t)loopPos);
+			for (int p = 0; p < numChannels; p++) {
+				loopEvents[p] = layers.getActive(p);
 				gateIn[p] = (loopEvents[p] == nullptr ? 0.0f : 10.0f);
 			}
-			loopStartEvent = loopStart.findEventGateOn(loopFrameOrClk);
-			loopStartIn = (loopStartEvent == nullptr ? 0.0f : 10.0f);
+			loopStartIn = (loopPos < (int64_t)(0.0011f * args.sampleRate) ? 10.0f : 0.0f);
+			loopPos++;
 		}
 		else {
 			for (int p = 0; p < poly; p++) {
@@ -377,8 +926,13 @@ struct NoteLoop : Module {
 			}
 			loopStartIn = 0.0f;
 		}
-		for (int p = 0; p < poly; p++) {
+		for (int p = 0; p < numChannels; p++) {
 			int eventEdge = gateTriggers[p].process(gateIn[p]);
+			if (eventEdge == 0 && loopEvents[p] != nullptr && layers.isRetriggered(p)) {
+				// another loop note took over this voice while it was held (stolen voice or legato notes)
+				channel[p].finishDelEvent(args.frame);
+				eventEdge = 1;
+			}
 			// sample the inputs on rising poly gate edges (finish job on falling)
 			if (eventEdge == 1) {
 				// here we have a rising gate on poly p
@@ -410,11 +964,14 @@ struct NoteLoop : Module {
 		}
 
 		
-		// outputs
+		// outputs (only rewritten when a gate turns on or off, the held values are kept otherwise)
 		if (monoMode != 1) {
-			for (int p = 0; p < poly; p++) {
+			for (int p = 0; p < numChannels; p++) {
+				if (!channel[p].updateReader(args.frame, 0) && !refreshOutputs) {
+					continue;
+				}
 				float gate = 0.0f;
-				NoteEvent* event = channel[p].findEventGateOn(args.frame);
+				NoteEvent* event = channel[p].getReaderEvent(0);
 				if (event != nullptr) {
 					gate = 10.0f;
 					outputs[CV_OUTPUT].setVoltage(event->cv, p);
@@ -424,22 +981,29 @@ struct NoteLoop : Module {
 			}	
 		}
 		else {
-			// find last CV and CV2
-			NoteEvent* lastEvent = nullptr;// closest last event where gate is high
-			for (int p = 0; p < poly; p++) {
-				NoteEvent* event = channel[p].findEventGateOn(args.frame);
-				if (event != nullptr) {
-					if (lastEvent == nullptr || event->gateOnFrame > lastEvent->gateOnFrame) {
-						lastEvent = event;
+			bool changed = refreshOutputs;
+			for (int p = 0; p < numChannels; p++) {
+				changed |= channel[p].updateReader(args.frame, 0);
+			}
+			if (changed) {
+				// find last CV and CV2
+				NoteEvent* lastEvent = nullptr;// closest last event where gate is high
+				for (int p = 0; p < numChannels; p++) {
+					NoteEvent* event = channel[p].getReaderEvent(0);
+					if (event != nullptr) {
+						if (lastEvent == nullptr || event->gateOnFrame > lastEvent->gateOnFrame) {
+							lastEvent = event;
+						}
 					}
 				}
+				if (lastEvent != nullptr) {
+					outputs[CV_OUTPUT].setVoltage(lastEvent->cv);
+					outputs[CV2_OUTPUT].setVoltage(lastEvent->cv2);							
+				}
+				outputs[GATE_OUTPUT].setVoltage(lastEvent != nullptr ? 10.0f : 0.0f);
 			}
-			if (lastEvent != nullptr) {
-				outputs[CV_OUTPUT].setVoltage(lastEvent->cv);
-				outputs[CV2_OUTPUT].setVoltage(lastEvent->cv2);							
-			}
-			outputs[GATE_OUTPUT].setVoltage(lastEvent != nullptr ? 10.0f : 0.0f);
 		}
+		refreshOutputs = false;
 
 		// outputs[CLEAR_OUTPUT].setVoltage((clearPulse.process(args.sampleTime) ? 10.0f : 0.0f));
 		
@@ -455,7 +1019,8 @@ struct NoteLoop : Module {
 			lights[CLEAR_LIGHT].setSmoothBrightness(clearLight, args.sampleTime * (RefreshCounter::displayRefreshStepSkips >> 2));	
 			clearLight = 0.0f;
 		}// lightRefreshCounter
-	
+		
+		processSnapshot();
 	}// process()
 };
 
@@ -493,14 +1058,14 @@ struct NoteLoopWidget : ModuleWidget {
 
 				Vec textPos = VecPx(5.7f, textOffsetY);
 				nvgFillColor(args.vg, nvgTransRGBA(displayColOn, 23));
-				std::string initString(2,'~');
+				std::string initString(3,'~');
 				nvgText(args.vg, textPos.x, textPos.y, initString.c_str(), NULL);
 				
 				nvgFillColor(args.vg, displayColOn);
-				std::string dispStr = " 4";
+				std::string dispStr = "  4";
 				if (module != NULL) {
 					int len = module->getLoopLengthKnob();
-					dispStr = string::f("%2u", (unsigned)len);
+					dispStr = string::f("%3u", (unsigned)len);
 				}
 				nvgText(args.vg, textPos.x, textPos.y, dispStr.c_str(), NULL);
 			}
@@ -591,6 +1156,16 @@ struct NoteLoopWidget : ModuleWidget {
 			[=]() {module->monoMode ^= 0x1;}
 		));
 
+		menu->addChild(createBoolPtrMenuItem("Overdub inputs while looping", "", &module->overdub));
+		if (module->loop && module->layers.isPoolFull()) {
+			menu->addChild(createMenuLabel("Loop note memory full, overdubs are ignored"));
+		}
+
+		menu->addChild(createMenuItem("Undo last loop layer", "",
+			[=]() {module->pendingUndo = true;},
+			!module->loop
+		));
+
 		createCv2NormalizationMenu(menu, &(module->cv2NormalledVoltage));
 	}	
 
@@ -629,7 +1204,7 @@ struct NoteLoopWidget : ModuleWidget {
 		
 		
 		// row 0
-		LenDisplayWidget* lenDisplayWidget = new LenDisplayWidget(mm2px(Vec(col1, row0)), VecPx(35, 24), module);
+		LenDisplayWidget* lenDisplayWidget = new LenDisplayWidget(mm2px(Vec(col1, row0)), VecPx(48, 24), module);
 		addChild(lenDisplayWidget);
 		svgPanel->fb->addChild(new DisplayBackground(lenDisplayWidget->box.pos, lenDisplayWidget->box.size, mode));
 		
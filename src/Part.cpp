@@ -34,6 +34,9 @@ struct Part : Module {
 	enum LightIds {
 		NUM_LIGHTS
 	};
+	
+	// Constants
+	static const int MAX_SPLITS = 8;// multi-zone mode, split points given by the channels of the split input
 		
 	// Need to save, no reset
 	int panelTheme;
@@ -43,15 +46,29 @@ struct Part : Module {
 	bool showSharp;
 	bool showPlusMinus;
 	bool applyEpsilonForSplit;
+	bool multiZone;
 
 	// No need to save, with reset
-	// none
+	int zoneWidth;// output channels per zone of the current multi-zone layout, 0 when none
+	int zoneNumChan;// input polyphony of the current multi-zone layout
+	int zoneNumSplits;// number of split points of the current multi-zone layout
+	TriggerRiseFall gateTriggers[PORT_MAX_CHANNELS];
+	int zoneOfChan[PORT_MAX_CHANNELS];// zone of the last note of each input channel, -1 when none
+	int slotOfChan[PORT_MAX_CHANNELS];// output channel of the last note of each input channel, -1 when none (dropped or stolen)
+	int chanOfSlot[PORT_MAX_CHANNELS];// input channel of the note in each output channel, -1 when none
+	uint32_t slotStamps[PORT_MAX_CHANNELS];// when the note in each output channel started, 0 when none
+	uint32_t stampCounter;
 	
 	// No need to save, no reset
 	RefreshCounter refresh;
 
 
-	float getSplitValue() {return clamp(params[SPLIT_PARAM].getValue() + inputs[SPLIT_INPUT].getVoltage(), -10.0f, 10.0f);}
+	float getSplitValue(int s = 0) {return clamp(params[SPLIT_PARAM].getValue() + inputs[SPLIT_INPUT].getVoltage(s), -10.0f, 10.0f);}
+	int getNumSplits() {return multiZone ? clamp(inputs[SPLIT_INPUT].getChannels(), 1, MAX_SPLITS) : 1;}
+	int getZoneWidth(int numChan) {
+		// each zone has numChan output channels when all the zones fit in 16 channels, else an equal share of the 16 channels
+		return std::min(numChan, PORT_MAX_CHANNELS / (getNumSplits() + 1));
+	}
 
 
 	Part() {
@@ -82,9 +99,25 @@ struct Part : Module {
 		showSharp = true;
 		showPlusMinus = true;
 		applyEpsilonForSplit = true;
+		multiZone = false;
 		resetNonJson();
 	}
 	void resetNonJson() {
+		zoneWidth = 0;
+		zoneNumChan = 0;
+		zoneNumSplits = 0;
+		clearZoneVoices();
+	}
+	void clearZoneVoices() {
+		for (int c = 0; c < PORT_MAX_CHANNELS; c++) {
+			gateTriggers[c].reset();
+			zoneOfChan[c] = -1;
+			slotOfChan[c] = -1;
+			chanOfSlot[c] = -1;
+			slotStamps[c] = 0;
+			outputs[LOW_OUTPUT].setVoltage(0.0f, c);
+		}
+		stampCounter = 0;
 	}
 	
 	
@@ -110,6 +143,9 @@ struct Part : Module {
 		// applyEpsilonForSplit
 		json_object_set_new(rootJ, "applyEpsilonForSplit", json_boolean(applyEpsilonForSplit));
 		
+		// multiZone
+		json_object_set_new(rootJ, "multiZone", json_boolean(multiZone));
+		
 		return rootJ;
 	}
 
@@ -142,6 +178,11 @@ struct Part : Module {
 		else 
 			applyEpsilonForSplit = false;
 		
+		// multiZone
+		json_t *multiZoneJ = json_object_get(rootJ, "multiZone");
+		if (multiZoneJ)
+			multiZone = json_is_true(multiZoneJ);
+		
 		resetNonJson();
 	}
 
@@ -150,21 +191,34 @@ struct Part : Module {
 		int numChan = inputs[GATE_INPUT].getChannels();
 		
 		if (refresh.processInputs()) {
-			outputs[LOW_OUTPUT].setChannels(numChan);
-			outputs[HIGH_OUTPUT].setChannels(numChan);
-			outputs[CVTHRU_OUTPUT].setChannels(inputs[CV_INPUT].getChannels());
+			if (multiZone) {
+				int numZoneChan = (getNumSplits() + 1) * getZoneWidth(numChan);
+				outputs[LOW_OUTPUT].setChannels(numZoneChan);
+				outputs[HIGH_OUTPUT].setChannels(numChan);
+				outputs[CVTHRU_OUTPUT].setChannels(numZoneChan);
+			}
+			else {
+				outputs[LOW_OUTPUT].setChannels(numChan);
+				outputs[HIGH_OUTPUT].setChannels(numChan);
+				outputs[CVTHRU_OUTPUT].setChannels(inputs[CV_INPUT].getChannels());
+			}
 		}// userInputs refresh
 		
-		
-		float splitPoint = getSplitValue() - (applyEpsilonForSplit ? 0.001f : 0.0f);// unconnected CV_INPUT or insufficient channels will cause 0.0f to be used
-		for (int c = 0; c < numChan; c++) {
-			bool isHigh = inputs[CV_INPUT].getVoltage(c) >= splitPoint;
-			float inGate = inputs[GATE_INPUT].getVoltage(c);// unconnected GATE_INPUT or insufficient channels will cause 0.0f to be used
-			outputs[LOW_OUTPUT].setVoltage(isHigh ? 0.0f : inGate, c);
-			outputs[HIGH_OUTPUT].setVoltage(isHigh ? inGate : 0.0f, c);
+		if (multiZone) {
+			processMultiZone(numChan);
 		}
-		for (int c = 0; c < inputs[CV_INPUT].getChannels(); c++) {
-			outputs[CVTHRU_OUTPUT].setVoltage(inputs[CV_INPUT].getVoltage(c), c);
+		else {
+			zoneWidth = 0;
+			float splitPoint = getSplitValue() - (applyEpsilonForSplit ? 0.001f : 0.0f);// unconnected CV_INPUT or insufficient channels will cause 0.0f to be used
+			for (int c = 0; c < numChan; c++) {
+				bool isHigh = inputs[CV_INPUT].getVoltage(c) >= splitPoint;
+				float inGate = inputs[GATE_INPUT].getVoltage(c);// unconnected GATE_INPUT or insufficient channels will cause 0.0f to be used
+				outputs[LOW_OUTPUT].setVoltage(isHigh ? 0.0f : inGate, c);
+				outputs[HIGH_OUTPUT].setVoltage(isHigh ? inGate : 0.0f, c);
+			}
+			for (int c = 0; c < inputs[CV_INPUT].getChannels(); c++) {
+				outputs[CVTHRU_OUTPUT].setVoltage(inputs[CV_INPUT].getVoltage(c), c);
+			}
 		}
 		
 		
@@ -173,6 +227,113 @@ struct Part : Module {
 			// none, but need this since refresh counter is stepped in processLights()
 		}
 	}
+	
+	
+	void processMultiZone(int numChan) {
+		// The split points are sorted, so that zone z holds the notes between the z-th and (z+1)-th lowest split points 
+		//   whatever the order of the channels of the split input (zone 0 is below all split points); the zone of a note 
+		//   is the number of split points at or below its CV, found for four channels at a time.
+		// Outputs: the gates of each zone in their own group of zoneWidth channels of the low output, with the CVs in the 
+		//   same channels of the thru output; the high output is as in the single split mode, with the gates of the notes
+		//   at or above the lowest split point
+		int numSplits = getNumSplits();
+		float epsilon = (applyEpsilonForSplit ? 0.001f : 0.0f);
+		float sortedSplits[MAX_SPLITS];
+		for (int s = 0; s < numSplits; s++) {
+			sortedSplits[s] = getSplitValue(s) - epsilon;
+		}
+		std::sort(sortedSplits, sortedSplits + numSplits);
+		simd::float_4 splitPoints[MAX_SPLITS];
+		for (int s = 0; s < numSplits; s++) {
+			splitPoints[s] = sortedSplits[s];
+		}
+		
+		int newZoneWidth = getZoneWidth(numChan);
+		if (newZoneWidth != zoneWidth || numChan != zoneNumChan || numSplits != zoneNumSplits) {
+			clearZoneVoices();
+			zoneWidth = newZoneWidth;
+			zoneNumChan = numChan;
+			zoneNumSplits = numSplits;
+		}
+		
+		float zones[PORT_MAX_CHANNELS];
+		float cvs[PORT_MAX_CHANNELS];
+		float gates[PORT_MAX_CHANNELS];
+		for (int c = 0; c < numChan; c += 4) {
+			simd::float_4 cv = inputs[CV_INPUT].getVoltageSimd<simd::float_4>(c);
+			simd::float_4 zone = 0.0f;
+			for (int s = 0; s < numSplits; s++) {
+				zone += simd::ifelse(cv >= splitPoints[s], 1.0f, 0.0f);
+			}
+			simd::float_4 inGate = inputs[GATE_INPUT].getVoltageSimd<simd::float_4>(c);
+			outputs[HIGH_OUTPUT].setVoltageSimd(simd::ifelse(zone >= 1.0f, inGate, 0.0f), c);
+			zone.store(&zones[c]);
+			cv.store(&cvs[c]);
+			inGate.store(&gates[c]);
+		}
+		
+		if (zoneWidth == numChan) {
+			// all the zones fit: channel c of the input is channel c of each zone, as in the single split mode
+			for (int c = 0; c < numChan; c++) {
+				for (int z = 0; z <= numSplits; z++) {
+					outputs[LOW_OUTPUT].setVoltage((int)zones[c] == z ? gates[c] : 0.0f, z * numChan + c);
+					outputs[CVTHRU_OUTPUT].setVoltage(cvs[c], z * numChan + c);
+				}
+			}
+		}
+		else {
+			// the zones have fewer channels than the input, the notes are given the free channels of their zone
+			for (int c = 0; c < numChan; c++) {
+				int zone = (int)zones[c];
+				int edge = gateTriggers[c].process(gates[c]);
+				if (edge == 1 || (gateTriggers[c].state && zone != zoneOfChan[c])) {
+					allocateZoneVoice(c, zone);// new note, or held note that moved to another zone
+				}
+				int slot = slotOfChan[c];
+				if (slot >= 0) {
+					outputs[LOW_OUTPUT].setVoltage(gates[c], slot);
+					if (gateTriggers[c].state) {
+						outputs[CVTHRU_OUTPUT].setVoltage(cvs[c], slot);// CV held once the gate is off, for the release
+					}
+				}
+			}
+		}
+	}
+	
+	
+	void allocateZoneVoice(int c, int zone) {
+		// the note of input channel c goes in the output channel it had if that one is in the given zone, else in the 
+		//   free or oldest released channel of the zone; the note is dropped when all the channels of the zone are held
+		int slot = slotOfChan[c];
+		if (slot >= 0 && slot / zoneWidth != zone) {
+			outputs[LOW_OUTPUT].setVoltage(0.0f, slot);
+			chanOfSlot[slot] = -1;
+			slotStamps[slot] = 0;
+			slot = -1;
+		}
+		if (slot < 0) {
+			for (int s = zone * zoneWidth; s < (zone + 1) * zoneWidth; s++) {
+				int owner = chanOfSlot[s];
+				if (owner >= 0 && gateTriggers[owner].state) {
+					continue;// held
+				}
+				if (slot < 0 || slotStamps[s] < slotStamps[slot]) {
+					slot = s;
+				}
+			}
+			if (slot >= 0) {
+				if (chanOfSlot[slot] >= 0) {
+					slotOfChan[chanOfSlot[slot]] = -1;
+				}
+				chanOfSlot[slot] = c;
+			}
+		}
+		if (slot >= 0) {
+			slotStamps[slot] = ++stampCounter;
+		}
+		slotOfChan[c] = slot;
+		zoneOfChan[c] = zone;
+	}
 };
 
 
@@ -282,6 +443,16 @@ struct PartWidget : ModuleWidget {
 		menu->addChild(createBoolPtrMenuItem("Show +/- for notes", "", &module->showPlusMinus));
 		
 		menu->addChild(createBoolPtrMenuItem("Apply -1mV epsilon to split point", "", &module->applyEpsilonForSplit));
+		
+		menu->addChild(createBoolPtrMenuItem("Multi-zone (split points from split input channels)", "", &module->multiZone));
+		
+		if (module->multiZone) {
+			int numChan = module->inputs[Part::GATE_INPUT].getChannels();
+			int zoneWidth = module->getZoneWidth(numChan);
+			if (zoneWidth < numChan) {
+				menu->addChild(createMenuLabel(string::f("Note: %i channels per zone (16 channels in all)", zoneWidth)));
+			}
+		}
 	}	
 	
 	
@@ -91,6 +91,14 @@ struct PhraseSeq32 : Module {
 	// Constants
 	enum DisplayStateIds {DISP_NORMAL, DISP_MODE, DISP_LENGTH, DISP_TRANSPOSE, DISP_ROTATE};
 
+	// Copy of the song and sequences, serialized by dataToJson() (see StateSnapshot)
+	struct SeqSnapshot {
+		SeqAttributes sequences[32];
+		int phrase[32];
+		float cv[32][32];
+		StepAttributes attributes[32][32];
+	};
+
 
 	// Need to save, no reset
 	int panelTheme;
@@ -113,6 +121,7 @@ struct PhraseSeq32 : Module {
 	float cv[32][32];// [-3.0 : 3.917]. First index is patten number, 2nd index is step
 	StepAttributes attributes[32][32];// First index is patten number, 2nd index is step (see enum AttributeBitMasks for details)
 	bool resetOnRun;
+	ClockBusReader clockBusReader;// clock, reset and run from the clock bus instead of the cables when subscribed
 	int retrigGatesOnReset;
 	bool attached;
 	bool stopAtEndOfSong;
@@ -151,6 +160,7 @@ struct PhraseSeq32 : Module {
 	// No need to save, no reset
 	int stepConfigSync = 0;// 0 means no sync requested, 1 means synchronous read of lengths requested
 	RefreshCounter refresh;
+	StateSnapshot<SeqSnapshot> snapshot;// song and sequences for dataToJson()
 	float slideCVdelta[2];// no need to initialize, this is a companion to slideStepsRemain	
 	float editingGateCV;// no need to initialize, this is a companion to editingGate (output this only when editingGate > 0)
 	int editingGateKeyLight;// no need to initialize, this is a companion to editingGate (use this only when editingGate > 0)
@@ -304,10 +314,12 @@ struct PhraseSeq32 : Module {
 			}
 		}
 		resetOnRun = false;
+		clockBusReader.source = -1;
 		retrigGatesOnReset = RGOR_NRUN;
 		attached = false;
 		stopAtEndOfSong = false;
 		resetNonJson(false);
+		publishSnapshot();
 	}
 	void resetNonJson(bool delayed) {// delay thread sensitive parts (i.e. schedule them so that process() will do them)
 		displayState = DISP_NORMAL;
@@ -367,11 +379,31 @@ struct PhraseSeq32 : Module {
 			}
 			sequences[seqIndexEdit].randomize(16 * stepConfig, NUM_MODES);// ok to use stepConfig since CONFIG_PARAM is not randomizable		
 		}
+		publishSnapshot();
 	}
 	
 	
+	void fillSnapshot(SeqSnapshot* snap) {// the song and sequences are a single chunk
+		std::memcpy(snap->sequences, sequences, sizeof(sequences));
+		std::memcpy(snap->phrase, phrase, sizeof(phrase));
+		std::memcpy(snap->cv, cv, sizeof(cv));
+		std::memcpy(snap->attributes, attributes, sizeof(attributes));
+	}
+
+
+	void publishSnapshot() {// onReset(), onRandomize() and dataFromJson() only (see StateSnapshot)
+		snapshot.publishNow([this](SeqSnapshot* snap, uint32_t chunks) {fillSnapshot(snap);});
+	}
+	void processSnapshot() {// end of process() and processBypass() only (see StateSnapshot)
+		snapshot.process([this](SeqSnapshot* snap, uint32_t chunks) {fillSnapshot(snap);});
+	}
+
+
 	json_t *dataToJson() override {
 		json_t *rootJ = json_object();
+		
+		// song and sequences are taken from a consistent copy of the state (see StateSnapshot)
+		const SeqSnapshot* snap = snapshot.acquire([this](SeqSnapshot* snap, uint32_t chunks) {fillSnapshot(snap);});
 
 		// panelTheme
 		json_object_set_new(rootJ, "panelTheme", json_integer(panelTheme));
@@ -406,7 +438,7 @@ struct PhraseSeq32 : Module {
 		// phrase 
 		json_t *phraseJ = json_array();
 		for (int i = 0; i < 32; i++)
-			json_array_insert_new(phraseJ, i, json_integer(phrase[i]));
+			json_array_insert_new(phraseJ, i, json_integer(snap->phrase[i]));
 		json_object_set_new(rootJ, "phrase", phraseJ);
 
 		// phrases
@@ -416,7 +448,7 @@ struct PhraseSeq32 : Module {
 		json_t *cvJ = json_array();
 		for (int i = 0; i < 32; i++)
 			for (int s = 0; s < 32; s++) {
-				json_array_insert_new(cvJ, s + (i * 32), json_real(cv[i][s]));
+				json_array_insert_new(cvJ, s + (i * 32), json_real(snap->cv[i][s]));
 			}
 		json_object_set_new(rootJ, "cv", cvJ);
 
@@ -424,7 +456,7 @@ struct PhraseSeq32 : Module {
 		json_t *attributesJ = json_array();
 		for (int i = 0; i < 32; i++)
 			for (int s = 0; s < 32; s++) {
-				json_array_insert_new(attributesJ, s + (i * 32), json_integer(attributes[i][s].getAttribute()));
+				json_array_insert_new(attributesJ, s + (i * 32), json_integer(snap->attributes[i][s].getAttribute()));
 			}
 		json_object_set_new(rootJ, "attributes", attributesJ);
 
@@ -436,6 +468,9 @@ struct PhraseSeq32 : Module {
 
 		// resetOnRun
 		json_object_set_new(rootJ, "resetOnRun", json_boolean(resetOnRun));
+
+		// clockBusSource
+		json_object_set_new(rootJ, "clockBusSource", json_integer(clockBusReader.source));
 		
 		// retrigGatesOnReset
 		json_object_set_new(rootJ, "retrigGatesOnReset2", json_integer(retrigGatesOnReset));
@@ -449,9 +484,11 @@ struct PhraseSeq32 : Module {
 		// sequences
 		json_t *sequencesJ = json_array();
 		for (int i = 0; i < 32; i++)
-			json_array_insert_new(sequencesJ, i, json_integer(sequences[i].getSeqAttrib()));
+			json_array_insert_new(sequencesJ, i, json_integer(snap->sequences[i].getSeqAttrib()));
 		json_object_set_new(rootJ, "sequences", sequencesJ);
 
+		snapshot.release();
+
 		return rootJ;
 	}
 
@@ -635,6 +672,13 @@ struct PhraseSeq32 : Module {
 		if (resetOnRunJ)
 			resetOnRun = json_is_true(resetOnRunJ);
 
+		// clockBusSource
+		json_t *clockBusSourceJ = json_object_get(rootJ, "clockBusSource");
+		if (clockBusSourceJ) {
+			clockBusReader.source = clamp((int)json_integer_value(clockBusSourceJ), -1, ClockBus::NUM_CLOCKS - 1);
+			clockBusReader.sync();
+		}
+
 		// retrigGatesOnReset
 		json_t *retrigGatesOnResetJ = json_object_get(rootJ, "retrigGatesOnReset2");
 		if (retrigGatesOnResetJ)
@@ -651,6 +695,7 @@ struct PhraseSeq32 : Module {
 			phraseIndexEdit = json_integer_value(phraseIndexEditJ);
 		
 		resetNonJson(true);
+		publishSnapshot();
 	}
 	
 	
@@ -699,6 +744,7 @@ struct PhraseSeq32 : Module {
 				activateTiedStep(seqIndexEdit, i);
 			}
 		}
+		snapshot.markDirtyFromUi();
 	}
 	
 
@@ -752,6 +798,13 @@ struct PhraseSeq32 : Module {
 	}
 	
 
+	void processBypass(const ProcessArgs &args) override {
+		Module::processBypass(args);
+		// keep publishing the edits done on the UI thread while bypassed (see StateSnapshot)
+		processSnapshot();
+	}
+	
+	
 	void process(const ProcessArgs &args) override {
 		float sampleRate = args.sampleRate;
 		static const float gateTime = 0.4f;// seconds
@@ -770,7 +823,12 @@ struct PhraseSeq32 : Module {
 		bool editingSequence = isEditingSequence();// true = editing sequence, false = editing song
 		
 		// Run button
-		if (runningTrigger.process(params[RUN_PARAM].getValue() + inputs[RUNCV_INPUT].getVoltage())) {// no input refresh here, don't want to introduce startup skew
+		bool busClock = clockBusReader.isSubscribed();
+		bool runToggled = runningTrigger.process(params[RUN_PARAM].getValue() + (busClock ? 0.0f : inputs[RUNCV_INPUT].getVoltage()));// no input refresh here, don't want to introduce startup skew
+		if (busClock && clockBusReader.processRun()) {
+			runToggled = !runToggled;
+		}
+		if (runToggled) {
 			running = !running;
 			if (running) {
 				if (resetOnRun) {
@@ -788,12 +846,14 @@ struct PhraseSeq32 : Module {
 			int oldStepConfig = stepConfig;
 			stepConfig = getStepConfig();
 			if (stepConfigSync != 0) {// sync from dataFromJson, so read lengths from seqAttribBuffer
+				snapshot.markDirty();
 				for (int i = 0; i < 32; i++)
 					sequences[i].setSeqAttrib(seqAttribBuffer[i].getSeqAttrib());
 				initRun();			
 				stepConfigSync = 0;
 			}
 			else if (stepConfig != oldStepConfig) {// switch moved, so init lengths
+				snapshot.markDirty();
 				for (int i = 0; i < 32; i++)
 					sequences[i].setLength(16 * stepConfig);
 				initRun();			
@@ -802,8 +862,13 @@ struct PhraseSeq32 : Module {
 			// Mode CV input
 			if (expanderPresent && editingSequence) {
 				float modeCVin = messagesFromExpander[4];
-				if (!std::isnan(modeCVin))
-					sequences[seqIndexEdit].setRunMode((int) clamp( std::round(modeCVin * ((float)NUM_MODES - 1.0f) / 10.0f), 0.0f, (float)NUM_MODES - 1.0f ));
+				if (!std::isnan(modeCVin)) {
+					int newRunMode = (int) clamp( std::round(modeCVin * ((float)NUM_MODES - 1.0f) / 10.0f), 0.0f, (float)NUM_MODES - 1.0f );
+					if (newRunMode != sequences[seqIndexEdit].getRunMode()) {
+						snapshot.markDirty();
+						sequences[seqIndexEdit].setRunMode(newRunMode);
+					}
+				}
 			}
 			
 			// Attach button
@@ -855,6 +920,7 @@ struct PhraseSeq32 : Module {
 			// Paste button
 			if (pasteTrigger.process(params[PASTE_PARAM].getValue())) {
 				if (!attached) {
+					snapshot.markDirty();
 					infoCopyPaste = (long) (-1 * revertDisplayTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
 					startCP = 0;
 					if (countCP <= 8) {
@@ -936,6 +1002,7 @@ struct PhraseSeq32 : Module {
 			if (writeTrig) {
 				if (editingSequence) {
 					if (!attributes[seqIndexEdit][stepIndexEdit].getTied()) {
+						snapshot.markDirty();
 						cv[seqIndexEdit][stepIndexEdit] = inputs[CV_INPUT].getVoltage();
 						propagateCVtoTied(seqIndexEdit, stepIndexEdit);
 					}
@@ -991,6 +1058,7 @@ struct PhraseSeq32 : Module {
 			}
 			if (stepPressed != -1) {
 				if (displayState == DISP_LENGTH) {
+					snapshot.markDirty();
 					if (editingSequence)
 						sequences[seqIndexEdit].setLength((stepPressed % (16 * stepConfig)) + 1);
 					else
@@ -1068,6 +1136,7 @@ struct PhraseSeq32 : Module {
 			if (deltaKnob != 0) {
 				if (abs(deltaKnob) <= 3) {// avoid discontinuous step (initialize for example)
 					// any changes in here should may also require right click behavior to be updated in the knob's onMouseDown()
+					snapshot.markDirty();
 					if (editingPpqn != 0) {
 						pulsesPerStep = indexToPps(ppsToIndex(pulsesPerStep) + deltaKnob);// indexToPps() does clamping
 						editingPpqn = (long) (editGateLengthTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
@@ -1160,6 +1229,7 @@ struct PhraseSeq32 : Module {
 						if (attributes[seqIndexEdit][stepIndexEdit].getTied())
 							tiedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
 						else {			
+							snapshot.markDirty();
 							cv[seqIndexEdit][stepIndexEdit] = applyNewOct(cv[seqIndexEdit][stepIndexEdit], 3 - i);
 							propagateCVtoTied(seqIndexEdit, stepIndexEdit);
 							editingGate = (unsigned long) (gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
@@ -1174,6 +1244,7 @@ struct PhraseSeq32 : Module {
 			// Keyboard buttons
 			if (keyTrigger.process(pkInfo.gate)) {
 				if (editingSequence) {
+					snapshot.markDirty();
 					displayState = DISP_NORMAL;
 					if (editingGateLength != 0l) {
 						int newMode = keyIndexToGateMode(pkInfo.key, pulsesPerStep);
@@ -1233,12 +1304,14 @@ struct PhraseSeq32 : Module {
 			if (gate1Trigger.process(params[GATE1_PARAM].getValue() + (expanderPresent ? messagesFromExpander[0] : 0.0f))) {
 				if (editingSequence) {
 					displayState = DISP_NORMAL;
+					snapshot.markDirty();
 					attributes[seqIndexEdit][stepIndexEdit].toggleGate1();
 				}
 			}		
 			if (gate1ProbTrigger.process(params[GATE1_PROB_PARAM].getValue())) {
 				if (editingSequence) {
 					displayState = DISP_NORMAL;
+					snapshot.markDirty();
 					if (attributes[seqIndexEdit][stepIndexEdit].getTied())
 						tiedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
 					else
@@ -1248,12 +1321,14 @@ struct PhraseSeq32 : Module {
 			if (gate2Trigger.process(params[GATE2_PARAM].getValue() + (expanderPresent ? messagesFromExpander[1] : 0.0f))) {
 				if (editingSequence) {
 					displayState = DISP_NORMAL;
+					snapshot.markDirty();
 					attributes[seqIndexEdit][stepIndexEdit].toggleGate2();
 				}
 			}		
 			if (slideTrigger.process(params[SLIDE_BTN_PARAM].getValue() + (expanderPresent ? messagesFromExpander[3] : 0.0f))) {
 				if (editingSequence) {
 					displayState = DISP_NORMAL;
+					snapshot.markDirty();
 					if (attributes[seqIndexEdit][stepIndexEdit].getTied())
 						tiedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
 					else
@@ -1263,6 +1338,7 @@ struct PhraseSeq32 : Module {
 			if (tiedTrigger.process(params[TIE_PARAM].getValue() + (expanderPresent ? messagesFromExpander[2] : 0.0f))) {
 				if (editingSequence) {
 					displayState = DISP_NORMAL;
+					snapshot.markDirty();
 					if (attributes[seqIndexEdit][stepIndexEdit].getTied()) {
 						deactivateTiedStep(seqIndexEdit, stepIndexEdit);
 					}
@@ -1295,7 +1371,7 @@ struct PhraseSeq32 : Module {
 		
 		// Clock
 		if (running && clockIgnoreOnReset == 0l) {
-			if (clockTrigger.process(inputs[CLOCK_INPUT].getVoltage())) {
+			if (busClock ? clockBusReader.processClock(&clockTrigger) : clockTrigger.process(inputs[CLOCK_INPUT].getVoltage())) {
 				ppqnCount++;
 				if (ppqnCount >= pulsesPerStep)
 					ppqnCount = 0;
@@ -1363,9 +1439,16 @@ struct PhraseSeq32 : Module {
 			}
 			clockPeriod++;
 		}
+		else if (busClock) {
+			clockBusReader.syncClock();
+		}
 		
 		// Reset
-		if (resetTrigger.process(inputs[RESET_INPUT].getVoltage() + params[RESET_PARAM].getValue())) {
+		bool resetTrigged = resetTrigger.process((busClock ? 0.0f : inputs[RESET_INPUT].getVoltage()) + params[RESET_PARAM].getValue());
+		if (busClock && clockBusReader.processReset()) {
+			resetTrigged = true;
+		}
+		if (resetTrigged) {
 			initRun();// must be before SEQCV_INPUT below
 			resetLight = 1.0f;
 			displayState = DISP_NORMAL;
@@ -1687,6 +1770,9 @@ struct PhraseSeq32 : Module {
 				
 		if (clockIgnoreOnReset > 0l)
 			clockIgnoreOnReset--;
+		
+		// publish the edits of the song and sequences for dataToJson(), when there are any (see StateSnapshot)
+		processSnapshot();
 	}// process()
 	
 
@@ -1829,6 +1915,7 @@ struct PhraseSeq32Widget : ModuleWidget {
 						}
 
 					}
+					module->snapshot.markDirtyFromUi();
 				}				
 				
 				lastTime = currentTime;
@@ -1976,6 +2063,8 @@ struct PhraseSeq32Widget : ModuleWidget {
 		
 		menu->addChild(createBoolPtrMenuItem("Reset on run", "", &module->resetOnRun));
 
+		createClockBusMenu(menu, &module->clockBusReader);
+
 		menu->addChild(createSubmenuItem("Retrigger gates on reset", "", [=](Menu* menu) {
 			menu->addChild(createCheckMenuItem("No", "",
 				[=]() {return module->retrigGatesOnReset == RGOR_NONE;},
@@ -2072,6 +2161,7 @@ struct PhraseSeq32Widget : ModuleWidget {
 						module->phrase[module->phraseIndexEdit] = 0;
 					}
 				}
+				module->snapshot.markDirtyFromUi();
 			}
 			ParamWidget::onDoubleClick(e);
 		}
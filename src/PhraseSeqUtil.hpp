@@ -46,7 +46,7 @@ class StepAttributes {
 	inline bool getTied() {return (attributes & ATT_MSK_TIED) != 0;}
 	inline int getGate1Mode() {return (attributes & ATT_MSK_GATE1MODE) >> gate1ModeShift;}
 	inline int getGate2Mode() {return (attributes & ATT_MSK_GATE2MODE) >> gate2ModeShift;}
-	inline unsigned short getAttribute() {return attributes;}
+	inline unsigned short getAttribute() const {return attributes;}
 
 	inline void setGate1(bool gate1State) {attributes &= ~ATT_MSK_GATE1; if (gate1State) attributes |= ATT_MSK_GATE1;}
 	inline void setGate1P(bool gate1PState) {attributes &= ~ATT_MSK_GATE1P; if (gate1PState) attributes |= ATT_MSK_GATE1P;}
@@ -104,7 +104,7 @@ class SeqAttributes {
 			ret *= -1;
 		return ret;
 	}
-	inline unsigned long getSeqAttrib() {return attributes;}
+	inline unsigned long getSeqAttrib() const {return attributes;}
 	
 	inline void setLength(int length) {attributes &= ~SEQ_MSK_LENGTH; attributes |= ((unsigned long)length);}
 	inline void setRunMode(int runMode) {attributes &= ~SEQ_MSK_RUNMODE; attributes |= (((unsigned long)runMode) << runModeShift);}
@@ -15,6 +15,81 @@
 
 
 
+// Walker/Vose alias table, to draw from a discrete distribution of N weights with one random number
+template<int N>
+struct AliasTable {
+	float probs[N];// probability of keeping the bucket itself, else its alias is drawn
+	uint8_t aliases[N];
+	bool empty;// when all weights are null, in which case sample() returns N
+	
+	void build(const float* weights) {
+		float total = 0.0f;
+		int maxi = 0;
+		for (int i = 0; i < N; i++) {
+			total += weights[i];
+			if (weights[i] > weights[maxi]) {
+				maxi = i;
+			}
+		}
+		empty = (total <= 0.0f);
+		if (empty) {
+			return;
+		}
+
+		float scaled[N];
+		int smalls[N];
+		int larges[N];
+		int numSmalls = 0;
+		int numLarges = 0;
+		for (int i = 0; i < N; i++) {
+			scaled[i] = weights[i] * (float)N / total;
+			if (scaled[i] < 1.0f) {
+				smalls[numSmalls++] = i;
+			}
+			else {
+				larges[numLarges++] = i;
+			}
+		}
+		while (numSmalls > 0 && numLarges > 0) {
+			int sm = smalls[--numSmalls];
+			int lg = larges[--numLarges];
+			probs[sm] = scaled[sm];
+			aliases[sm] = lg;
+			scaled[lg] = (scaled[lg] + scaled[sm]) - 1.0f;
+			if (scaled[lg] < 1.0f) {
+				smalls[numSmalls++] = lg;
+			}
+			else {
+				larges[numLarges++] = lg;
+			}
+		}
+		// leftovers are only due to rounding errors and are (almost) full buckets
+		while (numLarges > 0) {
+			int lg = larges[--numLarges];
+			probs[lg] = 1.0f;
+			aliases[lg] = lg;
+		}
+		while (numSmalls > 0) {
+			int sm = smalls[--numSmalls];
+			// a null weight must never be drawn, so its bucket always redirects to the largest weight
+			probs[sm] = (weights[sm] > 0.0f ? 1.0f : 0.0f);
+			aliases[sm] = (weights[sm] > 0.0f ? sm : maxi);
+		}
+	}
+	
+	int sample(float dice) {
+		// dice must be in [0.0f : 1.0f[
+		if (empty) {
+			return N;
+		}
+		float x = dice * (float)N;
+		int i = std::min((int)x, N - 1);
+		return (x - (float)i) < probs[i] ? i : aliases[i];
+	}
+};
+
+
+
 class ProbKernel {
 	public: 
 	
@@ -27,9 +102,41 @@ class ProbKernel {
 	float noteAnchors[12] = {};// [0.0f : 1.0f];  0.5f=oct"4"=0V, 1.0f=oct"4+MAX_ANCHOR_DELTA"; not quantized
 	float noteRanges[7] = {};// [0] is -3, [6] is +3
 	
+	// alias tables used by calcRandomCv(), rebuilt only when their source values change
+	struct OctTable {
+		float offset;
+		float squash;
+		float overlap;
+		bool valid;
+		AliasTable<7> table;
+	};
+	AliasTable<13> noteTable;// [12] is the probability of skipping a note (when sum of probs < 1)
+	std::atomic<uint32_t> noteProbsGen{0};// incremented each time noteProbs[] changes, possibly on the UI thread
+	uint32_t noteTableGen = 0xFFFFFFFF;// noteProbsGen that noteTable was built from
+	OctTable octTables[PORT_MAX_CHANNELS];// per poly chan, since offset and squash are per chan
+	
+	
+	void invalidateOctTables() {
+		for (int c = 0; c < PORT_MAX_CHANNELS; c++) {
+			octTables[c].valid = false;
+		}
+	}
+	
 	
 	public:
 	
+	ProbKernel() {
+		invalidateOctTables();
+	}
+	
+	
+	void invalidateNoteTable() {
+		// must be called when noteProbs[] is written to externally (see getNoteProbArray())
+		// a generation count instead of a flag, so that a change made while the table is being built is not lost
+		noteProbsGen.fetch_add(1);
+	}
+	
+	
 	void reset() {
 		for (int i = 0; i < 12; i++) {
 			noteProbs[i] = 0.0f;
@@ -43,6 +150,9 @@ class ProbKernel {
 			noteRanges[i] = 0.0f;
 		}
 		noteRanges[3] = 1.0f;
+		
+		invalidateNoteTable();
+		invalidateOctTables();
 	}
 	
 	
@@ -112,6 +222,9 @@ class ProbKernel {
 				}
 			}
 		}
+		
+		invalidateNoteTable();
+		invalidateOctTables();
 	}
 	
 	
@@ -140,6 +253,7 @@ class ProbKernel {
 				}
 			}
 		}
+		invalidateNoteTable();
 	}
 	void setNoteAnchor(int note, float anch, bool withSymmetry) {
 		if (withSymmetry) {
@@ -161,6 +275,7 @@ class ProbKernel {
 		if (withSymmetry) {
 			noteRanges[6 - note7] = range;
 		}
+		invalidateOctTables();
 	}
 	
 	
@@ -212,27 +327,27 @@ class ProbKernel {
 	}
 	
 	
-	float calcRandomCv(float offset, float squash, float density, float overlap) {
-		// not optimized for audio rate
+	float calcRandomCv(int chan, RandomStream* rng, float offset, float squash, float density, float overlap) {
 		// returns a cv value or IDEM_CV when a note gets randomly skipped (only possible when sum of probs < 1)
 		
 		// generate a (base) note according to noteProbs (base note only, C4=0 to B4)
-		float cumulProbs[12];
-		cumulProbs[0] = noteProbs[0];
-		for (int i = 1; i < 12; i++) {
-			cumulProbs[i] = cumulProbs[i - 1] + noteProbs[i];
-		}
-		
-		float diceNote = random::uniform() * std::max(cumulProbs[11], 1.0f);		
-		int note = 0;
-		for (; note < 12; note++) {
-			if (diceNote < cumulProbs[note]) {
-				break;
+		uint32_t gen = noteProbsGen.load();
+		if (gen != noteTableGen) {
+			// gen is read before noteProbs[], so a change made during the build will cause another build
+			noteTableGen = gen;
+			float noteWeights[13];
+			float cumulProbTotal = 0.0f;
+			for (int i = 0; i < 12; i++) {
+				noteWeights[i] = noteProbs[i];
+				cumulProbTotal += noteProbs[i];
 			}
+			noteWeights[12] = std::max(1.0f - cumulProbTotal, 0.0f);
+			noteTable.build(noteWeights);
 		}
+		int note = noteTable.sample(rng->uniform());// 12 when skipped
 		
 		float cv;
-		float diceDensity = random::uniform();
+		float diceDensity = rng->uniform();
 		if (note < 12 && diceDensity < density) {
 			// base note
 			cv = ((float)note) / 12.0f;
@@ -241,23 +356,19 @@ class ProbKernel {
 			cv += anchorToOct(noteAnchors[note]);
 			
 			// offset and squash
-			float noteRangesMod[7] = {};
-			calcOffsetAndSquash(noteRangesMod, offset, squash, overlap);
-			
-			// probabilistically transpose note according to octave ranges
-			float cumulRanges[7];
-			cumulRanges[0] = noteRangesMod[0];
-			for (int i = 1; i < 7; i++) {
-				cumulRanges[i] = cumulRanges[i - 1] + noteRangesMod[i];
+			OctTable* octTable = &octTables[chan];
+			if (!octTable->valid || octTable->offset != offset || octTable->squash != squash || octTable->overlap != overlap) {
+				float noteRangesMod[7] = {};
+				calcOffsetAndSquash(noteRangesMod, offset, squash, overlap);
+				octTable->table.build(noteRangesMod);
+				octTable->offset = offset;
+				octTable->squash = squash;
+				octTable->overlap = overlap;
+				octTable->valid = true;
 			}
 			
-			float diceOct = random::uniform() * cumulRanges[6];
-			int oct = 0;
-			for (; oct < 7; oct++) {
-				if (diceOct < cumulRanges[oct]) {
-					break;
-				}
-			}
+			// probabilistically transpose note according to octave ranges
+			int oct = octTable->table.sample(rng->uniform());// 7 when all ranges are null
 			if (oct < 7) {
 				oct -= 3;
 				cv += (float)oct;
@@ -284,6 +395,7 @@ class ProbKernel {
 			}
 			noteProbs[0] = noteProbB;
 			noteAnchors[0] = noteAnchorB;
+			invalidateNoteTable();
 		}
 	}
 	
@@ -300,6 +412,7 @@ class ProbKernel {
 			}
 			noteProbs[11] = noteProbC;
 			noteAnchors[11] = noteAnchorC;
+			invalidateNoteTable();
 		}
 	}
 	
@@ -580,6 +693,7 @@ struct ProbKey : Module {
 	// Need to save, no reset
 	int panelTheme;
 	float panelContrast;
+	uint32_t seed;// of the random streams in rngs[]
 	
 	// Need to save, with reset
 	int editMode;
@@ -599,6 +713,8 @@ struct ProbKey : Module {
 	bool infoTracerLockedStep;// only valid when infoTracer != 0
 
 	// No need to save, no reset
+	RandomStream rngs[PORT_MAX_CHANNELS];// one per poly chan
+	uint32_t rngsSeed;// seed currently used by rngs[], to detect a new seed from the menu
 	RefreshCounter refresh;
 	PianoKeyInfo pkInfo;
 	Trigger modeTriggers[3];
@@ -735,12 +851,21 @@ struct ProbKey : Module {
 
 		pkInfo.showMarks = 1;
 		
+		seed = random::u32();
 		onReset();
 		
 		loadThemeAndContrastFromDefault(&panelTheme, &panelContrast);
 	}
 
 
+	void seedRandomStreams() {
+		for (int c = 0; c < PORT_MAX_CHANNELS; c++) {
+			rngs[c].seed(seed, c);
+		}
+		rngsSeed = seed;
+	}
+	
+	
 	void onReset() override final {
 		editMode = MODE_PROB;
 		overlap = 0.5f;// must be 0 to 1
@@ -763,6 +888,7 @@ struct ProbKey : Module {
 		resetNonJson();
 	}
 	void resetNonJson() {
+		seedRandomStreams();
 		dispManager.reset();
 		infoTracer = 0;
 		infoTracerLockedStep = false;
@@ -778,7 +904,7 @@ struct ProbKey : Module {
 			float squash = getSquash(c);
 			float density = getDensity(c);
 			for (int i = 0; i < OutputKernel::MAX_LENGTH; i++) {
-				float newCv = probKernels[index].calcRandomCv(offset, squash, density, overlap);
+				float newCv = probKernels[index].calcRandomCv(c, &rngs[c], offset, squash, density, overlap);
 				outputKernels[c].stepWithInsertNew(newCv, OutputKernel::MAX_LENGTH - 1);
 			}
 		}
@@ -794,6 +920,9 @@ struct ProbKey : Module {
 		// panelContrast
 		json_object_set_new(rootJ, "panelContrast", json_real(panelContrast));
 
+		// seed
+		json_object_set_new(rootJ, "seed", json_integer(seed));
+
 		// editMode
 		json_object_set_new(rootJ, "editMode", json_integer(editMode));
 
@@ -861,6 +990,11 @@ struct ProbKey : Module {
 		if (panelContrastJ)
 			panelContrast = json_number_value(panelContrastJ);
 
+		// seed
+		json_t *seedJ = json_object_get(rootJ, "seed");
+		if (seedJ)
+			seed = (uint32_t)json_integer_value(seedJ);
+
 		// editMode
 		json_t *editModeJ = json_object_get(rootJ, "editMode");
 		if (editModeJ) {
@@ -1003,6 +1137,11 @@ struct ProbKey : Module {
 		//********** Buttons, knobs, switches and inputs **********
 		
 		if (refresh.processInputs()) {
+			// new random seed from menu
+			if (seed != rngsSeed) {
+				seedRandomStreams();
+			}
+			
 			// poly cable sizes
 			outputs[CV_OUTPUT].setChannels(inputs[GATE_INPUT].getChannels());
 			outputs[GATE_OUTPUT].setChannels(inputs[GATE_INPUT].getChannels());
@@ -1117,7 +1256,7 @@ struct ProbKey : Module {
 					isLockedStep = true;
 				}
 				// knob lock has lower precedence, since it has no special lock memory (it uses the output register)	
-				else if (getLock() > random::uniform()) {
+				else if (getLock() > rngs[c].uniform()) {
 					// recycle CV
 					outputKernels[c].stepWithKeepOld(length);
 					isLockedStep = true;
@@ -1129,7 +1268,7 @@ struct ProbKey : Module {
 						outputKernels[c].stepWithCopy(length);
 					}
 					else {
-						float newCv = probKernels[index].calcRandomCv(getOffset(c), getSquash(c), getDensity(c), overlap);
+						float newCv = probKernels[index].calcRandomCv(c, &rngs[c], getOffset(c), getSquash(c), getDensity(c), overlap);
 						outputKernels[c].stepWithInsertNew(newCv, length);
 					}
 				}
@@ -1394,9 +1533,10 @@ struct ProbKeyWidget : ModuleWidget {
 			// }
 		// };
 		struct NormalizedFloat12PasteItem : MenuItem {
-			float* floats12;
+			ProbKernel* probKernel;
 			void onAction(const event::Action &e) override {
-				NormalizedFloat12Paste(floats12);
+				NormalizedFloat12Paste(probKernel->getNoteProbArray());
+				probKernel->invalidateNoteTable();
 			}
 		};
 		// float* floats12;
@@ -1448,7 +1588,7 @@ struct ProbKeyWidget : ModuleWidget {
 		menu->addChild(interopSeqItem);
 
 		NormalizedFloat12Item::NormalizedFloat12PasteItem *float12PasteItem = createMenuItem<NormalizedFloat12Item::NormalizedFloat12PasteItem>("Paste weights from Adaptive Quantizer", "");
-		float12PasteItem->floats12 = module->probKernels[module->getIndex()].getNoteProbArray();
+		float12PasteItem->probKernel = &(module->probKernels[module->getIndex()]);
 		menu->addChild(float12PasteItem);		
 
 		// NormalizedFloat12Item *probs12Item = createMenuItem<NormalizedFloat12Item>("To/From Adaptive Quantizer", RIGHT_ARROW);
@@ -1458,6 +1598,8 @@ struct ProbKeyWidget : ModuleWidget {
 		menu->addChild(new MenuSeparator());
 		menu->addChild(createMenuLabel("Settings"));
 		
+		createRandomSeedMenu(menu, &(module->seed), nullptr);
+		
 		menu->addChild(createSubmenuItem("Manual step lock", "", [=](Menu* menu) {
 			menu->addChild(createMenuItem("Clear all locks", "",
 				[=]() {if (module->perIndexManualLocks != 0) {
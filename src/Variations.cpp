@@ -33,10 +33,14 @@ struct Variations : Module {
 		CLAMP_LIGHT,
 		NUM_LIGHTS
 	};
+	
+	// Constants
+	enum DistIds {DIST_PANEL, DIST_TRIANGULAR, NUM_DISTS};// DIST_PANEL is normal or uniform according to the mode switch
 		
 	// Need to save, no reset
 	int panelTheme;
 	float panelContrast;
+	uint32_t seed;// of the random streams in rngs[]
 	
 	// Need to save, with reset
 	float cvHold[PORT_MAX_CHANNELS];
@@ -44,11 +48,15 @@ struct Variations : Module {
 	float highClamp;
 	bool lowRangeSpread;
 	bool lowRangeOffset;
+	int distribution;
+	bool quantizeNoise;// to semitones
 
 	// No need to save, with reset
 	uint16_t clamped;// bit 0 is chan 0
 	
 	// No need to save, no reset
+	RandomStream4 rngs[PORT_MAX_CHANNELS / 4];// one lane per poly chan
+	uint32_t rngsSeed;// seed currently used by rngs[], to detect a new seed from the menu
 	RefreshCounter refresh;
 	Trigger gateTriggers[PORT_MAX_CHANNELS];
 
@@ -57,8 +65,19 @@ struct Variations : Module {
 		return params[MODE_PARAM].getValue() < 0.5f;
 	}
 	
-	float getNewNoise() {
-		float _noise = isNormalDist() ? (0.2f * random::normal()) : (random::uniform() * 2.0f - 1.0f);
+	simd::float_4 getNewNoise(int c, int chanMask) {
+		// noise for channels c to c + 3 (c must be a multiple of 4), only the random streams of the channels set in chanMask 
+		//   advance (bit i is chan c + i), so that each channel's noise only depends on its own gates
+		simd::float_4 _noise;
+		if (distribution == DIST_TRIANGULAR) {
+			_noise = rngs[c >> 2].triangular(chanMask);
+		}
+		else if (isNormalDist()) {
+			_noise = 0.2f * rngs[c >> 2].normal(chanMask);
+		}
+		else {
+			_noise = rngs[c >> 2].uniform(chanMask) * 2.0f - 1.0f;
+		}
 		// all calibrated for +-1 V noise
 		return _noise * 5.0f;
 		// returns a +- 5V noise without clamping
@@ -103,12 +122,21 @@ struct Variations : Module {
 		configBypass(CV_INPUT, CV_OUTPUT);
 		configBypass(GATE_INPUT, GATE_OUTPUT);
 
+		seed = random::u32();
 		onReset();
 		
 		loadThemeAndContrastFromDefault(&panelTheme, &panelContrast);
 	}
 
 	
+	void seedRandomStreams() {
+		for (int c = 0; c < PORT_MAX_CHANNELS; c += 4) {
+			rngs[c >> 2].seed(seed, c);
+		}
+		rngsSeed = seed;
+	}
+	
+	
 	void onReset() override final {
 		for (int c = 0; c < PORT_MAX_CHANNELS; c++) {
 			cvHold[c] = 0.0f;
@@ -117,9 +145,12 @@ struct Variations : Module {
 		highClamp = 10.0f;
 		lowRangeSpread = false;
 		lowRangeOffset = false;
+		distribution = DIST_PANEL;
+		quantizeNoise = false;
 		resetNonJson();
 	}
 	void resetNonJson() {
+		seedRandomStreams();
 		clamped = 0;
 	}
 	
@@ -137,6 +168,9 @@ struct Variations : Module {
 		// panelContrast
 		json_object_set_new(rootJ, "panelContrast", json_real(panelContrast));
 
+		// seed
+		json_object_set_new(rootJ, "seed", json_integer(seed));
+
 		// cvHold
 		json_t *cvHoldJ = json_array();
 		for (int c = 0; c < PORT_MAX_CHANNELS; c++) {
@@ -156,6 +190,12 @@ struct Variations : Module {
 		// lowRangeOffset
 		json_object_set_new(rootJ, "lowRangeOffset", json_boolean(lowRangeOffset));
 		
+		// distribution
+		json_object_set_new(rootJ, "distribution", json_integer(distribution));
+		
+		// quantizeNoise
+		json_object_set_new(rootJ, "quantizeNoise", json_boolean(quantizeNoise));
+		
 		return rootJ;
 	}
 
@@ -170,6 +210,11 @@ struct Variations : Module {
 		json_t *panelContrastJ = json_object_get(rootJ, "panelContrast");
 		if (panelContrastJ)
 			panelContrast = json_number_value(panelContrastJ);
+
+		// seed
+		json_t *seedJ = json_object_get(rootJ, "seed");
+		if (seedJ)
+			seed = (uint32_t)json_integer_value(seedJ);
 		
 		// cvHold
 		json_t *cvHoldJ = json_object_get(rootJ, "cvHold");
@@ -202,6 +247,16 @@ struct Variations : Module {
 		if (lowRangeOffsetJ)
 			lowRangeOffset = json_is_true(lowRangeOffsetJ);
 		
+		// distribution
+		json_t *distributionJ = json_object_get(rootJ, "distribution");
+		if (distributionJ)
+			distribution = clamp((int)json_integer_value(distributionJ), 0, NUM_DISTS - 1);
+		
+		// quantizeNoise
+		json_t *quantizeNoiseJ = json_object_get(rootJ, "quantizeNoise");
+		if (quantizeNoiseJ)
+			quantizeNoise = json_is_true(quantizeNoiseJ);
+		
 		resetNonJson();
 	}
 
@@ -213,33 +268,57 @@ struct Variations : Module {
 		}
 		
 		if (refresh.processInputs()) {
+			// new random seed from menu
+			if (seed != rngsSeed) {
+				seedRandomStreams();
+			}
+			
 			outputs[GATE_OUTPUT].setChannels(numChan);
 			outputs[CV_OUTPUT].setChannels(numChan);
 		}// userInputs refresh
 				
-		for (int c = 0; c < numChan; c++) {
-			// gate trigger
-			if (gateTriggers[c].process(inputs[GATE_INPUT].getVoltage(c)) || !inputs[GATE_INPUT].isConnected()) {
-				cvHold[c] = inputs[CV_INPUT].getVoltage(c);
-				// spread and offset
-				cvHold[c] += getSpreadValue(c) * getNewNoise();
-				cvHold[c] += getOffsetValue(c);
-				// clamper and its led
-				if (cvHold[c] < lowClamp) {
-					clamped |= (0x1 << c);
-					cvHold[c] = lowClamp;
+		bool gateConnected = inputs[GATE_INPUT].isConnected();
+		for (int c = 0; c < numChan; c += 4) {
+			// gate triggers (bit i is chan c + i)
+			int newHolds = 0;
+			for (int i = 0; i < 4 && c + i < numChan; i++) {
+				if (gateTriggers[c + i].process(inputs[GATE_INPUT].getVoltage(c + i)) || !gateConnected) {
+					newHolds |= (0x1 << i);
 				}
-				else if (cvHold[c] > highClamp) {
-					clamped |= (0x1 << c);
-					cvHold[c] = highClamp;
+			}
+			if (newHolds != 0) {
+				// spread and offset, four channels at a time
+				float spread[4];
+				float offset[4];
+				for (int i = 0; i < 4; i++) {
+					spread[i] = getSpreadValue(c + i);
+					offset[i] = getOffsetValue(c + i);
 				}
-				else {
-					clamped &= ~(0x1 << c);
+				simd::float_4 variation = simd::float_4::load(spread) * getNewNoise(c, newHolds);
+				if (quantizeNoise) {
+					variation = simd::round(variation * 12.0f) / 12.0f;
+				}
+				simd::float_4 cv = inputs[CV_INPUT].getVoltageSimd<simd::float_4>(c) + variation + simd::float_4::load(offset);
+				// clamper and its led
+				simd::float_4 cvClamped = simd::ifelse(cv < lowClamp, lowClamp, simd::ifelse(cv > highClamp, highClamp, cv));
+				int clampMask = simd::movemask(cvClamped != cv);
+				for (int i = 0; i < 4; i++) {
+					if ((newHolds & (0x1 << i)) != 0) {
+						cvHold[c + i] = cvClamped[i];
+						if ((clampMask & (0x1 << i)) != 0) {
+							clamped |= (0x1 << (c + i));
+						}
+						else {
+							clamped &= ~(0x1 << (c + i));
+						}
+					}
 				}
 			}
 			// outputs
-			outputs[CV_OUTPUT].setVoltage(cvHold[c], c);
-			outputs[GATE_OUTPUT].setVoltage(inputs[GATE_INPUT].getVoltage(c), c);// thru but with same sample delay as CV
+			for (int i = 0; i < 4 && c + i < numChan; i++) {
+				outputs[CV_OUTPUT].setVoltage(cvHold[c + i], c + i);
+				outputs[GATE_OUTPUT].setVoltage(inputs[GATE_INPUT].getVoltage(c + i), c + i);// thru but with same sample delay as CV
+			}
 		}
 		
 		// lights
@@ -298,9 +377,24 @@ struct VariationsWidget : ModuleWidget {
 		menu->addChild(new MenuSeparator());
 		menu->addChild(createMenuLabel("Settings"));
 		
+		createRandomSeedMenu(menu, &(module->seed), nullptr);
+		
 		menu->addChild(createBoolPtrMenuItem("Low range spread (1/5)", "", &module->lowRangeSpread));
 		menu->addChild(createBoolPtrMenuItem("Low range offset (1/3)", "", &module->lowRangeOffset));
 		
+		menu->addChild(createSubmenuItem("Noise distribution", "", [=](Menu* menu) {
+			menu->addChild(createCheckMenuItem("Normal or uniform (panel switch)", "",
+				[=]() {return module->distribution == Variations::DIST_PANEL;},
+				[=]() {module->distribution = Variations::DIST_PANEL;}
+			));
+			menu->addChild(createCheckMenuItem("Triangular", "",
+				[=]() {return module->distribution == Variations::DIST_TRIANGULAR;},
+				[=]() {module->distribution = Variations::DIST_TRIANGULAR;}
+			));
+		}));
+		
+		menu->addChild(createBoolPtrMenuItem("Quantize variations to semitones", "", &module->quantizeNoise));
+		
 		CvClampSlider *maxCvSlider = new CvClampSlider(&module->highClamp, true);
 		maxCvSlider->box.size.x = 200.0f;
 		menu->addChild(maxCvSlider);
@@ -0,0 +1,154 @@
+//***********************************************************************************************
+//Impromptu Modular: Modules for VCV Rack by Marc Boulé
+//
+//Unit tests of the clock classes shared by Clocked and Clkd (see ../src/ClockedCommon.hpp)
+//See ./LICENSE.md for all licenses
+//***********************************************************************************************
+
+// Usage: ClockedTest (returns 0 when all tests pass)
+//   ClockDelay: the delayed output must be the input shifted by N samples
+//   FrameClock: 24 hours at 48 and 192 kHz, the clock edges must not drift from their ideal sample position
+//     (runs for a few minutes)
+
+
+#include "../src/ClockedCommon.hpp"
+#include <cstdio>
+#include <random>
+
+
+static int failures = 0;
+
+static void check(bool cond, const char* testName, const char* what, int64_t n) {
+	if (!cond) {
+		if (failures < 20) {
+			std::printf("FAIL %s: %s at sample %lld\n", testName, what, (long long)n);
+		}
+		failures++;
+	}
+}
+
+
+
+// ClockDelay
+
+static void testClockDelay() {
+	// pulse train with random high and low widths, and the pulse values 1 and 2 of Clocked's double periods
+	const int64_t numSamples = 200000;
+	std::vector<int> in(numSamples);
+	std::minstd_rand rng(13);
+	int64_t n = 0;
+	int value = 1;
+	while (n < numSamples) {
+		int64_t high = 1 + rng() % 200;
+		int64_t low = 1 + rng() % 200;
+		for (int64_t i = 0; i < high + low && n < numSamples; i++, n++) {
+			in[n] = i < high ? value : 0;
+		}
+		value = 3 - value;
+	}
+
+	// delays up to 9000 samples stay well below the 128 pulses that the ring buffer holds
+	for (long delaySamples : {0l, 1l, 2l, 7l, 64l, 500l, 4321l, 9000l}) {
+		for (bool resetHigh : {false, true}) {
+			ClockDelay delay;
+			delay.reset(resetHigh);
+			int64_t errors = 0;
+			int64_t firstError = -1;
+			for (int64_t n = 0; n < numSamples; n++) {
+				delay.write(in[n]);
+				bool out = delay.read(delaySamples);
+				// before the first delayed edge, the output stays at its reset level
+				bool expected = (n >= delaySamples) ? (in[n - delaySamples] != 0) : resetHigh;
+				if (out != expected) {
+					if (firstError < 0) {
+						firstError = n;
+					}
+					errors++;
+				}
+			}
+			std::printf("ClockDelay delay %5ld reset %s: %lld errors\n", delaySamples, resetHigh ? "high" : "low ", (long long)errors);
+			check(errors == 0, "ClockDelay", "output is not the input shifted by the delay", firstError);
+		}
+	}
+}
+
+
+
+// FrameClock
+
+static void testFrameClockDrift(double sampleRate) {
+	// master at 133 BPM (a length is a double period) and a x3.5 sub-clock (ratioDoubled = 7, 7 lengths per master length),
+	//   each with two pulses per length at 0 and half the length, as in Clocked without swing
+	// the n-th rising edge must stay near its ideal position n * idealEdgeNum / idealEdgeDen, in samples, however long
+	//   the clocks run: an edge is on the first sample at or after its position, plus less than one sample of rounding
+	//   for the master, and the sub-clock also starts each master length without the master's fractional remainder
+	const int64_t bpm = 133;
+	const int64_t sampleRateInt = (int64_t)sampleRate;
+	const double sampleTime = 1.0 / sampleRate;
+	const double masterLength = 120.0 / (double)bpm;
+	const int64_t numSamples = sampleRateInt * 24 * 3600;
+
+	FrameClock master;
+	FrameClock sub;
+	sub.setSyncSrc(&master);
+	FrameClock* clocks[2] = {&master, &sub};
+	const int64_t idealEdgeNum[2] = {60 * sampleRateInt, 120 * sampleRateInt};// half a length, in samples: 60 * sr / bpm and 120 * sr / (bpm * 7)
+	const int64_t idealEdgeDen[2] = {bpm, bpm * 7};
+	const int64_t maxError[2] = {1, 2};// in samples
+	int64_t edgeCounts[2] = {0, 0};
+	int64_t maxErrors[2] = {0, 0};// in samples times idealEdgeDen
+	bool lastHighs[2] = {false, false};
+
+	for (int64_t n = 0; n < numSamples; n++) {
+		if (master.isReset()) {
+			master.setup(masterLength, 1, sampleTime, 1, 1);
+			master.start();
+		}
+		if (sub.isReset()) {
+			sub.setup(0.0, 7, sampleTime, 2, 7);
+			sub.start();
+		}
+		for (int c = 0; c < 2; c++) {
+			if (!clocks[c]->edgesUpToDate(0.0f, 0.5f)) {
+				double length = clocks[c]->getLength();
+				clocks[c]->setEdges(length * 0.25, length * 0.5, length * 0.75, 0.0f, 0.5f);
+			}
+			bool high = clocks[c]->getHigh() != 0;
+			if (high && !lastHighs[c]) {
+				int64_t error = n * idealEdgeDen[c] - edgeCounts[c] * idealEdgeNum[c];
+				maxErrors[c] = std::max(maxErrors[c], std::abs(error));
+				check(error >= 0 && error <= maxError[c] * idealEdgeDen[c], c == 0 ? "FrameClock master" : "FrameClock sub", "edge drifted from its ideal position", n);
+				edgeCounts[c]++;
+			}
+			lastHighs[c] = high;
+		}
+		master.stepClock();
+		sub.stepClock();
+	}
+
+	// the edges that are exactly at the end of the 24 hours are not seen
+	int64_t expectedCounts[2] = {
+		(numSamples * idealEdgeDen[0] + idealEdgeNum[0] - 1) / idealEdgeNum[0],
+		(numSamples * idealEdgeDen[1] + idealEdgeNum[1] - 1) / idealEdgeNum[1]
+	};
+	for (int c = 0; c < 2; c++) {
+		std::printf("FrameClock %s at %.0f Hz over 24 h: %lld edges (expected %lld), max error %.6f samples\n", c == 0 ? "master" : "sub   ", 
+			sampleRate, (long long)edgeCounts[c], (long long)expectedCounts[c], (double)maxErrors[c] / (double)idealEdgeDen[c]);
+		check(edgeCounts[c] == expectedCounts[c], c == 0 ? "FrameClock master" : "FrameClock sub", "wrong number of edges", numSamples);
+	}
+}
+
+
+
+int main(int argc, char* argv[]) {
+	testClockDelay();
+	testFrameClockDrift(48000.0);
+	testFrameClockDrift(192000.0);
+
+	if (failures > 0) {
+		std::printf("%d failures\n", failures);
+		return 1;
+	}
+	std::printf("All tests passed\n");
+	return 0;
+}